@@ -23,21 +23,84 @@
 
 // Do not include this file directly.  It is included by base/io-funcs.h
 
+#include <cstring>
 #include <limits>
 #include <vector>
 
 namespace kaldi {
 
+// Template that covers integers.
+template<class T> inline bool ParseBasicType(const char **str, T *t) {
+  // Compile time assertion that this is not called with a wrong type.
+  KALDI_ASSERT_IS_INTEGER_TYPE(T);
+  const char *p = *str;
+  while (::isspace(static_cast<unsigned char>(*p))) p++;
+  bool negative = false;
+  if (*p == '-' || *p == '+') {
+    negative = (*p == '-');
+    p++;
+  }
+  if (*p < '0' || *p > '9') return false;
+  // "limit" is the largest absolute value we can represent with this sign.
+  uint64 limit = static_cast<uint64>(std::numeric_limits<T>::max());
+  if (negative)
+    limit = (std::numeric_limits<T>::is_signed ? limit + 1 : 0);
+  uint64 i = 0;
+  for (; *p >= '0' && *p <= '9'; p++) {
+    uint64 digit = *p - '0';
+    if (i > limit / 10 || (i == limit / 10 && digit > limit % 10))
+      return false;  // Out of range.
+    i = i * 10 + digit;
+  }
+  if (negative && i != 0)  // Written this way to avoid overflow.
+    *t = static_cast<T>(-static_cast<int64>(i - 1) - 1);
+  else
+    *t = static_cast<T>(i);
+  *str = p;
+  return true;
+}
+
+template<class T> inline void ReadNumberText(std::istream &is, T *t) {
+  // Like "is >> *t", skip whitespace and then take the longest sequence of
+  // characters that may form part of a number.
+  char buf[128];
+  size_t n = 0;
+  if (is.good()) {
+    std::streambuf *sb = is.rdbuf();
+    int c = sb->sgetc();
+    while (c != -1 && ::isspace(c))
+      c = sb->snextc();
+    while (c != -1 && ((c >= '0' && c <= '9') || c == '-' || c == '+' ||
+                       c == '.' || c == 'e' || c == 'E')) {
+      if (n + 1 == sizeof(buf)) {  // Too long to be a valid number.
+        n = 0;
+        break;
+      }
+      buf[n++] = static_cast<char>(c);
+      c = sb->snextc();
+    }
+    if (c == -1) is.setstate(std::ios_base::eofbit);
+  }
+  buf[n] = '\0';
+  const char *p = buf;
+  if (n == 0 || !ParseBasicType(&p, t) || *p != '\0')
+    is.setstate(std::ios_base::failbit);
+}
+
 // Template that covers integers.
 template<class T>  void WriteBasicType(std::ostream &os,
                                        bool binary, T t) {
   // Compile time assertion that this is not called with a wrong type.
   KALDI_ASSERT_IS_INTEGER_TYPE(T);
   if (binary) {
-    char len_c = (std::numeric_limits<T>::is_signed ? 1 :  -1)
+    // Write the size character and the value with one call to the stream
+    // buffer; this is much faster than going through the ostream twice.
+    char buf[1 + sizeof(t)];
+    buf[0] = (std::numeric_limits<T>::is_signed ? 1 :  -1)
         * static_cast<char>(sizeof(t));
-    os.put(len_c);
-    os.write(reinterpret_cast<const char *>(&t), sizeof(t));
+    std::memcpy(buf + 1, &t, sizeof(t));
+    if (os.rdbuf()->sputn(buf, sizeof(buf)) != sizeof(buf))
+      os.setstate(std::ios_base::badbit);
   } else {
     if (sizeof(t) == 1)
       os << static_cast<int16>(t) << " ";
@@ -56,7 +119,11 @@ template<class T> inline void ReadBasicType(std::istream &is,
   // Compile time assertion that this is not called with a wrong type.
   KALDI_ASSERT_IS_INTEGER_TYPE(T);
   if (binary) {
-    int len_c_in = is.get();
+    // We read directly from the stream buffer, which avoids the overhead of
+    // the istream functions; this matters because these functions are called
+    // a very large number of times when reading things like lattices.
+    std::streambuf *sb = is.rdbuf();
+    int len_c_in = (is.good() ? sb->sbumpc() : -1);
     if (len_c_in == -1)
       KALDI_ERR << "ReadBasicType: encountered end of stream.";
     char len_c = static_cast<char>(len_c_in), len_c_expected
@@ -71,14 +138,15 @@ template<class T> inline void ReadBasicType(std::istream &is,
                 << " read it later, if needed.";
       // insert code here to read "wrong" type.  Might have a switch statement.
     }
-    is.read(reinterpret_cast<char *>(t), sizeof(*t));
+    if (sb->sgetn(reinterpret_cast<char *>(t), sizeof(*t)) != sizeof(*t))
+      is.setstate(std::ios_base::eofbit | std::ios_base::failbit);
   } else {
     if (sizeof(*t) == 1) {
       int16 i;
-      is >> i;
+      ReadNumberText(is, &i);
       *t = i;
     } else {
-      is >> *t;
+      ReadNumberText(is, t);
     }
   }
   if (is.fail()) {
@@ -128,20 +196,23 @@ template<class T> inline void ReadIntegerVector(std::istream &is,
   KALDI_ASSERT_IS_INTEGER_TYPE(T);
   KALDI_ASSERT(v != NULL);
   if (binary) {
-    int sz = is.peek();
+    std::streambuf *sb = is.rdbuf();  // See ReadBasicType().
+    int sz = (is.good() ? sb->sgetc() : -1);
     if (sz == sizeof(T)) {
-      is.get();
+      sb->sbumpc();
     } else {  // this is currently just a check.
       KALDI_ERR << "ReadIntegerVector: expected to see type of size "
                 << sizeof(T) << ", saw instead " << sz << ", at file position "
                 << is.tellg();
     }
     int32 vecsz;
-    is.read(reinterpret_cast<char *>(&vecsz), sizeof(vecsz));
-    if (is.fail() || vecsz < 0) goto bad;
+    if (sb->sgetn(reinterpret_cast<char *>(&vecsz), sizeof(vecsz)) !=
+        sizeof(vecsz) || vecsz < 0) goto bad;
     v->resize(vecsz);
     if (vecsz > 0) {
-      is.read(reinterpret_cast<char *>(&((*v)[0])), sizeof(T)*vecsz);
+      std::streamsize bytes = sizeof(T) * static_cast<std::streamsize>(vecsz);
+      if (sb->sgetn(reinterpret_cast<char *>(&((*v)[0])), bytes) != bytes)
+        goto bad;
     }
   } else {
     std::vector<T> tmp_v;  // use temporary so v doesn't use extra memory
@@ -156,13 +227,15 @@ template<class T> inline void ReadIntegerVector(std::istream &is,
     while (is.peek() != static_cast<int>(']')) {
       if (sizeof(T) == 1) {  // read/write chars as numbers.
         int16 next_t;
-        is >> next_t >> std::ws;
+        ReadNumberText(is, &next_t);
+        is >> std::ws;
         if (is.fail()) goto bad;
         else
             tmp_v.push_back((T)next_t);
       } else {
         T next_t;
-        is >> next_t >> std::ws;
+        ReadNumberText(is, &next_t);
+        is >> std::ws;
         if (is.fail()) goto bad;
         else
             tmp_v.push_back(next_t);
@@ -0,0 +1,123 @@
+// base/io-funcs-speed-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sys/time.h>
+
+#include "base/io-funcs.h"
+#include "base/kaldi-math.h"
+
+namespace kaldi {
+
+// The timer is in util/, which base/ can't depend on.
+static double CurrentTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1.0e-06 * tv.tv_usec;
+}
+
+// Writes and reads back records laid out like the nnet2 training examples
+// (tokens, a vector of (label, weight) pairs and some integers) and like the
+// arcs of a lattice (integers and floats), which is where programs reading
+// egs and lattice archives spend their time in these functions.
+void WriteRecords(std::ostream &os, bool binary, int32 num_records) {
+  for (int32 i = 0; i < num_records; i++) {
+    WriteToken(os, binary, "<NnetExample>");
+    WriteToken(os, binary, "<Labels>");
+    int32 num_labels = 1 + i % 3;
+    WriteBasicType(os, binary, num_labels);
+    for (int32 j = 0; j < num_labels; j++) {
+      WriteBasicType(os, binary, i + j);
+      WriteBasicType(os, binary, 1.0f / num_labels);
+    }
+    WriteToken(os, binary, "<LeftContext>");
+    WriteBasicType(os, binary, 4);
+    int32 num_arcs = 20;
+    WriteBasicType(os, binary, num_arcs);
+    for (int32 j = 0; j < num_arcs; j++) {
+      WriteBasicType(os, binary, j);  // Label.
+      WriteBasicType(os, binary, i);  // Next state.
+      WriteBasicType(os, binary, 0.5 * j);  // Weight.
+    }
+    std::vector<int32> alignment(10, i);
+    WriteIntegerVector(os, binary, alignment);
+    WriteToken(os, binary, "</NnetExample>");
+  }
+}
+
+double ReadRecords(std::istream &is, bool binary, int32 num_records) {
+  double sum = 0.0;
+  std::string token;
+  for (int32 i = 0; i < num_records; i++) {
+    ExpectToken(is, binary, "<NnetExample>");
+    ReadToken(is, binary, &token);
+    KALDI_ASSERT(token == "<Labels>");
+    int32 num_labels;
+    ReadBasicType(is, binary, &num_labels);
+    for (int32 j = 0; j < num_labels; j++) {
+      int32 label;
+      BaseFloat weight;
+      ReadBasicType(is, binary, &label);
+      ReadBasicType(is, binary, &weight);
+      sum += label * weight;
+    }
+    ExpectToken(is, binary, "<LeftContext>");
+    int32 left_context, num_arcs;
+    ReadBasicType(is, binary, &left_context);
+    ReadBasicType(is, binary, &num_arcs);
+    for (int32 j = 0; j < num_arcs; j++) {
+      int32 label, nextstate;
+      double weight;
+      ReadBasicType(is, binary, &label);
+      ReadBasicType(is, binary, &nextstate);
+      ReadBasicType(is, binary, &weight);
+      sum += weight;
+    }
+    std::vector<int32> alignment;
+    ReadIntegerVector(is, binary, &alignment);
+    KALDI_ASSERT(alignment.size() == 10 && alignment[0] == i);
+    ExpectToken(is, binary, "</NnetExample>");
+  }
+  return sum;
+}
+
+void TestReadSpeed(bool binary) {
+  const char *filename = "tmpf";
+  int32 num_records = (binary ? 200000 : 20000);
+  {
+    std::ofstream os(filename, std::ios_base::out | std::ios_base::binary);
+    WriteRecords(os, binary, num_records);
+    KALDI_ASSERT(!os.fail());
+  }
+  std::ifstream is(filename, std::ios_base::in | std::ios_base::binary);
+  double start = CurrentTime();
+  double sum = ReadRecords(is, binary, num_records);
+  double elapsed = CurrentTime() - start;
+  KALDI_ASSERT(Peek(is, binary) == -1);
+  KALDI_LOG << "For reading " << num_records << " records in "
+            << (binary ? "binary" : "text") << " mode, time was " << elapsed
+            << " seconds (" << (num_records / elapsed)
+            << " records per second); checksum " << sum;
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  using namespace kaldi;
+  TestReadSpeed(true);
+  TestReadSpeed(false);
+  return 0;
+}
@@ -19,6 +19,8 @@
 #include "base/io-funcs.h"
 #include "base/kaldi-math.h"
 
+#include <clocale>
+
 namespace kaldi {
 
 void UnitTestIo(bool binary) {
@@ -121,7 +123,175 @@ void UnitTestIo(bool binary) {
   }
 }
 
+// Tests the handling of long tokens, of mismatched tokens and of truncated
+// input.
+void UnitTestIoErrors(bool binary) {
+  std::string long_token;
+  for (int32 i = 0; i < 200; i++)
+    long_token += static_cast<char>('a' + rand() % 26);
+  {
+    std::ostringstream os;
+    WriteToken(os, binary, long_token);
+    WriteToken(os, binary, "<Foo>");
+    WriteToken(os, binary, "<Foo>");
+    std::istringstream is(os.str());
+    std::string str = "garbage";
+    ReadToken(is, binary, &str);
+    KALDI_ASSERT(str == long_token);
+    bool threw = false;
+    try {
+      ExpectToken(is, binary, "<Fo>");  // A prefix of the token.
+    } catch (std::runtime_error &e) {
+      threw = true;
+    }
+    KALDI_ASSERT(threw);
+    threw = false;
+    try {
+      ExpectToken(is, binary, "<Foo>Bar");  // The token is a prefix of this.
+    } catch (std::runtime_error &e) {
+      threw = true;
+    }
+    KALDI_ASSERT(threw);
+  }
+  {
+    std::string data = "<Foo>";  // No space after the token.
+    std::istringstream is(data);
+    bool threw = false;
+    try {
+      ExpectToken(is, binary, "<Foo>");
+    } catch (std::runtime_error &e) {
+      threw = true;
+    }
+    KALDI_ASSERT(threw);
+    std::istringstream is2(data);
+    std::string str;
+    threw = false;
+    try {
+      ReadToken(is2, binary, &str);
+    } catch (std::runtime_error &e) {
+      threw = true;
+    }
+    KALDI_ASSERT(threw);
+  }
+  if (binary) {  // In text mode, truncated numbers may still be valid.
+    std::ostringstream os;
+    WriteBasicType(os, binary, static_cast<int32>(12345));
+    WriteBasicType(os, binary, 0.5f);
+    std::string s = os.str();
+    std::istringstream is(s.substr(0, s.size() - 2));
+    int32 i;
+    ReadBasicType(is, binary, &i);
+    KALDI_ASSERT(i == 12345);
+    float f;
+    bool threw = false;
+    try {
+      ReadBasicType(is, binary, &f);
+    } catch (std::runtime_error &e) {
+      threw = true;
+    }
+    KALDI_ASSERT(threw);
+  }
+}
+
+template<class Real>
+void UnitTestParseReal() {
+  for (int32 i = 0; i < 1000; i++) {
+    double d = RandGauss() * Exp(RandGauss() * 10.0);
+    if (i % 10 == 0) d = rand() % 1000 - 500;
+    std::ostringstream os;
+    os.precision(1 + rand() % 18);
+    if (rand() % 2 == 0) os << std::scientific;
+    os << d;
+    std::string str = os.str() + (rand() % 2 == 0 ? " " : "");
+    // The result should be the same as from strtod or strtof.
+    Real ref = (sizeof(Real) == sizeof(double) ?
+                static_cast<Real>(strtod(str.c_str(), NULL)) :
+                static_cast<Real>(strtof(str.c_str(), NULL)));
+    const char *p = str.c_str();
+    Real r;
+    KALDI_ASSERT(ParseBasicType(&p, &r));
+    KALDI_ASSERT(*p == '\0' || *p == ' ');
+    KALDI_ASSERT(r == ref);
+    std::istringstream is(str);
+    Real r2;
+    ReadBasicType(is, false, &r2);
+    KALDI_ASSERT(r2 == r);
+  }
+  const char *good[] = { "1", "-0.5", "+2.5e3", ".5", "5.", "1e-40",
+                         "123456789012345678901234567890", "inf", "-nan",
+                         "3e5junk" };
+  Real values[] = { 1.0, -0.5, 2500.0, 0.5, 5.0, 0.0, 0.0, 0.0, 0.0, 3.0e+05 };
+  for (size_t i = 0; i < sizeof(good) / sizeof(good[0]); i++) {
+    const char *p = good[i];
+    Real r;
+    KALDI_ASSERT(ParseBasicType(&p, &r));
+    if (values[i] != 0.0) KALDI_ASSERT(r == values[i]);
+  }
+  const char *bad[] = { "", " ", "-", "e5", ".", "x1", "1e999999" };
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    const char *p = bad[i];
+    Real r;
+    KALDI_ASSERT(!ParseBasicType(&p, &r) && p == bad[i]);
+  }
+  // This is 1 + 2^-24 + a little, so it rounds up to 1 + 2^-23 as a float,
+  // but to 1 + 2^-24 as a double and then to 1 as a float.
+  const char *p = "1.000000059604644775390626";
+  Real r;
+  KALDI_ASSERT(ParseBasicType(&p, &r) && *p == '\0' &&
+               r == (sizeof(Real) == sizeof(float) ?
+                     static_cast<Real>(1.0 + 1.0 / (1 << 23)) :
+                     static_cast<Real>(1.000000059604644775390626)));
+  // The slow path must not depend on the locale, e.g. where the decimal point
+  // is ','.
+  const char *str = "0.12345678901234567890";
+  Real ref;
+  p = str;
+  KALDI_ASSERT(ParseBasicType(&p, &ref));
+  const char *locales[] = { "de_DE.UTF-8", "de_DE", "fr_FR.UTF-8", "fr_FR" };
+  for (size_t i = 0; i < sizeof(locales) / sizeof(locales[0]); i++) {
+    if (setlocale(LC_NUMERIC, locales[i]) != NULL) {
+      p = str;
+      KALDI_ASSERT(ParseBasicType(&p, &r) && *p == '\0' && r == ref);
+      setlocale(LC_NUMERIC, "C");
+      break;
+    }
+  }
+}
 
+void UnitTestParseInteger() {
+  const char *str = " 2147483647 -2147483648 2147483648 -12x 1.5";
+  const char *p = str;
+  int32 i;
+  KALDI_ASSERT(ParseBasicType(&p, &i) && i == 2147483647);
+  KALDI_ASSERT(ParseBasicType(&p, &i) && i == -2147483647 - 1);
+  const char *q = p;
+  KALDI_ASSERT(!ParseBasicType(&q, &i) && q == p);  // Out of range.
+  int64 j;
+  KALDI_ASSERT(ParseBasicType(&p, &j) && j == 2147483648LL);
+  KALDI_ASSERT(ParseBasicType(&p, &i) && i == -12 && *p == 'x');
+  p++;
+  KALDI_ASSERT(ParseBasicType(&p, &i) && i == 1 && *p == '.');
+  uint16 k;
+  p = "-0";
+  KALDI_ASSERT(ParseBasicType(&p, &k) && k == 0);
+  p = "-1";
+  KALDI_ASSERT(!ParseBasicType(&p, &k));
+  p = "65536";
+  KALDI_ASSERT(!ParseBasicType(&p, &k));
+  p = "-9223372036854775808";
+  KALDI_ASSERT(ParseBasicType(&p, &j) &&
+               j == std::numeric_limits<int64>::min());
+  uint64 l;
+  p = "18446744073709551615";
+  KALDI_ASSERT(ParseBasicType(&p, &l) &&
+               l == std::numeric_limits<uint64>::max());
+  p = "18446744073709551616";
+  KALDI_ASSERT(!ParseBasicType(&p, &l));
+  bool b;
+  p = " T F";
+  KALDI_ASSERT(ParseBasicType(&p, &b) && b && ParseBasicType(&p, &b) && !b);
+  KALDI_ASSERT(!ParseBasicType(&p, &b));
+}
 
 }  // end namespace kaldi.
 
@@ -130,7 +300,12 @@ int main() {
   for (size_t i = 0; i < 10; i++) {
     UnitTestIo(false);
     UnitTestIo(true);
+    UnitTestIoErrors(false);
+    UnitTestIoErrors(true);
   }
+  UnitTestParseReal<float>();
+  UnitTestParseReal<double>();
+  UnitTestParseInteger();
   KALDI_ASSERT(1);  // just wanted to check that KALDI_ASSERT does not fail for 1.
   return 0;
 }
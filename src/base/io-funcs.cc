@@ -20,8 +20,70 @@
 #include "base/io-funcs.h"
 #include "base/kaldi-math.h"
 
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <locale.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+#include <string>
+
 namespace kaldi {
 
+// The binary-mode functions below use the stream buffer directly rather than
+// the istream and ostream functions, each of which constructs a "sentry" object
+// and checks the stream state.  For the small reads and writes done here
+// (mostly a size character followed by a few bytes), that overhead dominates,
+// and these functions are called many millions of times when reading things
+// like nnet training examples and lattices.
+
+// Writes the size character and the bytes of f.
+template<class Real>
+static inline void WriteBinaryValue(std::ostream &os, Real f) {
+  char buf[1 + sizeof(f)];
+  buf[0] = sizeof(f);
+  std::memcpy(buf + 1, &f, sizeof(f));
+  if (os.rdbuf()->sputn(buf, sizeof(buf)) != sizeof(buf))
+    os.setstate(std::ios_base::badbit);
+}
+
+// Reads a floating-point value written by WriteBasicType in binary mode, which
+// may be of either type.
+template<class Real>
+static inline void ReadBinaryValue(std::istream &is, Real *f) {
+  std::streambuf *sb = is.rdbuf();
+  int c = (is.good() ? sb->sbumpc() : -1);
+  bool ok = false;
+  if (c == sizeof(float)) {
+    float tmp;
+    ok = (sb->sgetn(reinterpret_cast<char*>(&tmp), sizeof(tmp)) ==
+          sizeof(tmp));
+    *f = tmp;
+  } else if (c == sizeof(double)) {
+    double tmp;
+    ok = (sb->sgetn(reinterpret_cast<char*>(&tmp), sizeof(tmp)) ==
+          sizeof(tmp));
+    *f = tmp;
+  } else {
+    KALDI_ERR << "ReadBasicType: expected float, saw " << c
+              << ", at file position " << is.tellg();
+  }
+  if (!ok) is.setstate(std::ios_base::eofbit | std::ios_base::failbit);
+}
+
+// Skips over whitespace and returns the next character (or -1), without
+// consuming it.
+static inline int SkipWhitespace(std::istream &is) {
+  if (!is.good()) return -1;
+  std::streambuf *sb = is.rdbuf();
+  int c = sb->sgetc();
+  while (c != -1 && ::isspace(c))
+    c = sb->snextc();
+  if (c == -1) is.setstate(std::ios_base::eofbit);
+  return c;
+}
+
 template<>
 void WriteBasicType<bool>(std::ostream &os, bool binary, bool b) {
   os << (b ? "T":"F");
@@ -50,9 +112,7 @@ void ReadBasicType<bool>(std::istream &is, bool binary, bool *b) {
 template<>
 void WriteBasicType<float>(std::ostream &os, bool binary, float f) {
   if (binary) {
-    char c = sizeof(f);
-    os.put(c);
-    os.write(reinterpret_cast<const char *>(&f), sizeof(f));
+    WriteBinaryValue(os, f);
   } else {
     os << f << " ";
   }
@@ -61,9 +121,7 @@ void WriteBasicType<float>(std::ostream &os, bool binary, float f) {
 template<>
 void WriteBasicType<double>(std::ostream &os, bool binary, double f) {
   if (binary) {
-    char c = sizeof(f);
-    os.put(c);
-    os.write(reinterpret_cast<const char *>(&f), sizeof(f));
+    WriteBinaryValue(os, f);
   } else {
     os << f << " ";
   }
@@ -73,20 +131,9 @@ template<>
 void ReadBasicType<float>(std::istream &is, bool binary, float *f) {
   KALDI_PARANOID_ASSERT(f != NULL);
   if (binary) {
-    double d;
-    int c = is.peek();
-    if (c == sizeof(*f)) {
-      is.get();
-      is.read(reinterpret_cast<char*>(f), sizeof(*f));
-    } else if (c == sizeof(d)) {
-      ReadBasicType(is, binary, &d);
-      *f = d;
-    } else {
-      KALDI_ERR << "ReadBasicType: expected float, saw " << is.peek()
-                << ", at file position " << is.tellg();
-    }
+    ReadBinaryValue(is, f);
   } else {
-    is >> *f;
+    ReadNumberText(is, f);
   }
   if (is.fail()) {
     KALDI_ERR << "ReadBasicType: failed to read, at file position "
@@ -98,20 +145,9 @@ template<>
 void ReadBasicType<double>(std::istream &is, bool binary, double *d) {
   KALDI_PARANOID_ASSERT(d != NULL);
   if (binary) {
-    float f;
-    int c = is.peek();
-    if (c == sizeof(*d)) {
-      is.get();
-      is.read(reinterpret_cast<char*>(d), sizeof(*d));
-    } else if (c == sizeof(f)) {
-      ReadBasicType(is, binary, &f);
-      *d = f;
-    } else {
-      KALDI_ERR << "ReadBasicType: expected float, saw " << is.peek()
-                << ", at file position " << is.tellg();
-    }
+    ReadBinaryValue(is, d);
   } else {
-    is >> *d;
+    ReadNumberText(is, d);
   }
   if (is.fail()) {
     KALDI_ERR << "ReadBasicType: failed to read, at file position "
@@ -119,6 +155,169 @@ void ReadBasicType<double>(std::istream &is, bool binary, double *d) {
   }
 }
 
+template<>
+bool ParseBasicType<bool>(const char **str, bool *b) {
+  const char *p = *str;
+  while (::isspace(static_cast<unsigned char>(*p))) p++;
+  if (*p != 'T' && *p != 'F') return false;
+  *b = (*p == 'T');
+  *str = p + 1;
+  return true;
+}
+
+// CLocaleStrtod() is strtod, or strtof for float, in the "C" locale, so the
+// decimal point is always '.' whatever the program has passed to setlocale().
+#if defined(_MSC_VER)
+static _locale_t CLocale() {
+  static _locale_t c_locale = _create_locale(LC_NUMERIC, "C");
+  return c_locale;
+}
+static inline double CLocaleStrtod(const char *str, char **end, double *) {
+  return _strtod_l(str, end, CLocale());
+}
+static inline float CLocaleStrtod(const char *str, char **end, float *) {
+  return _strtof_l(str, end, CLocale());
+}
+#elif defined(__GLIBC__) || defined(__APPLE__) || defined(__FreeBSD__)
+static locale_t CLocale() {
+  static locale_t c_locale = newlocale(LC_NUMERIC_MASK, "C",
+                                       static_cast<locale_t>(0));
+  return c_locale;
+}
+static inline double CLocaleStrtod(const char *str, char **end, double *) {
+  return strtod_l(str, end, CLocale());
+}
+static inline float CLocaleStrtod(const char *str, char **end, float *) {
+  return strtof_l(str, end, CLocale());
+}
+#else
+// Without strtod_l, we give strtod a copy of the token in which the '.' is
+// replaced by the decimal point of the current locale.
+template<class Real>
+static Real CLocaleStrtodInternal(const char *str, char **end) {
+  const char *token_end = str;
+  while (*token_end != '\0' &&
+         !::isspace(static_cast<unsigned char>(*token_end))) token_end++;
+  std::string token(str, token_end), point(localeconv()->decimal_point);
+  size_t pos = token.find('.');
+  if (pos != std::string::npos && point != ".")
+    token.replace(pos, 1, point);
+  char *e = NULL;
+  Real value = (sizeof(Real) == sizeof(float) ?
+                static_cast<Real>(strtof(token.c_str(), &e)) :
+                static_cast<Real>(strtod(token.c_str(), &e)));
+  size_t num_chars = e - token.c_str();
+  if (pos != std::string::npos && num_chars > pos)
+    num_chars -= point.size() - 1;
+  *end = const_cast<char*>(str) + num_chars;
+  return value;
+}
+static inline double CLocaleStrtod(const char *str, char **end, double *) {
+  return CLocaleStrtodInternal<double>(str, end);
+}
+static inline float CLocaleStrtod(const char *str, char **end, float *) {
+  return CLocaleStrtodInternal<float>(str, end);
+}
+#endif
+
+// Parses a number at str with CLocaleStrtod() and sets *end to the character
+// after it.  Returns false if there was no number or it overflowed; underflow
+// is accepted, as it is by "is >> f".
+template<class Real>
+static bool StrToRealC(const char *str, const char **end, Real *out) {
+  char *e = NULL;
+  errno = 0;
+  Real value = CLocaleStrtod(str, &e, static_cast<Real*>(NULL));
+  if (e == str) return false;
+  if (errno == ERANGE && (value == std::numeric_limits<Real>::infinity() ||
+                          value == -std::numeric_limits<Real>::infinity()))
+    return false;
+  *out = value;
+  *end = e;
+  return true;
+}
+
+// Powers of ten that are exactly representable as doubles.
+static const double kExactPowersOfTen[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+  1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+// Parses a decimal number.  In the common case that there are few significant
+// digits and the exponent is small, the mantissa and the power of ten are both
+// exactly representable, so one multiplication or division gives the correctly
+// rounded result, the same as strtod or strtof.  (For float we need the
+// mantissa to fit in 24 bits and the power of ten to be at most 1e10.)
+// Otherwise, and for things like "inf" and "nan", we call StrToRealC().
+template<class Real>
+static bool ParseReal(const char **str, Real *out) {
+  const bool is_float = (sizeof(Real) == sizeof(float));
+  const uint64 max_mantissa = (is_float ? (1 << 24) : (1LL << 53));
+  const int32 max_exponent = (is_float ? 10 : 22);
+  const char *p = *str;
+  while (::isspace(static_cast<unsigned char>(*p))) p++;
+  const char *start = p;
+  bool negative = false;
+  if (*p == '-' || *p == '+') {
+    negative = (*p == '-');
+    p++;
+  }
+  uint64 mantissa = 0;
+  int32 exponent = 0, num_digits = 0;
+  bool exact = true;  // False if there were too many digits for the mantissa.
+  for (; *p >= '0' && *p <= '9'; p++, num_digits++) {
+    if (mantissa <= max_mantissa) mantissa = mantissa * 10 + (*p - '0');
+    else exact = false;
+  }
+  if (*p == '.') {
+    for (p++; *p >= '0' && *p <= '9'; p++, num_digits++) {
+      if (mantissa <= max_mantissa) {
+        mantissa = mantissa * 10 + (*p - '0');
+        exponent--;
+      } else {
+        exact = false;
+      }
+    }
+  }
+  if (num_digits != 0 && (*p == 'e' || *p == 'E')) {
+    const char *q = p + 1;
+    bool negative_exponent = false;
+    if (*q == '-' || *q == '+') {
+      negative_exponent = (*q == '-');
+      q++;
+    }
+    if (*q >= '0' && *q <= '9') {  // Otherwise the 'e' is not part of it.
+      int32 e = 0;
+      for (; *q >= '0' && *q <= '9'; q++)
+        if (e < 100000) e = e * 10 + (*q - '0');
+      exponent += (negative_exponent ? -e : e);
+      p = q;
+    }
+  }
+  if (num_digits != 0 && exact && mantissa <= max_mantissa &&
+      exponent >= -max_exponent && exponent <= max_exponent) {
+    Real value = static_cast<Real>(mantissa);
+    if (exponent < 0)
+      value /= static_cast<Real>(kExactPowersOfTen[-exponent]);
+    else
+      value *= static_cast<Real>(kExactPowersOfTen[exponent]);
+    *out = (negative ? -value : value);
+    *str = p;
+    return true;
+  }
+  // The slow path.
+  return StrToRealC(start, str, out);
+}
+
+template<>
+bool ParseBasicType<float>(const char **str, float *f) {
+  return ParseReal(str, f);
+}
+
+template<>
+bool ParseBasicType<double>(const char **str, double *d) {
+  return ParseReal(str, d);
+}
+
 void CheckToken(const char *token) {
   KALDI_ASSERT(*token != '\0');  // check it's nonempty.
   while (*token != '\0') {
@@ -132,7 +331,10 @@ void WriteToken(std::ostream &os, bool binary, const char *token) {
   // we use space as termination character in either case.
   KALDI_ASSERT(token != NULL);
   CheckToken(token);  // make sure it's valid (can be read back)
-  os << token << " ";
+  std::streambuf *sb = os.rdbuf();
+  std::streamsize len = std::strlen(token);
+  if (sb->sputn(token, len) != len || sb->sputc(' ') == -1)
+    os.setstate(std::ios_base::badbit);
   if (os.fail()) {
     throw std::runtime_error("Write failure in WriteToken.");
   }
@@ -149,18 +351,33 @@ void WriteToken(std::ostream &os, bool binary, const std::string & token) {
 
 void ReadToken(std::istream &is, bool binary, std::string *str) {
   KALDI_ASSERT(str != NULL);
-  if (!binary) is >> std::ws;  // consume whitespace.
-  is >> *str;
-  if (is.fail()) {
+  // Both modes skip whitespace before the token, as operator >> would.
+  int c = SkipWhitespace(is);
+  if (c == -1) {
+    is.setstate(std::ios_base::failbit);
     KALDI_ERR << "ReadToken, failed to read token at file position "
               << is.tellg();
   }
-  if (!isspace(is.peek())) {
+  // Reuse the string's memory, and add the characters a block at a time.
+  std::streambuf *sb = is.rdbuf();
+  str->clear();
+  char buf[64];
+  size_t n = 0;
+  do {
+    buf[n++] = static_cast<char>(c);
+    if (n == sizeof(buf)) {
+      str->append(buf, n);
+      n = 0;
+    }
+    c = sb->snextc();
+  } while (c != -1 && !::isspace(c));
+  str->append(buf, n);
+  if (c == -1) {
+    is.setstate(std::ios_base::eofbit);
     KALDI_ERR << "ReadToken, expected space after token, saw instead "
-              << static_cast<char>(is.peek())
-              << ", at file position " << is.tellg();
+              << "end of file, at file position " << is.tellg();
   }
-  is.get();  // consume the space.
+  sb->sbumpc();  // consume the space.
 }
 
 int PeekToken(std::istream &is, bool binary) {
@@ -182,21 +399,34 @@ int PeekToken(std::istream &is, bool binary) {
 
 
 void ExpectToken(std::istream &is, bool binary, const char *token) {
-  int pos_at_start = is.tellg();
   KALDI_ASSERT(token != NULL);
   CheckToken(token);  // make sure it's valid (can be read back)
-  if (!binary) is >> std::ws;  // consume whitespace.
-  std::string str;
-  is >> str;
-  is.get();  // consume the space.
-  if (is.fail()) {
-    KALDI_ERR << "Failed to read token [started at file position "
-              << pos_at_start << "], expected " << token;
+  // We compare the characters as we read them, so there is no need to
+  // construct a string unless there is an error.
+  int c = SkipWhitespace(is);
+  std::streambuf *sb = is.rdbuf();
+  const char *t = token;
+  while (*t != '\0' && c == static_cast<unsigned char>(*t)) {
+    c = sb->snextc();
+    t++;
+  }
+  if (*t == '\0' && c != -1 && ::isspace(c)) {
+    sb->sbumpc();  // consume the space.
+    return;
+  }
+  // Work out what we read instead, for the error message.
+  std::string str(token, t - token);
+  while (c != -1 && !::isspace(c)) {
+    str += static_cast<char>(c);
+    c = sb->snextc();
   }
-  if (strcmp(str.c_str(), token) != 0) {
-    KALDI_ERR << "Expected token \"" << token << "\", got instead \""
-              << str <<"\".";
+  if (c == -1) {
+    is.setstate(std::ios_base::eofbit | std::ios_base::failbit);
+    KALDI_ERR << "Failed to read token [reached end of file after \""
+              << str << "\"], expected " << token;
   }
+  KALDI_ERR << "Expected token \"" << token << "\", got instead \""
+            << str <<"\".";
 }
 
 void ExpectToken(std::istream &is, bool binary, const std::string &token) {
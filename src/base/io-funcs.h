@@ -174,6 +174,30 @@ inline void ReadBasicType(std::istream &is, bool binary, T *t, bool add) {
   }
 }
 
+/// ParseBasicType parses the text form of a bool, integer or floating-point
+/// value at *str, after skipping any whitespace.  On success it sets *str to
+/// the character after the value and returns true; it returns false if there
+/// is no such value, or it is out of range (floating-point values that
+/// underflow are accepted, and are rounded to zero or a denormal).  It is a
+/// faster, locale-independent replacement for strtol, strtod and strtof, used
+/// when reading text-mode archives; floats are rounded directly from the
+/// text, as strtof does, not via double.
+template<class T> bool ParseBasicType(const char **str, T *t);
+
+template<>
+bool ParseBasicType<bool>(const char **str, bool *b);
+
+template<>
+bool ParseBasicType<float>(const char **str, float *f);
+
+template<>
+bool ParseBasicType<double>(const char **str, double *d);
+
+/// ReadNumberText does the same as "is >> *t" for integer or floating-point
+/// types, but is faster as it uses ParseBasicType().  On failure it sets the
+/// stream's failbit.
+template<class T> inline void ReadNumberText(std::istream &is, T *t);
+
 /// Function for writing STL vectors of integer types.
 template<class T> inline void WriteIntegerVector(std::ostream &os, bool binary,
                                                  const std::vector<T> &v);
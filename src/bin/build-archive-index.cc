@@ -0,0 +1,126 @@
+// bin/build-archive-index.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/posterior.h"
+
+namespace kaldi {
+
+// Reads the archive "archive_rxfilename" using the Holder type to skip over the
+// objects, and outputs the (key, offset) pairs of the archive index.
+template<class Holder>
+bool GetArchiveIndex(const std::string &archive_rxfilename,
+                     std::vector<std::pair<std::string, int64> > *index) {
+  Input input(archive_rxfilename);
+  std::istream &is = input.Stream();
+  Holder holder;
+  std::string key;
+  while (is >> key) {
+    int c = is.peek();
+    if (c != ' ' && c != '\t' && c != '\n') {
+      KALDI_WARN << "Invalid archive file format: expected space after key "
+                 << key << ", reading " << archive_rxfilename;
+      return false;
+    }
+    if (c != '\n') is.get();  // Consume the space or tab.
+    int64 offset = is.tellg();
+    if (offset < 0) {  // e.g. a compressed archive.
+      KALDI_WARN << "Cannot get positions in " << archive_rxfilename
+                 << "; index gzipped archives by writing them with \"idx\".";
+      return false;
+    }
+    index->push_back(std::make_pair(key, offset));
+    if (!holder.Read(is)) {
+      KALDI_WARN << "Object read failed for key " << key << ", reading "
+                 << archive_rxfilename;
+      return false;
+    }
+    holder.Clear();
+  }
+  return is.eof();
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+
+    const char *usage =
+        "Build the index of an archive, which RandomAccessTableReader uses to\n"
+        "seek directly to objects in the archive (see also the \"idx\" option\n"
+        "in wspecifiers).  The index is written to <archive>.idx unless\n"
+        "<index-wxfilename> is given.  The --type option must give the type\n"
+        "of object in the archive: one of matrix, vector, int-vector,\n"
+        "int-vector-vector, posterior.\n"
+        "\n"
+        "Usage: build-archive-index [options] <archive-filename> "
+        "[<index-wxfilename>]\n"
+        " e.g.: build-archive-index --type=matrix feats.ark\n";
+
+    std::string type = "matrix";
+    ParseOptions po(usage);
+    po.Register("type", &type, "Type of object in the archive: matrix, vector, "
+                "int-vector, int-vector-vector or posterior");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 1 || po.NumArgs() > 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string archive_filename = po.GetArg(1),
+        index_wxfilename = po.GetOptArg(2);
+    if (index_wxfilename == "")
+      index_wxfilename = ArchiveIndexFilename(archive_filename);
+    if (ClassifyRxfilename(archive_filename) != kFileInput)
+      KALDI_ERR << "Archive must be an ordinary file: " << archive_filename;
+
+    std::vector<std::pair<std::string, int64> > index;
+    bool ans = false;
+    if (type == "matrix") {
+      ans = GetArchiveIndex<KaldiObjectHolder<Matrix<BaseFloat> > >(
+          archive_filename, &index);
+    } else if (type == "vector") {
+      ans = GetArchiveIndex<KaldiObjectHolder<Vector<BaseFloat> > >(
+          archive_filename, &index);
+    } else if (type == "int-vector") {
+      ans = GetArchiveIndex<BasicVectorHolder<int32> >(archive_filename,
+                                                        &index);
+    } else if (type == "int-vector-vector") {
+      ans = GetArchiveIndex<BasicVectorVectorHolder<int32> >(archive_filename,
+                                                              &index);
+    } else if (type == "posterior") {
+      ans = GetArchiveIndex<PosteriorHolder>(archive_filename, &index);
+    } else {
+      KALDI_ERR << "Invalid --type option " << type;
+    }
+    if (!ans)
+      KALDI_ERR << "Error reading archive " << archive_filename;
+    if (!WriteArchiveIndex(index_wxfilename, index))
+      KALDI_ERR << "Error writing archive index to " << index_wxfilename;
+    KALDI_LOG << "Wrote index of " << index.size() << " objects in "
+              << archive_filename << " to " << index_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
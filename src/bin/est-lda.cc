@@ -32,11 +32,15 @@ int main(int argc, char *argv[]) {
 
     bool binary = true;
     std::string full_matrix_wxfilename;
+    int32 num_threads = 1;
     LdaEstimateOptions opts;
     ParseOptions po(usage);
     po.Register("binary", &binary, "Write matrix in binary mode.");
     po.Register("write-full-matrix", &full_matrix_wxfilename,
                 "Write full LDA matrix to this location.");
+    po.Register("num-threads", &num_threads, "Number of threads to use in "
+                "matrix multiplication (has no effect if Kaldi was compiled "
+                "with a multi-threaded BLAS such as MKL or OpenBLAS).");
     opts.Register(&po);
     po.Read(argc, argv);
 
@@ -45,6 +49,8 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    SetNumBlasThreads(num_threads);
+
     LdaEstimate lda;
     std::string lda_mat_wxfilename = po.GetArg(1);
 
@@ -75,31 +75,42 @@ void Fbank::Compute(const VectorBase<BaseFloat> &wave,
     ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
 
   // Buffers
-  Vector<BaseFloat> window;  // windowed waveform.
-  Vector<BaseFloat> mel_energies;
-  BaseFloat log_energy;
-
-  // Compute all the freames, r is frame index..
-  for (int32 r = 0; r < rows_out; r++) {
-    // Cut the window, apply window function
-    ExtractWindow(wave, r, opts_.frame_opts, feature_window_function_, &window,
-                  (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
-
-    // Compute energy after window function (not the raw one)
-    if (opts_.use_energy && !opts_.raw_energy)
-      log_energy = log(VecVec(window, window));
-
-    if (srfft_ != NULL)  // Compute FFT using split-radix algorithm.
-      srfft_->Compute(window.Data(), true);
-    else  // An alternative algorithm that works for non-powers-of-two.
-      RealFft(&window, true);
+  Matrix<BaseFloat> power_spectra;  // power spectra of a chunk of frames.
+  Vector<BaseFloat> log_energies;  // and their log-energies.
+  int32 padded_window_size = opts_.frame_opts.PaddedWindowSize();
+
+  // Compute the frames in chunks, so the FFTs can be done as a batch.
+  for (int32 start = 0; start < rows_out; start += kFeatureChunkSize) {
+    int32 this_num_frames = std::min(kFeatureChunkSize, rows_out - start);
+    power_spectra.Resize(this_num_frames, padded_window_size, kUndefined);
+    log_energies.Resize(this_num_frames);
+    ExtractPowerSpectra(wave, start, opts_.frame_opts, feature_window_function_,
+                        opts_.raw_energy, srfft_, &power_spectra,
+                        (opts_.use_energy ? &log_energies : NULL));
+    SubMatrix<BaseFloat> this_output(output->RowRange(start, this_num_frames));
+    ComputeFromPowerSpectra(power_spectra, log_energies, vtln_warp,
+                            &this_output);
+  }
+}
 
-    // Convert the FFT into a power spectrum.
-    ComputePowerSpectrum(&window);
-    SubVector<BaseFloat> power_spectrum(window, 0, window.Dim()/2 + 1);
+void Fbank::ComputeFromPowerSpectra(const MatrixBase<BaseFloat> &power_spectra,
+                                    const VectorBase<BaseFloat> &log_energies,
+                                    BaseFloat vtln_warp,
+                                    MatrixBase<BaseFloat> *output) {
+  int32 num_frames = power_spectra.NumRows(),
+      padded_window_size = opts_.frame_opts.PaddedWindowSize();
+  KALDI_ASSERT(power_spectra.NumCols() >= padded_window_size/2 + 1 &&
+               log_energies.Dim() == num_frames &&
+               output->NumRows() == num_frames &&
+               output->NumCols() == Dim());
+  const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
+  Vector<BaseFloat> mel_energies;
+  for (int32 r = 0; r < num_frames; r++) {  // r is frame index..
+    BaseFloat log_energy = log_energies(r);
+    SubVector<BaseFloat> power_spectrum(power_spectra.Row(r), 0,
+                                        padded_window_size/2 + 1);
 
     // Integrate with MelFiterbank over power spectrum
-    const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
     this_mel_banks->Compute(power_spectrum, &mel_energies);
     if (opts_.use_log_fbank)
       mel_energies.ApplyLog();  // take the log.
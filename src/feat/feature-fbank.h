@@ -55,6 +55,12 @@ struct FbankOptions {
 
   void Register(OptionsItf *po) {
     frame_opts.Register(po);
+    RegisterNonFrameOptions(po);
+  }
+
+  /// Registers all options except frame_opts; for programs where the framing
+  /// is shared between several feature types (see MultiFeatureOptions).
+  void RegisterNonFrameOptions(OptionsItf *po) {
     mel_opts.Register(po);
     po->Register("use-energy", &use_energy,
                  "Add an extra dimension with energy to the FBANK output.");
@@ -76,9 +82,12 @@ class MelBanks;
 /// Class for computing FBANK features; see \ref feat_mfcc for more information.
 class Fbank {
  public:
+  typedef FbankOptions Options;
   explicit Fbank(const FbankOptions &opts);
   ~Fbank();
 
+  int32 Dim() { return opts_.mel_opts.num_bins + (opts_.use_energy ? 1 : 0); }
+
   /// Will throw exception on failure (e.g. if file too short for
   /// even one frame).
   void Compute(const VectorBase<BaseFloat> &wave,
@@ -86,6 +95,13 @@ class Fbank {
                Matrix<BaseFloat> *output,
                Vector<BaseFloat> *wave_remainder = NULL);
 
+  /// Computes the features of a chunk of frames from their power spectra and
+  /// log-energies; see Mfcc::ComputeFromPowerSpectra().
+  void ComputeFromPowerSpectra(const MatrixBase<BaseFloat> &power_spectra,
+                               const VectorBase<BaseFloat> &log_energies,
+                               BaseFloat vtln_warp,
+                               MatrixBase<BaseFloat> *output);
+
  private:
   const MelBanks *GetMelBanks(BaseFloat vtln_warp);
   FbankOptions opts_;
@@ -0,0 +1,88 @@
+// feat/feature-functions-speed-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/feature-functions.h"
+#include "util/timer.h"
+
+namespace kaldi {
+
+// Times SlidingWindowCmn() on a long recording; the time per frame should not
+// depend on the window size.
+void TestSlidingWindowCmnSpeed(const MatrixBase<BaseFloat> &feats,
+                               int32 cmn_window, bool normalize_variance,
+                               bool center) {
+  SlidingWindowCmnOptions opts;
+  opts.cmn_window = cmn_window;
+  opts.min_window = std::min(100, cmn_window);
+  opts.normalize_variance = normalize_variance;
+  opts.center = center;
+  Matrix<BaseFloat> output(feats.NumRows(), feats.NumCols(), kUndefined);
+  Timer timer;
+  SlidingWindowCmn(opts, feats, &output);
+  double elapsed = timer.Elapsed();
+  KALDI_LOG << "For SlidingWindowCmn with cmn-window=" << cmn_window
+            << ", norm-vars=" << (normalize_variance ? "true" : "false")
+            << ", center=" << (center ? "true" : "false") << ", time was "
+            << elapsed << " seconds (" << (feats.NumRows() / elapsed)
+            << " frames per second); checksum " << output.Sum();
+}
+
+// Times the online form, as used by OnlineCmnInput, frame by frame.
+void TestSlidingWindowCmnComputerSpeed(const MatrixBase<BaseFloat> &feats,
+                                       int32 cmn_window) {
+  SlidingWindowCmnOptions opts;
+  opts.cmn_window = cmn_window;
+  opts.min_window = std::min(100, cmn_window);
+  SlidingWindowCmnComputer computer(opts, feats.NumCols(), true);
+  Vector<BaseFloat> frame(feats.NumCols(), kUndefined);
+  double sum = 0.0;
+  Timer timer;
+  for (int32 t = 0; t < feats.NumRows(); t++) {
+    computer.AcceptFrame(feats.Row(t));
+    while (computer.NumFramesOutput() < computer.NumFramesReady()) {
+      computer.OutputFrame(&frame);
+      sum += frame(0);
+    }
+  }
+  computer.InputFinished();
+  while (computer.NumFramesOutput() < computer.NumFramesReady()) {
+    computer.OutputFrame(&frame);
+    sum += frame(0);
+  }
+  double elapsed = timer.Elapsed();
+  KALDI_LOG << "For SlidingWindowCmnComputer with cmn-window=" << cmn_window
+            << " on history only, time was " << elapsed << " seconds ("
+            << (feats.NumRows() / elapsed) << " frames per second); checksum "
+            << sum;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  // About 30 minutes of 40-dimensional features.
+  Matrix<BaseFloat> feats(200000, 40);
+  feats.SetRandn();
+  feats.Add(10.0);
+  int32 windows[] = { 100, 1000, 10000, 100000 };
+  for (int32 i = 0; i < 4; i++) {
+    TestSlidingWindowCmnSpeed(feats, windows[i], false, false);
+    TestSlidingWindowCmnSpeed(feats, windows[i], true, false);
+    TestSlidingWindowCmnSpeed(feats, windows[i], true, true);
+    TestSlidingWindowCmnComputerSpeed(feats, windows[i]);
+  }
+}
@@ -93,6 +93,73 @@ void UnitTestOnlineCmvn() {
 }
 
 
+// Streams frames through SlidingWindowCmnComputer in random-sized pieces, and
+// compares with normalizing each frame directly over its window.  The inputs
+// are long compared with the window and have a large offset, so any drift in
+// the running sums would show.
+void UnitTestSlidingWindowCmnComputer() {
+  for (int32 i = 0; i < 100; i++) {
+    int32 dim = 1 + rand() % 10;
+    SlidingWindowCmnOptions opts;
+    bool history_only = (rand() % 2 == 0);
+    opts.center = (!history_only && rand() % 2 == 0);
+    opts.normalize_variance = (rand() % 2 == 0);
+    opts.cmn_window = 5 + rand() % 50;
+    opts.min_window = 1 + rand() % opts.cmn_window;
+    int32 num_frames = 1 + rand() % (20 * opts.cmn_window);
+
+    Matrix<BaseFloat> feats(num_frames, dim), output_feats(num_frames, dim);
+    feats.SetRandn();
+    feats.Add(100.0);
+    SlidingWindowCmnComputer computer(opts, dim, history_only);
+    int32 t_in = 0;
+    while (computer.NumFramesOutput() < num_frames) {
+      int32 num_new = std::min(rand() % 20, num_frames - t_in);
+      for (int32 j = 0; j < num_new; j++, t_in++)
+        computer.AcceptFrame(feats.Row(t_in));
+      if (t_in == num_frames)
+        computer.InputFinished();
+      KALDI_ASSERT(computer.NumFramesAccepted() == t_in &&
+                   computer.NumFramesReady() <= t_in);
+      while (computer.NumFramesOutput() < computer.NumFramesReady()) {
+        SubVector<BaseFloat> frame(output_feats, computer.NumFramesOutput());
+        computer.OutputFrame(&frame);
+      }
+    }
+
+    for (int32 t = 0; t < num_frames; t++) {
+      int32 window_begin, window_end;
+      if (opts.center) {
+        window_begin = std::max(0, t - opts.cmn_window / 2);
+        window_end = window_begin + opts.cmn_window;
+      } else {
+        window_begin = std::max(0, t - opts.cmn_window);
+        window_end = std::max(history_only ? t : t + 1, opts.min_window);
+      }
+      if (window_end > num_frames) {
+        window_begin = std::max(0, window_begin - (window_end - num_frames));
+        window_end = num_frames;
+      }
+      int32 window_size = window_end - window_begin;
+      for (int32 d = 0; d < dim; d++) {
+        double sum = 0.0;
+        for (int32 t2 = window_begin; t2 < window_end; t2++)
+          sum += feats(t2, d);
+        double mean = sum / window_size, sumsq = 0.0;
+        for (int32 t2 = window_begin; t2 < window_end; t2++)
+          sumsq += (feats(t2, d) - mean) * (feats(t2, d) - mean);
+        double norm_data = feats(t, d) - mean;
+        if (opts.normalize_variance) {
+          if (window_size == 1) norm_data = 0.0;
+          else norm_data /= std::sqrt(std::max(sumsq / window_size, 1.0e-10));
+        }
+        KALDI_ASSERT(std::abs(output_feats(t, d) - norm_data) <
+                     1.0e-03 * std::max(1.0, std::abs(norm_data)));
+      }
+    }
+  }
+}
+
 }
 
 
@@ -101,6 +168,7 @@ int main() {
   using namespace kaldi;
   try {
     UnitTestOnlineCmvn();
+    UnitTestSlidingWindowCmnComputer();
     std::cout << "Tests succeeded.\n";
     return 0;
   } catch (const std::exception &e) {
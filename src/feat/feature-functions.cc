@@ -163,6 +163,55 @@ void ComputePowerSpectrum(VectorBase<BaseFloat> *waveform) {
   // if the signal has been bandlimited sensibly this should be zero.
 }
 
+void ExtractPowerSpectra(const VectorBase<BaseFloat> &wave,
+                         int32 first_frame,
+                         const FrameExtractionOptions &opts,
+                         const FeatureWindowFunction &window_function,
+                         bool raw_energy,
+                         SplitRadixRealFft<BaseFloat> *srfft,
+                         MatrixBase<BaseFloat> *power_spectra,
+                         VectorBase<BaseFloat> *log_energy) {
+  ExtractPowerSpectraAndEnergies(wave, first_frame, opts, window_function,
+                                 srfft, power_spectra,
+                                 (raw_energy ? log_energy : NULL),
+                                 (raw_energy ? NULL : log_energy));
+}
+
+void ExtractPowerSpectraAndEnergies(
+    const VectorBase<BaseFloat> &wave,
+    int32 first_frame,
+    const FrameExtractionOptions &opts,
+    const FeatureWindowFunction &window_function,
+    SplitRadixRealFft<BaseFloat> *srfft,
+    MatrixBase<BaseFloat> *power_spectra,
+    VectorBase<BaseFloat> *log_energy_raw,
+    VectorBase<BaseFloat> *log_energy_windowed) {
+  int32 num_frames = power_spectra->NumRows();
+  KALDI_ASSERT(power_spectra->NumCols() == opts.PaddedWindowSize());
+  KALDI_ASSERT(log_energy_raw == NULL || log_energy_raw->Dim() == num_frames);
+  KALDI_ASSERT(log_energy_windowed == NULL ||
+               log_energy_windowed->Dim() == num_frames);
+  Vector<BaseFloat> window;  // windowed waveform.
+  for (int32 i = 0; i < num_frames; i++) {
+    // Cut the window, apply window function
+    ExtractWindow(wave, first_frame + i, opts, window_function, &window,
+                  (log_energy_raw != NULL ? &((*log_energy_raw)(i)) : NULL));
+    // Compute energy after window function (not the raw one)
+    if (log_energy_windowed != NULL)
+      (*log_energy_windowed)(i) = log(VecVec(window, window));
+    if (srfft == NULL)  // An alternative algorithm that works for non-powers-of-two.
+      RealFft(&window, true);
+    power_spectra->Row(i).CopyFromVec(window);
+  }
+  if (srfft != NULL)  // Compute all the FFTs using the split-radix algorithm.
+    srfft->Compute(power_spectra, true);
+  for (int32 i = 0; i < num_frames; i++) {
+    // Convert the FFT into a power spectrum.
+    SubVector<BaseFloat> this_power_spectrum(*power_spectra, i);
+    ComputePowerSpectrum(&this_power_spectrum);
+  }
+}
+
 
 DeltaFeatures::DeltaFeatures(const DeltaFeaturesOptions &opts): opts_(opts) {
   KALDI_ASSERT(opts.order >= 0 && opts.order < 1000);  // just make sure we don't get binary junk.
@@ -390,104 +439,169 @@ void SlidingWindowCmnOptions::Check() const {
 }
 
 
-void SlidingWindowCmn(const SlidingWindowCmnOptions &opts,
-                      const MatrixBase<double> &input,
-                      MatrixBase<double> *output) {  
+SlidingWindowCmnComputer::SlidingWindowCmnComputer(
+    const SlidingWindowCmnOptions &opts, int32 dim, bool history_only):
+    opts_(opts), dim_(dim), history_only_(history_only), finished_(false),
+    num_accepted_(0), num_output_(0),
+    buffer_(std::max(opts.cmn_window, opts.min_window) + 2, dim, kUndefined),
+    window_start_(0), window_end_(0), sum_(dim), sumsq_(dim), frame_(dim),
+    variance_(dim), num_removed_(0) {
   opts.Check();
-  int32 num_frames = input.NumRows(), dim = input.NumCols();
+  KALDI_ASSERT(!(history_only && opts.center));
+  if (history_only)
+    KALDI_ASSERT(opts.min_window > 0);
+}
 
-  int32 last_window_start = -1, last_window_end = -1;
-  Vector<double> cur_sum(dim), cur_sumsq(dim);
-    
-  for (int32 t = 0; t < num_frames; t++) {
-    int32 window_start, window_end; // note: window_end will be one
-    // past the end of the window we use for normalization.
-    if (opts.center) {
-      window_start = t - (opts.cmn_window / 2);
-      window_end = window_start + opts.cmn_window;
-    } else {
-      window_start = t - opts.cmn_window;
-      window_end = t + 1;
-    }
-    if (window_start < 0) { // shift window right if starts <0.
-      window_end -= window_start;
-      window_start = 0; // or: window_start -= window_start
-    }
-    if (!opts.center) {
-      if (window_end > t)
-        window_end = std::max(t + 1, opts.min_window);
-    }
-    if (window_end > num_frames) {
-      window_start -= (window_end - num_frames);
-      window_end = num_frames;
-      if (window_start < 0) window_start = 0;
+template<typename Real>
+void SlidingWindowCmnComputer::AcceptFrame(const VectorBase<Real> &frame) {
+  KALDI_ASSERT(!finished_ && frame.Dim() == dim_);
+  int32 size = buffer_.NumRows();
+  if (num_accepted_ - window_start_ == size) {
+    // The buffer is full, because the frames are not being output as soon as
+    // they are ready; make it bigger.
+    Matrix<double> new_buffer(2 * size, dim_, kUndefined);
+    for (int32 t = window_start_; t < num_accepted_; t++)
+      new_buffer.Row(t % (2 * size)).CopyFromVec(buffer_.Row(t % size));
+    buffer_.Swap(&new_buffer);
+  }
+  BufferedFrame(num_accepted_).CopyFromVec(frame);
+  num_accepted_++;
+}
+
+// Instantiate the template for float and double.
+template
+void SlidingWindowCmnComputer::AcceptFrame(const VectorBase<float> &frame);
+template
+void SlidingWindowCmnComputer::AcceptFrame(const VectorBase<double> &frame);
+
+void SlidingWindowCmnComputer::InputFinished() {
+  finished_ = true;
+}
+
+void SlidingWindowCmnComputer::GetWindow(int32 t, int32 *start,
+                                         int32 *end) const {
+  // This follows the windows used by SlidingWindowCmn() before it used this
+  // class; "end" is one past the end of the window.
+  if (opts_.center) {
+    *start = t - (opts_.cmn_window / 2);
+    *end = *start + opts_.cmn_window;
+  } else {
+    *start = t - opts_.cmn_window;
+    *end = t + 1;
+  }
+  if (*start < 0) {  // shift window right if starts < 0.
+    *end -= *start;
+    *start = 0;
+  }
+  if (!opts_.center)
+    *end = std::max(history_only_ ? t : t + 1, opts_.min_window);
+  if (finished_ && *end > num_accepted_) {
+    *start -= (*end - num_accepted_);
+    *end = num_accepted_;
+    if (*start < 0) *start = 0;
+  }
+}
+
+int32 SlidingWindowCmnComputer::NumFramesReady() const {
+  if (finished_)
+    return num_accepted_;
+  // The frames whose windows (as given by GetWindow() without the end effects)
+  // end at or before num_accepted_.
+  if (!opts_.center)
+    return (num_accepted_ >= opts_.min_window ? num_accepted_ : 0);
+  int32 lookahead = opts_.cmn_window - opts_.cmn_window / 2;
+  return (num_accepted_ >= opts_.cmn_window ?
+          num_accepted_ - lookahead + 1 : 0);
+}
+
+template<typename Real>
+void SlidingWindowCmnComputer::OutputFrame(VectorBase<Real> *frame) {
+  KALDI_ASSERT(num_output_ < NumFramesReady() && frame->Dim() == dim_);
+  int32 t = num_output_, start, end;
+  GetWindow(t, &start, &end);
+  KALDI_ASSERT(start >= window_start_ && end >= window_end_ &&
+               end <= num_accepted_);
+  // Move the window; each frame enters and leaves it once.
+  for (; window_end_ < end; window_end_++) {
+    SubVector<double> frame_to_add(BufferedFrame(window_end_));
+    sum_.AddVec(1.0, frame_to_add);
+    if (opts_.normalize_variance)
+      sumsq_.AddVec2(1.0, frame_to_add);
+  }
+  for (; window_start_ < start; window_start_++) {
+    SubVector<double> frame_to_remove(BufferedFrame(window_start_));
+    sum_.AddVec(-1.0, frame_to_remove);
+    if (opts_.normalize_variance)
+      sumsq_.AddVec2(-1.0, frame_to_remove);
+    num_removed_++;
+  }
+  if (num_removed_ >= opts_.cmn_window) {
+    // Recompute the sums from the frames, so that rounding errors from
+    // adding and removing frames do not build up over long inputs.  This
+    // costs O(dim) per frame on average.
+    sum_.SetZero();
+    sumsq_.SetZero();
+    for (int32 i = window_start_; i < window_end_; i++) {
+      SubVector<double> this_frame(BufferedFrame(i));
+      sum_.AddVec(1.0, this_frame);
+      if (opts_.normalize_variance)
+        sumsq_.AddVec2(1.0, this_frame);
     }
-    if (last_window_start == -1) {
-      SubMatrix<double> input_part(input, 
-                                      window_start, window_end - window_start,
-                                      0, dim);
-      cur_sum.AddRowSumMat(1.0, input_part , 0.0);
-      if (opts.normalize_variance)
-        cur_sumsq.AddDiagMat2(1.0, input_part, kTrans, 0.0);
+    num_removed_ = 0;
+  }
+
+  int32 window_frames = window_end_ - window_start_;
+  KALDI_ASSERT(window_frames > 0);
+  frame_.CopyFromVec(BufferedFrame(t));
+  frame_.AddVec(-1.0 / window_frames, sum_);
+  if (opts_.normalize_variance) {
+    if (window_frames == 1) {
+      frame_.Set(0.0);
     } else {
-      if (window_start > last_window_start) {
-        KALDI_ASSERT(window_start == last_window_start + 1);
-        SubVector<double> frame_to_remove(input, last_window_start);
-        cur_sum.AddVec(-1.0, frame_to_remove);
-        if (opts.normalize_variance)
-          cur_sumsq.AddVec2(-1.0, frame_to_remove);
-      }
-      if (window_end > last_window_end) {
-        KALDI_ASSERT(window_end == last_window_end + 1);
-        SubVector<double> frame_to_add(input, last_window_end);
-        cur_sum.AddVec(1.0, frame_to_add);
-        if (opts.normalize_variance)
-          cur_sumsq.AddVec2(1.0, frame_to_add);
-      }
-    }
-    int32 window_frames = window_end - window_start;
-    last_window_start = window_start;
-    last_window_end = window_end;
-
-    KALDI_ASSERT(window_frames > 0); 
-    SubVector<double> input_frame(input, t),
-        output_frame(*output, t);
-    output_frame.CopyFromVec(input_frame);
-    output_frame.AddVec(-1.0 / window_frames, cur_sum);
-
-    if (opts.normalize_variance) {
-      if (window_frames == 1) {
-        output_frame.Set(0.0);
-      } else {
-        Vector<double> variance(cur_sumsq);
-        variance.Scale(1.0 / window_frames);
-        variance.AddVec2(-1.0 / (window_frames * window_frames), cur_sum);
-        // now "variance" is the variance of the features in the window,
-        // around their own mean.
-        int32 num_floored = variance.ApplyFloor(1.0e-10);
-        if (num_floored > 0 && num_frames > 1) {
-          KALDI_WARN << "Flooring variance When normalizing variance, floored " << num_floored
-                     << " elements; num-frames was " << window_frames;
-        }
-        variance.ApplyPow(-0.5); // get inverse standard deviation.
-        output_frame.MulElements(variance);
+      variance_.CopyFromVec(sumsq_);
+      variance_.Scale(1.0 / window_frames);
+      variance_.AddVec2(-1.0 / (static_cast<double>(window_frames) *
+                                window_frames), sum_);
+      // now "variance" is the variance of the features in the window,
+      // around their own mean.
+      int32 num_floored = variance_.ApplyFloor(1.0e-10);
+      if (num_floored > 0) {
+        KALDI_WARN << "Flooring variance When normalizing variance, floored "
+                   << num_floored << " elements; num-frames was "
+                   << window_frames;
       }
+      variance_.ApplyPow(-0.5);  // get inverse standard deviation.
+      frame_.MulElements(variance_);
     }
   }
+  frame->CopyFromVec(frame_);
+  num_output_++;
 }
 
+// Instantiate the template for float and double.
+template
+void SlidingWindowCmnComputer::OutputFrame(VectorBase<float> *frame);
+template
+void SlidingWindowCmnComputer::OutputFrame(VectorBase<double> *frame);
 
 
 void SlidingWindowCmn(const SlidingWindowCmnOptions &opts,
                       const MatrixBase<BaseFloat> &input,
                       MatrixBase<BaseFloat> *output) {
   KALDI_ASSERT(SameDim(input, *output) && input.NumRows() > 0);
-  Matrix<double> input_dbl(input), output_dbl(input.NumRows(), input.NumCols());
-  // calll double-precision version
-  SlidingWindowCmn(opts, input_dbl, &output_dbl);
-  output->CopyFromMat(output_dbl);
+  int32 num_frames = input.NumRows();
+  SlidingWindowCmnComputer computer(opts, input.NumCols());
+  for (int32 t = 0; t < num_frames; t++) {
+    computer.AcceptFrame(input.Row(t));
+    if (t + 1 == num_frames)
+      computer.InputFinished();
+    for (int32 ready = computer.NumFramesReady();
+         computer.NumFramesOutput() < ready; ) {
+      SubVector<BaseFloat> output_frame(*output, computer.NumFramesOutput());
+      computer.OutputFrame(&output_frame);
+    }
+  }
 }
-  
 
 
 }  // namespace kaldi
@@ -21,6 +21,7 @@
 #ifndef KALDI_FEAT_FEATURE_FUNCTIONS_H_
 #define KALDI_FEAT_FEATURE_FUNCTIONS_H_
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -165,6 +166,42 @@ void ExtractWaveformRemainder(const VectorBase<BaseFloat> &wave,
 void ComputePowerSpectrum(VectorBase<BaseFloat> *complex_fft);
 
 
+// Number of frames the feature extractors process at a time; the FFTs of each
+// such chunk are computed as a batch (see ExtractPowerSpectra()).
+const int32 kFeatureChunkSize = 64;
+
+// ExtractPowerSpectra extracts the windowed frames first_frame, first_frame +
+// 1, ... of "wave" (one per row of "power_spectra", which must have
+// opts.PaddedWindowSize() columns) as ExtractWindow() would, and converts each
+// one to a power spectrum as RealFft() followed by ComputePowerSpectrum()
+// would, so the first PaddedWindowSize()/2 + 1 elements of each row are the
+// output.  If srfft != NULL (it must then have PaddedWindowSize() points), the
+// FFTs are done as a batch, which is faster; otherwise RealFft() is used for
+// each frame.  If log_energy != NULL, it gets the log-energy of each frame,
+// before windowing if raw_energy == true and after it otherwise.
+void ExtractPowerSpectra(const VectorBase<BaseFloat> &wave,
+                         int32 first_frame,
+                         const FrameExtractionOptions &opts,
+                         const FeatureWindowFunction &window_function,
+                         bool raw_energy,
+                         SplitRadixRealFft<BaseFloat> *srfft,
+                         MatrixBase<BaseFloat> *power_spectra,
+                         VectorBase<BaseFloat> *log_energy = NULL);
+
+// This is as ExtractPowerSpectra(), but it can output the log-energies both
+// before windowing (to "log_energy_raw") and after it (to
+// "log_energy_windowed"); either may be NULL.  It is used when several feature
+// types with different "raw_energy" options share the same power spectra.
+void ExtractPowerSpectraAndEnergies(
+    const VectorBase<BaseFloat> &wave,
+    int32 first_frame,
+    const FrameExtractionOptions &opts,
+    const FeatureWindowFunction &window_function,
+    SplitRadixRealFft<BaseFloat> *srfft,
+    MatrixBase<BaseFloat> *power_spectra,
+    VectorBase<BaseFloat> *log_energy_raw,
+    VectorBase<BaseFloat> *log_energy_windowed);
+
 
 inline void MaxNormalizeEnergy(Matrix<BaseFloat> *feats) {
   // Just subtract the largest energy value... assume energy is the first
@@ -336,6 +373,80 @@ void SlidingWindowCmn(const SlidingWindowCmnOptions &opts,
                       MatrixBase<BaseFloat> *output);
 
 
+/// SlidingWindowCmnComputer does the work of SlidingWindowCmn() on a stream
+/// of frames, for online feature extraction: frames are given one by one to
+/// AcceptFrame(), and each normalized frame can be output once all the frames
+/// in its window have been accepted (or InputFinished() has been called).
+/// The window sums are kept in double and updated as frames enter and leave
+/// the window, so each frame costs O(dim) whatever the window size; only the
+/// frames that may still be needed are kept.
+///
+/// If "history_only" is true (only allowed if !opts.center), the window of a
+/// frame is the cmn_window frames before it, excluding the frame itself, or
+/// the first min_window frames at the start, as in OnlineCmnInput.
+class SlidingWindowCmnComputer {
+ public:
+  SlidingWindowCmnComputer(const SlidingWindowCmnOptions &opts, int32 dim,
+                           bool history_only = false);
+
+  int32 Dim() const { return dim_; }
+
+  /// Accepts the next frame of input; Real is float or double.
+  template<typename Real>
+  void AcceptFrame(const VectorBase<Real> &frame);
+
+  /// Says that there will be no more input, which allows the frames near the
+  /// end to be output.
+  void InputFinished();
+
+  /// Returns the number of frames accepted so far.
+  int32 NumFramesAccepted() const { return num_accepted_; }
+
+  /// Returns the number of frames that can be output, counting from the
+  /// start of the input (including those already output).
+  int32 NumFramesReady() const;
+
+  /// Returns the number of frames output so far.
+  int32 NumFramesOutput() const { return num_output_; }
+
+  /// Outputs the next normalized frame; requires NumFramesOutput() <
+  /// NumFramesReady().
+  template<typename Real>
+  void OutputFrame(VectorBase<Real> *frame);
+
+ private:
+  // Works out the window [*start, *end) for frame t, with the number of frames
+  // taken to be "num_frames" (if finished_) or unlimited.
+  void GetWindow(int32 t, int32 *start, int32 *end) const;
+
+  // Returns the row of buffer_ that holds frame t.
+  SubVector<double> BufferedFrame(int32 t) {
+    return buffer_.Row(t % buffer_.NumRows());
+  }
+
+  SlidingWindowCmnOptions opts_;
+  int32 dim_;
+  bool history_only_;
+  bool finished_;
+  int32 num_accepted_;
+  int32 num_output_;
+  // Circular buffer holding frames window_start_ to num_accepted_ - 1; it
+  // grows if needed.
+  Matrix<double> buffer_;
+  // The sums are over frames window_start_ to window_end_ - 1.
+  int32 window_start_;
+  int32 window_end_;
+  Vector<double> sum_;
+  Vector<double> sumsq_;
+  Vector<double> frame_;  // Temporary storage for the output frame.
+  Vector<double> variance_;  // Temporary storage for the variance.
+  // The number of frames removed from the sums since they were last
+  // recomputed from scratch.
+  int32 num_removed_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SlidingWindowCmnComputer);
+};
+
+
 /// @} End of "addtogroup feat"
 }  // namespace kaldi
 
@@ -60,6 +60,12 @@ struct MfccOptions {
 
   void Register(OptionsItf *po) {
     frame_opts.Register(po);
+    RegisterNonFrameOptions(po);
+  }
+
+  /// Registers all options except frame_opts; for programs where the framing
+  /// is shared between several feature types (see MultiFeatureOptions).
+  void RegisterNonFrameOptions(OptionsItf *po) {
     mel_opts.Register(po);
     po->Register("num-ceps", &num_ceps,
                  "Number of cepstra in MFCC computation (including C0)");
@@ -84,6 +90,7 @@ class MelBanks;
 /// Class for computing MFCC features; see \ref feat_mfcc for more information.
 class Mfcc {
  public:
+  typedef MfccOptions Options;
   explicit Mfcc(const MfccOptions &opts);
   ~Mfcc();
 
@@ -101,6 +108,16 @@ class Mfcc {
                Matrix<BaseFloat> *output,
                Vector<BaseFloat> *wave_remainder = NULL);
   
+  /// Computes the features of a chunk of frames from their power spectra, as
+  /// output by ExtractPowerSpectra() with the frame options given to this
+  /// class, and their log-energies (only used if use_energy == true).
+  /// "output" must have the same number of rows as "power_spectra", and Dim()
+  /// columns.
+  void ComputeFromPowerSpectra(const MatrixBase<BaseFloat> &power_spectra,
+                               const VectorBase<BaseFloat> &log_energies,
+                               BaseFloat vtln_warp,
+                               MatrixBase<BaseFloat> *output);
+
   void ComputeFromFbank(const Matrix<BaseFloat> &fbank,
                Matrix<BaseFloat> *output);
 
@@ -0,0 +1,103 @@
+// feat/feature-multi-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+
+#include "feat/feature-multi.h"
+#include "feat/wave-reader.h"
+
+namespace kaldi {
+
+static void ReadTestWave(Vector<BaseFloat> *v) {
+  std::ifstream is("test_data/test.wav");
+  WaveData wave;
+  wave.Read(is);
+  const Matrix<BaseFloat> data(wave.Data());
+  KALDI_ASSERT(data.NumRows() == 1);
+  v->Resize(data.NumCols());
+  v->CopyFromVec(data.Row(0));
+}
+
+// Checks that the features computed together from the shared power spectra
+// are the same as those computed separately.
+static void UnitTestMultiFeatures(const VectorBase<BaseFloat> &wave) {
+  MultiFeatureOptions opts;
+  opts.frame_opts.dither = 0.0;
+  opts.frame_opts.round_to_power_of_two = (rand() % 2 == 0);
+  opts.frame_opts.frame_length_ms = 20.0 + rand() % 10;
+  if (rand() % 2 == 0) opts.frame_opts.window_type = "hamming";
+  opts.mfcc_opts.raw_energy = (rand() % 2 == 0);
+  opts.mfcc_opts.htk_compat = (rand() % 2 == 0);
+  opts.fbank_opts.use_energy = (rand() % 2 == 0);
+  opts.fbank_opts.raw_energy = (rand() % 2 == 0);
+  opts.fbank_opts.mel_opts.num_bins = 20 + rand() % 20;
+  opts.plp_opts.raw_energy = (rand() % 2 == 0);
+  opts.plp_opts.use_energy = (rand() % 2 == 0);
+  opts.spectrogram_opts.raw_energy = (rand() % 2 == 0);
+  BaseFloat vtln_warp = (rand() % 2 == 0 ? 1.0 : 0.9);
+
+  MultiFeatureComputer computer(opts);
+  Matrix<BaseFloat> mfcc, fbank, plp, spectrogram, pitch;
+  bool use_mfcc = (rand() % 2 == 0), use_fbank = (rand() % 2 == 0),
+      use_plp = (rand() % 2 == 0), use_pitch = (rand() % 4 == 0);
+  computer.Compute(wave, vtln_warp,
+                   (use_mfcc ? &mfcc : NULL), (use_fbank ? &fbank : NULL),
+                   (use_plp ? &plp : NULL), &spectrogram,
+                   (use_pitch ? &pitch : NULL));
+
+  Matrix<BaseFloat> ref;
+  if (use_mfcc) {
+    opts.mfcc_opts.frame_opts = opts.frame_opts;
+    Mfcc mfcc_ref(opts.mfcc_opts);
+    mfcc_ref.Compute(wave, vtln_warp, &ref);
+    AssertEqual(mfcc, ref);
+  } else {
+    KALDI_ASSERT(mfcc.NumRows() == 0);
+  }
+  if (use_fbank) {
+    opts.fbank_opts.frame_opts = opts.frame_opts;
+    Fbank fbank_ref(opts.fbank_opts);
+    fbank_ref.Compute(wave, vtln_warp, &ref);
+    AssertEqual(fbank, ref);
+  }
+  if (use_plp) {
+    opts.plp_opts.frame_opts = opts.frame_opts;
+    Plp plp_ref(opts.plp_opts);
+    plp_ref.Compute(wave, vtln_warp, &ref);
+    AssertEqual(plp, ref);
+  }
+  opts.spectrogram_opts.frame_opts = opts.frame_opts;
+  Spectrogram spectrogram_ref(opts.spectrogram_opts);
+  spectrogram_ref.Compute(wave, &ref);
+  AssertEqual(spectrogram, ref);
+  if (use_pitch) {
+    Compute(opts.pitch_opts, wave, &ref);
+    AssertEqual(pitch, ref);
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  Vector<BaseFloat> wave;
+  ReadTestWave(&wave);
+  for (int32 i = 0; i < 10; i++)
+    UnitTestMultiFeatures(wave);
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,139 @@
+// feat/feature-multi.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/feature-multi.h"
+
+
+namespace kaldi {
+
+// Returns a copy of "opts" with its frame options replaced by "frame_opts".
+template<class Options>
+static Options WithFrameOptions(const Options &opts,
+                                const FrameExtractionOptions &frame_opts) {
+  Options ans(opts);
+  ans.frame_opts = frame_opts;
+  return ans;
+}
+
+MultiFeatureComputer::MultiFeatureComputer(const MultiFeatureOptions &opts)
+    : opts_(opts),
+      mfcc_(WithFrameOptions(opts.mfcc_opts, opts.frame_opts)),
+      fbank_(WithFrameOptions(opts.fbank_opts, opts.frame_opts)),
+      plp_(WithFrameOptions(opts.plp_opts, opts.frame_opts)),
+      spectrogram_(WithFrameOptions(opts.spectrogram_opts, opts.frame_opts)),
+      feature_window_function_(opts.frame_opts), srfft_(NULL) {
+  int32 padded_window_size = opts.frame_opts.PaddedWindowSize();
+  if ((padded_window_size & (padded_window_size-1)) == 0)  // Is a power of two...
+    srfft_ = new SplitRadixRealFft<BaseFloat>(padded_window_size);
+}
+
+MultiFeatureComputer::~MultiFeatureComputer() {
+  if (srfft_ != NULL)
+    delete srfft_;
+}
+
+void MultiFeatureComputer::Compute(const VectorBase<BaseFloat> &wave,
+                                   BaseFloat vtln_warp,
+                                   Matrix<BaseFloat> *mfcc,
+                                   Matrix<BaseFloat> *fbank,
+                                   Matrix<BaseFloat> *plp,
+                                   Matrix<BaseFloat> *spectrogram,
+                                   Matrix<BaseFloat> *pitch) {
+  if (pitch != NULL) {
+    const PitchExtractionOptions &pitch_opts = opts_.pitch_opts;
+    if (pitch_opts.samp_freq != opts_.frame_opts.samp_freq ||
+        pitch_opts.frame_shift_ms != opts_.frame_opts.frame_shift_ms)
+      KALDI_ERR << "Sample frequency and frame shift of the pitch ("
+                << pitch_opts.samp_freq << ", " << pitch_opts.frame_shift_ms
+                << ") do not match those of the other features ("
+                << opts_.frame_opts.samp_freq << ", "
+                << opts_.frame_opts.frame_shift_ms << ")";
+    kaldi::Compute(pitch_opts, wave, pitch);
+  }
+  if (mfcc == NULL && fbank == NULL && plp == NULL && spectrogram == NULL)
+    return;
+
+  int32 rows_out = NumFrames(wave.Dim(), opts_.frame_opts);
+  if (rows_out == 0)
+    KALDI_ERR << "No frames fit in file (#samples is " << wave.Dim() << ")";
+  if (mfcc != NULL) mfcc->Resize(rows_out, mfcc_.Dim());
+  if (fbank != NULL) fbank->Resize(rows_out, fbank_.Dim());
+  if (plp != NULL) plp->Resize(rows_out, plp_.Dim());
+  if (spectrogram != NULL) spectrogram->Resize(rows_out, spectrogram_.Dim());
+
+  // Work out which kinds of log-energy we need: the features may differ in
+  // whether they compute it before or after windowing.
+  const MfccOptions &mo = opts_.mfcc_opts;
+  const FbankOptions &fo = opts_.fbank_opts;
+  const PlpOptions &po = opts_.plp_opts;
+  const SpectrogramOptions &so = opts_.spectrogram_opts;
+  bool need_raw_energy =
+      (mfcc != NULL && mo.use_energy && mo.raw_energy) ||
+      (fbank != NULL && fo.use_energy && fo.raw_energy) ||
+      (plp != NULL && po.use_energy && po.raw_energy) ||
+      (spectrogram != NULL && so.raw_energy),
+      need_windowed_energy =
+      (mfcc != NULL && mo.use_energy && !mo.raw_energy) ||
+      (fbank != NULL && fo.use_energy && !fo.raw_energy) ||
+      (plp != NULL && po.use_energy && !po.raw_energy) ||
+      (spectrogram != NULL && !so.raw_energy);
+
+  // Buffers
+  Matrix<BaseFloat> power_spectra;  // power spectra of a chunk of frames.
+  Vector<BaseFloat> raw_log_energies,  // their log-energies before windowing,
+      windowed_log_energies;  // and after it.
+  int32 padded_window_size = opts_.frame_opts.PaddedWindowSize();
+
+  // Compute the frames in chunks, so the FFTs can be done as a batch.
+  for (int32 start = 0; start < rows_out; start += kFeatureChunkSize) {
+    int32 this_num_frames = std::min(kFeatureChunkSize, rows_out - start);
+    power_spectra.Resize(this_num_frames, padded_window_size, kUndefined);
+    raw_log_energies.Resize(this_num_frames);
+    windowed_log_energies.Resize(this_num_frames);
+    ExtractPowerSpectraAndEnergies(
+        wave, start, opts_.frame_opts, feature_window_function_, srfft_,
+        &power_spectra, (need_raw_energy ? &raw_log_energies : NULL),
+        (need_windowed_energy ? &windowed_log_energies : NULL));
+    if (mfcc != NULL) {
+      SubMatrix<BaseFloat> this_output(mfcc->RowRange(start, this_num_frames));
+      mfcc_.ComputeFromPowerSpectra(
+          power_spectra, (mo.raw_energy ? raw_log_energies :
+                          windowed_log_energies), vtln_warp, &this_output);
+    }
+    if (fbank != NULL) {
+      SubMatrix<BaseFloat> this_output(fbank->RowRange(start, this_num_frames));
+      fbank_.ComputeFromPowerSpectra(
+          power_spectra, (fo.raw_energy ? raw_log_energies :
+                          windowed_log_energies), vtln_warp, &this_output);
+    }
+    if (plp != NULL) {
+      SubMatrix<BaseFloat> this_output(plp->RowRange(start, this_num_frames));
+      plp_.ComputeFromPowerSpectra(
+          power_spectra, (po.raw_energy ? raw_log_energies :
+                          windowed_log_energies), vtln_warp, &this_output);
+    }
+    if (spectrogram != NULL) {
+      SubMatrix<BaseFloat> this_output(spectrogram->RowRange(start,
+                                                             this_num_frames));
+      spectrogram_.ComputeFromPowerSpectra(
+          power_spectra, (so.raw_energy ? raw_log_energies :
+                          windowed_log_energies), &this_output);
+    }
+  }
+}
+
+}  // namespace kaldi
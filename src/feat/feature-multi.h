@@ -0,0 +1,105 @@
+// feat/feature-multi.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FEAT_FEATURE_MULTI_H_
+#define KALDI_FEAT_FEATURE_MULTI_H_
+
+#include <string>
+
+#include "feat/feature-functions.h"
+#include "feat/feature-mfcc.h"
+#include "feat/feature-fbank.h"
+#include "feat/feature-plp.h"
+#include "feat/feature-spectrogram.h"
+#include "feat/pitch-functions.h"
+#include "util/parse-options.h"
+
+namespace kaldi {
+/// @addtogroup  feat FeatureExtraction
+/// @{
+
+
+/// MultiFeatureOptions contains the options for computing several feature
+/// types from the same waveform.  The framing options (frame_opts) are shared
+/// by the MFCC, filterbank, PLP and spectrogram features, and override the
+/// frame_opts members of their own option structs.  The pitch extractor has
+/// its own framing, but its sample frequency and frame shift must agree with
+/// frame_opts so that the outputs line up.
+struct MultiFeatureOptions {
+  FrameExtractionOptions frame_opts;
+  MfccOptions mfcc_opts;
+  FbankOptions fbank_opts;
+  PlpOptions plp_opts;
+  SpectrogramOptions spectrogram_opts;
+  PitchExtractionOptions pitch_opts;
+
+  /// Registers frame_opts without a prefix, and the other options with the
+  /// prefixes "mfcc", "fbank", "plp", "spectrogram" and "pitch", e.g.
+  /// --mfcc.num-ceps=20 or --pitch.min-f0=60.
+  void Register(ParseOptions *po) {
+    frame_opts.Register(po);
+    ParseOptions po_mfcc("mfcc", po), po_fbank("fbank", po),
+        po_plp("plp", po), po_spectrogram("spectrogram", po),
+        po_pitch("pitch", po);
+    mfcc_opts.RegisterNonFrameOptions(&po_mfcc);
+    fbank_opts.RegisterNonFrameOptions(&po_fbank);
+    plp_opts.RegisterNonFrameOptions(&po_plp);
+    spectrogram_opts.RegisterNonFrameOptions(&po_spectrogram);
+    pitch_opts.Register(&po_pitch);
+  }
+};
+
+
+/// MultiFeatureComputer computes any subset of MFCC, filterbank, PLP,
+/// spectrogram and pitch features of a waveform.  The framing, windowing and
+/// FFT are done once and the power spectra are shared by all the
+/// spectrum-based features; the results are the same as from the separate
+/// classes (apart from the dithering, which is done only once).  This class is
+/// not thread-safe; use one object per thread.
+class MultiFeatureComputer {
+ public:
+  explicit MultiFeatureComputer(const MultiFeatureOptions &opts);
+  ~MultiFeatureComputer();
+
+  /// Computes the features whose output pointers are non-NULL; the others are
+  /// not computed.  Will throw exception on failure (e.g. if the waveform is
+  /// too short for even one frame).
+  void Compute(const VectorBase<BaseFloat> &wave,
+               BaseFloat vtln_warp,
+               Matrix<BaseFloat> *mfcc,
+               Matrix<BaseFloat> *fbank,
+               Matrix<BaseFloat> *plp,
+               Matrix<BaseFloat> *spectrogram,
+               Matrix<BaseFloat> *pitch);
+
+ private:
+  MultiFeatureOptions opts_;
+  Mfcc mfcc_;
+  Fbank fbank_;
+  Plp plp_;
+  Spectrogram spectrogram_;
+  FeatureWindowFunction feature_window_function_;
+  SplitRadixRealFft<BaseFloat> *srfft_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MultiFeatureComputer);
+};
+
+
+/// @} End of "addtogroup feat"
+}  // namespace kaldi
+
+
+#endif  // KALDI_FEAT_FEATURE_MULTI_H_
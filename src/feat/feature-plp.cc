@@ -98,7 +98,33 @@ void Plp::Compute(const VectorBase<BaseFloat> &wave,
   output->Resize(rows_out, cols_out);
   if (wave_remainder != NULL)
     ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
-  Vector<BaseFloat> window;  // windowed waveform.
+  Matrix<BaseFloat> power_spectra;  // power spectra of a chunk of frames.
+  Vector<BaseFloat> log_energies;  // and their log-energies.
+  int32 padded_window_size = opts_.frame_opts.PaddedWindowSize();
+  // Compute the frames in chunks, so the FFTs can be done as a batch.
+  for (int32 start = 0; start < rows_out; start += kFeatureChunkSize) {
+    int32 this_num_frames = std::min(kFeatureChunkSize, rows_out - start);
+    power_spectra.Resize(this_num_frames, padded_window_size, kUndefined);
+    log_energies.Resize(this_num_frames);
+    ExtractPowerSpectra(wave, start, opts_.frame_opts, feature_window_function_,
+                        opts_.raw_energy, srfft_, &power_spectra,
+                        (opts_.use_energy ? &log_energies : NULL));
+    SubMatrix<BaseFloat> this_output(output->RowRange(start, this_num_frames));
+    ComputeFromPowerSpectra(power_spectra, log_energies, vtln_warp,
+                            &this_output);
+  }
+}
+
+void Plp::ComputeFromPowerSpectra(const MatrixBase<BaseFloat> &power_spectra,
+                                  const VectorBase<BaseFloat> &log_energies,
+                                  BaseFloat vtln_warp,
+                                  MatrixBase<BaseFloat> *output) {
+  int32 num_frames = power_spectra.NumRows(),
+      padded_window_size = opts_.frame_opts.PaddedWindowSize();
+  KALDI_ASSERT(power_spectra.NumCols() >= padded_window_size/2 + 1 &&
+               log_energies.Dim() == num_frames &&
+               output->NumRows() == num_frames &&
+               output->NumCols() == opts_.num_ceps);
   int32 num_mel_bins = opts_.mel_opts.num_bins;
   Vector<BaseFloat> mel_energies(num_mel_bins);
   Vector<BaseFloat> mel_energies_duplicated(num_mel_bins+2);
@@ -108,33 +134,19 @@ void Plp::Compute(const VectorBase<BaseFloat> &wave,
   // and size may differ from final size.
   Vector<BaseFloat> final_cepstrum(opts_.num_ceps);
   KALDI_ASSERT(opts_.num_ceps <= opts_.lpc_order+1);  // our num-ceps includes C0.
-  for (int32 r = 0; r < rows_out; r++) {  // r is frame index..
-    BaseFloat log_energy;
-    ExtractWindow(wave, r, opts_.frame_opts,
-                  feature_window_function_, &window,
-                  (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
-
-    if (opts_.use_energy && !opts_.raw_energy)
-      log_energy = log(VecVec(window, window));
-
-    if (srfft_ != NULL)  // Compute FFT using split-radix algorithm.
-      srfft_->Compute(window.Data(), true);
-    else  // An alternative algorithm that works for non-powers-of-two.
-      RealFft(&window, true);
-
-    // Convert the FFT into a power spectrum.
-    ComputePowerSpectrum(&window);  // elements 0 ... window.Dim()/2
-
-    SubVector<BaseFloat> power_spectrum(window, 0, window.Dim()/2 + 1);
-
-    const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
+  const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
+  const Vector<BaseFloat> *equal_loudness = GetEqualLoudness(vtln_warp);
+  for (int32 r = 0; r < num_frames; r++) {  // r is frame index..
+    BaseFloat log_energy = log_energies(r);
+    SubVector<BaseFloat> power_spectrum(power_spectra.Row(r), 0,
+                                        padded_window_size/2 + 1);
 
     this_mel_banks->Compute(power_spectrum, &mel_energies);
 
     // HTK doesn't log the mel bank outputs for the PLPs' [HARDCODED]
     // mel_energies.ApplyLog();  // take the log.
 
-    mel_energies.MulElements(*GetEqualLoudness(vtln_warp));
+    mel_energies.MulElements(*equal_loudness);
 
     mel_energies.ApplyPow(opts_.compress_factor);
 
@@ -183,7 +195,6 @@ void Plp::Compute(const VectorBase<BaseFloat> &wave,
     }
 
     output->Row(r).CopyFromVec(final_cepstrum);
-    // std::cout << "FIN" << final_cepstrum;
   }
 }
 
@@ -68,6 +68,12 @@ struct PlpOptions {
 
   void Register(OptionsItf *po) {
     frame_opts.Register(po);
+    RegisterNonFrameOptions(po);
+  }
+
+  /// Registers all options except frame_opts; for programs where the framing
+  /// is shared between several feature types (see MultiFeatureOptions).
+  void RegisterNonFrameOptions(OptionsItf *po) {
     mel_opts.Register(po);
     po->Register("lpc-order", &lpc_order,
                  "Order of LPC analysis in PLP computation");
@@ -97,6 +103,7 @@ struct PlpOptions {
 /// documentation will eventually be added.
 class Plp {
  public:
+  typedef PlpOptions Options;
   explicit Plp(const PlpOptions &opts);
   ~Plp();
 
@@ -107,6 +114,13 @@ class Plp {
                Matrix<BaseFloat> *output,
                Vector<BaseFloat> *wave_remainder = NULL);
 
+  /// Computes the features of a chunk of frames from their power spectra and
+  /// log-energies; see Mfcc::ComputeFromPowerSpectra().
+  void ComputeFromPowerSpectra(const MatrixBase<BaseFloat> &power_spectra,
+                               const VectorBase<BaseFloat> &log_energies,
+                               BaseFloat vtln_warp,
+                               MatrixBase<BaseFloat> *output);
+
  private:
   const MelBanks *GetMelBanks(BaseFloat vtln_warp);
   const Vector<BaseFloat> *GetEqualLoudness(BaseFloat vtln_warp);
@@ -0,0 +1,203 @@
+// feat/feature-segments-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <unistd.h>
+
+#include "feat/feature-segments.h"
+#include "feat/feature-mfcc.h"
+#include "feat/feature-fbank.h"
+#include "util/kaldi-io.h"
+#include "util/kaldi-table.h"
+
+namespace kaldi {
+
+static void UnitTestSegmentParse() {
+  Segment segment;
+  KALDI_ASSERT(segment.Parse("seg1 rec1 1.10 2.36"));
+  KALDI_ASSERT(segment.id == "seg1" && segment.recording == "rec1" &&
+               segment.start_time == 1.10 && segment.end_time == 2.36 &&
+               segment.channel == -1);
+  KALDI_ASSERT(segment.Parse("seg1\trec1 0 -1 1"));
+  KALDI_ASSERT(segment.end_time == -1.0 && segment.channel == 1);
+  KALDI_ASSERT(!segment.Parse("seg1 rec1 1.10"));
+  KALDI_ASSERT(!segment.Parse("seg1 rec1 2.0 1.0"));
+  KALDI_ASSERT(!segment.Parse("seg1 rec1 -1.0 1.0"));
+  KALDI_ASSERT(!segment.Parse("seg1 rec1 1.0 x"));
+  KALDI_ASSERT(!segment.Parse("seg1 rec1 1.0 2.0 -1"));
+
+  int32 start, end;
+  KALDI_ASSERT(segment.Parse("seg1 rec1 0.5 1.2"));
+  KALDI_ASSERT(segment.GetSamples(8000, 10000, 0.5, &start, &end) &&
+               start == 4000 && end == 9600);
+  KALDI_ASSERT(segment.Parse("seg1 rec1 0.5 1.3"));
+  KALDI_ASSERT(segment.GetSamples(8000, 10000, 0.5, &start, &end) &&
+               end == 10000);  // truncated.
+  KALDI_ASSERT(!segment.GetSamples(8000, 10000, 0.0, &start, &end));
+  KALDI_ASSERT(segment.Parse("seg1 rec1 0.5 -1"));
+  KALDI_ASSERT(segment.GetSamples(8000, 10000, 0.5, &start, &end) &&
+               end == 10000);
+  KALDI_ASSERT(segment.Parse("seg1 rec1 2.0 3.0"));
+  KALDI_ASSERT(!segment.GetSamples(8000, 10000, 0.5, &start, &end));
+}
+
+// Checks that the features computed by ComputeSegmentFeatures() are the same
+// as those computed from the segments' samples, whether or not the segments
+// start on frame boundaries, overlap or have different warp factors.
+template<class F, class Options>
+static void UnitTestComputeSegmentFeatures(Options opts) {
+  std::string rxfilename = "test_data/test.wav";
+  WaveReader reader;
+  reader.Open(rxfilename);
+  opts.frame_opts.dither = 0.0;
+  opts.frame_opts.samp_freq = reader.SampFreq();
+  int32 frame_shift = opts.frame_opts.WindowShift();
+  F computer(opts);
+
+  std::vector<SegmentSamples> segments;
+  int32 start = 0;
+  for (int32 i = 0; i < 30; i++) {
+    SegmentSamples segment;
+    segment.channel = 0;
+    if (rand() % 3 == 0)
+      start = rand() % reader.NumSamples();  // maybe not on a frame boundary.
+    else
+      start = std::max(0, start + frame_shift * (rand() % 40 - 10));
+    segment.start_sample = std::min(start, reader.NumSamples() - 1);
+    segment.num_samples = 1 + rand() % (reader.NumSamples() -
+                                        segment.start_sample);
+    segment.vtln_warp = (rand() % 5 == 0 ? 0.9 : 1.0);
+    segments.push_back(segment);
+  }
+  std::vector<Matrix<BaseFloat> > features;
+  ComputeSegmentFeatures(opts.frame_opts, segments, &reader, &computer,
+                         &features);
+  KALDI_ASSERT(features.size() == segments.size());
+  for (size_t i = 0; i < segments.size(); i++) {
+    Matrix<BaseFloat> wave;
+    reader.Read(segments[i].start_sample, segments[i].num_samples, &wave);
+    if (NumFrames(wave.NumCols(), opts.frame_opts) == 0) {
+      KALDI_ASSERT(features[i].NumRows() == 0);
+      continue;
+    }
+    Matrix<BaseFloat> ref;
+    computer.Compute(wave.Row(0), segments[i].vtln_warp, &ref, NULL);
+    AssertEqual(features[i], ref);
+  }
+}
+
+static void UnitTestSegmentsReader() {
+  {
+    Output ko("tmp.scp", false);
+    ko.Stream() << "rec1 rec1.wav\nrec2 rec2.wav\n";
+  }
+  {
+    Output ko("tmp.segments", false);
+    ko.Stream() << "a rec1 0 1\nb rec1 1 2\nbad line\nc rec3 0 1\n"
+                << "d rec2 0 1\ne rec1 2 3\n";
+  }
+  SegmentsReader reader("tmp.segments", "scp:tmp.scp");
+  std::string wav_rxfilename;
+  std::vector<Segment> segments;
+  KALDI_ASSERT(reader.Next(&wav_rxfilename, &segments));
+  KALDI_ASSERT(wav_rxfilename == "rec1.wav" && segments.size() == 2 &&
+               segments[0].id == "a" && segments[1].id == "b");
+  // The invalid line and the segment of rec3, which is not in the script
+  // file, are skipped.
+  KALDI_ASSERT(reader.Next(&wav_rxfilename, &segments));
+  KALDI_ASSERT(wav_rxfilename == "rec2.wav" && segments.size() == 1 &&
+               segments[0].id == "d");
+  KALDI_ASSERT(reader.Next(&wav_rxfilename, &segments));
+  KALDI_ASSERT(wav_rxfilename == "rec1.wav" && segments.size() == 1 &&
+               segments[0].id == "e");
+  KALDI_ASSERT(!reader.Next(&wav_rxfilename, &segments));
+  KALDI_ASSERT(reader.NumSegments() == 6);
+  unlink("tmp.scp");
+  unlink("tmp.segments");
+}
+
+// Checks that ComputeFeaturesForSegments() writes the features of each valid
+// segment, and that they are those computed from the segment's samples.
+static void UnitTestComputeFeaturesForSegments() {
+  std::string wav_rxfilename = "test_data/test.wav";
+  WaveReader wave_reader;
+  wave_reader.Open(wav_rxfilename);
+  BaseFloat samp_freq = wave_reader.SampFreq();
+  {
+    Output ko("tmp.scp", false);
+    ko.Stream() << "rec1 " << wav_rxfilename << "\n";
+  }
+  {
+    Output ko("tmp.segments", false);
+    ko.Stream() << "a rec1 0 0.5\nb rec1 0.25 0.75\nc rec1 0.3 0.30001\n"
+                << "d rec1 0.6 -1\ne rec1 0.1 0.2 1\n";
+  }
+  MfccOptions opts;
+  opts.frame_opts.dither = 0.0;
+  opts.frame_opts.samp_freq = samp_freq;
+  FeatureComputerPool<Mfcc> pool(opts);
+  TaskSequencerConfig thread_config;
+  thread_config.num_threads = 2;
+  int32 num_segments, num_success;
+  {
+    FeatureWriter writer("ark:tmp.ark", "kaldi", 0, 0);
+    ComputeFeaturesForSegments(thread_config, &pool, "tmp.segments",
+                               "scp:tmp.scp", NULL, 1.0, -1, 0.0, 0.5, false,
+                               &writer, &num_segments, &num_success);
+  }
+  // "c" is too short for any frames, and the recording has only one channel
+  // so "e" is skipped.
+  KALDI_ASSERT(num_segments == 5 && num_success == 3);
+  Mfcc mfcc(opts);
+  SequentialBaseFloatMatrixReader reader("ark:tmp.ark");
+  const char *lines[] = { "a rec1 0 0.5", "b rec1 0.25 0.75",
+                          "d rec1 0.6 -1" };
+  for (int32 i = 0; i < 3; i++, reader.Next()) {
+    Segment segment;
+    KALDI_ASSERT(segment.Parse(lines[i]));
+    KALDI_ASSERT(!reader.Done() && reader.Key() == segment.id);
+    int32 start, end;
+    KALDI_ASSERT(segment.GetSamples(samp_freq, wave_reader.NumSamples(), 0.5,
+                                    &start, &end));
+    Matrix<BaseFloat> wave, ref;
+    wave_reader.Read(start, end - start, &wave);
+    mfcc.Compute(wave.Row(0), 1.0, &ref, NULL);
+    Matrix<BaseFloat> features(reader.Value());
+    AssertEqual(features, ref);
+  }
+  KALDI_ASSERT(reader.Done());
+  unlink("tmp.scp");
+  unlink("tmp.segments");
+  unlink("tmp.ark");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestSegmentParse();
+  UnitTestSegmentsReader();
+  UnitTestComputeFeaturesForSegments();
+  for (int32 i = 0; i < 5; i++) {
+    UnitTestComputeSegmentFeatures<Mfcc>(MfccOptions());
+    FbankOptions fbank_opts;
+    fbank_opts.use_energy = (i % 2 == 0);
+    UnitTestComputeSegmentFeatures<Fbank>(fbank_opts);
+  }
+  std::cout << "Test OK.\n";
+  return 0;
+}
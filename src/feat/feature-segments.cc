@@ -0,0 +1,172 @@
+// feat/feature-segments.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/feature-segments.h"
+#include "util/kaldi-table.h"
+#include "util/text-utils.h"
+
+namespace kaldi {
+
+bool Segment::Parse(const std::string &line) {
+  std::vector<std::string> split_line;
+  SplitStringToVector(line, " \t\r", true, &split_line);
+  if (split_line.size() != 4 && split_line.size() != 5)
+    return false;
+  id = split_line[0];
+  recording = split_line[1];
+  if (!ConvertStringToReal(split_line[2], &start_time) ||
+      !ConvertStringToReal(split_line[3], &end_time))
+    return false;
+  // The start time must not be negative or after the end time, except that an
+  // end time of -1 means the end of the recording.
+  if (start_time < 0 || (end_time != -1.0 && end_time <= 0) ||
+      (start_time >= end_time && end_time > 0))
+    return false;
+  channel = -1;
+  if (split_line.size() == 5 &&
+      (!ConvertStringToInteger(split_line[4], &channel) || channel < 0))
+    return false;
+  return true;
+}
+
+bool Segment::GetSamples(BaseFloat samp_freq, int32 num_samples,
+                         BaseFloat max_overshoot,
+                         int32 *start_sample, int32 *end_sample) const {
+  *start_sample = start_time * samp_freq;
+  *end_sample = (end_time != -1.0 ? end_time * samp_freq : num_samples);
+  if (*start_sample >= num_samples) {
+    KALDI_WARN << "Start sample out of range " << *start_sample
+               << " [length:] " << num_samples << ", skipping segment " << id;
+    return false;
+  }
+  if (*end_sample > num_samples) {
+    if (*end_sample >=
+        num_samples + static_cast<int32>(max_overshoot * samp_freq)) {
+      KALDI_WARN << "End sample too far out of range " << *end_sample
+                 << " [length:] " << num_samples << ", skipping segment "
+                 << id;
+      return false;
+    }
+    *end_sample = num_samples;  // for small differences, just truncate.
+  }
+  return true;
+}
+
+SegmentsReader::SegmentsReader(const std::string &segments_rxfilename,
+                               const std::string &wav_rspecifier):
+    input_(segments_rxfilename), have_next_segment_(false), num_segments_(0) {
+  std::string script_rxfilename;
+  RspecifierOptions rspecifier_opts;
+  if (ClassifyRspecifier(wav_rspecifier, &script_rxfilename,
+                         &rspecifier_opts) != kScriptRspecifier)
+    KALDI_ERR << "With segments, the wav-rspecifier must be an scp file: "
+              << wav_rspecifier;
+  std::vector<std::pair<std::string, std::string> > script;
+  if (!ReadScriptFile(script_rxfilename, true, &script))
+    KALDI_ERR << "Error reading script file "
+              << PrintableRxfilename(script_rxfilename);
+  recording_to_rxfilename_.insert(script.begin(), script.end());
+}
+
+bool SegmentsReader::Next(std::string *wav_rxfilename,
+                          std::vector<Segment> *segments) {
+  std::string line;
+  while (true) {
+    segments->clear();
+    while (true) {
+      if (!have_next_segment_) {
+        if (!std::getline(input_.Stream(), line)) break;
+        num_segments_++;
+        if (!next_segment_.Parse(line)) {
+          KALDI_WARN << "Invalid line in segments file: " << line;
+          continue;
+        }
+        have_next_segment_ = true;
+      }
+      if (!segments->empty() &&
+          next_segment_.recording != (*segments)[0].recording)
+        break;
+      segments->push_back(next_segment_);
+      have_next_segment_ = false;
+    }
+    if (segments->empty()) return false;
+    std::map<std::string, std::string>::const_iterator iter =
+        recording_to_rxfilename_.find((*segments)[0].recording);
+    if (iter != recording_to_rxfilename_.end()) {
+      *wav_rxfilename = iter->second;
+      return true;
+    }
+    KALDI_WARN << "Could not find recording " << (*segments)[0].recording
+               << ", skipping " << segments->size() << " segments.";
+  }
+}
+
+void GetSegmentSamples(const FrameExtractionOptions &frame_opts,
+                       const std::vector<Segment> &segments,
+                       const std::vector<BaseFloat> &vtln_warps,
+                       int32 channel,
+                       BaseFloat min_duration,
+                       BaseFloat max_overshoot,
+                       const WaveReader &reader,
+                       std::vector<SegmentSamples> *samples,
+                       std::vector<std::string> *ids) {
+  KALDI_ASSERT(!segments.empty() && segments.size() == vtln_warps.size());
+  samples->clear();
+  ids->clear();
+  BaseFloat samp_freq = reader.SampFreq();
+  if (frame_opts.samp_freq != samp_freq)
+    KALDI_ERR << "Sample frequency mismatch: you specified "
+              << frame_opts.samp_freq << " but data has "
+              << samp_freq << " (use --sample-frequency "
+              << "option).  Recording is " << segments[0].recording;
+  int32 num_chan = reader.NumChannels();
+  for (size_t i = 0; i < segments.size(); i++) {
+    const Segment &segment = segments[i];
+    int32 start_sample, end_sample;
+    if (!segment.GetSamples(samp_freq, reader.NumSamples(), max_overshoot,
+                            &start_sample, &end_sample))
+      continue;
+    BaseFloat duration = (end_sample - start_sample) / samp_freq;
+    if (duration < min_duration) {
+      KALDI_WARN << "File: " << segment.id << " is too short ("
+                 << duration << " sec): producing no output.";
+      continue;
+    }
+    // A channel in the segments file overrides the "channel" argument.
+    int32 this_chan = (segment.channel != -1 ? segment.channel : channel);
+    if (this_chan == -1) {
+      this_chan = 0;
+      if (num_chan != 1)
+        KALDI_WARN << "Channel not specified but you have data with "
+                   << num_chan  << " channels; defaulting to zero";
+    } else if (this_chan >= num_chan) {
+      KALDI_WARN << "File with id " << segment.id << " has "
+                 << num_chan << " channels but you specified channel "
+                 << this_chan << ", producing no output.";
+      continue;
+    }
+    SegmentSamples this_samples;
+    this_samples.channel = this_chan;
+    this_samples.start_sample = start_sample;
+    this_samples.num_samples = end_sample - start_sample;
+    this_samples.vtln_warp = vtln_warps[i];
+    samples->push_back(this_samples);
+    ids->push_back(segment.id);
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,315 @@
+// feat/feature-segments.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FEAT_FEATURE_SEGMENTS_H_
+#define KALDI_FEAT_FEATURE_SEGMENTS_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "feat/feature-functions.h"
+#include "feat/feature-task.h"
+#include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
+#include "util/kaldi-io.h"
+
+namespace kaldi {
+/// @addtogroup  feat FeatureExtraction
+/// @{
+
+
+/// A line of a "segments" file, which has the format
+/// <segment-id> <recording-id> <start-time> <end-time> [<channel>]
+/// with the times in seconds; an end-time of -1 means the end of the
+/// recording.
+struct Segment {
+  std::string id;
+  std::string recording;
+  double start_time;
+  double end_time;
+  int32 channel;  // -1 if not specified.
+
+  Segment(): start_time(0.0), end_time(0.0), channel(-1) { }
+
+  /// Parses a line of a segments file; returns false if it is invalid.
+  bool Parse(const std::string &line);
+
+  /// Works out the range of samples [*start_sample, *end_sample) of the
+  /// segment in a recording with "num_samples" samples.  An end that is past
+  /// the end of the recording by less than "max_overshoot" seconds is
+  /// truncated.  Returns false, with a warning, if the segment does not fit in
+  /// the recording.
+  bool GetSamples(BaseFloat samp_freq, int32 num_samples,
+                  BaseFloat max_overshoot,
+                  int32 *start_sample, int32 *end_sample) const;
+};
+
+
+/// The samples of a recording covered by a segment, and the VTLN warp factor
+/// to use for it.
+struct SegmentSamples {
+  int32 channel;
+  int32 start_sample;
+  int32 num_samples;
+  BaseFloat vtln_warp;
+};
+
+
+/// Computes the features of segments of a recording, reading only the samples
+/// that are needed from "reader".  The features are computed independently
+/// for each frame, so a segment that starts a whole number of frame shifts
+/// into the recording has the same frames as the recording has at that point.
+/// When segments like this overlap the previous one (with the same channel and
+/// warp factor), the frames they share are computed only once.  F may be Mfcc,
+/// Fbank or Plp.  The features of segments[i] are put in (*features)[i]; it
+/// will be empty if the segment is too short for any frames.
+template<class F>
+void ComputeSegmentFeatures(const FrameExtractionOptions &frame_opts,
+                            const std::vector<SegmentSamples> &segments,
+                            WaveReader *reader,
+                            F *computer,
+                            std::vector<Matrix<BaseFloat> > *features) {
+  int32 frame_shift = frame_opts.WindowShift(),
+      frame_length = frame_opts.WindowSize();
+  features->clear();
+  features->resize(segments.size());
+  // The frames of the recording [cache_start, cache_start + cache.NumRows())
+  // of channel cache_channel, with warp factor cache_warp.
+  Matrix<BaseFloat> cache;
+  int32 cache_start = 0, cache_channel = -1;
+  BaseFloat cache_warp = 0.0;
+  Matrix<BaseFloat> wave;
+  for (size_t i = 0; i < segments.size(); i++) {
+    const SegmentSamples &segment = segments[i];
+    int32 num_frames = NumFrames(segment.num_samples, frame_opts);
+    if (num_frames == 0) continue;
+    Matrix<BaseFloat> &output = (*features)[i];
+    if (segment.start_sample % frame_shift != 0) {
+      reader->Read(segment.start_sample, segment.num_samples, &wave);
+      computer->Compute(wave.Row(segment.channel), segment.vtln_warp,
+                        &output, NULL);
+      continue;
+    }
+    int32 start_frame = segment.start_sample / frame_shift,
+        end_frame = start_frame + num_frames,
+        cache_end = cache_start + cache.NumRows();
+    if (cache.NumRows() == 0 || segment.channel != cache_channel ||
+        segment.vtln_warp != cache_warp || start_frame < cache_start ||
+        start_frame > cache_end)
+      cache_end = start_frame;  // We can't use the cache.
+    // Compute the frames [cache_end, end_frame) that we don't have yet.
+    Matrix<BaseFloat> new_frames;
+    if (end_frame > cache_end) {
+      reader->Read(cache_end * frame_shift,
+                   (end_frame - cache_end - 1) * frame_shift + frame_length,
+                   &wave);
+      computer->Compute(wave.Row(segment.channel), segment.vtln_warp,
+                        &new_frames, NULL);
+      KALDI_ASSERT(new_frames.NumRows() == end_frame - cache_end);
+    }
+    // The new cache has the frames from start_frame on; later segments that
+    // start earlier than this one will not use it.
+    int32 num_kept = std::max(0, cache_end - start_frame);
+    Matrix<BaseFloat> new_cache(num_kept + new_frames.NumRows(),
+                                (num_kept > 0 ? cache.NumCols() :
+                                 new_frames.NumCols()), kUndefined);
+    if (num_kept > 0)
+      new_cache.RowRange(0, num_kept).CopyFromMat(
+          cache.RowRange(start_frame - cache_start, num_kept));
+    if (new_frames.NumRows() > 0)
+      new_cache.RowRange(num_kept, new_frames.NumRows()).CopyFromMat(
+          new_frames);
+    cache.Swap(&new_cache);
+    cache_start = start_frame;
+    cache_channel = segment.channel;
+    cache_warp = segment.vtln_warp;
+    output = cache.RowRange(0, num_frames);
+  }
+}
+
+
+/// Reads a segments file and gives the segments of one recording at a time,
+/// with the rxfilename of the recording from a script file ("wav.scp").  A
+/// recording whose segments are not consecutive in the segments file is
+/// returned once for each run of its segments.
+class SegmentsReader {
+ public:
+  /// "wav_rspecifier" must be a script rspecifier, e.g. "scp:wav.scp".  Dies
+  /// if it is not or if the files can't be read.
+  SegmentsReader(const std::string &segments_rxfilename,
+                 const std::string &wav_rspecifier);
+
+  /// Gets the next run of segments of the same recording; returns false at
+  /// the end of the file.  Invalid lines and segments of recordings that are
+  /// not in the script file are skipped with a warning.
+  bool Next(std::string *wav_rxfilename, std::vector<Segment> *segments);
+
+  /// The number of segments read so far, including those skipped.
+  int32 NumSegments() const { return num_segments_; }
+
+ private:
+  Input input_;
+  std::map<std::string, std::string> recording_to_rxfilename_;
+  Segment next_segment_;  // The first segment of the next run, if any.
+  bool have_next_segment_;
+  int32 num_segments_;
+};
+
+
+/// Works out the samples of the recording in "reader" that "segments" cover
+/// (see SegmentSamples), and puts them in "samples" and the segment-ids in
+/// "ids".  Segments that don't fit in the recording (see Segment::GetSamples()),
+/// are shorter than "min_duration" seconds or have no such channel are skipped
+/// with a warning.  A channel in a segment overrides "channel"; -1 means the
+/// recording should be mono.  Dies if the sample frequency of the recording is
+/// not that of "frame_opts".
+void GetSegmentSamples(const FrameExtractionOptions &frame_opts,
+                       const std::vector<Segment> &segments,
+                       const std::vector<BaseFloat> &vtln_warps,
+                       int32 channel,
+                       BaseFloat min_duration,
+                       BaseFloat max_overshoot,
+                       const WaveReader &reader,
+                       std::vector<SegmentSamples> *samples,
+                       std::vector<std::string> *ids);
+
+
+/// A task for TaskSequencer that computes the features of segments of one
+/// recording with ComputeSegmentFeatures() and writes them to "writer"; the
+/// constructor, which is run sequentially, opens the recording and checks the
+/// segments (see GetSegmentSamples()).  F may be Mfcc, Fbank or Plp.
+template<class F>
+class SegmentsTask {
+ public:
+  SegmentsTask(FeatureComputerPool<F> *pool,
+               const std::string &wav_rxfilename,
+               const std::vector<Segment> &segments,
+               const std::vector<BaseFloat> &vtln_warps,
+               int32 channel,
+               BaseFloat min_duration,
+               BaseFloat max_overshoot,
+               bool subtract_mean,
+               FeatureWriter *writer,
+               int32 *num_success):
+      pool_(pool), subtract_mean_(subtract_mean), writer_(writer),
+      num_success_(num_success) {
+    KALDI_ASSERT(!segments.empty() && segments.size() == vtln_warps.size());
+    try {
+      reader_.Open(wav_rxfilename);
+    } catch (...) {
+      KALDI_WARN << "Could not read recording " << segments[0].recording
+                 << ", skipping " << segments.size() << " segments.";
+      return;
+    }
+    GetSegmentSamples(pool->GetOptions().frame_opts, segments, vtln_warps,
+                      channel, min_duration, max_overshoot, reader_,
+                      &samples_, &ids_);
+  }
+
+  void operator () () {
+    if (samples_.empty()) return;
+    F *computer = pool_->Acquire();
+    try {
+      ComputeSegmentFeatures(pool_->GetOptions().frame_opts, samples_,
+                             &reader_, computer, &features_);
+    } catch (...) {
+      features_.clear();
+    }
+    pool_->Release(computer);
+    if (subtract_mean_)
+      for (size_t i = 0; i < features_.size(); i++)
+        SubtractFeatureMean(&(features_[i]));
+  }
+
+  ~SegmentsTask() {  // Produces output.  Run sequentially.
+    for (size_t i = 0; i < ids_.size(); i++) {
+      // Segments too short for any frames have no features.
+      if (i >= features_.size() || features_[i].NumRows() == 0) {
+        KALDI_WARN << "Failed to compute features for utterance " << ids_[i];
+        continue;
+      }
+      writer_->Write(ids_[i], features_[i]);
+      KALDI_VLOG(2) << "Processed features for key " << ids_[i];
+      (*num_success_)++;
+    }
+  }
+
+ private:
+  FeatureComputerPool<F> *pool_;
+  bool subtract_mean_;
+  FeatureWriter *writer_;
+  int32 *num_success_;
+  WaveReader reader_;
+  std::vector<SegmentSamples> samples_;
+  std::vector<std::string> ids_;
+  std::vector<Matrix<BaseFloat> > features_;
+};
+
+
+/// Computes the features of the segments in "segments_rxfilename" of the
+/// recordings in "wav_rspecifier" (see SegmentsReader), reading each run of
+/// segments of a recording once, and writes them to "writer".  The warp
+/// factors are looked up in "vtln_map_reader" if it is not NULL; otherwise
+/// "vtln_warp" is used.  Sets "num_segments" to the number of segments read
+/// and "num_success" to the number written.
+template<class F>
+void ComputeFeaturesForSegments(
+    const TaskSequencerConfig &thread_config, FeatureComputerPool<F> *pool,
+    const std::string &segments_rxfilename, const std::string &wav_rspecifier,
+    RandomAccessBaseFloatReaderMapped *vtln_map_reader, BaseFloat vtln_warp,
+    int32 channel, BaseFloat min_duration, BaseFloat max_overshoot,
+    bool subtract_mean, FeatureWriter *writer, int32 *num_segments,
+    int32 *num_success) {
+  SegmentsReader segments_reader(segments_rxfilename, wav_rspecifier);
+  TaskSequencer<SegmentsTask<F> > sequencer(thread_config);
+  *num_success = 0;
+  std::string wav_rxfilename;
+  std::vector<Segment> segments;
+  while (segments_reader.Next(&wav_rxfilename, &segments)) {
+    std::vector<Segment> kept_segments;
+    std::vector<BaseFloat> vtln_warps;
+    for (size_t i = 0; i < segments.size(); i++) {
+      const std::string &id = segments[i].id;
+      BaseFloat vtln_warp_local = vtln_warp;
+      if (vtln_map_reader != NULL) {
+        if (!vtln_map_reader->HasKey(id)) {
+          KALDI_WARN << "No vtln-map entry for utterance-id (or speaker-id) "
+                     << id;
+          continue;
+        }
+        vtln_warp_local = vtln_map_reader->Value(id);
+      }
+      kept_segments.push_back(segments[i]);
+      vtln_warps.push_back(vtln_warp_local);
+    }
+    if (!kept_segments.empty())
+      sequencer.Run(new SegmentsTask<F>(pool, wav_rxfilename, kept_segments,
+                                        vtln_warps, channel, min_duration,
+                                        max_overshoot, subtract_mean, writer,
+                                        num_success));
+  }
+  sequencer.Wait();
+  *num_segments = segments_reader.NumSegments();
+}
+
+
+/// @} End of "addtogroup feat"
+}  // namespace kaldi
+
+
+#endif  // KALDI_FEAT_FEATURE_SEGMENTS_H_
@@ -57,33 +57,36 @@ void Spectrogram::Compute(const VectorBase<BaseFloat> &wave,
     ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
 
   // Buffers
-  Vector<BaseFloat> window;  // windowed waveform.
-  BaseFloat log_energy;
-
-  // Compute all the freames, r is frame index..
-  for (int32 r = 0; r < rows_out; r++) {
-    // Cut the window, apply window function
-    ExtractWindow(wave, r, opts_.frame_opts, feature_window_function_,
-                  &window, (opts_.raw_energy ? &log_energy : NULL));
-
-    // Compute energy after window function (not the raw one)
-    if (!opts_.raw_energy)
-      log_energy = log(VecVec(window, window));
-
-    if (srfft_ != NULL)  // Compute FFT using split-radix algorithm.
-      srfft_->Compute(window.Data(), true);
-    else  // An alternative algorithm that works for non-powers-of-two
-      RealFft(&window, true);
-
-    // Convert the FFT into a power spectrum.
-    ComputePowerSpectrum(&window);
-    SubVector<BaseFloat> power_spectrum(window, 0, window.Dim()/2 + 1);
-
-    power_spectrum.ApplyLog();  // take the log.
+  Matrix<BaseFloat> power_spectra;  // power spectra of a chunk of frames.
+  Vector<BaseFloat> log_energies;  // and their log-energies.
+  int32 padded_window_size = opts_.frame_opts.PaddedWindowSize();
+
+  // Compute the frames in chunks, so the FFTs can be done as a batch.
+  for (int32 start = 0; start < rows_out; start += kFeatureChunkSize) {
+    int32 this_num_frames = std::min(kFeatureChunkSize, rows_out - start);
+    power_spectra.Resize(this_num_frames, padded_window_size, kUndefined);
+    log_energies.Resize(this_num_frames);
+    ExtractPowerSpectra(wave, start, opts_.frame_opts, feature_window_function_,
+                        opts_.raw_energy, srfft_, &power_spectra,
+                        &log_energies);
+    SubMatrix<BaseFloat> this_output(output->RowRange(start, this_num_frames));
+    ComputeFromPowerSpectra(power_spectra, log_energies, &this_output);
+  }
+}
 
-    // Output buffers
+void Spectrogram::ComputeFromPowerSpectra(
+    const MatrixBase<BaseFloat> &power_spectra,
+    const VectorBase<BaseFloat> &log_energies,
+    MatrixBase<BaseFloat> *output) {
+  int32 num_frames = power_spectra.NumRows(), dim = Dim();
+  KALDI_ASSERT(power_spectra.NumCols() >= dim &&
+               log_energies.Dim() == num_frames &&
+               output->NumRows() == num_frames && output->NumCols() == dim);
+  for (int32 r = 0; r < num_frames; r++) {  // r is frame index..
+    BaseFloat log_energy = log_energies(r);
     SubVector<BaseFloat> this_output(output->Row(r));
-    this_output.CopyFromVec(power_spectrum);
+    this_output.CopyFromVec(SubVector<BaseFloat>(power_spectra.Row(r), 0, dim));
+    this_output.ApplyLog();  // take the log.
     if (opts_.energy_floor > 0.0 && log_energy < log_energy_floor_) {
         log_energy = log_energy_floor_;
     }
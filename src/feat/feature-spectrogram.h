@@ -46,6 +46,12 @@ struct SpectrogramOptions {
 
   void Register(OptionsItf *po) {
     frame_opts.Register(po);
+    RegisterNonFrameOptions(po);
+  }
+
+  /// Registers all options except frame_opts; for programs where the framing
+  /// is shared between several feature types (see MultiFeatureOptions).
+  void RegisterNonFrameOptions(OptionsItf *po) {
     po->Register("energy-floor", &energy_floor,
                  "Floor on energy (absolute, not relative) in Spectrogram computation");
     po->Register("raw-energy", &raw_energy,
@@ -56,15 +62,36 @@ struct SpectrogramOptions {
 /// Class for computing SPECTROGRAM features; see \ref feat_mfcc for more information.
 class Spectrogram {
  public:
+  typedef SpectrogramOptions Options;
   explicit Spectrogram(const SpectrogramOptions &opts);
   ~Spectrogram();
 
+  int32 Dim() { return opts_.frame_opts.PaddedWindowSize() / 2 + 1; }
+
   /// Will throw exception on failure (e.g. if file too short for
   /// even one frame).
   void Compute(const VectorBase<BaseFloat> &wave,
                Matrix<BaseFloat> *output,
                Vector<BaseFloat> *wave_remainder = NULL);
 
+  /// As above; the spectrogram has no VTLN, so vtln_warp must be 1.0.  This
+  /// gives Spectrogram the same interface as Mfcc, Fbank and Plp, so it can be
+  /// used with FeatureTask.
+  void Compute(const VectorBase<BaseFloat> &wave,
+               BaseFloat vtln_warp,
+               Matrix<BaseFloat> *output,
+               Vector<BaseFloat> *wave_remainder = NULL) {
+    KALDI_ASSERT(vtln_warp == 1.0);
+    Compute(wave, output, wave_remainder);
+  }
+
+  /// Computes the features of a chunk of frames from their power spectra
+  /// (which are not modified) and log-energies; see
+  /// Mfcc::ComputeFromPowerSpectra().
+  void ComputeFromPowerSpectra(const MatrixBase<BaseFloat> &power_spectra,
+                               const VectorBase<BaseFloat> &log_energies,
+                               MatrixBase<BaseFloat> *output);
+
  private:
   SpectrogramOptions opts_;
   BaseFloat log_energy_floor_;
@@ -0,0 +1,65 @@
+// feat/feature-task.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/feature-task.h"
+
+namespace kaldi {
+
+void SubtractFeatureMean(Matrix<BaseFloat> *features) {
+  if (features->NumRows() == 0) return;
+  Vector<BaseFloat> mean(features->NumCols());
+  mean.AddRowSumMat(1.0, *features);
+  mean.Scale(1.0 / features->NumRows());
+  features->AddVecToRows(-1.0, mean);
+}
+
+FeatureWriter::FeatureWriter(const std::string &wspecifier,
+                             const std::string &output_format,
+                             uint16 htk_kind, int32 htk_frame_shift):
+    htk_kind_(htk_kind), htk_frame_shift_(htk_frame_shift) {
+  if (output_format == "kaldi") {
+    if (!kaldi_writer_.Open(wspecifier))
+      KALDI_ERR << "Could not initialize output with wspecifier "
+                << wspecifier;
+  } else if (output_format == "htk") {
+    if (!htk_writer_.Open(wspecifier))
+      KALDI_ERR << "Could not initialize output with wspecifier "
+                << wspecifier;
+  } else {
+    KALDI_ERR << "Invalid output_format string " << output_format;
+  }
+}
+
+void FeatureWriter::Write(const std::string &key,
+                          const Matrix<BaseFloat> &features) {
+  if (kaldi_writer_.IsOpen()) {
+    kaldi_writer_.Write(key, features);
+  } else {
+    std::pair<Matrix<BaseFloat>, HtkHeader> p;
+    p.first = features;
+    HtkHeader header = {
+      features.NumRows(),
+      htk_frame_shift_,
+      static_cast<int16>(sizeof(float) * features.NumCols()),
+      htk_kind_
+    };
+    p.second = header;
+    htk_writer_.Write(key, p);
+  }
+}
+
+}  // namespace kaldi
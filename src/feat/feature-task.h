@@ -0,0 +1,164 @@
+// feat/feature-task.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FEAT_FEATURE_TASK_H_
+#define KALDI_FEAT_FEATURE_TASK_H_
+
+#include <string>
+#include <vector>
+
+#include "feat/feature-functions.h"
+#include "util/kaldi-table.h"
+#include "util/table-types.h"
+#include "thread/kaldi-mutex.h"
+
+namespace kaldi {
+/// @addtogroup  feat FeatureExtraction
+/// @{
+
+
+/// Subtracts the mean of the rows of "features" from each row (per-utterance
+/// cepstral mean subtraction).
+void SubtractFeatureMean(Matrix<BaseFloat> *features);
+
+
+/// Writes features to a table of Kaldi matrices or, if the output format is
+/// "htk", of HTK files, which get a header with the given parameter kind
+/// (e.g. 006 | 020000 for MFCC_0) and frame shift (in units of 100ns).
+class FeatureWriter {
+ public:
+  /// Dies if the output can't be opened or the format is not "kaldi" or "htk".
+  FeatureWriter(const std::string &wspecifier,
+                const std::string &output_format,
+                uint16 htk_kind, int32 htk_frame_shift);
+
+  void Write(const std::string &key, const Matrix<BaseFloat> &features);
+
+ private:
+  BaseFloatMatrixWriter kaldi_writer_;
+  TableWriter<HtkMatrixHolder> htk_writer_;
+  uint16 htk_kind_;
+  int32 htk_frame_shift_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(FeatureWriter);
+};
+
+
+/// Feature computers for the threads of a TaskSequencer.  The computers (Mfcc,
+/// Fbank, Plp or Spectrogram) have buffers that Compute() modifies, so each
+/// may only be used by one thread at a time; instead of constructing one per
+/// utterance, which for some feature types costs more than computing the
+/// features, they are kept here and reused.  There are never more of them
+/// than threads running at once.
+template<class F>
+class FeatureComputerPool {
+ public:
+  explicit FeatureComputerPool(const typename F::Options &opts): opts_(opts) { }
+
+  const typename F::Options &GetOptions() const { return opts_; }
+
+  F *Acquire() {
+    mutex_.Lock();
+    F *ans;
+    if (free_.empty()) {
+      ans = new F(opts_);
+      computers_.push_back(ans);
+    } else {
+      ans = free_.back();
+      free_.pop_back();
+    }
+    mutex_.Unlock();
+    return ans;
+  }
+
+  void Release(F *computer) {
+    mutex_.Lock();
+    free_.push_back(computer);
+    mutex_.Unlock();
+  }
+
+  ~FeatureComputerPool() {
+    for (size_t i = 0; i < computers_.size(); i++)
+      delete computers_[i];
+  }
+
+ private:
+  typename F::Options opts_;
+  std::vector<F*> computers_;
+  std::vector<F*> free_;
+  Mutex mutex_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(FeatureComputerPool);
+};
+
+
+/// A task for TaskSequencer that computes the features of one utterance with a
+/// computer from "pool" and writes them to "writer"; "num_success" is
+/// incremented for each utterance written.
+template<class F>
+class FeatureTask {
+ public:
+  FeatureTask(FeatureComputerPool<F> *pool,
+              const std::string &utt,
+              const VectorBase<BaseFloat> &wave,
+              BaseFloat vtln_warp,
+              bool subtract_mean,
+              FeatureWriter *writer,
+              int32 *num_success):
+      pool_(pool), utt_(utt), wave_(wave), vtln_warp_(vtln_warp),
+      subtract_mean_(subtract_mean), writer_(writer),
+      num_success_(num_success), ok_(false) { }
+
+  void operator () () {
+    F *computer = pool_->Acquire();
+    try {
+      computer->Compute(wave_, vtln_warp_, &features_, NULL);
+      ok_ = true;
+    } catch (...) {
+      ok_ = false;
+    }
+    pool_->Release(computer);
+    if (ok_ && subtract_mean_)
+      SubtractFeatureMean(&features_);
+  }
+
+  ~FeatureTask() {  // Produces output.  Run sequentially.
+    if (!ok_) {
+      KALDI_WARN << "Failed to compute features for utterance " << utt_;
+      return;
+    }
+    writer_->Write(utt_, features_);
+    KALDI_VLOG(2) << "Processed features for key " << utt_;
+    (*num_success_)++;
+  }
+
+ private:
+  FeatureComputerPool<F> *pool_;
+  std::string utt_;
+  Vector<BaseFloat> wave_;
+  BaseFloat vtln_warp_;
+  bool subtract_mean_;
+  FeatureWriter *writer_;
+  int32 *num_success_;
+  bool ok_;
+  Matrix<BaseFloat> features_;
+};
+
+
+/// @} End of "addtogroup feat"
+}  // namespace kaldi
+
+
+#endif  // KALDI_FEAT_FEATURE_TASK_H_
@@ -0,0 +1,212 @@
+// feat/mask-targets-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+
+#include "feat/mask-targets.h"
+
+namespace kaldi {
+
+static bool IsClose(double a, double b, double tol) {
+  return std::abs(a - b) <= tol * std::max(1.0, std::abs(b));
+}
+
+// Makes random log filterbank energies of clean speech and noise, and of the
+// noisy speech (the log of the sum of the energies).
+static void RandomLogEnergies(int32 num_rows, int32 num_cols,
+                              Matrix<BaseFloat> *clean,
+                              Matrix<BaseFloat> *noise,
+                              Matrix<BaseFloat> *noisy) {
+  clean->Resize(num_rows, num_cols);
+  noise->Resize(num_rows, num_cols);
+  noisy->Resize(num_rows, num_cols);
+  for (int32 r = 0; r < num_rows; r++) {
+    for (int32 c = 0; c < num_cols; c++) {
+      (*clean)(r, c) = 10.0 + 4.0 * RandGauss();
+      (*noise)(r, c) = 10.0 + 4.0 * RandGauss();
+      double sum = std::exp(static_cast<double>((*clean)(r, c))) +
+          std::exp(static_cast<double>((*noise)(r, c)));
+      (*noisy)(r, c) = std::log(sum);
+    }
+  }
+}
+
+static void UnitTestMaskTargets() {
+  for (int32 i = 0; i < 10; i++) {
+    MaskTargetOptions opts;
+    opts.irm_beta = -10.0 + 10.0 * RandUniform();
+    opts.snr_span = 10.0 + 30.0 * RandUniform();
+    opts.arm_beta = -5.0 + 5.0 * RandUniform();
+    opts.arm_span = 4.0 + 8.0 * RandUniform();
+    opts.from_noisy = (i % 2 == 1);
+    opts.apply_log = (i % 3 != 0);
+    MaskTargetComputer computer(opts);
+
+    int32 num_rows = 1 + rand() % 50, num_cols = 1 + rand() % 30;
+    Matrix<BaseFloat> clean, noise, noisy;
+    RandomLogEnergies(num_rows, num_cols, &clean, &noise, &noisy);
+    Matrix<BaseFloat> irm_targets, irm, snr, arm_targets, arm;
+    computer.Compute(clean, (opts.from_noisy ? noisy : noise), &irm_targets,
+                     &irm, &snr, &arm_targets, &arm);
+
+    double irm_alpha = 2 * Log(19.0) / Log(10.0) / opts.snr_span,
+        arm_alpha = 2 * Log(19.0) / Log(10.0) / opts.arm_span,
+        db_scale = 10.0 / Log(10.0);
+    for (int32 r = 0; r < num_rows; r++) {
+      for (int32 c = 0; c < num_cols; c++) {
+        double log_c = clean(r, c), log_n = noise(r, c), log_y = noisy(r, c);
+        if (opts.from_noisy) {
+          // The noise is worked out from the noisy speech; skip bins where
+          // that is badly conditioned.
+          if (log_y - log_c < 1.0e-04) continue;
+          log_n = log_y + std::log(1.0 - std::exp(log_c - log_y));
+        }
+        double snr_db = db_scale * (log_c - log_n),
+            ref_irm_target = 1.0 / (1.0 + std::exp(-irm_alpha *
+                                                   (snr_db - opts.irm_beta))),
+            ref_irm = 1.0 / (1.0 + std::exp(log_n - log_c)),
+            arm_db = db_scale * (log_c - log_y),
+            ref_arm_target = 1.0 / (1.0 + std::exp(-arm_alpha *
+                                                   (arm_db - opts.arm_beta))),
+            ref_arm = std::exp(log_c - log_y);
+        if (opts.apply_log) {
+          ref_irm = std::log(ref_irm);
+          ref_arm = std::log(ref_arm);
+        }
+        KALDI_ASSERT(IsClose(snr(r, c), snr_db, 1.0e-04));
+        KALDI_ASSERT(IsClose(irm_targets(r, c), ref_irm_target, 1.0e-04));
+        KALDI_ASSERT(IsClose(irm(r, c), ref_irm, 1.0e-04));
+        KALDI_ASSERT(IsClose(arm_targets(r, c), ref_arm_target, 1.0e-04));
+        KALDI_ASSERT(IsClose(arm(r, c), ref_arm, 1.0e-04));
+
+        // The masks are what irm-targets-to-irm and arm-targets-to-arm
+        // compute from the targets.
+        double d = irm_targets(r, c);
+        if (d > 0.01 && d < 0.99) {
+          double p = 1.0 / (db_scale * irm_alpha),
+              converted = 1.0 / (1.0 + std::pow(1.0 / d - 1.0, p) *
+                                 std::pow(10.0, -opts.irm_beta / 10.0));
+          if (opts.apply_log) converted = std::log(converted);
+          KALDI_ASSERT(IsClose(irm(r, c), converted, 1.0e-03));
+        }
+        d = arm_targets(r, c);
+        if (d > 0.01 && d < 0.99) {
+          double converted = (-std::log(1.0 / d - 1.0) / arm_alpha +
+                              opts.arm_beta) / db_scale;
+          if (!opts.apply_log) converted = std::exp(converted);
+          KALDI_ASSERT(IsClose(arm(r, c), converted, 1.0e-03));
+        }
+      }
+    }
+
+    // Computing only some of the outputs gives the same values.
+    Matrix<BaseFloat> irm_targets2, arm2;
+    computer.Compute(clean, (opts.from_noisy ? noisy : noise), &irm_targets2,
+                     NULL, NULL, NULL, &arm2);
+    AssertEqual(irm_targets, irm_targets2);
+    AssertEqual(arm, arm2);
+  }
+}
+
+// Bins where the noisy energy is no more than the clean energy have no noise.
+static void UnitTestMaskTargetsNoNoise() {
+  MaskTargetOptions opts;
+  opts.from_noisy = true;
+  MaskTargetComputer computer(opts);
+  Matrix<BaseFloat> clean(1, 3), noisy(1, 3);
+  clean(0, 0) = 5.0;
+  noisy(0, 0) = 4.0;
+  clean(0, 1) = 5.0;
+  noisy(0, 1) = 5.0;
+  clean(0, 2) = 5.0;
+  noisy(0, 2) = 6.0;
+  Matrix<BaseFloat> irm_targets, irm, snr;
+  computer.Compute(clean, noisy, &irm_targets, &irm, &snr, NULL, NULL);
+  for (int32 c = 0; c < 2; c++) {
+    KALDI_ASSERT(irm_targets(0, c) == 1.0 && irm(0, c) == 0.0);
+    KALDI_ASSERT(IsClose(snr(0, c), 50.0 / Log(10.0), 1.0e-06));
+  }
+  KALDI_ASSERT(irm_targets(0, 2) < 1.0 && irm(0, 2) < 0.0);
+}
+
+// Converting the targets back gives the log masks.
+static void UnitTestTargetsToLogMasks() {
+  for (int32 i = 0; i < 5; i++) {
+    MaskTargetOptions opts;
+    opts.irm_beta = -10.0 + 10.0 * RandUniform();
+    opts.snr_span = 10.0 + 30.0 * RandUniform();
+    opts.arm_beta = -5.0 + 5.0 * RandUniform();
+    opts.arm_span = 4.0 + 8.0 * RandUniform();
+    MaskTargetComputer computer(opts);
+
+    int32 num_rows = 1 + rand() % 50, num_cols = 1 + rand() % 30;
+    Matrix<BaseFloat> clean, noise, noisy;
+    RandomLogEnergies(num_rows, num_cols, &clean, &noise, &noisy);
+    Matrix<BaseFloat> irm_targets, irm, arm_targets, arm;
+    Matrix<BaseFloat> *outputs[kNumMaskTargetTypes] = { &irm_targets, &irm,
+                                                         NULL, &arm_targets,
+                                                         &arm };
+    computer.Compute(clean, noise, outputs);
+    Matrix<BaseFloat> log_irm(irm_targets), log_arm(arm_targets);
+    computer.ToLogMask(kIrmTargets, &log_irm);
+    computer.ToLogMask(kArmTargets, &log_arm);
+    Matrix<BaseFloat> irm_copy(irm);
+    computer.ToLogMask(kIrm, &irm_copy);  // Already the log: unchanged.
+    AssertEqual(irm_copy, irm);
+    for (int32 r = 0; r < num_rows; r++) {
+      for (int32 c = 0; c < num_cols; c++) {
+        // Saturated targets lose the information.
+        if (irm_targets(r, c) > 0.01 && irm_targets(r, c) < 0.99)
+          KALDI_ASSERT(IsClose(log_irm(r, c), irm(r, c), 1.0e-03));
+        if (arm_targets(r, c) > 0.01 && arm_targets(r, c) < 0.99)
+          KALDI_ASSERT(IsClose(log_arm(r, c), arm(r, c), 1.0e-03));
+      }
+    }
+  }
+  // Saturated outputs of 0 and 1 give finite log masks.
+  MaskTargetOptions opts;
+  opts.apply_log = false;
+  MaskTargetComputer computer(opts);
+  for (int32 type = 0; type < kNumMaskTargetTypes; type++) {
+    if (type == kSnr) continue;
+    Matrix<BaseFloat> outputs(1, 2);
+    outputs(0, 0) = 1.0;
+    outputs(0, 1) = 0.0;
+    computer.ToLogMask(static_cast<MaskTargetType>(type), &outputs);
+    KALDI_ASSERT(KALDI_ISFINITE(outputs(0, 0)) &&
+                 KALDI_ISFINITE(outputs(0, 1)) &&
+                 outputs(0, 1) < outputs(0, 0));
+    if (type == kIrmTargets || type == kIrm)
+      KALDI_ASSERT(outputs(0, 0) > -1.0e-05 && outputs(0, 0) <= 0.0);
+  }
+
+  MaskTargetType type;
+  KALDI_ASSERT(GetMaskTargetType("arm-targets", &type) && type == kArmTargets);
+  KALDI_ASSERT(GetMaskTargetType("snr", &type) && type == kSnr);
+  KALDI_ASSERT(!GetMaskTargetType("mask", &type));
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestMaskTargets();
+  UnitTestMaskTargetsNoNoise();
+  UnitTestTargetsToLogMasks();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,195 @@
+// feat/mask-targets.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+
+#include "feat/mask-targets.h"
+
+namespace kaldi {
+
+bool GetMaskTargetType(const std::string &name, MaskTargetType *type) {
+  if (name == "irm-targets") *type = kIrmTargets;
+  else if (name == "irm") *type = kIrm;
+  else if (name == "snr") *type = kSnr;
+  else if (name == "arm-targets") *type = kArmTargets;
+  else if (name == "arm") *type = kArm;
+  else return false;
+  return true;
+}
+
+static inline BaseFloat Sigmoid(BaseFloat x) {
+  // Avoids overflow in the exponential, as in VectorBase::Sigmoid().
+  if (x > 0.0) {
+    return 1.0 / (1.0 + Exp(-x));
+  } else {
+    BaseFloat ex = Exp(x);
+    return ex / (ex + 1.0);
+  }
+}
+
+// Returns log(sigmoid(x)) = -log(1 + exp(-x)).
+static inline BaseFloat LogSigmoid(BaseFloat x) {
+  if (x < -20.0) return x;  // log(1 + exp(-x)) approaches -x.
+  return -Log1p(Exp(-x));
+}
+
+MaskTargetComputer::MaskTargetComputer(const MaskTargetOptions &opts):
+    opts_(opts) {
+  if (opts.snr_span <= 0)
+    KALDI_ERR << "--snr-span is expected to be > 0. But it is given "
+              << opts.snr_span;
+  if (opts.arm_span <= 0)
+    KALDI_ERR << "--arm-span is expected to be > 0. But it is given "
+              << opts.arm_span;
+  irm_alpha_ = 2 * Log(19.0) / Log(10.0) / opts.snr_span;
+  arm_alpha_ = 2 * Log(19.0) / Log(10.0) / opts.arm_span;
+}
+
+void MaskTargetComputer::Compute(const MatrixBase<BaseFloat> &clean,
+                                 const MatrixBase<BaseFloat> &other,
+                                 Matrix<BaseFloat> *irm_targets,
+                                 Matrix<BaseFloat> *irm,
+                                 Matrix<BaseFloat> *snr,
+                                 Matrix<BaseFloat> *arm_targets,
+                                 Matrix<BaseFloat> *arm) const {
+  KALDI_ASSERT(SameDim(clean, other));
+  int32 num_rows = clean.NumRows(), num_cols = clean.NumCols();
+  Matrix<BaseFloat> *outputs[] = { irm_targets, irm, snr, arm_targets, arm };
+  for (int32 i = 0; i < 5; i++)
+    if (outputs[i] != NULL)
+      outputs[i]->Resize(num_rows, num_cols, kUndefined);
+
+  // To convert natural logs of energy ratios to dB.
+  const BaseFloat db_scale = 10.0 / Log(10.0);
+  // The IRM and ARM targets are sigmoid(scale * x + offset), with x the
+  // natural log of C / N or of C / Y.
+  const BaseFloat irm_scale = irm_alpha_ * db_scale,
+      irm_offset = -irm_alpha_ * opts_.irm_beta,
+      arm_scale = arm_alpha_ * db_scale,
+      arm_offset = -arm_alpha_ * opts_.arm_beta;
+  const bool from_noisy = opts_.from_noisy, apply_log = opts_.apply_log;
+
+  for (int32 r = 0; r < num_rows; r++) {
+    const BaseFloat *clean_row = clean.RowData(r),
+        *other_row = other.RowData(r);
+    BaseFloat *irm_targets_row = (irm_targets ? irm_targets->RowData(r) : NULL),
+        *irm_row = (irm ? irm->RowData(r) : NULL),
+        *snr_row = (snr ? snr->RowData(r) : NULL),
+        *arm_targets_row = (arm_targets ? arm_targets->RowData(r) : NULL),
+        *arm_row = (arm ? arm->RowData(r) : NULL);
+    for (int32 c = 0; c < num_cols; c++) {
+      // log(C / N) and log(C / Y).
+      BaseFloat log_snr, log_arm;
+      bool no_noise = false;
+      if (from_noisy) {
+        log_arm = clean_row[c] - other_row[c];
+        if (log_arm < 0.0) {
+          // N = Y - C, so log(C / N) = log(C / Y) - log(1 - C / Y).
+          log_snr = log_arm - Log1p(-Exp(log_arm));
+        } else {
+          no_noise = true;
+          log_snr = clean_row[c];
+        }
+      } else {
+        log_snr = clean_row[c] - other_row[c];
+        // Y = C + N, so C / Y = sigmoid(log(C / N)).
+        log_arm = LogSigmoid(log_snr);
+      }
+      if (irm_targets_row)
+        irm_targets_row[c] = (no_noise ? 1.0 :
+                              Sigmoid(irm_scale * log_snr + irm_offset));
+      if (irm_row) {
+        // The IRM C / (C + N) is sigmoid(log(C / N)).
+        if (no_noise) irm_row[c] = (apply_log ? 0.0 : 1.0);
+        else irm_row[c] = (apply_log ? LogSigmoid(log_snr) : Sigmoid(log_snr));
+      }
+      if (snr_row)
+        snr_row[c] = db_scale * log_snr;
+      if (arm_targets_row)
+        arm_targets_row[c] = Sigmoid(arm_scale * log_arm + arm_offset);
+      if (arm_row)
+        arm_row[c] = (apply_log ? log_arm : Exp(log_arm));
+    }
+  }
+}
+
+// Returns log(x / (1 - x)), the inverse of the sigmoid.  x is limited to
+// [eps, 1 - eps] first, so that saturated network outputs of exactly 0 or 1
+// give finite values.
+static inline BaseFloat Logit(BaseFloat x) {
+  const BaseFloat eps = std::numeric_limits<BaseFloat>::epsilon();
+  if (x < eps) x = eps;
+  else if (x > 1.0 - eps) x = 1.0 - eps;
+  return Log(x) - Log1p(-x);
+}
+
+void MaskTargetComputer::Compute(
+    const MatrixBase<BaseFloat> &clean,
+    const MatrixBase<BaseFloat> &other,
+    Matrix<BaseFloat> *outputs[kNumMaskTargetTypes]) const {
+  Compute(clean, other, outputs[kIrmTargets], outputs[kIrm], outputs[kSnr],
+          outputs[kArmTargets], outputs[kArm]);
+}
+
+void MaskTargetComputer::IrmTargetsToLogIrm(
+    MatrixBase<BaseFloat> *targets) const {
+  const BaseFloat db_scale = 10.0 / Log(10.0),
+      irm_scale = irm_alpha_ * db_scale,
+      irm_offset = -irm_alpha_ * opts_.irm_beta;
+  for (int32 r = 0; r < targets->NumRows(); r++) {
+    BaseFloat *row = targets->RowData(r);
+    for (int32 c = 0; c < targets->NumCols(); c++) {
+      BaseFloat log_snr = (Logit(row[c]) - irm_offset) / irm_scale;
+      row[c] = LogSigmoid(log_snr);
+    }
+  }
+}
+
+void MaskTargetComputer::ArmTargetsToLogArm(
+    MatrixBase<BaseFloat> *targets) const {
+  const BaseFloat db_scale = 10.0 / Log(10.0),
+      arm_scale = arm_alpha_ * db_scale,
+      arm_offset = -arm_alpha_ * opts_.arm_beta;
+  for (int32 r = 0; r < targets->NumRows(); r++) {
+    BaseFloat *row = targets->RowData(r);
+    for (int32 c = 0; c < targets->NumCols(); c++)
+      row[c] = (Logit(row[c]) - arm_offset) / arm_scale;
+  }
+}
+
+void MaskTargetComputer::ToLogMask(MaskTargetType type,
+                                   MatrixBase<BaseFloat> *outputs) const {
+  switch (type) {
+    case kIrmTargets:
+      IrmTargetsToLogIrm(outputs);
+      break;
+    case kArmTargets:
+      ArmTargetsToLogArm(outputs);
+      break;
+    case kIrm: case kArm:
+      if (!opts_.apply_log) {
+        // As in Logit(), so that masks of 0 give finite values.
+        outputs->ApplyFloor(std::numeric_limits<BaseFloat>::epsilon());
+        outputs->ApplyLog();
+      }
+      break;
+    default:
+      KALDI_ERR << "Outputs of type " << type << " are not masks.";
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,131 @@
+// feat/mask-targets.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FEAT_MASK_TARGETS_H_
+#define KALDI_FEAT_MASK_TARGETS_H_
+
+#include "matrix/matrix-lib.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+/// @addtogroup  feat FeatureExtraction
+/// @{
+
+
+/// Options for the targets used to train networks for time-frequency masking.
+/// In each filterbank bin, with C, N and Y the energies of the clean speech,
+/// the noise and the noisy speech, the ideal ratio mask (IRM) is C / (C + N)
+/// and the apparent ratio mask (ARM) is C / Y.  The training targets are
+/// sigmoids of the SNR 10 log10(C / N), or of 10 log10(C / Y) for the ARM, in
+/// dB:
+///   d(t,f) = 1 / (1 + exp(-alpha (x(t,f) - beta)))
+/// where alpha is set so that targets of 0.05 and 0.95 are "span" dB apart.
+struct MaskTargetOptions {
+  BaseFloat irm_beta;  // in dB
+  BaseFloat snr_span;  // in dB
+  BaseFloat arm_beta;  // in dB
+  BaseFloat arm_span;  // in dB
+  bool from_noisy;
+  bool apply_log;
+
+  MaskTargetOptions(): irm_beta(-6.0), snr_span(35.0), arm_beta(-2.6),
+                       arm_span(8.0), from_noisy(false), apply_log(true) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("irm-beta", &irm_beta, "Shift the IRM target sigmoid to be "
+                 "centered at this SNR (in dB)");
+    po->Register("snr-span", &snr_span, "The difference between SNR values "
+                 "that correspond to IRM target values of 0.05 and 0.95");
+    po->Register("arm-beta", &arm_beta, "Shift the ARM target sigmoid to be "
+                 "centered at this value (in dB)");
+    po->Register("arm-span", &arm_span, "The difference between ARM values "
+                 "(in dB) that correspond to target values of 0.05 and 0.95");
+    po->Register("from-noisy", &from_noisy, "If true, the second input is "
+                 "the noisy speech rather than the noise, whose energy is "
+                 "taken to be the difference of the noisy and clean energies");
+    po->Register("apply-log", &apply_log, "If true, output the logarithm of "
+                 "the IRM and ARM");
+  }
+};
+
+
+/// The outputs of MaskTargetComputer: the IRM targets, the IRM, the SNR, the
+/// ARM targets and the ARM.
+enum MaskTargetType { kIrmTargets, kIrm, kSnr, kArmTargets, kArm,
+                      kNumMaskTargetTypes };
+
+/// Gets the MaskTargetType with the name "irm-targets", "irm", "snr",
+/// "arm-targets" or "arm"; returns false if "name" is none of these.
+bool GetMaskTargetType(const std::string &name, MaskTargetType *type);
+
+
+/// MaskTargetComputer computes the IRM and ARM targets, the SNR and the masks
+/// themselves in one pass over the log filterbank energies (natural log, e.g.
+/// from Fbank with use_log_fbank=true) of the clean speech and of the noise,
+/// or of the noisy speech if opts.from_noisy.  Compute() is const, so one
+/// object may be shared between threads.
+class MaskTargetComputer {
+ public:
+  explicit MaskTargetComputer(const MaskTargetOptions &opts);
+
+  /// Computes the outputs whose pointers are non-NULL.  "snr" is in dB, and
+  /// "irm" and "arm" are the masks, or their logs if opts.apply_log.  With
+  /// opts.from_noisy, bins where the noisy energy is no more than the clean
+  /// energy are taken to have no noise: their IRM target and IRM are 1, and
+  /// their SNR is computed with a noise energy of 1.  Otherwise, the noisy
+  /// energy used for the ARM is the sum of the clean and noise energies.
+  void Compute(const MatrixBase<BaseFloat> &clean,
+               const MatrixBase<BaseFloat> &other,
+               Matrix<BaseFloat> *irm_targets,
+               Matrix<BaseFloat> *irm,
+               Matrix<BaseFloat> *snr,
+               Matrix<BaseFloat> *arm_targets,
+               Matrix<BaseFloat> *arm) const;
+
+  /// As above, with the outputs indexed by MaskTargetType.
+  void Compute(const MatrixBase<BaseFloat> &clean,
+               const MatrixBase<BaseFloat> &other,
+               Matrix<BaseFloat> *outputs[kNumMaskTargetTypes]) const;
+
+  /// Converts IRM targets, e.g. as predicted by a network, to the log of the
+  /// IRM, in place; this inverts the computation of "irm_targets" above.
+  /// Targets are first limited to [eps, 1 - eps], with eps the machine
+  /// epsilon, so the output is finite even for saturated targets of 0 or 1.
+  void IrmTargetsToLogIrm(MatrixBase<BaseFloat> *targets) const;
+
+  /// Converts ARM targets to the log of the ARM, in place; limits the targets
+  /// as IrmTargetsToLogIrm() does.
+  void ArmTargetsToLogArm(MatrixBase<BaseFloat> *targets) const;
+
+  /// Converts outputs of the given type, which may not be kSnr, to the log of
+  /// the mask, in place.  Outputs of type kIrm or kArm are the mask, or its
+  /// log if opts.apply_log, as output by Compute(); masks are floored at eps
+  /// before taking the log.
+  void ToLogMask(MaskTargetType type, MatrixBase<BaseFloat> *outputs) const;
+
+ private:
+  MaskTargetOptions opts_;
+  BaseFloat irm_alpha_;
+  BaseFloat arm_alpha_;
+};
+
+
+/// @} End of "addtogroup feat"
+}  // namespace kaldi
+
+
+#endif  // KALDI_FEAT_MASK_TARGETS_H_
@@ -0,0 +1,115 @@
+// feat/noise-mixer-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+#include "feat/noise-mixer.h"
+#include "feat/wave-reader.h"
+
+namespace kaldi {
+
+// Makes a wave with integer samples in the 16-bit range.
+static void RandomWave(int32 num_samples, Vector<BaseFloat> *data) {
+  data->Resize(num_samples);
+  for (int32 i = 0; i < num_samples; i++)
+    (*data)(i) = static_cast<int32>(RandGauss() * 5000.0);
+}
+
+static void UnitTestNoiseMixer() {
+  BaseFloat samp_freq = 8000;
+  std::vector<std::string> filenames, rxfilenames;
+  std::vector<Vector<BaseFloat> > noises(3);
+  for (int32 i = 0; i < 3; i++) {
+    RandomWave(100 + rand() % 2000, &(noises[i]));
+    Matrix<BaseFloat> data(1, noises[i].Dim());
+    data.Row(0).CopyFromVec(noises[i]);
+    WaveData wave(samp_freq, data);
+    std::ostringstream filename;
+    filename << "tmp" << i << ".wav";
+    std::ofstream os(filename.str().c_str(), std::ios_base::out |
+                     std::ios_base::binary);
+    wave.Write(os);
+    KALDI_ASSERT(os.good());
+    filenames.push_back(filename.str());
+    // Read one of them through a pipe, which is kept in memory.
+    rxfilenames.push_back(i == 1 ? "cat " + filename.str() + " |" :
+                          filename.str());
+  }
+
+  NoiseMixerOptions opts;
+  opts.min_snr = -5.0;
+  opts.max_snr = 15.0;
+  NoiseMixer mixer(opts, rxfilenames);
+  KALDI_ASSERT(mixer.NumNoises() == 3 && mixer.SampFreq() == samp_freq);
+  opts.srand = 1;
+  NoiseMixer mixer2(opts, rxfilenames);
+
+  int32 num_differ = 0;
+  for (int32 i = 0; i < 20; i++) {
+    std::ostringstream utt;
+    utt << "utt" << i;
+    Vector<BaseFloat> clean;
+    RandomWave(1 + rand() % 3000, &clean);
+
+    NoiseSegment segment, segment2, segment3;
+    mixer.Choose(utt.str(), clean.Dim(), &segment);
+    // The choice depends only on the seed and the utterance-id.
+    mixer.Choose(utt.str(), clean.Dim(), &segment2);
+    KALDI_ASSERT(segment.noise_index == segment2.noise_index &&
+                 segment.offset == segment2.offset &&
+                 segment.snr == segment2.snr);
+    mixer2.Choose(utt.str(), clean.Dim(), &segment3);
+    if (segment3.noise_index != segment.noise_index ||
+        segment3.offset != segment.offset || segment3.snr != segment.snr)
+      num_differ++;
+    KALDI_ASSERT(segment.snr >= opts.min_snr && segment.snr <= opts.max_snr);
+
+    Vector<BaseFloat> noise;
+    mixer.GetNoise(segment, clean, &noise);
+    KALDI_ASSERT(noise.Dim() == clean.Dim());
+    double snr = 10.0 * Log(VecVec(clean, clean) / VecVec(noise, noise)) /
+        Log(10.0);
+    KALDI_ASSERT(std::abs(snr - segment.snr) < 1.0e-03);
+
+    // The noise is the recording from the offset on, repeated as needed.
+    const Vector<BaseFloat> &ref = noises[segment.noise_index];
+    KALDI_ASSERT(segment.offset >= 0 && segment.offset < ref.Dim());
+    if (ref.Dim() >= clean.Dim())
+      KALDI_ASSERT(segment.offset + clean.Dim() <= ref.Dim());
+    Vector<BaseFloat> expected(clean.Dim());
+    for (int32 j = 0; j < clean.Dim(); j++)
+      expected(j) = ref((segment.offset + j) % ref.Dim());
+    expected.Scale(std::sqrt(VecVec(noise, noise) /
+                             VecVec(expected, expected)));
+    AssertEqual(noise, expected, 1.0e-03);
+  }
+  KALDI_ASSERT(num_differ > 0);
+
+  for (int32 i = 0; i < 3; i++)
+    unlink(filenames[i].c_str());
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestNoiseMixer();
+  std::cout << "Test OK.\n";
+  return 0;
+}
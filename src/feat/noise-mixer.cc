@@ -0,0 +1,150 @@
+// feat/noise-mixer.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/noise-mixer.h"
+#include "feat/wave-reader.h"
+
+namespace kaldi {
+
+// Random numbers for one utterance, from a generator seeded with the seed and
+// the utterance-id.  Unlike rand(), which is also used e.g. for dithering,
+// the numbers do not depend on which other utterances were processed, or in
+// which order or threads.
+class UtteranceRandom {
+ public:
+  UtteranceRandom(int32 srand, const std::string &utt) {
+    // FNV-1a hash of the utterance-id.
+    state_ = 14695981039346656037ULL;
+    for (size_t i = 0; i < utt.size(); i++) {
+      state_ ^= static_cast<unsigned char>(utt[i]);
+      state_ *= 1099511628211ULL;
+    }
+    state_ ^= static_cast<uint64>(static_cast<uint32>(srand)) *
+        0xBF58476D1CE4E5B9ULL;
+  }
+
+  // Returns a number uniformly distributed in [0, 1) (the SplitMix64
+  // generator).
+  double Uniform() {
+    uint64 z = (state_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  // Returns an integer uniformly distributed in [0, n).
+  int32 Int(int32 n) {
+    return std::min(static_cast<int32>(Uniform() * n), n - 1);
+  }
+
+ private:
+  uint64 state_;
+};
+
+NoiseMixer::NoiseMixer(const NoiseMixerOptions &opts,
+                       const std::vector<std::string> &noise_rxfilenames):
+    opts_(opts), rxfilenames_(noise_rxfilenames), samp_freq_(0.0) {
+  if (opts.min_snr > opts.max_snr)
+    KALDI_ERR << "--min-snr = " << opts.min_snr << " is greater than "
+              << "--max-snr = " << opts.max_snr;
+  if (rxfilenames_.empty())
+    KALDI_ERR << "No noise recordings given.";
+  num_samples_.resize(rxfilenames_.size());
+  samples_.resize(rxfilenames_.size());
+  for (size_t i = 0; i < rxfilenames_.size(); i++) {
+    WaveReader reader;
+    reader.Open(rxfilenames_[i]);
+    num_samples_[i] = reader.NumSamples();
+    if (num_samples_[i] == 0)
+      KALDI_ERR << "Noise recording " << rxfilenames_[i] << " is empty.";
+    if (!reader.Seekable()) {
+      // Open() has read it all already.
+      Matrix<BaseFloat> data;
+      reader.Read(0, num_samples_[i], &data);
+      samples_[i] = data.Row(0);
+    }
+    if (i == 0)
+      samp_freq_ = reader.SampFreq();
+    else if (reader.SampFreq() != samp_freq_)
+      KALDI_ERR << "Noise recording " << rxfilenames_[i] << " has sampling "
+                << "frequency " << reader.SampFreq() << ", but "
+                << rxfilenames_[0] << " has " << samp_freq_;
+  }
+}
+
+void NoiseMixer::Choose(const std::string &utt, int32 num_samples,
+                        NoiseSegment *segment) const {
+  UtteranceRandom random(opts_.srand, utt);
+  segment->noise_index = random.Int(rxfilenames_.size());
+  int32 noise_samples = num_samples_[segment->noise_index];
+  // Any offset into a recording shorter than the utterance will do, as it is
+  // repeated.
+  segment->offset = random.Int(noise_samples > num_samples ?
+                               noise_samples - num_samples + 1 :
+                               noise_samples);
+  segment->snr = opts_.min_snr +
+      (opts_.max_snr - opts_.min_snr) * random.Uniform();
+}
+
+void NoiseMixer::GetNoise(const NoiseSegment &segment,
+                          const VectorBase<BaseFloat> &clean,
+                          Vector<BaseFloat> *noise) const {
+  KALDI_ASSERT(segment.noise_index >= 0 &&
+               segment.noise_index < NumNoises());
+  const std::string &rxfilename = rxfilenames_[segment.noise_index];
+  int32 noise_samples = num_samples_[segment.noise_index],
+      num_samples = clean.Dim();
+  KALDI_ASSERT(segment.offset >= 0 && segment.offset < noise_samples);
+
+  const Vector<BaseFloat> &samples = samples_[segment.noise_index];
+  WaveReader reader;
+  if (samples.Dim() == 0) {
+    reader.Open(rxfilename);
+    if (reader.NumSamples() != noise_samples)
+      KALDI_ERR << "Noise recording " << rxfilename << " has changed length.";
+  }
+  noise->Resize(num_samples, kUndefined);
+  Matrix<BaseFloat> data;
+  int32 start = segment.offset;
+  for (int32 done = 0; done < num_samples; ) {
+    int32 this_num_samples = std::min(num_samples - done,
+                                      noise_samples - start);
+    SubVector<BaseFloat> this_noise(*noise, done, this_num_samples);
+    if (samples.Dim() != 0) {
+      this_noise.CopyFromVec(samples.Range(start, this_num_samples));
+    } else {
+      reader.Read(start, this_num_samples, &data);
+      this_noise.CopyFromVec(data.Row(0));
+    }
+    done += this_num_samples;
+    start = 0;
+  }
+
+  double clean_power = VecVec(clean, clean),
+      noise_power = VecVec(*noise, *noise);
+  if (clean_power == 0.0)
+    KALDI_ERR << "The clean speech is silent.";
+  if (noise_power == 0.0)
+    KALDI_ERR << "The noise from " << rxfilename << " at offset "
+              << segment.offset << " is silent.";
+  // Both powers are over the same number of samples.
+  noise->Scale(std::sqrt(clean_power / noise_power *
+                         std::pow(10.0, -segment.snr / 10.0)));
+}
+
+}  // namespace kaldi
@@ -0,0 +1,111 @@
+// feat/noise-mixer.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FEAT_NOISE_MIXER_H_
+#define KALDI_FEAT_NOISE_MIXER_H_
+
+#include <string>
+#include <vector>
+
+#include "matrix/matrix-lib.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+/// @addtogroup  feat FeatureExtraction
+/// @{
+
+
+struct NoiseMixerOptions {
+  BaseFloat min_snr;  // in dB
+  BaseFloat max_snr;  // in dB
+  int32 srand;
+
+  NoiseMixerOptions(): min_snr(0.0), max_snr(20.0), srand(0) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("min-snr", &min_snr, "Minimum SNR (in dB) at which noise is "
+                 "added");
+    po->Register("max-snr", &max_snr, "Maximum SNR (in dB) at which noise is "
+                 "added");
+    po->Register("srand", &srand, "Seed for the random choice of noise.  The "
+                 "choice for an utterance depends only on this and the "
+                 "utterance-id, so runs with the same seed add the same "
+                 "noise; change it to get new noisy data, e.g. each epoch.");
+  }
+};
+
+
+/// The noise added to an utterance: the samples of noise recording
+/// "noise_index" from sample "offset" on, starting again from the beginning
+/// of the recording if it is shorter than the utterance, scaled so that the
+/// SNR of the noisy speech is "snr" dB.
+struct NoiseSegment {
+  int32 noise_index;
+  int32 offset;
+  BaseFloat snr;
+  NoiseSegment(): noise_index(-1), offset(0), snr(0.0) { }
+};
+
+
+/// NoiseMixer corrupts speech with noise recordings at random SNRs, for
+/// simulating noisy training data on the fly.  The SNR is that of the whole
+/// utterance, from the mean power of the clean speech and of the noise (as
+/// WaveData::MeanLoudness()).  Only the first channel of each noise recording
+/// is used.  Recordings in files are read as needed by seeking; others, e.g.
+/// pipes, would have to be read in full for each utterance, so their samples
+/// are kept in memory instead.  All the methods are const, so one object may
+/// be shared between threads.
+class NoiseMixer {
+ public:
+  /// "noise_rxfilenames" are the noise recordings, e.g. the second fields of
+  /// a wav.scp.  Reads their headers (and the samples of those that are not
+  /// seekable), and throws if they are empty or do not all have the same
+  /// sampling frequency.
+  NoiseMixer(const NoiseMixerOptions &opts,
+             const std::vector<std::string> &noise_rxfilenames);
+
+  int32 NumNoises() const { return rxfilenames_.size(); }
+
+  BaseFloat SampFreq() const { return samp_freq_; }
+
+  /// Chooses the noise for utterance "utt" of "num_samples" samples; the
+  /// choice depends only on opts.srand and "utt".
+  void Choose(const std::string &utt, int32 num_samples,
+              NoiseSegment *segment) const;
+
+  /// Reads the noise of "segment" and scales it to be added to "clean".
+  /// Throws on error, or if the clean speech or the noise is silent.
+  void GetNoise(const NoiseSegment &segment,
+                const VectorBase<BaseFloat> &clean,
+                Vector<BaseFloat> *noise) const;
+
+ private:
+  NoiseMixerOptions opts_;
+  std::vector<std::string> rxfilenames_;
+  std::vector<int32> num_samples_;
+  // The first channel of the recordings that are not seekable; empty for
+  // the others.
+  std::vector<Vector<BaseFloat> > samples_;
+  BaseFloat samp_freq_;
+};
+
+
+/// @} End of "addtogroup feat"
+}  // namespace kaldi
+
+
+#endif  // KALDI_FEAT_NOISE_MIXER_H_
@@ -19,9 +19,11 @@
 #include <iostream>
 #include "feat/pitch-functions.cc"
 #include "feat/feature-plp.h"
+#include "feat/feature-mfcc.h"
 #include "base/kaldi-math.h"
 #include "matrix/kaldi-matrix-inl.h"
 #include "feat/wave-reader.h"
+#include "util/timer.h"
 #include "sys/timeb.h"
 #include "sys/stat.h"
 #include "sys/types.h"
@@ -436,12 +438,169 @@ void UnitTestResample() {
   }
 }
 
+// Checks that the online pitch extractor gives the same output as Compute()
+// when the whole waveform is given before any frames are requested, however it
+// is split into chunks, and similar output when the frames are requested as
+// the waveform comes in.
+static void UnitTestOnlinePitch() {
+  KALDI_LOG << "=== UnitTestOnlinePitch() ===\n";
+  std::ifstream is("test_data/test.wav");
+  WaveData wave;
+  wave.Read(is);
+  KALDI_ASSERT(wave.Data().NumRows() == 1);
+  SubVector<BaseFloat> waveform(wave.Data(), 0);
+  PitchExtractionOptions op;
+  op.samp_freq = wave.SampFreq();
+  Matrix<BaseFloat> ref;
+  Compute(op, waveform, &ref);
+  int32 num_frames = ref.NumRows();
+
+  for (int32 i = 0; i < 6; i++) {
+    bool online = (i >= 2);
+    op.max_frames_latency = (i >= 4 ? 10 + rand() % 20 : 0);
+    OnlinePitchExtractor extractor(op);
+    int32 num_ready = 0;
+    for (int32 start = 0; start < waveform.Dim(); ) {
+      int32 size = std::min(1 + rand() % 2000, waveform.Dim() - start);
+      extractor.AcceptWaveform(waveform.Range(start, size));
+      start += size;
+      if (online) {
+        int32 n = extractor.NumFramesReady();
+        KALDI_ASSERT(n >= num_ready);
+        num_ready = n;
+        if (op.max_frames_latency > 0) {
+          // Allow for the window length and the filters' delay.
+          int32 frames_in = start / (op.samp_freq * 0.001 * op.frame_shift_ms);
+          KALDI_ASSERT(num_ready >= frames_in - op.max_frames_latency - 10);
+        }
+      }
+    }
+    extractor.InputFinished();
+    KALDI_ASSERT(extractor.NumFramesReady() == num_frames);
+    Matrix<BaseFloat> m(num_frames, 2);
+    for (int32 t = 0; t < num_frames; t++) {
+      SubVector<BaseFloat> row(m, t);
+      extractor.GetFrame(t, &row);
+    }
+    if (!online) {
+      AssertEqual(m, ref);
+    } else {
+      // The normalization by the RMS value differs at the start, so the
+      // output may differ a little.
+      int32 num_same = 0;
+      for (int32 t = 0; t < num_frames; t++)
+        if (fabs(m(t, 1) - ref(t, 1)) < 0.01 * ref(t, 1)) num_same++;
+      KALDI_LOG << num_same << " out of " << num_frames << " frames have "
+                << "the same pitch.";
+      KALDI_ASSERT(num_same > 0.9 * num_frames);
+    }
+  }
+}
+
+// The NCCF as it used to be computed, with an inner product per lag; used to
+// test the faster version in Nccf().
+static void NccfReference(const Vector<double> &wave,
+                          int32 start, int32 end,
+                          int32 nccf_window_size,
+                          Vector<double> *inner_prod,
+                          Vector<double> *norm_prod) {
+  Vector<double> zero_mean_wave(wave);
+  SubVector<double> wave_part(wave, 0, nccf_window_size);
+  zero_mean_wave.Add(-wave_part.Sum() / nccf_window_size);
+  SubVector<double> sub_vec1(zero_mean_wave, 0, nccf_window_size);
+  double e1 = VecVec(sub_vec1, sub_vec1);
+  for (int32 lag = start; lag < end; lag++) {
+    SubVector<double> sub_vec2(zero_mean_wave, lag, nccf_window_size);
+    (*inner_prod)(lag-start) = VecVec(sub_vec1, sub_vec2);
+    (*norm_prod)(lag-start) = e1 * VecVec(sub_vec2, sub_vec2);
+  }
+}
+
+static void UnitTestNccf() {
+  KALDI_LOG << "=== UnitTestNccf() ===\n";
+  for (int32 i = 0; i < 100; i++) {
+    int32 window_size = 1 + rand() % 200, start = rand() % 20,
+        end = start + 1 + rand() % 100;
+    Vector<double> wave(end + window_size - 1 + rand() % 10);
+    wave.SetRandn();
+    if (i % 4 == 0) {
+      // A loud part followed by silence, which is where errors in the
+      // sliding energy would show up.
+      wave.Range(0, wave.Dim() / 2).Scale(1000.0);
+      wave.Range(wave.Dim() / 2, wave.Dim() - wave.Dim() / 2).SetZero();
+    }
+    int32 num_lags = end - start;
+    Vector<double> inner_prod(num_lags), norm_prod(num_lags),
+        inner_prod_ref(num_lags), norm_prod_ref(num_lags);
+    Nccf(wave, start, end, window_size, &inner_prod, &norm_prod);
+    NccfReference(wave, start, end, window_size, &inner_prod_ref,
+                  &norm_prod_ref);
+    // The errors are relative to the energies.
+    double scale = norm_prod_ref.Max();
+    for (int32 j = 0; j < num_lags; j++) {
+      KALDI_ASSERT(fabs(inner_prod(j) - inner_prod_ref(j)) <=
+                   1.0e-10 * std::sqrt(scale));
+      KALDI_ASSERT(fabs(norm_prod(j) - norm_prod_ref(j)) <= 1.0e-10 * scale);
+    }
+  }
+}
+
+// Compares the speed of the NCCF computation with that of the old version,
+// and the speed of pitch extraction with that of MFCC extraction.
+static void UnitTestNccfSpeed() {
+  KALDI_LOG << "=== UnitTestNccfSpeed() ===\n";
+  PitchExtractionOptions op;
+  int32 window_size = op.NccfWindowSize(),
+      start = Round(op.resample_freq / op.max_f0),
+      end = Round(op.resample_freq / op.min_f0), num_frames = 10000;
+  Vector<double> wave(end + window_size), inner_prod(end - start),
+      norm_prod(end - start);
+  wave.SetRandn();
+  Timer timer;
+  for (int32 i = 0; i < num_frames; i++)
+    Nccf(wave, start, end, window_size, &inner_prod, &norm_prod);
+  double nccf_time = timer.Elapsed();
+  timer.Reset();
+  for (int32 i = 0; i < num_frames; i++)
+    NccfReference(wave, start, end, window_size, &inner_prod, &norm_prod);
+  double reference_time = timer.Elapsed();
+  KALDI_LOG << "For " << num_frames << " frames, NCCF took " << nccf_time
+            << " seconds, versus " << reference_time << " for the "
+            << "per-lag version.";
+
+  std::ifstream is("test_data/test.wav");
+  WaveData wave_data;
+  wave_data.Read(is);
+  SubVector<BaseFloat> waveform(wave_data.Data(), 0);
+  op.samp_freq = wave_data.SampFreq();
+  int32 num_iters = 5;
+  Matrix<BaseFloat> m;
+  timer.Reset();
+  for (int32 i = 0; i < num_iters; i++)
+    Compute(op, waveform, &m);
+  double pitch_time = timer.Elapsed();
+  MfccOptions mfcc_opts;
+  mfcc_opts.frame_opts.samp_freq = wave_data.SampFreq();
+  Mfcc mfcc(mfcc_opts);
+  timer.Reset();
+  for (int32 i = 0; i < num_iters; i++)
+    mfcc.Compute(waveform, 1.0, &m);
+  double mfcc_time = timer.Elapsed();
+  double speech_time = num_iters * waveform.Dim() / op.samp_freq;
+  KALDI_LOG << "Pitch extraction took " << (pitch_time / speech_time)
+            << " seconds per second of speech, MFCC extraction "
+            << (mfcc_time / speech_time);
+}
+
 static void UnitTestFeatNoKeele() {
   UnitTestSimple();
   UnitTestDeltaPitch();
   UnitTestTakeLogOfPitch();
   UnitTestWeightedMwn();
   UnitTestResample();
+  UnitTestOnlinePitch();
+  UnitTestNccf();
+  UnitTestNccfSpeed();
 }
 static void UnitTestFeatWithKeele() {
   UnitTestKeele();
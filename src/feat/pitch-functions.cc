@@ -231,35 +231,63 @@ class LinearResample {
   }
 
   void Upsample(const VectorBase<double> &input,
-                VectorBase<double> *output) {
+                VectorBase<double> *output) const {
     // each row of "input" corresponds to the data to resample;
     // the corresponding row of "output" is the resampled data.
-    int32 num_samples_in_ = input.Dim();
-    int32 resampled_len = 1 + static_cast<int>(num_samples_in_ / frame_shift_);
+    int32 num_samples_in = input.Dim();
+    int32 resampled_len = 1 + static_cast<int>(num_samples_in / frame_shift_);
     if (output->Dim() != resampled_len) resampled_len = output->Dim();
 
-    for (int32 i = 0; i < resampled_len; i++) {
-      int32 inner_i = i % num_weights_;  // the index of weight to be used
-      int32 offset = (i - inner_i) * frame_shift_;
-      int32 fake_first_index = indexes_[inner_i].first_index + offset,
-            fake_last_index = indexes_[inner_i].last_index + offset;
-      int32 first_index = std::max(0, fake_first_index),
-            last_index = std::min((num_samples_in_ - 1), fake_last_index);
-      int32 num_indices = last_index - first_index + 1;
-      SubVector<double> input_part(input, first_index, num_indices);
-      Vector<double> &weights = weights_[inner_i];
-      if (num_indices == weights.Dim())
-        (*output)(i) = VecVec(input_part, weights);
-      else if (fake_first_index >= 0) {
-        SubVector<double> weight_vec(weights, 0, num_indices);
-        (*output)(i) = VecVec(input_part, weight_vec);
-      } else if (fake_first_index < 0) {
-        SubVector<double> weight_vec(weights, -fake_first_index, num_indices);
-        (*output)(i) = VecVec(input_part, weight_vec);
-      }
-    }
+    for (int32 i = 0; i < resampled_len; i++)
+      (*output)(i) = OutputSample(input, 0, num_samples_in, i);
     output->Scale(1.0/samp_rate_in_);
   }
+
+  double SampRateIn() const { return samp_rate_in_; }
+
+  /// Returns the index of the first input sample (possibly negative) on which
+  /// output sample i depends.
+  int32 FirstInputIndex(int32 i) const {
+    int32 inner_i = i % num_weights_;
+    int32 offset = (i - inner_i) * frame_shift_;
+    return indexes_[inner_i].first_index + offset;
+  }
+
+  /// Returns the index of the last input sample (possibly beyond the end of
+  /// the input) on which output sample i depends.
+  int32 LastInputIndex(int32 i) const {
+    int32 inner_i = i % num_weights_;
+    int32 offset = (i - inner_i) * frame_shift_;
+    return indexes_[inner_i].last_index + offset;
+  }
+
+  /// Computes output sample i, without the scaling by 1.0 / samp_rate_in that
+  /// Upsample() applies.  "input" holds the input samples from index
+  /// "input_offset" on, and num_samples_in is the total number of input
+  /// samples.
+  double OutputSample(const VectorBase<double> &input, int32 input_offset,
+                      int32 num_samples_in, int32 i) const {
+    int32 inner_i = i % num_weights_;  // the index of weight to be used
+    int32 fake_first_index = FirstInputIndex(i),
+          fake_last_index = LastInputIndex(i);
+    int32 first_index = std::max(0, fake_first_index),
+          last_index = std::min((num_samples_in - 1), fake_last_index);
+    int32 num_indices = last_index - first_index + 1;
+    KALDI_ASSERT(first_index >= input_offset &&
+                 last_index < input_offset + input.Dim());
+    SubVector<double> input_part(input, first_index - input_offset,
+                                 num_indices);
+    const Vector<double> &weights = weights_[inner_i];
+    if (num_indices == weights.Dim()) {
+      return VecVec(input_part, weights);
+    } else if (fake_first_index >= 0) {
+      SubVector<double> weight_vec(weights, 0, num_indices);
+      return VecVec(input_part, weight_vec);
+    } else {
+      SubVector<double> weight_vec(weights, -fake_first_index, num_indices);
+      return VecVec(input_part, weight_vec);
+    }
+  }
  private:
   void PreSet() {
     int32 samp_rate_gcd = Gcd(static_cast<int>(samp_rate_in_),
@@ -369,6 +397,18 @@ class ArbitraryResample {
       output->CopyColFromVec(output_col, i);
     }
   }
+
+  // This version resamples a single vector.
+  void Upsample(const VectorBase<double> &input,
+                VectorBase<double> *output) const {
+    KALDI_ASSERT(input.Dim() == num_samples_in_ &&
+                 output->Dim() == NumSamplesOut());
+    for (int32 i = 0; i < NumSamplesOut(); i++) {
+      SubVector<double> input_part(input, indexes_[i].first_index,
+                                   indexes_[i].num_indices);
+      (*output)(i) = (1.0 / samp_rate_in_) * VecVec(input_part, weights_[i]);
+    }
+  }
  private:
   void SetIndex(const std::vector<double> &sample_points) {
     int32 last_ind, num_sample = sample_points.size();
@@ -426,44 +466,39 @@ class ArbitraryResample {
 };
 
 
-void PreProcess(const PitchExtractionOptions opts,
-                const Vector<double> &wave,
-                Vector<double> *processed_wave) {
-  KALDI_ASSERT(processed_wave != NULL);
-  // down-sample and Low-Pass filtering the input wave
-  int32 num_samples_in = wave.Dim();
-  double dt = opts.samp_freq / opts.resample_freq;
-  int32 resampled_len = 1 + static_cast<int>(num_samples_in / dt);
-  processed_wave->Resize(resampled_len);  // filtered wave
-  LinearResample resample(opts.samp_freq, opts.resample_freq,
-                          opts.lowpass_cutoff,
-                          opts.lowpass_filter_width);
-  resample.Upsample(wave, processed_wave);
-
-  // Normalize input signal using rms
-  double rms = pow(VecVec((*processed_wave), (*processed_wave))
-    / processed_wave->Dim(), 0.5);
-  if (rms != 0.0)
-    (*processed_wave).Scale(1.0 / rms);
-}
-
+// Computes, for each lag in [start, end), the inner product of the
+// (mean-subtracted) first nccf_window_size samples of "wave" with the samples
+// starting at that lag, and the product of the energies of the two.  The
+// energy of the lagged window is updated as the window slides along, rather
+// than being recomputed for each lag, which halves the number of inner
+// products.
 void Nccf(const Vector<double> &wave,
           int32 start, int32 end,
           int32 nccf_window_size,
           Vector<double> *inner_prod,
           Vector<double> *norm_prod) {
+  KALDI_ASSERT(start >= 0 && end > start &&
+               end - 1 + nccf_window_size <= wave.Dim() &&
+               inner_prod->Dim() == end - start &&
+               norm_prod->Dim() == end - start);
   Vector<double> zero_mean_wave(wave);
   SubVector<double> wave_part(wave, 0, nccf_window_size);
   // subtract mean-frame from wave
   zero_mean_wave.Add(-wave_part.Sum() / nccf_window_size);
-  double e1, e2, sum;
+  const double *data = zero_mean_wave.Data();
   SubVector<double> sub_vec1(zero_mean_wave, 0, nccf_window_size);
-  e1 = VecVec(sub_vec1, sub_vec1);
+  double e1 = VecVec(sub_vec1, sub_vec1), e2 = 0.0;
   for (int32 lag = start; lag < end; lag++) {
     SubVector<double> sub_vec2(zero_mean_wave, lag, nccf_window_size);
-    e2 = VecVec(sub_vec2, sub_vec2);
-    sum = VecVec(sub_vec1, sub_vec2);
-    (*inner_prod)(lag-start) = sum;
+    if (lag == start) {
+      e2 = VecVec(sub_vec2, sub_vec2);
+    } else {
+      double next = data[lag + nccf_window_size - 1], prev = data[lag - 1];
+      // Rounding errors may make e2 slightly negative if the signal is
+      // silent after being loud.
+      e2 = std::max(e2 + next * next - prev * prev, 0.0);
+    }
+    (*inner_prod)(lag-start) = VecVec(sub_vec1, sub_vec2);
     (*norm_prod)(lag-start) = e1 * e2;
   }
 }
@@ -476,7 +511,7 @@ void ProcessNccf(const Vector<double> &inner_prod,
   for (int32 lag = start; lag < end; lag++) {
     if (norm_prod(lag-start) != 0.0)
       (*autocorr)(lag) =
-        inner_prod(lag-start) / pow(norm_prod(lag-start) + a_fact, 0.5);
+        inner_prod(lag-start) / std::sqrt(norm_prod(lag-start) + a_fact);
     KALDI_ASSERT((*autocorr)(lag) < 1.01 && (*autocorr)(lag) > -1.01);
   }
 }
@@ -506,202 +541,314 @@ void SelectLag(const PitchExtractionOptions &opts,
   (*state_num) = count;
 }
 
-class PitchExtractor {
- public:
-  explicit PitchExtractor(const PitchExtractionOptions &opts,
-                          const Vector<double> lags,
-                          int32 state_num,
-                          int32 num_frames) :
-      opts_(opts),
-      state_num_(state_num),
-      num_frames_(num_frames),
-      lags_(lags) {
-    frames_.resize(num_frames_+1);
-    for (int32 i = 0; i < num_frames_+1; i++) {
-      frames_[i].local_cost.Resize(state_num_);
-      frames_[i].obj_func.Resize(state_num_);
-      frames_[i].back_pointers.Resize(state_num_);
-    }
+OnlinePitchExtractor::OnlinePitchExtractor(const PitchExtractionOptions &opts)
+    : opts_(opts), input_finished_(false), input_offset_(0),
+      num_input_samples_(0), resampled_offset_(0), num_resampled_(0),
+      resampled_sumsq_(0.0), num_frames_processed_(0) {
+  resample_ = new LinearResample(opts.samp_freq, opts.resample_freq,
+                                 opts.lowpass_cutoff,
+                                 opts.lowpass_filter_width);
+  double outer_min_lag = 1.0 / (1.0 * opts.max_f0) -
+      (opts.upsample_filter_width/(2.0 * opts.resample_freq));
+  double outer_max_lag = 1.0 / (1.0 * opts.min_f0) +
+      (opts.upsample_filter_width/(2.0 * opts.resample_freq));
+  num_nccf_lags_ = Round(outer_max_lag * opts.resample_freq) + 2;
+  nccf_first_lag_ = Round(opts.resample_freq  * outer_min_lag);
+  nccf_end_lag_ = Round(opts.resample_freq / opts.min_f0) +
+      Round(opts.lowpass_filter_width / 2);
+  SelectLag(opts, &num_states_, &lags_);
+  a_fact_pitch_ = pow(opts.NccfWindowSize(), 4) * opts.nccf_ballast;
+  a_fact_pov_ = pow(10, -9);
+  delta_pitch_sq_ = log(1 + opts.delta_pitch) * log(1 + opts.delta_pitch);
+
+  std::vector<double> lag_vec(num_states_);
+  for (int32 i = 0; i < num_states_; i++)
+    lag_vec[i] = static_cast<double>(lags_(i));
+  // upsample_cutoff is the filter cutoff for upsampling the NCCF, which is the
+  // Nyquist of the resampling frequency.  The NCCF is (almost completely)
+  // bandlimited to around "lowpass_cutoff" (1000 by default), and when the
+  // spectrum of this bandlimited signal is convolved with the spectrum of an
+  // impulse train with frequency "resample_freq", which are separated by 4kHz,
+  // we get energy at -5000,-3000, -1000...1000, 3000..5000, etc.  Filtering at
+  // half the Nyquist (2000 by default) is sufficient to get only the first
+  // repetition.
+  BaseFloat upsample_cutoff = opts.resample_freq * 0.5;
+  nccf_resample_ = new ArbitraryResample(num_nccf_lags_, opts.resample_freq,
+                                         upsample_cutoff, lag_vec,
+                                         opts.upsample_filter_width);
+  obj_func_.Resize(num_states_);
+}
+
+OnlinePitchExtractor::~OnlinePitchExtractor() {
+  delete resample_;
+  delete nccf_resample_;
+  for (size_t i = 0; i < pending_frames_.size(); i++)
+    delete pending_frames_[i];
+}
+
+void OnlinePitchExtractor::AcceptWaveform(const VectorBase<BaseFloat> &wave) {
+  KALDI_ASSERT(!input_finished_ &&
+               "AcceptWaveform() called after InputFinished()");
+  if (wave.Dim() == 0) return;
+  // Append to the input that has not yet been resampled.
+  int32 num_kept = num_input_samples_ - input_offset_;
+  Vector<double> input(num_kept + wave.Dim(), kUndefined);
+  if (num_kept > 0)
+    input.Range(0, num_kept).CopyFromVec(input_.Range(0, num_kept));
+  input.Range(num_kept, wave.Dim()).CopyFromVec(wave);
+  input_.Swap(&input);
+  num_input_samples_ += wave.Dim();
+  ResampleInput();
+}
+
+void OnlinePitchExtractor::InputFinished() {
+  input_finished_ = true;
+  ResampleInput();
+  ProcessFrames();
+  OutputFrames();
+}
+
+int32 OnlinePitchExtractor::NumFramesReady() {
+  ProcessFrames();
+  OutputFrames();
+  return output_.size();
+}
+
+void OnlinePitchExtractor::GetFrame(int32 frame,
+                                    VectorBase<BaseFloat> *feat) const {
+  KALDI_ASSERT(frame >= 0 && frame < static_cast<int32>(output_.size()) &&
+               feat->Dim() == 2);
+  (*feat)(0) = output_[frame].first;
+  (*feat)(1) = output_[frame].second;
+}
+
+void OnlinePitchExtractor::ResampleInput() {
+  // The total number of samples the resampled signal will have, if the input
+  // ends here.
+  double dt = opts_.samp_freq / opts_.resample_freq;
+  int32 resampled_len = 1 + static_cast<int>(num_input_samples_ / dt);
+  int32 end = num_resampled_;
+  while (end < resampled_len &&
+         (input_finished_ ||
+          resample_->LastInputIndex(end) < num_input_samples_))
+    end++;
+  if (end == num_resampled_) return;
+
+  // Append the new samples to the resampled signal we are keeping.
+  int32 num_kept = num_resampled_ - resampled_offset_,
+      num_new = end - num_resampled_;
+  Vector<double> resampled(num_kept + num_new, kUndefined);
+  if (num_kept > 0)
+    resampled.Range(0, num_kept).CopyFromVec(resampled_.Range(0, num_kept));
+  double scale = 1.0 / resample_->SampRateIn();
+  for (int32 i = num_resampled_; i < end; i++) {
+    double sample = scale * resample_->OutputSample(input_, input_offset_,
+                                                    num_input_samples_, i);
+    resampled(num_kept + i - num_resampled_) = sample;
+    resampled_sumsq_ += sample * sample;
+  }
+  resampled_.Swap(&resampled);
+  num_resampled_ = end;
+
+  // Discard the input that no later resampled sample depends on.
+  int32 new_input_offset = std::min(num_input_samples_,
+                                    std::max(input_offset_,
+                                             resample_->FirstInputIndex(end)));
+  if (new_input_offset > input_offset_) {
+    Vector<double> input(input_.Range(new_input_offset - input_offset_,
+                                      num_input_samples_ - new_input_offset));
+    input_.Swap(&input);
+    input_offset_ = new_input_offset;
+  }
+}
+
+void OnlinePitchExtractor::ProcessFrames() {
+  int32 frame_shift = opts_.NccfWindowShift(),
+      frame_length = opts_.NccfWindowSize(),
+      full_frame_length = frame_length + Round(opts_.resample_freq /
+                                               opts_.min_f0) +
+      Round(opts_.lowpass_filter_width / 2);  // as in ExtractFrame().
+  KALDI_ASSERT(frame_shift != 0 && frame_length != 0);
+  int32 start_frame = num_frames_processed_;
+  while (true) {
+    int32 start = num_frames_processed_ * frame_shift;
+    // Once the input has finished, the last frames are padded with zeros.
+    if (input_finished_ ? start + frame_length > num_resampled_ :
+        start + full_frame_length > num_resampled_)
+      break;
+    // Normalize the signal by its RMS value, as far as we know it.
+    double rms = pow(resampled_sumsq_ / num_resampled_, 0.5);
+    int32 length = std::min(full_frame_length, num_resampled_ - start);
+    Vector<double> wave(resampled_.Range(start - resampled_offset_, length));
+    if (rms != 0.0)
+      wave.Scale(1.0 / rms);
+    Vector<double> window;
+    ExtractFrame(wave, 0, opts_, &window);
+    ProcessFrame(window);
+    num_frames_processed_++;
+  }
+  if (num_frames_processed_ == start_frame) return;
+  // Discard the resampled signal that no later frame depends on.
+  int32 new_offset = std::min(num_resampled_,
+                              num_frames_processed_ * frame_shift);
+  if (new_offset > resampled_offset_) {
+    Vector<double> resampled(resampled_.Range(new_offset - resampled_offset_,
+                                              num_resampled_ - new_offset));
+    resampled_.Swap(&resampled);
+    resampled_offset_ = new_offset;
   }
-  ~PitchExtractor() {}
-
-  void ComputeLocalCost(const Matrix<double> &autocorrelation) {
-    Vector<double> correl(state_num_);
-
-    for (int32 i = 1; i < num_frames_ + 1; i++) {
-      SubVector<double> frame(autocorrelation.Row(i-1));
-      Vector<double> local_cost(state_num_);
-      for (int32 j = 0; j < state_num_; j++)
-        correl(j) = frame(j);
-      // compute the local cost
-      frames_[i].local_cost.Add(1.0);
-      frames_[i].local_cost.AddVec(-1.0, correl);
-      Vector<double> corr_lag_cost(state_num_);
-      corr_lag_cost.AddVecVec(opts_.soft_min_f0, correl, lags_, 0);
-      frames_[i].local_cost.AddVec(1.0, corr_lag_cost);
-    }  // end of loop over frames
-  }
-  void FastViterbi(const Matrix<double> &correl) {
-    ComputeLocalCost(correl);
-    double intercost, min_c, this_c;
-    int best_b, min_i, max_i;
-    BaseFloat delta_pitch_sq = log(1 + opts_.delta_pitch)
-      * log(1 + opts_.delta_pitch);
-    // loop over frames
-    for (int32 t = 1; t < num_frames_ + 1; t++) {
-      // Forward Pass
-      for (int32 i = 0; i < state_num_; i++) {
-        if ( i == 0 )
-          min_i = 0;
-        else
-          min_i = frames_[t].back_pointers(i-1);
-        min_c = std::numeric_limits<double>::infinity();
-        best_b = -1;
-
-        for (int32 k = min_i; k <= i; k++) {
-          intercost = (i-k) * (i-k) * delta_pitch_sq;
-          this_c = frames_[t-1].obj_func(k)+ opts_.penalty_factor * intercost;
-          if (this_c < min_c) {
-            min_c = this_c;
-            best_b = k;
-          }
-        }
-        frames_[t].back_pointers(i) = best_b;
-        frames_[t].obj_func(i) = min_c + frames_[t].local_cost(i);
+}
+
+void OnlinePitchExtractor::ProcessFrame(const Vector<double> &window) {
+  // Compute the NCCF for pitch extraction and for the probability of voicing,
+  // and upsample them to the lags of the Viterbi states.
+  int32 num_lags = nccf_end_lag_ - nccf_first_lag_;
+  Vector<double> inner_prod(num_lags), norm_prod(num_lags);
+  Nccf(window, nccf_first_lag_, nccf_end_lag_, opts_.NccfWindowSize(),
+       &inner_prod, &norm_prod);
+  Vector<double> nccf(num_nccf_lags_);
+  SubVector<double> nccf_sub(nccf, 0, num_nccf_lags_);
+  ProcessNccf(inner_prod, norm_prod, a_fact_pitch_, nccf_first_lag_,
+              nccf_end_lag_, &nccf_sub);
+  Vector<double> nccf_pitch(num_states_);
+  nccf_resample_->Upsample(nccf, &nccf_pitch);
+  PendingFrame *frame = new PendingFrame;
+  frame->nccf_pov.Resize(num_states_);
+  nccf.SetZero();
+  ProcessNccf(inner_prod, norm_prod, a_fact_pov_, nccf_first_lag_,
+              nccf_end_lag_, &nccf_sub);
+  nccf_resample_->Upsample(nccf, &(frame->nccf_pov));
+
+  // Compute the local cost.
+  Vector<double> local_cost(num_states_);
+  local_cost.Add(1.0);
+  local_cost.AddVec(-1.0, nccf_pitch);
+  Vector<double> corr_lag_cost(num_states_);
+  corr_lag_cost.AddVecVec(opts_.soft_min_f0, nccf_pitch, lags_, 0);
+  local_cost.AddVec(1.0, corr_lag_cost);
+
+  // Do the Viterbi forward pass.  The search for the best predecessor of each
+  // state is limited to the range between those of its neighbours, which
+  // works because the back-pointers are non-decreasing in the state index.
+  std::vector<int32> &back_pointers = frame->back_pointers;
+  back_pointers.resize(num_states_);
+  Vector<double> obj_func(num_states_);
+  double intercost, min_c, this_c;
+  int32 best_b, min_i, max_i;
+  // Forward Pass
+  for (int32 i = 0; i < num_states_; i++) {
+    if (i == 0)
+      min_i = 0;
+    else
+      min_i = back_pointers[i-1];
+    min_c = std::numeric_limits<double>::infinity();
+    best_b = -1;
+
+    for (int32 k = min_i; k <= i; k++) {
+      intercost = (i-k) * (i-k) * delta_pitch_sq_;
+      this_c = obj_func_(k) + opts_.penalty_factor * intercost;
+      if (this_c < min_c) {
+        min_c = this_c;
+        best_b = k;
       }
-      // Backward Pass
-      for (int32 i = state_num_-1; i >= 0; i--) {
-        if (i == state_num_-1)
-          max_i = state_num_-1;
-        else
-          max_i = frames_[t].back_pointers(i+1);
-        min_c = frames_[t].obj_func(i) - frames_[t].local_cost(i);
-        best_b = frames_[t].back_pointers(i);
-
-        for (int32 k = i+1 ; k <= max_i; k++) {
-          intercost = (i-k) * (i-k) * delta_pitch_sq;
-          this_c = frames_[t-1].obj_func(k)+ opts_.penalty_factor *intercost;
-          if (this_c < min_c) {
-            min_c = this_c;
-            best_b = k;
-          }
-        }
-        frames_[t].back_pointers(i) = best_b;
-        frames_[t].obj_func(i) = min_c + frames_[t].local_cost(i);
+    }
+    back_pointers[i] = best_b;
+    obj_func(i) = min_c + local_cost(i);
+  }
+  // Backward Pass
+  for (int32 i = num_states_-1; i >= 0; i--) {
+    if (i == num_states_-1)
+      max_i = num_states_-1;
+    else
+      max_i = back_pointers[i+1];
+    min_c = obj_func(i) - local_cost(i);
+    best_b = back_pointers[i];
+
+    for (int32 k = i+1 ; k <= max_i; k++) {
+      intercost = (i-k) * (i-k) * delta_pitch_sq_;
+      this_c = obj_func_(k) + opts_.penalty_factor * intercost;
+      if (this_c < min_c) {
+        min_c = this_c;
+        best_b = k;
       }
     }
-    // FindBestPath(resampled_nccf_pov);
+    back_pointers[i] = best_b;
+    obj_func(i) = min_c + local_cost(i);
   }
+  obj_func_.Swap(&obj_func);
+  pending_frames_.push_back(frame);
+}
 
-  void FindBestPath(const Matrix<double> &correlation) {
-    // Find the Best path using backpointers
-    int32 i = num_frames_;
+void OnlinePitchExtractor::OutputFrames() {
+  if (pending_frames_.empty()) return;
+  int32 last_frame = num_frames_processed_ - 1;
+  if (input_finished_) {
     int32 best;
-    double l_opt;
-    frames_[i].obj_func.Min(&best);
-    while (i > 0) {
-      l_opt = lags_(best);
-      frames_[i].truepitch = 1.0 / l_opt;
-      frames_[i].pov = correlation(i-1, best);
-      best = frames_[i].back_pointers(best);
-      i--;
-    }
+    obj_func_.Min(&best);
+    OutputPath(last_frame, best);
+    return;
   }
-  void GetPitch(Matrix<BaseFloat> *output) {
-    output->Resize(num_frames_, 2);
-    for (int32 frm = 0; frm < num_frames_; frm++) {
-      (*output)(frm, 0) = static_cast<BaseFloat>(frames_[frm + 1].pov);
-      (*output)(frm, 1) = static_cast<BaseFloat>(frames_[frm + 1].truepitch);
-    }
+  // Trace back from the lowest and highest states; as the back-pointers are
+  // non-decreasing, the paths from all the other states lie between these
+  // two, so all the paths go through the same state at any frame where these
+  // two meet.
+  int32 first_frame = output_.size(), low = 0, high = num_states_ - 1,
+      t = last_frame;
+  for (; t >= first_frame && low != high; t--) {
+    const std::vector<int32> &back_pointers =
+        pending_frames_[t - first_frame]->back_pointers;
+    low = back_pointers[low];
+    high = back_pointers[high];
   }
- private:
-  PitchExtractionOptions opts_;
-  int32 state_num_;      // number of states in Viterbi Computation
-  int32 num_frames_;     // number of frames in input wave
-  Vector<double> lags_;    // all lags used in viterbi
-  struct PitchFrame {
-    Vector<double> local_cost;
-    Vector<double> obj_func;      // optimal objective function for frame i
-    Vector<double> back_pointers;
-    double truepitch;             // True pitch
-    double pov;                   // probability of voicing
-    explicit PitchFrame() {}
-  };
-  std::vector< PitchFrame > frames_;
-};
+  if (low == high && t >= first_frame)
+    OutputPath(t, low);
+  if (opts_.max_frames_latency > 0 &&
+      last_frame - opts_.max_frames_latency >=
+      static_cast<int32>(output_.size())) {
+    // Output the frames that have reached the maximum latency, following the
+    // current best path.
+    int32 best;
+    obj_func_.Min(&best);
+    for (t = last_frame; t > last_frame - opts_.max_frames_latency; t--)
+      best = pending_frames_[t - output_.size()]->back_pointers[best];
+    OutputPath(t, best);
+  }
+}
+
+void OnlinePitchExtractor::OutputPath(int32 last_frame, int32 state) {
+  int32 first_frame = output_.size();
+  KALDI_ASSERT(last_frame >= first_frame &&
+               last_frame < num_frames_processed_);
+  output_.resize(last_frame + 1);
+  for (int32 t = last_frame; t >= first_frame; t--) {
+    const PendingFrame *frame = pending_frames_[t - first_frame];
+    output_[t].first = static_cast<BaseFloat>(frame->nccf_pov(state));
+    output_[t].second = static_cast<BaseFloat>(1.0 / lags_(state));
+    state = frame->back_pointers[state];
+  }
+  for (int32 t = first_frame; t <= last_frame; t++) {
+    delete pending_frames_.front();
+    pending_frames_.pop_front();
+  }
+}
 
 void Compute(const PitchExtractionOptions &opts,
              const VectorBase<BaseFloat> &wave,
              Matrix<BaseFloat> *output) {
   KALDI_ASSERT(output != NULL);
-  Vector<double> wave2(wave);
-
-  // Preprocess the wave
-  Vector<double> processed_wave(wave2.Dim());
-  PreProcess(opts, wave2, &processed_wave);
-  int32 num_states, rows_out = PitchNumFrames(processed_wave.Dim(), opts);
+  PitchExtractionOptions batch_opts(opts);
+  batch_opts.max_frames_latency = 0;
+  OnlinePitchExtractor extractor(batch_opts);
+  extractor.AcceptWaveform(wave);
+  extractor.InputFinished();
+  int32 rows_out = extractor.NumFramesReady();
   if (rows_out == 0)
-    KALDI_ERR << "No frames fit in file (#samples is "
-      << processed_wave.Dim() << ")";
-  Vector<double> window;       // windowed waveform.
-  double outer_min_lag = 1.0 / (1.0 * opts.max_f0) -
-      (opts.upsample_filter_width/(2.0 * opts.resample_freq));
-  double outer_max_lag = 1.0 / (1.0 * opts.min_f0) +
-      (opts.upsample_filter_width/(2.0 * opts.resample_freq));
-  int32 num_max_lag = Round(outer_max_lag * opts.resample_freq) + 1;
-  int32 num_lags = Round(opts.resample_freq * outer_max_lag) -
-      Round(opts.resample_freq *  outer_min_lag) + 1;
-  int32 start = Round(opts.resample_freq  * outer_min_lag),
-      end = Round(opts.resample_freq / opts.min_f0) +
-      Round(opts.lowpass_filter_width / 2);
-  
-  Vector<double> lags;
-  SelectLag(opts, &num_states, &lags);
-  double a_fact_pitch = pow(opts.NccfWindowSize(), 4) * opts.nccf_ballast,
-    a_fact_pov = pow(10, -9);
-  Matrix<double> nccf_pitch(rows_out, num_max_lag + 1),
-      nccf_pov(rows_out, num_max_lag + 1);
-  for (int32 r = 0; r < rows_out; r++) {  // r is frame index.
-    ExtractFrame(processed_wave, r, opts, &window);
-    // compute nccf for pitch extraction
-    Vector<double> inner_prod(num_lags), norm_prod(num_lags);
-    Nccf(window, start, end, opts.NccfWindowSize(),
-         &inner_prod, &norm_prod);
-    SubVector<double> nccf_pitch_vec(nccf_pitch.Row(r));
-    ProcessNccf(inner_prod, norm_prod, a_fact_pitch,
-        start, end, &(nccf_pitch_vec));
-    // compute the Nccf for Probability of voicing estimation
-    SubVector<double> nccf_pov_vec(nccf_pov.Row(r));
-    ProcessNccf(inner_prod, norm_prod, a_fact_pov,
-        start, end, &(nccf_pov_vec));
-  }
-  std::vector<double> lag_vec(num_states);
-  for (int32 i = 0; i < num_states; i++)
-    lag_vec[i] = static_cast<double>(lags(i));
-  // upsample the nccf to have better pitch and pov estimation
-
-  // upsample_cutoff is the filter cutoff for upsampling the NCCF, which is the
-  // Nyquist of the resampling frequency.  The NCCF is (almost completely)
-  // bandlimited to around "lowpass_cutoff" (1000 by default), and when the
-  // spectrum of this bandlimited signal is convolved with the spectrum of an
-  // impulse train with frequency "resample_freq", which are separated by 4kHz,
-  // we get energy at -5000,-3000, -1000...1000, 3000..5000, etc.  Filtering at
-  // half the Nyquist (2000 by default) is sufficient to get only the first
-  // repetition.
-  BaseFloat upsample_cutoff = opts.resample_freq * 0.5;
-  ArbitraryResample resample(num_max_lag + 1, opts.resample_freq,
-                             upsample_cutoff,
-                             lag_vec, opts.upsample_filter_width);
-  Matrix<double> resampled_nccf_pitch(rows_out, num_states);
-  resample.Upsample(nccf_pitch, &resampled_nccf_pitch);
-  Matrix<double> resampled_nccf_pov(rows_out, num_states);
-  resample.Upsample(nccf_pov, &resampled_nccf_pov);
-
-  PitchExtractor pitch(opts, lags, num_states, rows_out);
-  pitch.FastViterbi(resampled_nccf_pitch);
-  pitch.FindBestPath(resampled_nccf_pov);
+    KALDI_ERR << "No frames fit in file (#samples is " << wave.Dim() << ")";
   output->Resize(rows_out, 2);  // (pov, pitch)
-  pitch.GetPitch(output);
+  for (int32 r = 0; r < rows_out; r++) {
+    SubVector<BaseFloat> row(*output, r);
+    extractor.GetFrame(r, &row);
+  }
 }
 
 void ExtractDeltaPitch(const PostProcessPitchOptions &opts,
@@ -22,7 +22,9 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <deque>
 #include <string>
+#include <utility>
 #include <vector>
 
 
@@ -55,6 +57,8 @@ struct PitchExtractionOptions {
                                 // lowpass filter
   int32 upsample_filter_width;  // Integer that determines filter width when
                                 // upsampling NCCF
+  int32 max_frames_latency;  // Maximum latency, in frames, of the online pitch
+                             // extractor's backtrace (if > 0).
   explicit PitchExtractionOptions() :
       samp_freq(16000),
       frame_shift_ms(10.0),
@@ -69,7 +73,8 @@ struct PitchExtractionOptions {
       delta_pitch(0.005),
       nccf_ballast(0.7),
       lowpass_filter_width(1),
-      upsample_filter_width(5) {}
+      upsample_filter_width(5),
+      max_frames_latency(0) {}
   void Register(OptionsItf *po) {
     po->Register("sample-frequency", &samp_freq,
                  "Waveform data sample frequency (must match the waveform file, "
@@ -100,6 +105,10 @@ struct PitchExtractionOptions {
                  "lowpass filter, more gives sharper filter");
     po->Register("upsample-filter-width", &upsample_filter_width,
                  "Integer that determines filter width when upsampling NCCF");
+    po->Register("max-frames-latency", &max_frames_latency,
+                 "In online pitch extraction, the maximum number of frames by "
+                 "which the output may lag the input; if <= 0, each frame is "
+                 "output once its best path is known, which may take longer.");
   }
   int32 NccfWindowSize() const {
     return static_cast<int32>(resample_freq * 0.001 * frame_length_ms);
@@ -166,6 +175,100 @@ struct PostProcessPitchOptions {
                 "If true, the warped NCCF is added to output features");
   }
 };
+class LinearResample;
+class ArbitraryResample;
+
+/// OnlinePitchExtractor computes the same features as Compute(), but accepts
+/// the waveform in chunks and outputs each frame as soon as it is known, so
+/// its memory use does not grow with the length of the input (apart from two
+/// floats per output frame).
+///
+/// The waveform is normalized by its RMS value after resampling; as the RMS
+/// value of the whole input is not known until the end, each frame uses that
+/// of all the input available when it is processed.  Frames are processed when
+/// NumFramesReady() or InputFinished() is called, so if the whole waveform is
+/// given before that, the output is the same as that of Compute().
+///
+/// A frame is output when the best paths from all the pitch values at the
+/// latest frame processed go through the same pitch value at that frame, as
+/// the batch computation would then choose that value too.  If
+/// opts.max_frames_latency > 0, a frame is also output once that many later
+/// frames have been processed, using the current best path.
+class OnlinePitchExtractor {
+ public:
+  explicit OnlinePitchExtractor(const PitchExtractionOptions &opts);
+  ~OnlinePitchExtractor();
+
+  /// Accepts more of the waveform, sampled at opts.samp_freq.
+  void AcceptWaveform(const VectorBase<BaseFloat> &wave);
+
+  /// Signals that there is no more input; all remaining frames are then
+  /// processed and output.
+  void InputFinished();
+
+  /// Processes the frames for which there is enough input, and returns the
+  /// number of frames that have been output.
+  int32 NumFramesReady();
+
+  /// Gets the output for the given frame, which must be less than
+  /// NumFramesReady(): the NCCF (between -1 and 1, and higher for voiced
+  /// frames) and the pitch in Hz.
+  void GetFrame(int32 frame, VectorBase<BaseFloat> *feat) const;
+
+ private:
+  // Resamples as much of the input as possible.
+  void ResampleInput();
+  // Computes the NCCF and the Viterbi forward pass for each frame for which
+  // there is enough resampled input.
+  void ProcessFrames();
+  void ProcessFrame(const Vector<double> &window);
+  // Outputs the frames whose best path is known, or which have reached the
+  // maximum latency.
+  void OutputFrames();
+  // Outputs frames up to "last_frame", following the backpointers from
+  // "state" at that frame.
+  void OutputPath(int32 last_frame, int32 state);
+
+  // The state of a frame that has been processed but not output.
+  struct PendingFrame {
+    std::vector<int32> back_pointers;  // best state at the previous frame.
+    Vector<double> nccf_pov;  // the NCCF for the probability of voicing.
+  };
+
+  PitchExtractionOptions opts_;
+  LinearResample *resample_;  // resamples the input to opts_.resample_freq.
+  ArbitraryResample *nccf_resample_;  // upsamples the NCCF to the lags.
+  Vector<double> lags_;  // the lags of the Viterbi states.
+  int32 num_states_;
+  int32 nccf_first_lag_, nccf_end_lag_;  // the range of lags of the NCCF.
+  int32 num_nccf_lags_;  // the NCCF's dimension before upsampling.
+  double a_fact_pitch_, a_fact_pov_;  // NCCF ballast terms.
+  BaseFloat delta_pitch_sq_;
+
+  bool input_finished_;
+  Vector<double> input_;  // the input from sample input_offset_ on.
+  int32 input_offset_;
+  int32 num_input_samples_;  // total number of input samples received.
+  Vector<double> resampled_;  // resampled input from resampled_offset_ on.
+  int32 resampled_offset_;
+  int32 num_resampled_;  // total number of resampled samples.
+  double resampled_sumsq_;  // sum of squares of all resampled samples.
+
+  int32 num_frames_processed_;
+  Vector<double> obj_func_;  // Viterbi objective function at the last frame.
+  // Frames output_.size(), ..., num_frames_processed_ - 1.
+  std::deque<PendingFrame*> pending_frames_;
+  std::vector<std::pair<BaseFloat, BaseFloat> > output_;  // (NCCF, pitch)
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlinePitchExtractor);
+};
+
+/// Computes the pitch features of "wave"; "output" gets one row per frame,
+/// containing the NCCF (between -1 and 1, and higher for voiced frames) and
+/// the pitch in Hz.
+void Compute(const PitchExtractionOptions &opts,
+             const VectorBase<BaseFloat> &wave,
+             Matrix<BaseFloat> *output);
+
 /// @} End of "addtogroup feat"
 }  // namespace kaldi
 #endif  // KALDI_FEAT_PITCH_FUNCTIONS_H_
@@ -0,0 +1,121 @@
+// feat/wave-reader-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+#include "feat/wave-reader.h"
+
+namespace kaldi {
+
+// Makes a wave with integer samples in the 16-bit range.
+static void RandomWave(int32 num_channels, int32 num_samples,
+                       Matrix<BaseFloat> *data) {
+  data->Resize(num_channels, num_samples);
+  for (int32 c = 0; c < num_channels; c++)
+    for (int32 i = 0; i < num_samples; i++)
+      (*data)(c, i) = static_cast<int32>(RandGauss() * 5000.0);
+}
+
+// Checks that the ranges read by WaveReader are the same as the corresponding
+// parts of the whole file read by WaveData.
+static void TestWaveReaderRanges(const std::string &rxfilename,
+                                 const Matrix<BaseFloat> &ref,
+                                 BaseFloat samp_freq) {
+  WaveReader reader;
+  reader.Open(rxfilename);
+  KALDI_ASSERT(reader.NumChannels() == ref.NumRows() &&
+               reader.NumSamples() == ref.NumCols() &&
+               reader.SampFreq() == samp_freq);
+  for (int32 i = 0; i < 20; i++) {
+    int32 start = rand() % ref.NumCols(),
+        num_samples = rand() % (ref.NumCols() - start + 1);
+    Matrix<BaseFloat> data;
+    reader.Read(start, num_samples, &data);
+    KALDI_ASSERT(data.NumRows() == ref.NumRows() &&
+                 data.NumCols() == num_samples);
+    if (num_samples > 0) {
+      Matrix<BaseFloat> ref_part(ref.Range(0, ref.NumRows(), start,
+                                           num_samples));
+      AssertEqual(data, ref_part);
+    }
+  }
+  Matrix<BaseFloat> data, ref_copy(ref);
+  reader.Read(0, ref.NumCols(), &data);
+  AssertEqual(data, ref_copy);
+  reader.Close();
+}
+
+static void UnitTestWaveReader() {
+  for (int32 i = 0; i < 5; i++) {
+    int32 num_channels = 1 + rand() % 2, num_samples = 1 + rand() % 20000;
+    BaseFloat samp_freq = (rand() % 2 == 0 ? 8000 : 16000);
+    Matrix<BaseFloat> data;
+    RandomWave(num_channels, num_samples, &data);
+    WaveData wave(samp_freq, data);
+    std::string filename = "tmp.wav";
+    {
+      std::ofstream os(filename.c_str(), std::ios_base::out |
+                       std::ios_base::binary);
+      wave.Write(os);
+      KALDI_ASSERT(os.good());
+    }
+    {
+      WaveData wave2;
+      std::ifstream is(filename.c_str(), std::ios_base::in |
+                       std::ios_base::binary);
+      wave2.Read(is);
+      Matrix<BaseFloat> data2(wave2.Data());
+      AssertEqual(data2, data);
+    }
+    // From a file, which is seekable.
+    TestWaveReaderRanges(filename, data, samp_freq);
+    // From a pipe, which is not.
+    TestWaveReaderRanges("cat " + filename + " |", data, samp_freq);
+
+    // From an offset into a file, as when wave files are written to an archive
+    // and read through the .scp file.
+    std::string ark_filename = "tmp.ark";
+    int32 offset;
+    {
+      std::ofstream os(ark_filename.c_str(), std::ios_base::out |
+                       std::ios_base::binary);
+      os << "utt1 ";
+      offset = os.tellp();
+      wave.Write(os);
+      os << "utt2 ";
+      wave.Write(os);
+      KALDI_ASSERT(os.good());
+    }
+    std::ostringstream rxfilename;
+    rxfilename << ark_filename << ":" << offset;
+    TestWaveReaderRanges(rxfilename.str(), data, samp_freq);
+    unlink(filename.c_str());
+    unlink(ark_filename.c_str());
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestWaveReader();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -43,8 +43,7 @@ WaveData::WaveData(BaseFloat samp_freq, int32 num_samples, int32 num_channels, B
 WaveData::WaveData(BaseFloat samp_freq, BaseFloat duration, int32 num_channels, BaseFloat variance) 
   : WaveData(samp_freq, static_cast<int32>(duration * samp_freq), num_channels, variance) {}
 
-// static
-void WaveData::Expect4ByteTag(std::istream &is, const char *expected) {
+static void Expect4ByteTag(std::istream &is, const char *expected) {
   char tmp[5];
   tmp[4] = '\0';
   is.read(tmp, 4);
@@ -54,7 +53,7 @@ void WaveData::Expect4ByteTag(std::istream &is, const char *expected) {
     KALDI_ERR << "WaveData: expected " << expected << ", got " << tmp;
 }
 
-uint32 WaveData::ReadUint32(std::istream &is, bool swap) {
+static uint32 ReadUint32(std::istream &is, bool swap) {
   union {
     char result[4];
     uint32 ans;
@@ -68,7 +67,7 @@ uint32 WaveData::ReadUint32(std::istream &is, bool swap) {
 }
 
 
-uint16 WaveData::ReadUint16(std::istream &is, bool swap) {
+static uint16 ReadUint16(std::istream &is, bool swap) {
   union {
     char result[2];
     int16 ans;
@@ -81,8 +80,7 @@ uint16 WaveData::ReadUint16(std::istream &is, bool swap) {
   return u.ans;
 }
 
-// static
-void WaveData::Read4ByteTag(std::istream &is, char *dest) {
+static void Read4ByteTag(std::istream &is, char *dest) {
   is.read(dest, 4);
   if (is.fail())
     KALDI_ERR << "WaveData: expected 4-byte chunk-name, got read errror";
@@ -119,9 +117,7 @@ void WaveData::WriteUint16(std::ostream &os, int16 i) {
 
 
 
-void WaveData::Read(std::istream &is) {
-  data_.Resize(0, 0);  // clear the data.
-
+void WaveInfo::Read(std::istream &is) {
   char tmp[5];
   tmp[4] = '\0';
   Read4ByteTag(is, &tmp[0]);
@@ -133,10 +129,10 @@ void WaveData::Read(std::istream &is) {
   else
     KALDI_ERR << "WaveData: expected RIFF or RIFX, got " << tmp;
 
-#ifdef __BIG_ENDIAN__  
-  bool swap = !is_rifx;
+#ifdef __BIG_ENDIAN__
+  swap = !is_rifx;
 #else
-  bool swap = is_rifx;
+  swap = is_rifx;
 #endif
   
   uint32 riff_chunk_size = ReadUint32(is, swap);
@@ -147,12 +143,12 @@ void WaveData::Read(std::istream &is) {
 
   Expect4ByteTag(is, "fmt ");
   uint32 subchunk1_size = ReadUint32(is, swap);
-  uint16 audio_format = ReadUint16(is, swap),
-      num_channels = ReadUint16(is, swap);
+  uint16 audio_format = ReadUint16(is, swap);
+  num_channels = ReadUint16(is, swap);
   uint32 sample_rate = ReadUint32(is, swap),
       byte_rate = ReadUint32(is, swap),
-      block_align = ReadUint16(is, swap),
-      bits_per_sample = ReadUint16(is, swap);
+      block_align = ReadUint16(is, swap);
+  bits_per_sample = ReadUint16(is, swap);
 
   if (audio_format != 1)
     KALDI_ERR << "WaveData: can read only PCM data, audio_format is not 1: "
@@ -164,7 +160,7 @@ void WaveData::Read(std::istream &is) {
 
   if (num_channels <= 0)
     KALDI_ERR << "WaveData: no channels present";
-  samp_freq_ = static_cast<BaseFloat>(sample_rate);
+  samp_freq = static_cast<BaseFloat>(sample_rate);
   if (bits_per_sample != 8 && bits_per_sample != 16 && bits_per_sample != 32)
     KALDI_ERR << "WaveData: bits_per_sample is " << bits_per_sample;
   if (byte_rate != sample_rate * bits_per_sample/8 * num_channels)
@@ -205,49 +201,45 @@ void WaveData::Read(std::istream &is) {
     KALDI_ERR << "WaveData: expected data chunk, got instead "
               << next_chunk_name;
 
-  uint32 data_chunk_size = ReadUint32(is, swap);
-  riff_chunk_read += 4;
-  std::vector<char> chunk_data_vec(data_chunk_size);
-  char *data_ptr = &(chunk_data_vec[0]);
-  is.read(data_ptr, data_chunk_size);
-  riff_chunk_read += data_chunk_size;
+  data_size = ReadUint32(is, swap);
+  riff_chunk_read += 4 + data_size;
 
   if (riff_chunk_read != riff_chunk_size)
     KALDI_WARN << "Expected " << riff_chunk_size << " bytes in RIFF chunk, but got "
                << riff_chunk_read << " (do not support reading multiple data chunks).";
-  if (is.fail())
-    KALDI_ERR << "WaveData: failed to read data chunk.";
-
-  if (data_chunk_size % block_align != 0)
+  if (data_size % block_align != 0)
     KALDI_ERR << "WaveData: data chunk size has unexpected length "
-              << data_chunk_size << "; block-align = " << block_align;
-  if (data_chunk_size == 0)
+              << data_size << "; block-align = " << block_align;
+  if (data_size == 0)
     KALDI_ERR << "WaveData: empty file (no data)";
+}
 
-  uint32 num_samp = data_chunk_size / block_align;
-  data_.Resize(num_channels, num_samp);
-  for (uint32 i = 0; i < num_samp; i++) {
-    for (uint32 j = 0; j < num_channels; j++) {
+void WaveInfo::ConvertSamples(const char *data_ptr, int32 num_samp,
+                              MatrixBase<BaseFloat> *out) const {
+  KALDI_ASSERT(out->NumRows() == num_channels && out->NumCols() == num_samp);
+  MatrixBase<BaseFloat> &data = *out;
+  for (int32 i = 0; i < num_samp; i++) {
+    for (int32 j = 0; j < num_channels; j++) {
       switch (bits_per_sample) {
         case 8:
-          data_(j, i) = *data_ptr;
+          data(j, i) = *data_ptr;
           data_ptr++;
           break;
         case 16:
           {
-            int16 k = *reinterpret_cast<uint16*>(data_ptr);
+            int16 k = *reinterpret_cast<const uint16*>(data_ptr);
             if (swap)
               KALDI_SWAP2(k);
-            data_(j, i) =  k;
+            data(j, i) =  k;
             data_ptr += 2;
             break;
           }
         case 32:
           {
-            int32 k = *reinterpret_cast<uint32*>(data_ptr);
+            int32 k = *reinterpret_cast<const uint32*>(data_ptr);
             if (swap)
               KALDI_SWAP4(k);
-            data_(j, i) =  k;
+            data(j, i) =  k;
             data_ptr += 4;
             break;
           }
@@ -258,6 +250,71 @@ void WaveData::Read(std::istream &is) {
   }
 }
 
+void WaveData::Read(std::istream &is) {
+  data_.Resize(0, 0);  // clear the data.
+
+  WaveInfo info;
+  info.Read(is);
+  samp_freq_ = info.samp_freq;
+  std::vector<char> chunk_data_vec(info.data_size);
+  is.read(&(chunk_data_vec[0]), info.data_size);
+  if (is.fail())
+    KALDI_ERR << "WaveData: failed to read data chunk.";
+
+  data_.Resize(info.num_channels, info.NumSamples());
+  info.ConvertSamples(&(chunk_data_vec[0]), info.NumSamples(), &data_);
+}
+
+void WaveReader::Open(const std::string &rxfilename) {
+  data_.Resize(0, 0);
+  if (!input_.Open(rxfilename))
+    KALDI_ERR << "Failed to open wave file " << PrintableRxfilename(rxfilename);
+  std::istream &is = input_.Stream();
+  info_.Read(is);
+  // Files and offsets into files can be seeked in, but pipes and compressed
+  // files can't, and tellg() fails for them.
+  data_start_ = is.tellg();
+  seekable_ = (data_start_ != std::streampos(-1));
+  if (!seekable_) {
+    is.clear();
+    std::vector<char> chunk_data_vec(info_.data_size);
+    is.read(&(chunk_data_vec[0]), info_.data_size);
+    if (is.fail())
+      KALDI_ERR << "WaveData: failed to read data chunk from "
+                << PrintableRxfilename(rxfilename);
+    data_.Resize(info_.num_channels, info_.NumSamples());
+    info_.ConvertSamples(&(chunk_data_vec[0]), info_.NumSamples(), &data_);
+  }
+}
+
+void WaveReader::Close() {
+  if (input_.IsOpen()) input_.Close();
+  info_ = WaveInfo();
+  data_.Resize(0, 0);
+  buffer_.clear();
+}
+
+void WaveReader::Read(int32 start, int32 num_samples,
+                      Matrix<BaseFloat> *data) {
+  KALDI_ASSERT(input_.IsOpen() && start >= 0 && num_samples >= 0 &&
+               start + num_samples <= NumSamples());
+  data->Resize(info_.num_channels, num_samples, kUndefined);
+  if (num_samples == 0) return;
+  if (!seekable_) {
+    data->CopyFromMat(data_.Range(0, info_.num_channels, start, num_samples));
+    return;
+  }
+  std::istream &is = input_.Stream();
+  int32 block_align = info_.BlockAlign();
+  is.seekg(data_start_ + static_cast<std::streamoff>(start) * block_align);
+  buffer_.resize(static_cast<size_t>(num_samples) * block_align);
+  is.read(&(buffer_[0]), buffer_.size());
+  if (is.fail())
+    KALDI_ERR << "WaveReader: failed to read samples " << start << " to "
+              << (start + num_samples) << " from wave file.";
+  info_.ConvertSamples(&(buffer_[0]), num_samples, data);
+}
+
 
 // Write 16-bit PCM.
 
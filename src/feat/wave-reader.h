@@ -45,14 +45,43 @@
 #define KALDI_FEAT_WAVE_READER_H_
 
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "base/kaldi-types.h"
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
+#include "util/kaldi-io.h"
 
 
 namespace kaldi {
 
+/// This struct holds the format of a wave file, as read from its header.
+struct WaveInfo {
+  BaseFloat samp_freq;
+  int32 num_channels;
+  int32 bits_per_sample;
+  bool swap;  // true if the samples need to be byte-swapped.
+  uint32 data_size;  // size of the data chunk in bytes.
+
+  WaveInfo(): samp_freq(0.0), num_channels(0), bits_per_sample(0),
+              swap(false), data_size(0) { }
+
+  /// Reads the header, up to the start of the data (i.e. after the size of
+  /// the "data" chunk).  Throws on error.
+  void Read(std::istream &is);
+
+  int32 BlockAlign() const { return num_channels * bits_per_sample / 8; }
+
+  int32 NumSamples() const { return data_size / BlockAlign(); }
+
+  /// Converts "num_samples" samples (of all the channels) in the format of
+  /// the data chunk, starting at "data", into the columns of "out", which
+  /// must have NumChannels() rows and num_samples columns.
+  void ConvertSamples(const char *data, int32 num_samples,
+                      MatrixBase<BaseFloat> *out) const;
+};
+
 /// This class's purpose is to read in Wave files.
 class WaveData {
  public:
@@ -96,6 +125,11 @@ class WaveData {
     samp_freq_ = 0.0;
   }
 
+  void Swap(WaveData *other) {
+    data_.Swap(&(other->data_));
+    std::swap(samp_freq_, other->samp_freq_);
+  }
+
   // Returns number of channels
   int32 NumChannels() const { return data_.NumRows(); }
   
@@ -111,10 +145,6 @@ class WaveData {
  private:
   Matrix<BaseFloat> data_;
   BaseFloat samp_freq_;
-  static void Expect4ByteTag(std::istream &is, const char *expected);
-  uint32 ReadUint32(std::istream &is, bool swap);
-  uint16 ReadUint16(std::istream &is, bool swap);
-  static void Read4ByteTag(std::istream &is, char *dest);
 
   static void WriteUint32(std::ostream &os, int32 i);
   static void WriteUint16(std::ostream &os, int16 i);
@@ -123,6 +153,52 @@ class WaveData {
 
 
 
+/// WaveReader reads ranges of samples from a wave file on demand, so that
+/// segments of very long recordings can be processed in memory proportional
+/// to the length of the segments rather than that of the recording.  Files and
+/// offsets into files (see Input) are read by seeking; for other inputs,
+/// e.g. pipes and .gz files, the whole file is read in when it is opened.
+class WaveReader {
+ public:
+  WaveReader(): seekable_(false) { }
+
+  /// Opens the wave file "rxfilename" and reads its header.  Throws on
+  /// error.  It's valid to call Open() when a file is already open.
+  void Open(const std::string &rxfilename);
+
+  bool IsOpen() { return input_.IsOpen(); }
+
+  void Close();
+
+  BaseFloat SampFreq() const { return info_.samp_freq; }
+
+  int32 NumChannels() const { return info_.num_channels; }
+
+  int32 NumSamples() const { return info_.NumSamples(); }
+
+  /// Returns the duration in seconds.
+  BaseFloat Duration() const { return NumSamples() / info_.samp_freq; }
+
+  /// Returns true if the samples are read by seeking, and false if the whole
+  /// file was read in by Open().
+  bool Seekable() const { return seekable_; }
+
+  /// Reads samples [start, start + num_samples) of all the channels into
+  /// "data", which is resized to NumChannels() by num_samples.  Throws on
+  /// error.
+  void Read(int32 start, int32 num_samples, Matrix<BaseFloat> *data);
+
+ private:
+  Input input_;
+  WaveInfo info_;
+  bool seekable_;
+  std::streampos data_start_;  // The position of the samples in the stream.
+  std::vector<char> buffer_;
+  Matrix<BaseFloat> data_;  // The whole file, if !seekable_.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(WaveReader);
+};
+
+
 // Holder class for .wav files that enables us to read (but not write)
 // .wav files. c.f. util/kaldi-holder.h
 class WaveHolder {
@@ -148,6 +224,8 @@ class WaveHolder {
 
   void Clear() { t_.Clear(); }
 
+  void Swap(WaveHolder *other) { t_.Swap(&(other->t_)); }
+
   const T &Value() { return t_; }
 
   WaveHolder &operator = (const WaveHolder &other) {
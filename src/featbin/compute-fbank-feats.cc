@@ -21,30 +21,42 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "feat/feature-fbank.h"
+#include "feat/feature-segments.h"
+#include "feat/feature-task.h"
 #include "feat/wave-reader.h"
-
+#include "thread/kaldi-task-sequence.h"
 
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
     const char *usage =
         "Create Mel-filter bank (FBANK) feature files.\n"
-        "Usage:  compute-fbank-feats [options...] <wav-rspecifier> <feats-wspecifier>\n";
+        "Usage:  compute-fbank-feats [options...] <wav-rspecifier> <feats-wspecifier>\n"
+        "e.g.: compute-fbank-feats --num-threads=8 scp:wav.scp ark:fbank.ark\n"
+        "With --segments, <wav-rspecifier> must be an scp file of recordings,\n"
+        "and features are computed for each segment (as with extract-segments\n"
+        "--min-segment-length=0 piped to this program, but reading only the\n"
+        "segments, and computing frames that overlapping segments share once).\n"
+        "e.g.: compute-fbank-feats --segments=segments scp:wav.scp ark:fbank.ark\n";
 
     // construct all the global objects
     ParseOptions po(usage);
     FbankOptions fbank_opts;
+    TaskSequencerConfig thread_config;
     bool subtract_mean = false;
     BaseFloat vtln_warp = 1.0;
     std::string vtln_map_rspecifier;
     std::string utt2spk_rspecifier;
     int32 channel = -1;
     BaseFloat min_duration = 0.0;
+    std::string segments_rxfilename;
+    BaseFloat max_overshoot = 0.5;
     // Define defaults for gobal options
     std::string output_format = "kaldi";
 
     // Register the option struct
     fbank_opts.Register(&po);
+    thread_config.Register(&po);
     // Register the options
     po.Register("output-format", &output_format, "Format of the output files [kaldi, htk]");
     po.Register("subtract-mean", &subtract_mean, "Subtract mean of each feature file [CMS]; not recommended to do it this way. ");
@@ -53,6 +65,13 @@ int main(int argc, char *argv[]) {
     po.Register("utt2spk", &utt2spk_rspecifier, "Utterance to speaker-id map (if doing VTLN and you have warps per speaker)");
     po.Register("channel", &channel, "Channel to extract (-1 -> expect mono, 0 -> left, 1 -> right)");
     po.Register("min-duration", &min_duration, "Minimum duration of segments to process (in seconds).");
+    po.Register("segments", &segments_rxfilename, "Segments file, with lines "
+                "<segment-id> <recording-id> <start-time> <end-time> "
+                "[<channel>]; if given, compute features of the segments of "
+                "the recordings in <wav-rspecifier>");
+    po.Register("max-overshoot", &max_overshoot, "With --segments: segments "
+                "ending past the end of the recording by less than this (in "
+                "seconds) are truncated, else rejected.");
 
     // OPTION PARSING ..........................................................
     //
@@ -69,31 +88,31 @@ int main(int argc, char *argv[]) {
 
     std::string output_wspecifier = po.GetArg(2);
 
-    Fbank fbank(fbank_opts);
-
-    SequentialTableReader<WaveHolder> reader(wav_rspecifier);
-    BaseFloatMatrixWriter kaldi_writer;  // typedef to TableWriter<something>.
-    TableWriter<HtkMatrixHolder> htk_writer;
-
     if (utt2spk_rspecifier != "")
       KALDI_ASSERT(vtln_map_rspecifier != "" && "the utt2spk option is only "
                    "needed if the vtln-map option is used.");
     RandomAccessBaseFloatReaderMapped vtln_map_reader(vtln_map_rspecifier,
                                                       utt2spk_rspecifier);
-    
-    if (output_format == "kaldi") {
-      if (!kaldi_writer.Open(output_wspecifier))
-        KALDI_ERR << "Could not initialize output with wspecifier "
-                  << output_wspecifier;
-    } else if (output_format == "htk") {
-      if (!htk_writer.Open(output_wspecifier))
-        KALDI_ERR << "Could not initialize output with wspecifier "
-                  << output_wspecifier;
-    } else {
-      KALDI_ERR << "Invalid output_format string " << output_format;
-    }
+
+    // HTK kind FBANK, with energy or else c0; 10ms shift.
+    FeatureWriter writer(output_wspecifier, output_format,
+                         007 | (fbank_opts.use_energy ? 0100 : 020000), 100000);
 
     int32 num_utts = 0, num_success = 0;
+    FeatureComputerPool<Fbank> pool(fbank_opts);
+    if (segments_rxfilename != "") {
+      ComputeFeaturesForSegments(
+          thread_config, &pool, segments_rxfilename, wav_rspecifier,
+          (vtln_map_rspecifier != "" ? &vtln_map_reader : NULL), vtln_warp,
+          channel, min_duration, max_overshoot, subtract_mean, &writer,
+          &num_utts, &num_success);
+      KALDI_LOG << " Done " << num_success << " out of " << num_utts
+                << " utterances.";
+      return (num_success != 0 ? 0 : 1);
+    }
+
+    SequentialTableReader<WaveHolder> reader(wav_rspecifier);
+    TaskSequencer<FeatureTask<Fbank> > sequencer(thread_config);
     for (; !reader.Done(); reader.Next()) {
       num_utts++;
       std::string utt = reader.Key();
@@ -139,42 +158,13 @@ int main(int argc, char *argv[]) {
                   << "option).  Utterance is " << utt;
 
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        fbank.Compute(waveform, vtln_warp_local, &features, NULL);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute features for utterance "
-                   << utt;
-        continue;
-      }
-      if (subtract_mean) {
-        Vector<BaseFloat> mean(features.NumCols());
-        mean.AddRowSumMat(1.0, features);
-        mean.Scale(1.0 / features.NumRows());
-        for (int32 i = 0; i < features.NumRows(); i++)
-          features.Row(i).AddVec(-1.0, mean);
-      }
-      if (output_format == "kaldi") {
-        kaldi_writer.Write(utt, features);
-      } else {
-        std::pair<Matrix<BaseFloat>, HtkHeader> p;
-        p.first.Resize(features.NumRows(), features.NumCols());
-        p.first.CopyFromMat(features);
-        HtkHeader header = {
-          features.NumRows(),
-          100000,  // 10ms shift
-          static_cast<int16>(sizeof(float)*features.NumCols()),
-          static_cast<uint16>(007 | // FBANK
-          (fbank_opts.use_energy ? 0100 : 020000)) // energy; otherwise c0
-        };
-        p.second = header;
-        htk_writer.Write(utt, p);
-      }
+      sequencer.Run(new FeatureTask<Fbank>(&pool, utt, waveform,
+                                           vtln_warp_local, subtract_mean,
+                                           &writer, &num_success));
       if (num_utts % 10 == 0)
         KALDI_LOG << "Processed " << num_utts << " utterances";
-      KALDI_VLOG(2) << "Processed features for key " << utt;
-      num_success++;
     }
+    sequencer.Wait();
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
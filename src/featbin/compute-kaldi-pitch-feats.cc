@@ -19,8 +19,35 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "feat/pitch-functions.cc"
+#include "feat/feature-task.h"
 #include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
 
+namespace kaldi {
+
+// Gives the pitch extractor the interface of the other feature computers, so
+// that it can be used with FeatureTask.
+class PitchComputer {
+ public:
+  typedef PitchExtractionOptions Options;
+
+  explicit PitchComputer(const PitchExtractionOptions &opts): opts_(opts) { }
+
+  void Compute(const VectorBase<BaseFloat> &wave, BaseFloat vtln_warp,
+               Matrix<BaseFloat> *output, Vector<BaseFloat> *wave_remainder) {
+    KALDI_ASSERT(vtln_warp == 1.0 && wave_remainder == NULL);
+    kaldi::Compute(opts_, wave, output);
+    double tot = output->Sum();
+    if (output->NumCols() != 2 || KALDI_ISINF(tot) || KALDI_ISNAN(tot))
+      KALDI_WARN << "Pitch extraction failed, num-rows is "
+                 << output->NumRows() << ", total is " << tot;
+  }
+
+ private:
+  PitchExtractionOptions opts_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -32,17 +59,20 @@ int main(int argc, char *argv[]) {
         "process-kaldi-pitch-feats.\n"
         "Usage: compute-kaldi-pitch-feats [options...] <wav-rspecifier> <feats-wspecifier>\n"
         "e.g.\n"
-        "compute-kaldi-pitch-feats --sample-frequency=8000 scp:wav.scp ark:- \n";
+        "compute-kaldi-pitch-feats --sample-frequency=8000 --num-threads=4 \\\n"
+        "   scp:wav.scp ark:- \n";
     
     
     ParseOptions po(usage);
     PitchExtractionOptions pitch_opts;
+    TaskSequencerConfig thread_config;
     int32 channel = -1; // Note: this isn't configurable because it's not a very
                         // good idea to control it this way: better to extract the
                         // on the command line (in the .scp file) using sox or
                         // similar.
 
     pitch_opts.Register(&po);
+    thread_config.Register(&po);
     
     po.Read(argc, argv);
 
@@ -55,9 +85,11 @@ int main(int argc, char *argv[]) {
         feat_wspecifier = po.GetArg(2);
 
     SequentialTableReader<WaveHolder> wav_reader(wav_rspecifier);
-    BaseFloatMatrixWriter feat_writer(feat_wspecifier);
+    FeatureWriter feat_writer(feat_wspecifier, "kaldi", 0, 0);
 
-    int32 num_done = 0, num_err = 0;
+    int32 num_utts = 0, num_done = 0;
+    FeatureComputerPool<PitchComputer> pool(pitch_opts);
+    TaskSequencer<FeatureTask<PitchComputer> > sequencer(thread_config);
     for (; !wav_reader.Done(); wav_reader.Next()) {
       std::string utt = wav_reader.Key();  
       const WaveData &wave_data = wav_reader.Value(); 
@@ -89,29 +121,14 @@ int main(int argc, char *argv[]) {
       
       
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        Compute(pitch_opts, waveform, &features);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute pitch for utterance "
-                   << utt;
-        continue;
-      }
-
-      double tot = features.Sum();
-      if (features.NumCols() != 2 || KALDI_ISINF(tot) || KALDI_ISNAN(tot)) {
-        KALDI_WARN << "Pitch extraction failed for utterance " << utt
-                   << ", num-rows is " << features.NumRows() << ", total is "
-                   << tot;
-      }
-      
-      feat_writer.Write(utt, features);
-      if (num_done % 50 == 0 && num_done != 0)
-        KALDI_VLOG(2) << "Processed " << num_done << " utterances";
-      num_done++;
+      num_utts++;
+      sequencer.Run(new FeatureTask<PitchComputer>(&pool, utt, waveform, 1.0,
+                                                   false, &feat_writer,
+                                                   &num_done));
     }
-    KALDI_LOG << "Done " << num_done << " utterances, " << num_err
-              << " with errors.";
+    sequencer.Wait();
+    KALDI_LOG << "Done " << num_done << " utterances, "
+              << (num_utts - num_done) << " with errors.";
     return (num_done != 0 ? 0 : 1);
   } catch(const std::exception &e) {
     std::cerr << e.what();
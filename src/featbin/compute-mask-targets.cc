@@ -0,0 +1,294 @@
+// featbin/compute-mask-targets.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "feat/feature-fbank.h"
+#include "feat/mask-targets.h"
+#include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// The writers for each output; those that are not open are not computed.  If
+// "compress" is true, the compressed writers are used.
+struct MaskTargetWriters {
+  bool compress;
+  CompressionMethod compression_method;
+  BaseFloatMatrixWriter writers[kNumMaskTargetTypes];
+  CompressedMatrixWriter compressed_writers[kNumMaskTargetTypes];
+
+  bool IsOpen(int32 i) const {
+    return writers[i].IsOpen() || compressed_writers[i].IsOpen();
+  }
+};
+
+// Computes the requested outputs for one utterance from its clean and noisy
+// waveforms.
+class MaskTargetTask {
+ public:
+  // If fbank_opts is non-NULL, "clean" and "other" are waveforms, from which
+  // the filterbank features are computed; otherwise they are the features.
+  MaskTargetTask(const MaskTargetComputer &computer,
+                 const FbankOptions *fbank_opts,
+                 const std::string &utt,
+                 const VectorBase<BaseFloat> &clean_wave,
+                 const VectorBase<BaseFloat> &other_wave,
+                 const MatrixBase<BaseFloat> &clean_feats,
+                 const MatrixBase<BaseFloat> &other_feats,
+                 MaskTargetWriters *writers,
+                 int32 *num_success):
+      computer_(computer), fbank_opts_(fbank_opts), utt_(utt),
+      clean_wave_(clean_wave), other_wave_(other_wave),
+      clean_feats_(clean_feats), other_feats_(other_feats),
+      writers_(writers), num_success_(num_success), ok_(false) { }
+
+  void operator () () {
+    try {
+      if (fbank_opts_ != NULL) {
+        Fbank fbank(*fbank_opts_);
+        fbank.Compute(clean_wave_, 1.0, &clean_feats_, NULL);
+        fbank.Compute(other_wave_, 1.0, &other_feats_, NULL);
+      }
+      Matrix<BaseFloat> *outputs[kNumMaskTargetTypes];
+      for (int32 i = 0; i < kNumMaskTargetTypes; i++)
+        outputs[i] = (writers_->IsOpen(i) ? &(outputs_[i]) : NULL);
+      computer_.Compute(clean_feats_, other_feats_, outputs);
+      if (writers_->compress) {
+        for (int32 i = 0; i < kNumMaskTargetTypes; i++) {
+          if (outputs[i] == NULL) continue;
+          compressed_outputs_[i].CopyFromMat(outputs_[i],
+                                             writers_->compression_method);
+          outputs_[i].Resize(0, 0);
+        }
+      }
+      ok_ = true;
+    } catch (...) {
+      ok_ = false;
+    }
+  }
+
+  ~MaskTargetTask() {  // Produces output.  Run sequentially.
+    if (!ok_) {
+      KALDI_WARN << "Failed to compute targets for utterance " << utt_;
+      return;
+    }
+    for (int32 i = 0; i < kNumMaskTargetTypes; i++) {
+      if (writers_->writers[i].IsOpen())
+        writers_->writers[i].Write(utt_, outputs_[i]);
+      if (writers_->compressed_writers[i].IsOpen())
+        writers_->compressed_writers[i].Write(utt_, compressed_outputs_[i]);
+    }
+    KALDI_VLOG(2) << "Processed targets for key " << utt_;
+    (*num_success_)++;
+  }
+
+ private:
+  const MaskTargetComputer &computer_;
+  const FbankOptions *fbank_opts_;
+  std::string utt_;
+  Vector<BaseFloat> clean_wave_;
+  Vector<BaseFloat> other_wave_;
+  Matrix<BaseFloat> clean_feats_;
+  Matrix<BaseFloat> other_feats_;
+  MaskTargetWriters *writers_;
+  int32 *num_success_;
+  bool ok_;
+  Matrix<BaseFloat> outputs_[kNumMaskTargetTypes];
+  CompressedMatrix compressed_outputs_[kNumMaskTargetTypes];
+};
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    const char *usage =
+        "Compute the targets for training time-frequency masking networks,\n"
+        "and the masks themselves, in one pass: IRM targets, IRM, SNR, ARM\n"
+        "targets and ARM (see MaskTargetOptions in feat/mask-targets.h).  The\n"
+        "inputs are log-filterbank features of the clean speech and of the\n"
+        "noise (or of the noisy speech, with --from-noisy=true), or with\n"
+        "--wav=true, the waveforms, from which the filterbank features are\n"
+        "computed (see the --fbank.* options).  Only the outputs whose\n"
+        "wspecifier is given are computed.  The targets are computed as in\n"
+        "compute-irm-targets and compute-arm-targets, but not bit-for-bit:\n"
+        "with --from-noisy=true, the noise energy is computed with log1p,\n"
+        "and bins where the noisy and clean energies are equal get IRM\n"
+        "target 1.\n"
+        "Usage: compute-mask-targets [options] <clean-rspecifier> "
+        "<noise-or-noisy-rspecifier>\n"
+        "e.g.: compute-mask-targets --irm-targets-wspecifier=ark:targets.ark \\\n"
+        "   --snr-wspecifier=ark:snr.ark --num-threads=4 \\\n"
+        "   scp:clean_feats.scp scp:noise_feats.scp\n"
+        "e.g.: compute-mask-targets --wav=true --from-noisy=true \\\n"
+        "   --irm-wspecifier=ark:irm.ark scp:clean_wav.scp scp:noisy_wav.scp\n"
+        "See also: compute-irm-targets, compute-arm-targets, "
+        "irm-targets-to-irm, arm-targets-to-arm\n";
+
+    ParseOptions po(usage);
+    MaskTargetOptions mask_opts;
+    FbankOptions fbank_opts;
+    TaskSequencerConfig thread_config;
+    bool wav = false;
+    bool compress = false;
+    int32 compression_method_in = 1;
+    std::string wspecifiers[kNumMaskTargetTypes];
+
+    // Dithering would add different noise to the clean and noisy features.
+    fbank_opts.frame_opts.dither = 0.0;
+
+    mask_opts.Register(&po);
+    ParseOptions po_fbank("fbank", &po);
+    fbank_opts.Register(&po_fbank);
+    thread_config.Register(&po);
+
+    po.Register("irm-targets-wspecifier", &wspecifiers[kIrmTargets],
+                "Wspecifier for IRM targets");
+    po.Register("irm-wspecifier", &wspecifiers[kIrm], "Wspecifier for the "
+                "IRM (or its log, if --apply-log=true)");
+    po.Register("snr-wspecifier", &wspecifiers[kSnr], "Wspecifier for the "
+                "SNR in dB");
+    po.Register("arm-targets-wspecifier", &wspecifiers[kArmTargets],
+                "Wspecifier for ARM targets");
+    po.Register("arm-wspecifier", &wspecifiers[kArm], "Wspecifier for the "
+                "ARM (or its log, if --apply-log=true)");
+    po.Register("wav", &wav, "If true, the inputs are waveforms rather than "
+                "log-filterbank features");
+    po.Register("compress", &compress, "If true, write outputs in compressed "
+                "form");
+    po.Register("compression-method", &compression_method_in,
+                "Only relevant if --compress=true; the method (1, 2 or 3) "
+                "used to compress the outputs; see CompressionMethod in "
+                "matrix/compressed-matrix.h");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string clean_rspecifier = po.GetArg(1),
+        other_rspecifier = po.GetArg(2);
+
+    if (compression_method_in < kSpeechFeature ||
+        compression_method_in > kEntropyCodedFeature)
+      KALDI_ERR << "Invalid --compression-method=" << compression_method_in;
+    if (wav && !fbank_opts.use_log_fbank)
+      KALDI_ERR << "--fbank.use-log-fbank must be true.";
+
+    MaskTargetComputer computer(mask_opts);
+
+    MaskTargetWriters writers;
+    writers.compress = compress;
+    writers.compression_method =
+        static_cast<CompressionMethod>(compression_method_in);
+    int32 num_outputs = 0;
+    for (int32 i = 0; i < kNumMaskTargetTypes; i++) {
+      if (wspecifiers[i] == "") continue;
+      if (!(compress ? writers.compressed_writers[i].Open(wspecifiers[i]) :
+            writers.writers[i].Open(wspecifiers[i])))
+        KALDI_ERR << "Could not initialize output with wspecifier "
+                  << wspecifiers[i];
+      num_outputs++;
+    }
+    if (num_outputs == 0)
+      KALDI_ERR << "No outputs specified: use at least one of "
+                << "--irm-targets-wspecifier, --irm-wspecifier, "
+                << "--snr-wspecifier, --arm-targets-wspecifier or "
+                << "--arm-wspecifier";
+
+    int32 num_utts = 0, num_success = 0, num_missing = 0, num_mismatch = 0;
+    TaskSequencer<MaskTargetTask> sequencer(thread_config);
+    if (wav) {
+      SequentialTableReader<WaveHolder> clean_reader(clean_rspecifier);
+      RandomAccessTableReader<WaveHolder> other_reader(other_rspecifier);
+      for (; !clean_reader.Done(); clean_reader.Next()) {
+        num_utts++;
+        std::string utt = clean_reader.Key();
+        if (!other_reader.HasKey(utt)) {
+          KALDI_WARN << "Missing noise or noisy waveform for utterance "
+                     << utt;
+          num_missing++;
+          continue;
+        }
+        const WaveData &clean_wave = clean_reader.Value(),
+            &other_wave = other_reader.Value(utt);
+        if (clean_wave.NumSamples() != other_wave.NumSamples() ||
+            clean_wave.SampFreq() != other_wave.SampFreq()) {
+          KALDI_WARN << "Mismatch in number of samples or sampling frequency "
+                     << "for utterance " << utt << ", skipping it.";
+          num_mismatch++;
+          continue;
+        }
+        if (fbank_opts.frame_opts.samp_freq != clean_wave.SampFreq())
+          KALDI_ERR << "Sample frequency mismatch: you specified "
+                    << fbank_opts.frame_opts.samp_freq << " but data has "
+                    << clean_wave.SampFreq() << " (use --fbank.sample-"
+                    << "frequency option).  Utterance is " << utt;
+        if (clean_wave.NumChannels() != 1)
+          KALDI_WARN << "Utterance " << utt << " has "
+                     << clean_wave.NumChannels() << " channels; using the "
+                     << "first.";
+        Matrix<BaseFloat> empty;
+        sequencer.Run(new MaskTargetTask(computer, &fbank_opts, utt,
+                                         clean_wave.Data().Row(0),
+                                         other_wave.Data().Row(0),
+                                         empty, empty, &writers,
+                                         &num_success));
+      }
+    } else {
+      SequentialBaseFloatMatrixReader clean_reader(clean_rspecifier);
+      RandomAccessBaseFloatMatrixReader other_reader(other_rspecifier);
+      for (; !clean_reader.Done(); clean_reader.Next()) {
+        num_utts++;
+        std::string utt = clean_reader.Key();
+        if (!other_reader.HasKey(utt)) {
+          KALDI_WARN << "Missing noise or noisy features for utterance "
+                     << utt;
+          num_missing++;
+          continue;
+        }
+        const Matrix<BaseFloat> &clean_feats = clean_reader.Value(),
+            &other_feats = other_reader.Value(utt);
+        if (!SameDim(clean_feats, other_feats)) {
+          KALDI_WARN << "Mismatch in dimensions of clean and noise or noisy "
+                     << "features for utterance " << utt << ": "
+                     << clean_feats.NumRows() << " x " << clean_feats.NumCols()
+                     << " vs " << other_feats.NumRows() << " x "
+                     << other_feats.NumCols() << ", skipping it.";
+          num_mismatch++;
+          continue;
+        }
+        Vector<BaseFloat> empty;
+        sequencer.Run(new MaskTargetTask(computer, NULL, utt, empty, empty,
+                                         clean_feats, other_feats, &writers,
+                                         &num_success));
+      }
+    }
+    sequencer.Wait();
+    KALDI_LOG << "Computed targets for " << num_success << " out of "
+              << num_utts << " utterances; " << num_missing << " had no "
+              << "noise or noisy input, " << num_mismatch << " had "
+              << "mismatched inputs.";
+    return (num_success != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
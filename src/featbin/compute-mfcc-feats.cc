@@ -21,29 +21,42 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "feat/feature-mfcc.h"
+#include "feat/feature-segments.h"
+#include "feat/feature-task.h"
 #include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
 
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
     const char *usage =
         "Create MFCC feature files.\n"
-        "Usage:  compute-mfcc-feats [options...] <wav-rspecifier> <feats-wspecifier>\n";
+        "Usage:  compute-mfcc-feats [options...] <wav-rspecifier> <feats-wspecifier>\n"
+        "e.g.: compute-mfcc-feats --num-threads=8 scp:wav.scp ark:mfcc.ark\n"
+        "With --segments, <wav-rspecifier> must be an scp file of recordings,\n"
+        "and features are computed for each segment (as with extract-segments\n"
+        "--min-segment-length=0 piped to this program, but reading only the\n"
+        "segments, and computing frames that overlapping segments share once).\n"
+        "e.g.: compute-mfcc-feats --segments=segments scp:wav.scp ark:mfcc.ark\n";
 
     // construct all the global objects
     ParseOptions po(usage);
     MfccOptions mfcc_opts;
+    TaskSequencerConfig thread_config;
     bool subtract_mean = false;
     BaseFloat vtln_warp = 1.0;
     std::string vtln_map_rspecifier;
     std::string utt2spk_rspecifier;
     int32 channel = -1;
     BaseFloat min_duration = 0.0;
+    std::string segments_rxfilename;
+    BaseFloat max_overshoot = 0.5;
     // Define defaults for gobal options
     std::string output_format = "kaldi";
 
     // Register the MFCC option struct
     mfcc_opts.Register(&po);
+    thread_config.Register(&po);
 
     // Register the options
     po.Register("output-format", &output_format, "Format of the output "
@@ -60,6 +73,13 @@ int main(int argc, char *argv[]) {
                 "0 -> left, 1 -> right)");
     po.Register("min-duration", &min_duration, "Minimum duration of segments "
                 "to process (in seconds).");
+    po.Register("segments", &segments_rxfilename, "Segments file, with lines "
+                "<segment-id> <recording-id> <start-time> <end-time> "
+                "[<channel>]; if given, compute features of the segments of "
+                "the recordings in <wav-rspecifier>");
+    po.Register("max-overshoot", &max_overshoot, "With --segments: segments "
+                "ending past the end of the recording by less than this (in "
+                "seconds) are truncated, else rejected.");
 
     po.Read(argc, argv);
 
@@ -72,31 +92,31 @@ int main(int argc, char *argv[]) {
 
     std::string output_wspecifier = po.GetArg(2);
 
-    Mfcc mfcc(mfcc_opts);
-
-    SequentialTableReader<WaveHolder> reader(wav_rspecifier);
-    BaseFloatMatrixWriter kaldi_writer;  // typedef to TableWriter<something>.
-    TableWriter<HtkMatrixHolder> htk_writer;
-
     if (utt2spk_rspecifier != "")
       KALDI_ASSERT(vtln_map_rspecifier != "" && "the utt2spk option is only "
                    "needed if the vtln-map option is used.");
     RandomAccessBaseFloatReaderMapped vtln_map_reader(vtln_map_rspecifier,
                                                       utt2spk_rspecifier);
-    
-    if (output_format == "kaldi") {
-      if (!kaldi_writer.Open(output_wspecifier))
-        KALDI_ERR << "Could not initialize output with wspecifier "
-                  << output_wspecifier;
-    } else if (output_format == "htk") {
-      if (!htk_writer.Open(output_wspecifier))
-        KALDI_ERR << "Could not initialize output with wspecifier "
-                  << output_wspecifier;
-    } else {
-      KALDI_ERR << "Invalid output_format string " << output_format;
-    }
+
+    // HTK kind MFCC, with energy or else c0; 10ms shift.
+    FeatureWriter writer(output_wspecifier, output_format,
+                         006 | (mfcc_opts.use_energy ? 0100 : 020000), 100000);
 
     int32 num_utts = 0, num_success = 0;
+    FeatureComputerPool<Mfcc> pool(mfcc_opts);
+    if (segments_rxfilename != "") {
+      ComputeFeaturesForSegments(
+          thread_config, &pool, segments_rxfilename, wav_rspecifier,
+          (vtln_map_rspecifier != "" ? &vtln_map_reader : NULL), vtln_warp,
+          channel, min_duration, max_overshoot, subtract_mean, &writer,
+          &num_utts, &num_success);
+      KALDI_LOG << " Done " << num_success << " out of " << num_utts
+                << " utterances.";
+      return (num_success != 0 ? 0 : 1);
+    }
+
+    SequentialTableReader<WaveHolder> reader(wav_rspecifier);
+    TaskSequencer<FeatureTask<Mfcc> > sequencer(thread_config);
     for (; !reader.Done(); reader.Next()) {
       num_utts++;
       std::string utt = reader.Key();
@@ -142,42 +162,13 @@ int main(int argc, char *argv[]) {
                   << "option).  Utterance is " << utt;
 
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        mfcc.Compute(waveform, vtln_warp_local, &features, NULL);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute features for utterance "
-                   << utt;
-        continue;
-      }
-      if (subtract_mean) {
-        Vector<BaseFloat> mean(features.NumCols());
-        mean.AddRowSumMat(1.0, features);
-        mean.Scale(1.0 / features.NumRows());
-        for (int32 i = 0; i < features.NumRows(); i++)
-          features.Row(i).AddVec(-1.0, mean);
-      }
-      if (output_format == "kaldi") {
-        kaldi_writer.Write(utt, features);
-      } else {
-        std::pair<Matrix<BaseFloat>, HtkHeader> p;
-        p.first.Resize(features.NumRows(), features.NumCols());
-        p.first.CopyFromMat(features);
-        HtkHeader header = {
-          features.NumRows(),
-          100000,  // 10ms shift
-          static_cast<int16>(sizeof(float)*(features.NumCols())),
-          static_cast<uint16>( 006 | // MFCC
-          (mfcc_opts.use_energy ? 0100 : 020000)) // energy; otherwise c0
-        };
-        p.second = header;
-        htk_writer.Write(utt, p);
-      }
+      sequencer.Run(new FeatureTask<Mfcc>(&pool, utt, waveform,
+                                          vtln_warp_local, subtract_mean,
+                                          &writer, &num_success));
       if (num_utts % 10 == 0)
         KALDI_LOG << "Processed " << num_utts << " utterances";
-      KALDI_VLOG(2) << "Processed features for key " << utt;
-      num_success++;
     }
+    sequencer.Wait();
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
@@ -0,0 +1,237 @@
+// featbin/compute-multi-feats.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "feat/feature-multi.h"
+#include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// The writers for each feature type; those that are not open are not computed.
+struct MultiFeatureWriters {
+  BaseFloatMatrixWriter mfcc, fbank, plp, spectrogram, pitch;
+};
+
+class MultiFeatureTask {
+ public:
+  MultiFeatureTask(const MultiFeatureOptions &opts,
+                   const std::string &utt,
+                   const VectorBase<BaseFloat> &wave,
+                   BaseFloat vtln_warp,
+                   MultiFeatureWriters *writers,
+                   int32 *num_success):
+      opts_(opts), utt_(utt), wave_(wave), vtln_warp_(vtln_warp),
+      writers_(writers), num_success_(num_success), ok_(false) { }
+
+  void operator () () {
+    MultiFeatureComputer computer(opts_);
+    try {
+      computer.Compute(wave_, vtln_warp_,
+                       (writers_->mfcc.IsOpen() ? &mfcc_ : NULL),
+                       (writers_->fbank.IsOpen() ? &fbank_ : NULL),
+                       (writers_->plp.IsOpen() ? &plp_ : NULL),
+                       (writers_->spectrogram.IsOpen() ? &spectrogram_ : NULL),
+                       (writers_->pitch.IsOpen() ? &pitch_ : NULL));
+      ok_ = true;
+    } catch (...) {
+      ok_ = false;
+    }
+  }
+
+  ~MultiFeatureTask() {  // Produces output.  Run sequentially.
+    if (!ok_) {
+      KALDI_WARN << "Failed to compute features for utterance " << utt_;
+      return;
+    }
+    if (writers_->mfcc.IsOpen()) writers_->mfcc.Write(utt_, mfcc_);
+    if (writers_->fbank.IsOpen()) writers_->fbank.Write(utt_, fbank_);
+    if (writers_->plp.IsOpen()) writers_->plp.Write(utt_, plp_);
+    if (writers_->spectrogram.IsOpen())
+      writers_->spectrogram.Write(utt_, spectrogram_);
+    if (writers_->pitch.IsOpen()) writers_->pitch.Write(utt_, pitch_);
+    KALDI_VLOG(2) << "Processed features for key " << utt_;
+    (*num_success_)++;
+  }
+
+ private:
+  const MultiFeatureOptions &opts_;
+  std::string utt_;
+  Vector<BaseFloat> wave_;
+  BaseFloat vtln_warp_;
+  MultiFeatureWriters *writers_;
+  int32 *num_success_;
+  bool ok_;
+  Matrix<BaseFloat> mfcc_, fbank_, plp_, spectrogram_, pitch_;
+};
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    const char *usage =
+        "Create several types of feature files (MFCC, filterbank, PLP,\n"
+        "spectrogram and pitch) in one pass over the waveforms.  The framing,\n"
+        "windowing and FFT are shared between the spectral features.  Options\n"
+        "for the frame extraction are shared; the others have prefixes, e.g.\n"
+        "--mfcc.num-ceps, --fbank.num-mel-bins, --pitch.min-f0.  Only the\n"
+        "features whose wspecifier is given are computed.\n"
+        "Usage:  compute-multi-feats [options...] <wav-rspecifier>\n"
+        "e.g.: compute-multi-feats --mfcc-wspecifier=ark:mfcc.ark \\\n"
+        "   --fbank-wspecifier=ark:fbank.ark --num-threads=4 scp:wav.scp\n";
+
+    // construct all the global objects
+    ParseOptions po(usage);
+    MultiFeatureOptions multi_opts;
+    TaskSequencerConfig thread_config;
+    BaseFloat vtln_warp = 1.0;
+    std::string vtln_map_rspecifier;
+    std::string utt2spk_rspecifier;
+    std::string mfcc_wspecifier, fbank_wspecifier, plp_wspecifier,
+        spectrogram_wspecifier, pitch_wspecifier;
+    int32 channel = -1;
+    BaseFloat min_duration = 0.0;
+
+    // Register the option structs
+    multi_opts.Register(&po);
+    thread_config.Register(&po);
+
+    // Register the options
+    po.Register("mfcc-wspecifier", &mfcc_wspecifier, "Wspecifier for MFCC "
+                "features");
+    po.Register("fbank-wspecifier", &fbank_wspecifier, "Wspecifier for "
+                "filterbank features");
+    po.Register("plp-wspecifier", &plp_wspecifier, "Wspecifier for PLP "
+                "features");
+    po.Register("spectrogram-wspecifier", &spectrogram_wspecifier,
+                "Wspecifier for spectrogram features");
+    po.Register("pitch-wspecifier", &pitch_wspecifier, "Wspecifier for pitch "
+                "features (NCCF, pitch in Hz)");
+    po.Register("vtln-warp", &vtln_warp, "Vtln warp factor (only applicable "
+                "if vtln-map not specified)");
+    po.Register("vtln-map", &vtln_map_rspecifier, "Map from utterance or "
+                "speaker-id to vtln warp factor (rspecifier)");
+    po.Register("utt2spk", &utt2spk_rspecifier, "Utterance to speaker-id map "
+                "rspecifier (if doing VTLN and you have warps per speaker)");
+    po.Register("channel", &channel, "Channel to extract (-1 -> expect mono, "
+                "0 -> left, 1 -> right)");
+    po.Register("min-duration", &min_duration, "Minimum duration of segments "
+                "to process (in seconds).");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 1) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string wav_rspecifier = po.GetArg(1);
+
+    MultiFeatureWriters writers;
+    const std::string *wspecifiers[] = { &mfcc_wspecifier, &fbank_wspecifier,
+                                         &plp_wspecifier,
+                                         &spectrogram_wspecifier,
+                                         &pitch_wspecifier };
+    BaseFloatMatrixWriter *writer_ptrs[] = { &writers.mfcc, &writers.fbank,
+                                             &writers.plp, &writers.spectrogram,
+                                             &writers.pitch };
+    int32 num_outputs = 0;
+    for (int32 i = 0; i < 5; i++) {
+      if (*(wspecifiers[i]) == "") continue;
+      if (!writer_ptrs[i]->Open(*(wspecifiers[i])))
+        KALDI_ERR << "Could not initialize output with wspecifier "
+                  << *(wspecifiers[i]);
+      num_outputs++;
+    }
+    if (num_outputs == 0)
+      KALDI_ERR << "No outputs specified: use at least one of --mfcc-wspecifier, "
+                << "--fbank-wspecifier, --plp-wspecifier, "
+                << "--spectrogram-wspecifier or --pitch-wspecifier";
+
+    SequentialTableReader<WaveHolder> reader(wav_rspecifier);
+
+    if (utt2spk_rspecifier != "")
+      KALDI_ASSERT(vtln_map_rspecifier != "" && "the utt2spk option is only "
+                   "needed if the vtln-map option is used.");
+    RandomAccessBaseFloatReaderMapped vtln_map_reader(vtln_map_rspecifier,
+                                                      utt2spk_rspecifier);
+
+    int32 num_utts = 0, num_success = 0;
+    {
+      TaskSequencer<MultiFeatureTask> sequencer(thread_config);
+      for (; !reader.Done(); reader.Next()) {
+        num_utts++;
+        std::string utt = reader.Key();
+        const WaveData &wave_data = reader.Value();
+        if (wave_data.Duration() < min_duration) {
+          KALDI_WARN << "File: " << utt << " is too short ("
+                     << wave_data.Duration() << " sec): producing no output.";
+          continue;
+        }
+        int32 num_chan = wave_data.Data().NumRows(), this_chan = channel;
+        {  // This block works out the channel (0=left, 1=right...)
+          KALDI_ASSERT(num_chan > 0);  // should have been caught in
+          // reading code if no channels.
+          if (channel == -1) {
+            this_chan = 0;
+            if (num_chan != 1)
+              KALDI_WARN << "Channel not specified but you have data with "
+                         << num_chan  << " channels; defaulting to zero";
+          } else {
+            if (this_chan >= num_chan) {
+              KALDI_WARN << "File with id " << utt << " has "
+                         << num_chan << " channels but you specified channel "
+                         << channel << ", producing no output.";
+              continue;
+            }
+          }
+        }
+        BaseFloat vtln_warp_local;  // Work out VTLN warp factor.
+        if (vtln_map_rspecifier != "") {
+          if (!vtln_map_reader.HasKey(utt)) {
+            KALDI_WARN << "No vtln-map entry for utterance-id (or speaker-id) "
+                       << utt;
+            continue;
+          }
+          vtln_warp_local = vtln_map_reader.Value(utt);
+        } else {
+          vtln_warp_local = vtln_warp;
+        }
+        if (multi_opts.frame_opts.samp_freq != wave_data.SampFreq())
+          KALDI_ERR << "Sample frequency mismatch: you specified "
+                    << multi_opts.frame_opts.samp_freq << " but data has "
+                    << wave_data.SampFreq() << " (use --sample-frequency "
+                    << "option).  Utterance is " << utt;
+
+        SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
+        sequencer.Run(new MultiFeatureTask(multi_opts, utt, waveform,
+                                           vtln_warp_local, &writers,
+                                           &num_success));
+        if (num_utts % 10 == 0)
+          KALDI_LOG << "Processed " << num_utts << " utterances";
+      }
+    }
+    KALDI_LOG << " Done " << num_success << " out of " << num_utts
+              << " utterances.";
+    return (num_success != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -21,19 +21,22 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "feat/feature-plp.h"
+#include "feat/feature-task.h"
 #include "feat/wave-reader.h"
-
+#include "thread/kaldi-task-sequence.h"
 
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
     const char *usage =
         "Create PLP feature files.\n"
-        "Usage:  compute-plp-feats [options...] <wav-rspecifier> <feats-wspecifier>\n";
+        "Usage:  compute-plp-feats [options...] <wav-rspecifier> <feats-wspecifier>\n"
+        "e.g.: compute-plp-feats --num-threads=8 scp:wav.scp ark:plp.ark\n";
 
     // construct all the global objects
     ParseOptions po(usage);
     PlpOptions plp_opts;
+    TaskSequencerConfig thread_config;
     bool subtract_mean = false;
     BaseFloat vtln_warp = 1.0;
     std::string vtln_map_rspecifier;
@@ -60,6 +63,7 @@ int main(int argc, char *argv[]) {
                 "to process (in seconds).");
 
     plp_opts.Register(&po);
+    thread_config.Register(&po);
 
     po.Read(argc, argv);
     
@@ -72,31 +76,22 @@ int main(int argc, char *argv[]) {
 
     std::string output_wspecifier = po.GetArg(2);
 
-    Plp plp(plp_opts);
-
     SequentialTableReader<WaveHolder> reader(wav_rspecifier);
-    BaseFloatMatrixWriter kaldi_writer;  // typedef to TableWriter<something>.
-    TableWriter<HtkMatrixHolder> htk_writer;
 
     if (utt2spk_rspecifier != "")
       KALDI_ASSERT(vtln_map_rspecifier != "" && "the utt2spk option is only "
                    "needed if the vtln-map option is used.");
     RandomAccessBaseFloatReaderMapped vtln_map_reader(vtln_map_rspecifier,
                                                       utt2spk_rspecifier);
-    
-    if (output_format == "kaldi") {
-      if (!kaldi_writer.Open(output_wspecifier))
-        KALDI_ERR << "Could not initialize output with wspecifier "
-                  << output_wspecifier;
-    } else if (output_format == "htk") {
-      if (!htk_writer.Open(output_wspecifier))
-        KALDI_ERR << "Could not initialize output with wspecifier "
-                  << output_wspecifier;
-    } else {
-      KALDI_ERR << "Invalid output_format string " << output_format;
-    }
+
+    // HTK kind PLP with c0 (there is no option to use energy in PLP); 10ms
+    // shift.
+    FeatureWriter writer(output_wspecifier, output_format, 013 | 020000,
+                         100000);
 
     int32 num_utts = 0, num_success = 0;
+    FeatureComputerPool<Plp> pool(plp_opts);
+    TaskSequencer<FeatureTask<Plp> > sequencer(thread_config);
     for (; !reader.Done(); reader.Next()) {
       num_utts++;
       std::string utt = reader.Key();
@@ -142,42 +137,13 @@ int main(int argc, char *argv[]) {
                   << "option).  Utterance is " << utt;
 
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        plp.Compute(waveform, vtln_warp_local, &features, NULL);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute features for utterance "
-                   << utt;
-        continue;
-      }
-      if (subtract_mean) {
-        Vector<BaseFloat> mean(features.NumCols());
-        mean.AddRowSumMat(1.0, features);
-        mean.Scale(1.0 / features.NumRows());
-        for (size_t i = 0; i < features.NumRows(); i++)
-          features.Row(i).AddVec(-1.0, mean);
-      }
-      if (output_format == "kaldi") {
-        kaldi_writer.Write(utt, features);
-      } else {
-        std::pair<Matrix<BaseFloat>, HtkHeader> p;
-        p.first.Resize(features.NumRows(), features.NumCols());
-        p.first.CopyFromMat(features);
-        HtkHeader header = {
-          features.NumRows(),
-          100000,  // 10ms shift
-          static_cast<int16>(sizeof(float)*features.NumCols()),
-          013 | // PLP
-          020000 // C0 [no option currently to use energy in PLP.
-        };
-        p.second = header;
-        htk_writer.Write(utt, p);
-      }
+      sequencer.Run(new FeatureTask<Plp>(&pool, utt, waveform,
+                                         vtln_warp_local, subtract_mean,
+                                         &writer, &num_success));
       if (num_utts % 10 == 0)
         KALDI_LOG << "Processed " << num_utts << " utterances";
-      KALDI_VLOG(2) << "Processed features for key " << utt;
-      num_success++;
     }
+    sequencer.Wait();
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
@@ -20,19 +20,22 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "feat/feature-spectrogram.h"
+#include "feat/feature-task.h"
 #include "feat/wave-reader.h"
-
+#include "thread/kaldi-task-sequence.h"
 
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
     const char *usage =
         "Create spectrogram feature files.\n"
-        "Usage:  compute-spectrogram-feats [options...] <wav-rspecifier> <feats-wspecifier>\n";
+        "Usage:  compute-spectrogram-feats [options...] <wav-rspecifier> <feats-wspecifier>\n"
+        "e.g.: compute-spectrogram-feats --num-threads=8 scp:wav.scp ark:spec.ark\n";
 
     // construct all the global objects
     ParseOptions po(usage);
     SpectrogramOptions spec_opts;
+    TaskSequencerConfig thread_config;
     bool subtract_mean = false;
     int32 channel = -1;
     BaseFloat min_duration = 0.0;
@@ -41,6 +44,7 @@ int main(int argc, char *argv[]) {
 
     // Register the option struct
     spec_opts.Register(&po);
+    thread_config.Register(&po);
     // Register the options
     po.Register("output-format", &output_format, "Format of the output files [kaldi, htk]");
     po.Register("subtract-mean", &subtract_mean, "Subtract mean of each feature file [CMS]; not recommended to do it this way. ");
@@ -62,25 +66,15 @@ int main(int argc, char *argv[]) {
 
     std::string output_wspecifier = po.GetArg(2);
 
-    Spectrogram spec(spec_opts);
-
     SequentialTableReader<WaveHolder> reader(wav_rspecifier);
-    BaseFloatMatrixWriter kaldi_writer;  // typedef to TableWriter<something>.
-    TableWriter<HtkMatrixHolder> htk_writer;
-
-    if (output_format == "kaldi") {
-      if (!kaldi_writer.Open(output_wspecifier))
-        KALDI_ERR << "Could not initialize output with wspecifier "
-                  << output_wspecifier;
-    } else if (output_format == "htk") {
-      if (!htk_writer.Open(output_wspecifier))
-        KALDI_ERR << "Could not initialize output with wspecifier "
-                  << output_wspecifier;
-    } else {
-      KALDI_ERR << "Invalid output_format string " << output_format;
-    }
+    // HTK kind FBANK with c0, and the frame shift in units of 100ns.
+    FeatureWriter writer(
+        output_wspecifier, output_format, 007 | 020000,
+        static_cast<int32>(spec_opts.frame_opts.frame_shift_ms * 10000));
 
     int32 num_utts = 0, num_success = 0;
+    FeatureComputerPool<Spectrogram> pool(spec_opts);
+    TaskSequencer<FeatureTask<Spectrogram> > sequencer(thread_config);
     for (; !reader.Done(); reader.Next()) {
       num_utts++;
       std::string utt = reader.Key();
@@ -116,42 +110,13 @@ int main(int argc, char *argv[]) {
                   << "option).  Utterance is " << utt;
 
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        spec.Compute(waveform, &features, NULL);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute features for utterance "
-                   << utt;
-        continue;
-      }
-      if (subtract_mean) {
-        Vector<BaseFloat> mean(features.NumCols());
-        mean.AddRowSumMat(1.0, features);
-        mean.Scale(1.0 / features.NumRows());
-        for (int32 i = 0; i < features.NumRows(); i++)
-          features.Row(i).AddVec(-1.0, mean);
-      }
-      if (output_format == "kaldi") {
-        kaldi_writer.Write(utt, features);
-      } else {
-        std::pair<Matrix<BaseFloat>, HtkHeader> p;
-        p.first.Resize(features.NumRows(), features.NumCols());
-        p.first.CopyFromMat(features);
-        int32 frame_shift = spec_opts.frame_opts.frame_shift_ms * 10000;
-        HtkHeader header = {
-          features.NumRows(),
-          frame_shift,
-          static_cast<int16>(sizeof(float)*features.NumCols()),
-          007 | 020000
-        };
-        p.second = header;
-        htk_writer.Write(utt, p);
-      }
-      if(num_utts % 10 == 0)
+      sequencer.Run(new FeatureTask<Spectrogram>(&pool, utt, waveform, 1.0,
+                                                 subtract_mean, &writer,
+                                                 &num_success));
+      if (num_utts % 10 == 0)
         KALDI_LOG << "Processed " << num_utts << " utterances";
-      KALDI_VLOG(2) << "Processed features for key " << utt;
-      num_success++;
     }
+    sequencer.Wait();
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
@@ -40,6 +40,7 @@ int main(int argc, char *argv[]) {
     bool htk_in = false;
     bool sphinx_in = false;
     bool compress = false;
+    int32 compression_method_in = 1;
     po.Register("htk-in", &htk_in, "Read input as HTK features");
     po.Register("sphinx-in", &sphinx_in, "Read input as Sphinx features");
     po.Register("binary", &binary, "Binary-mode output (not relevant if writing "
@@ -47,6 +48,12 @@ int main(int argc, char *argv[]) {
     po.Register("compress", &compress, "If true, write output in compressed form"
                 "(only currently supported for wxfilename, i.e. archive/script,"
                 "output)");
+    po.Register("compression-method", &compression_method_in,
+                "Only relevant if --compress=true; the method (1, 2 or 3) "
+                "used to compress the features: 1 = per-column percentiles, "
+                "2 = per-row linear (good for short matrices), 3 = like 1 but "
+                "entropy coded (smaller, for long feature streams).  See "
+                "CompressionMethod in matrix/compressed-matrix.h");
     
     po.Read(argc, argv);
 
@@ -55,6 +62,12 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    if (compression_method_in < kSpeechFeature ||
+        compression_method_in > kEntropyCodedFeature)
+      KALDI_ERR << "Invalid --compression-method=" << compression_method_in;
+    CompressionMethod compression_method =
+        static_cast<CompressionMethod>(compression_method_in);
+
     int32 num_done = 0;
     
     if (ClassifyRspecifier(po.GetArg(1), NULL, NULL) != kNoRspecifier) {
@@ -63,7 +76,9 @@ int main(int argc, char *argv[]) {
       std::string wspecifier = po.GetArg(2);
 
       if (!compress) {
-        BaseFloatMatrixWriter kaldi_writer(wspecifier);
+        // The view reader/writer avoid copying the features when the input is
+        // a binary archive or script that can be memory-mapped.
+        BaseFloatMatrixViewWriter kaldi_writer(wspecifier);
         if (htk_in) {
           SequentialTableReader<HtkMatrixHolder> htk_reader(rspecifier);
           for (; !htk_reader.Done(); htk_reader.Next(), num_done++)
@@ -73,7 +88,7 @@ int main(int argc, char *argv[]) {
           for (; !sphinx_reader.Done(); sphinx_reader.Next(), num_done++)
             kaldi_writer.Write(sphinx_reader.Key(), sphinx_reader.Value());
         } else {
-          SequentialBaseFloatMatrixReader kaldi_reader(rspecifier);
+          SequentialBaseFloatMatrixViewReader kaldi_reader(rspecifier);
           for (; !kaldi_reader.Done(); kaldi_reader.Next(), num_done++)
             kaldi_writer.Write(kaldi_reader.Key(), kaldi_reader.Value());
         }
@@ -83,17 +98,20 @@ int main(int argc, char *argv[]) {
           SequentialTableReader<HtkMatrixHolder> htk_reader(rspecifier);
           for (; !htk_reader.Done(); htk_reader.Next(), num_done++)
             kaldi_writer.Write(htk_reader.Key(),
-                               CompressedMatrix(htk_reader.Value().first));
+                               CompressedMatrix(htk_reader.Value().first,
+                                                compression_method));
         } else if (sphinx_in) {
           SequentialTableReader<SphinxMatrixHolder<> > sphinx_reader(rspecifier);
           for (; !sphinx_reader.Done(); sphinx_reader.Next(), num_done++)
             kaldi_writer.Write(sphinx_reader.Key(),
-                               CompressedMatrix(sphinx_reader.Value()));
+                               CompressedMatrix(sphinx_reader.Value(),
+                                                compression_method));
         } else {
-          SequentialBaseFloatMatrixReader kaldi_reader(rspecifier);
+          SequentialBaseFloatMatrixViewReader kaldi_reader(rspecifier);
           for (; !kaldi_reader.Done(); kaldi_reader.Next(), num_done++)
             kaldi_writer.Write(kaldi_reader.Key(),
-                               CompressedMatrix(kaldi_reader.Value()));
+                               CompressedMatrix(kaldi_reader.Value(),
+                                                compression_method));
         }
       }
       KALDI_LOG << "Copied " << num_done << " feature matrices.";
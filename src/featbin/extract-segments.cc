@@ -21,6 +21,7 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "feat/feature-mfcc.h"
+#include "feat/feature-segments.h"
 #include "feat/wave-reader.h"
 
 /*! @brief This is the main program for extracting segments from a wav file
@@ -44,6 +45,9 @@ int main(int argc, char *argv[]) {
         " e.g.: spkabc_seg1 spkabc_recording1 1.10 2.36 1\n"
         " If channel is not provided as last element, expects mono.\n"
         " end_time of -1 means the segment runs till the end of the WAV file.\n"
+        " If <wav-rspecifier> is an scp file, only the segments are read from\n"
+        " the recordings (where they are files or offsets into archives), so\n"
+        " the memory used does not depend on the length of the recordings.\n"
         "See also: extract-rows, which does the same thing but to feature files,\n"
         " wav-copy, wav-to-duration\n";
 
@@ -68,7 +72,27 @@ int main(int argc, char *argv[]) {
     std::string segments_rxfilename = po.GetArg(2);
     std::string wav_wspecifier = po.GetArg(3);
 
-    RandomAccessTableReader<WaveHolder> reader(wav_rspecifier);
+    // If the recordings are listed in an scp file, we read just the segments
+    // with WaveReader, rather than reading in whole recordings.
+    std::string script_rxfilename;
+    RspecifierOptions rspecifier_opts;
+    bool use_wave_reader = (ClassifyRspecifier(wav_rspecifier,
+                                               &script_rxfilename,
+                                               &rspecifier_opts) ==
+                            kScriptRspecifier);
+    std::map<std::string, std::string> recording_to_rxfilename;
+    RandomAccessTableReader<WaveHolder> reader;
+    if (use_wave_reader) {
+      std::vector<std::pair<std::string, std::string> > script;
+      if (!ReadScriptFile(script_rxfilename, true, &script))
+        KALDI_ERR << "Error reading script file "
+                  << PrintableRxfilename(script_rxfilename);
+      recording_to_rxfilename.insert(script.begin(), script.end());
+    } else if (!reader.Open(wav_rspecifier)) {
+      KALDI_ERR << "Error opening wave files " << wav_rspecifier;
+    }
+    WaveReader wave_reader;
+    std::string open_recording;  // The recording wave_reader has open.
     TableWriter<WaveHolder> writer(wav_wspecifier);
     Input ki(segments_rxfilename);  // no binary argment: never binary.
 
@@ -121,44 +145,52 @@ int main(int argc, char *argv[]) {
       /* check whether a segment start time and end time exists in recording 
        * if fails , skips the segment.
        */ 
-      if (!reader.HasKey(recording)) {
-        KALDI_WARN << "Could not find recording " << recording
-                   << ", skipping segment " << segment;
-        continue;
-      }
-      
-      const WaveData &wave = reader.Value(recording);
-      const Matrix<BaseFloat> &wave_data = wave.Data();
-      BaseFloat samp_freq = wave.SampFreq();  // read sampling fequency
-      int32 num_samp = wave_data.NumCols(),  // number of samples in recording
-        num_chan = wave_data.NumRows();  // number of channels in recording
-
-      // Convert starting time of the segment to corresponding sample number.
-      // If end time is -1 then use the whole file starting from start time.
-      int32 start_samp = start * samp_freq,
-          end_samp = (end != -1)? (end * samp_freq) : num_samp;
-      KALDI_ASSERT(start_samp >= 0 && end_samp > 0 && "Invalid start or end.");
-
-      // start sample must be less than total number of samples,
-      // otherwise skip the segment
-      if (start_samp < 0 || start_samp >= num_samp) {
-        KALDI_WARN << "Start sample out of range " << start_samp << " [length:] "
-                   << num_samp << ", skipping segment " << segment;
-        continue;
-      }
-      /* end sample must be less than total number samples 
-       * otherwise skip the segment
-       */
-      if (end_samp > num_samp) {
-        if ((end_samp >=
-             num_samp + static_cast<int32>(max_overshoot * samp_freq))) {
-          KALDI_WARN << "End sample too far out of range " << end_samp
-                     << " [length:] " << num_samp << ", skipping segment "
-                     << segment;
+      const WaveData *wave = NULL;
+      if (use_wave_reader) {
+        std::map<std::string, std::string>::const_iterator iter =
+            recording_to_rxfilename.find(recording);
+        if (iter == recording_to_rxfilename.end()) {
+          KALDI_WARN << "Could not find recording " << recording
+                     << ", skipping segment " << segment;
           continue;
         }
-        end_samp = num_samp;  // for small differences, just truncate.
+        if (recording != open_recording) {
+          open_recording = "";
+          try {
+            wave_reader.Open(iter->second);
+          } catch (...) {
+            KALDI_WARN << "Could not read recording " << recording
+                       << ", skipping segment " << segment;
+            continue;
+          }
+          open_recording = recording;
+        }
+      } else {
+        if (!reader.HasKey(recording)) {
+          KALDI_WARN << "Could not find recording " << recording
+                     << ", skipping segment " << segment;
+          continue;
+        }
+        wave = &(reader.Value(recording));
       }
+      // read sampling fequency
+      BaseFloat samp_freq = (wave ? wave->SampFreq() : wave_reader.SampFreq());
+      // number of samples and channels in recording
+      int32 num_samp = (wave ? wave->NumSamples() : wave_reader.NumSamples()),
+          num_chan = (wave ? wave->NumChannels() : wave_reader.NumChannels());
+
+      // Work out the samples of the segment; if the end time is -1, it runs to
+      // the end of the recording.  Skip the segment if it doesn't fit.
+      Segment seg;
+      seg.id = segment;
+      seg.recording = recording;
+      seg.start_time = start;
+      seg.end_time = end;
+      seg.channel = channel;
+      int32 start_samp, end_samp;
+      if (!seg.GetSamples(samp_freq, num_samp, max_overshoot,
+                          &start_samp, &end_samp))
+        continue;
       // Skip if segment size is less than minimum segment length (default 0.1s)
       if (end_samp <=
           start_samp + static_cast<int32>(min_segment_length * samp_freq)) {
@@ -185,8 +217,16 @@ int main(int argc, char *argv[]) {
       /*
        * This function  return a portion of a wav data from the orignial wav data matrix 
        */
-      SubMatrix<BaseFloat> segment_matrix(wave_data, channel, 1, start_samp, end_samp-start_samp);
-      WaveData segment_wave(samp_freq, segment_matrix);
+      Matrix<BaseFloat> segment_data;
+      if (wave != NULL) {
+        segment_data = wave->Data().Range(channel, 1, start_samp,
+                                          end_samp - start_samp);
+      } else {
+        Matrix<BaseFloat> all_channels;
+        wave_reader.Read(start_samp, end_samp - start_samp, &all_channels);
+        segment_data = all_channels.RowRange(channel, 1);
+      }
+      WaveData segment_wave(samp_freq, segment_data);
       writer.Write(segment, segment_wave); // write segment in wave format.
       num_success++;
     }
@@ -53,7 +53,7 @@ int main(int argc, char *argv[]) {
     string wspecifier = po.GetArg(3);
     
     // set up input (we'll need that to validate the selected indices)
-    SequentialBaseFloatMatrixReader kaldi_reader(rspecifier);
+    SequentialBaseFloatMatrixViewReader kaldi_reader(rspecifier);
     
     if (kaldi_reader.Done()) {
       KALDI_WARN << "Empty archive provided.";
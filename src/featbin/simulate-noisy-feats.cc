@@ -0,0 +1,250 @@
+// featbin/simulate-noisy-feats.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "feat/feature-fbank.h"
+#include "feat/feature-task.h"
+#include "feat/mask-targets.h"
+#include "feat/noise-mixer.h"
+#include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Adds noise to one utterance and computes the features of the noisy speech
+// and the targets.
+class SimulateNoisyTask {
+ public:
+  SimulateNoisyTask(const NoiseMixer &mixer,
+                    FeatureComputerPool<Fbank> *feats_pool,
+                    FeatureComputerPool<Fbank> *targets_pool,
+                    const MaskTargetComputer *computer,
+                    bool from_noisy,
+                    MaskTargetType target_type,
+                    const std::string &utt,
+                    const VectorBase<BaseFloat> &clean,
+                    BaseFloatMatrixWriter *feats_writer,
+                    BaseFloatMatrixWriter *targets_writer,
+                    int32 *num_success):
+      mixer_(mixer), feats_pool_(feats_pool), targets_pool_(targets_pool),
+      computer_(computer), from_noisy_(from_noisy), target_type_(target_type),
+      utt_(utt), clean_(clean), feats_writer_(feats_writer),
+      targets_writer_(targets_writer), num_success_(num_success),
+      ok_(false) { }
+
+  void operator () () {
+    Fbank *feats_fbank = (feats_writer_->IsOpen() ? feats_pool_->Acquire() :
+                          NULL),
+        *targets_fbank = (targets_writer_->IsOpen() ?
+                          targets_pool_->Acquire() : NULL);
+    try {
+      mixer_.Choose(utt_, clean_.Dim(), &segment_);
+      Vector<BaseFloat> noise;
+      mixer_.GetNoise(segment_, clean_, &noise);
+      Vector<BaseFloat> noisy(clean_);
+      noisy.AddVec(1.0, noise);
+      if (feats_fbank != NULL)
+        feats_fbank->Compute(noisy, 1.0, &feats_, NULL);
+      if (targets_fbank != NULL) {
+        // The targets are computed without dithering, which would add
+        // different noise to the clean speech and the noise or noisy speech.
+        Matrix<BaseFloat> clean_fbank, other_fbank;
+        targets_fbank->Compute(clean_, 1.0, &clean_fbank, NULL);
+        if (!from_noisy_)
+          targets_fbank->Compute(noise, 1.0, &other_fbank, NULL);
+        else if (feats_fbank != NULL &&
+                 feats_pool_->GetOptions().frame_opts.dither == 0.0)
+          other_fbank = feats_;
+        else
+          targets_fbank->Compute(noisy, 1.0, &other_fbank, NULL);
+        Matrix<BaseFloat> *outputs[kNumMaskTargetTypes] = { NULL };
+        outputs[target_type_] = &targets_;
+        computer_->Compute(clean_fbank, other_fbank, outputs);
+      }
+      ok_ = true;
+    } catch (...) {
+      ok_ = false;
+    }
+    if (feats_fbank != NULL)
+      feats_pool_->Release(feats_fbank);
+    if (targets_fbank != NULL)
+      targets_pool_->Release(targets_fbank);
+  }
+
+  ~SimulateNoisyTask() {  // Produces output.  Run sequentially.
+    if (!ok_) {
+      KALDI_WARN << "Failed to simulate noisy data for utterance " << utt_;
+      return;
+    }
+    if (feats_writer_->IsOpen())
+      feats_writer_->Write(utt_, feats_);
+    if (targets_writer_->IsOpen())
+      targets_writer_->Write(utt_, targets_);
+    KALDI_VLOG(2) << "Added noise " << segment_.noise_index << " from sample "
+                  << segment_.offset << " at SNR " << segment_.snr
+                  << " dB to utterance " << utt_;
+    (*num_success_)++;
+  }
+
+ private:
+  const NoiseMixer &mixer_;
+  FeatureComputerPool<Fbank> *feats_pool_;
+  FeatureComputerPool<Fbank> *targets_pool_;
+  const MaskTargetComputer *computer_;
+  bool from_noisy_;
+  MaskTargetType target_type_;
+  std::string utt_;
+  Vector<BaseFloat> clean_;
+  BaseFloatMatrixWriter *feats_writer_;
+  BaseFloatMatrixWriter *targets_writer_;
+  int32 *num_success_;
+  bool ok_;
+  NoiseSegment segment_;
+  Matrix<BaseFloat> feats_;
+  Matrix<BaseFloat> targets_;
+};
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    const char *usage =
+        "Simulate noisy speech for training time-frequency masking networks,\n"
+        "without storing it: add a randomly chosen piece of one of the noise\n"
+        "recordings to each clean utterance, at an SNR chosen uniformly\n"
+        "between --min-snr and --max-snr, and compute the filterbank features\n"
+        "of the noisy speech and the mask targets (see --target-type and\n"
+        "MaskTargetOptions in feat/mask-targets.h).  The noise for each\n"
+        "utterance depends only on --srand and the utterance-id; change\n"
+        "--srand to get new noisy data, e.g. each epoch.\n"
+        "To stream both outputs of one run into nnet-train-frmshuff\n"
+        "--dense-targets=true, write the features to its feature pipe and the\n"
+        "targets to a named pipe through \"| cat\", so that neither program\n"
+        "waits to open its second input or output, with the \"f\" option so\n"
+        "each utterance is flushed (see the example).\n"
+        "<noise-wav-scp> lists the noise recordings, as a wav.scp does.\n"
+        "Usage: simulate-noisy-feats [options] <clean-wav-rspecifier> "
+        "<noise-wav-scp>\n"
+        "e.g.: simulate-noisy-feats --srand=3 --feats-wspecifier=ark:feats.ark \\\n"
+        "   --targets-wspecifier=ark:targets.ark scp:clean_wav.scp noise_wav.scp\n"
+        "e.g.: mkfifo targets.fifo; nnet-train-frmshuff --dense-targets=true \\\n"
+        "   --objective-function=mse \"ark:simulate-noisy-feats --srand=3 \\\n"
+        "   --feats-wspecifier=ark,f:- \\\n"
+        "   --targets-wspecifier='ark,f:| cat > targets.fifo' \\\n"
+        "   scp:clean_wav.scp noise_wav.scp |\" ark,s,cs:targets.fifo \\\n"
+        "   nnet.init nnet.iter1\n"
+        "See also: wav-add-noise, compute-mask-targets, nnet-train-frmshuff\n";
+
+    ParseOptions po(usage);
+    NoiseMixerOptions mixer_opts;
+    FbankOptions fbank_opts;
+    MaskTargetOptions mask_opts;
+    TaskSequencerConfig thread_config;
+    std::string feats_wspecifier, targets_wspecifier,
+        target_type_str = "irm-targets";
+
+    mixer_opts.Register(&po);
+    fbank_opts.Register(&po);
+    mask_opts.Register(&po);
+    thread_config.Register(&po);
+
+    po.Register("feats-wspecifier", &feats_wspecifier, "Wspecifier for the "
+                "filterbank features of the noisy speech");
+    po.Register("targets-wspecifier", &targets_wspecifier, "Wspecifier for "
+                "the targets");
+    po.Register("target-type", &target_type_str, "Targets to write: "
+                "irm-targets|irm|snr|arm-targets|arm");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string clean_rspecifier = po.GetArg(1),
+        noise_scp_rxfilename = po.GetArg(2);
+
+    MaskTargetType target_type;
+    if (!GetMaskTargetType(target_type_str, &target_type))
+      KALDI_ERR << "Invalid --target-type=" << target_type_str;
+    if (!fbank_opts.use_log_fbank)
+      KALDI_ERR << "--use-log-fbank must be true.";
+    if (feats_wspecifier == "" && targets_wspecifier == "")
+      KALDI_ERR << "No outputs specified: use --feats-wspecifier or "
+                << "--targets-wspecifier";
+
+    std::vector<std::pair<std::string, std::string> > noise_scp;
+    if (!ReadScriptFile(noise_scp_rxfilename, true, &noise_scp))
+      KALDI_ERR << "Could not read noise list from "
+                << PrintableRxfilename(noise_scp_rxfilename);
+    std::vector<std::string> noise_rxfilenames;
+    for (size_t i = 0; i < noise_scp.size(); i++)
+      noise_rxfilenames.push_back(noise_scp[i].second);
+    NoiseMixer mixer(mixer_opts, noise_rxfilenames);
+    if (mixer.SampFreq() != fbank_opts.frame_opts.samp_freq)
+      KALDI_ERR << "Sample frequency mismatch: you specified "
+                << fbank_opts.frame_opts.samp_freq << " but the noise has "
+                << mixer.SampFreq() << " (use --sample-frequency option).";
+
+    FbankOptions targets_opts(fbank_opts);
+    targets_opts.frame_opts.dither = 0.0;
+    FeatureComputerPool<Fbank> feats_pool(fbank_opts),
+        targets_pool(targets_opts);
+    MaskTargetComputer computer(mask_opts);
+
+    BaseFloatMatrixWriter feats_writer, targets_writer;
+    if (feats_wspecifier != "" && !feats_writer.Open(feats_wspecifier))
+      KALDI_ERR << "Could not initialize output with wspecifier "
+                << feats_wspecifier;
+    if (targets_wspecifier != "" && !targets_writer.Open(targets_wspecifier))
+      KALDI_ERR << "Could not initialize output with wspecifier "
+                << targets_wspecifier;
+
+    int32 num_utts = 0, num_success = 0;
+    SequentialTableReader<WaveHolder> clean_reader(clean_rspecifier);
+    TaskSequencer<SimulateNoisyTask> sequencer(thread_config);
+    for (; !clean_reader.Done(); clean_reader.Next()) {
+      num_utts++;
+      std::string utt = clean_reader.Key();
+      const WaveData &clean_wave = clean_reader.Value();
+      if (clean_wave.SampFreq() != mixer.SampFreq())
+        KALDI_ERR << "Sample frequency mismatch: the noise has "
+                  << mixer.SampFreq() << " but data has "
+                  << clean_wave.SampFreq() << ".  Utterance is " << utt;
+      if (clean_wave.NumChannels() != 1)
+        KALDI_WARN << "Utterance " << utt << " has "
+                   << clean_wave.NumChannels() << " channels; using the "
+                   << "first.";
+      sequencer.Run(new SimulateNoisyTask(mixer, &feats_pool, &targets_pool,
+                                          &computer, mask_opts.from_noisy,
+                                          target_type, utt,
+                                          clean_wave.Data().Row(0),
+                                          &feats_writer, &targets_writer,
+                                          &num_success));
+    }
+    sequencer.Wait();
+    KALDI_LOG << "Simulated noisy data for " << num_success << " out of "
+              << num_utts << " utterances.";
+    return (num_success != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -19,6 +19,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
 #include <vector>
 #include "hmm/posterior.h"
 #include "util/kaldi-table.h"
@@ -102,27 +103,31 @@ bool PosteriorHolder::Read(std::istream &is) {
         KALDI_WARN << "holder of Posterior: error reading line " << (is.eof() ? "[eof]" : "");
         return false;  // probably eof.  fail in any case.
       }
-      std::istringstream line_is(line);
+      // Parse the line directly; this is much faster than using an
+      // istringstream.
+      const char *p = line.c_str();
       while (1) {
-        std::string str;
-        line_is >> std::ws;  // eat up whitespace.
-        if (line_is.eof()) break;
-        line_is >> str;
-        if (str != "[") KALDI_ERR << "Reading Posterior object: expecting [, got "
-                                  << str << " (if this is an integer, possibly "
+        while (::isspace(static_cast<unsigned char>(*p))) p++;
+        if (*p == '\0') break;
+        if (*p != '[' || !(p[1] == '\0' || ::isspace(static_cast<unsigned char>(p[1]))))
+          KALDI_ERR << "Reading Posterior object: expecting [, got "
+                    << std::string(p, std::strcspn(p, " \t"))
+                    << " (if this is an integer, possibly "
                             "you gave alignments in place of posteriors?)";
+        p++;
         std::vector<std::pair<int32, BaseFloat> > this_vec;
         while (1) {
-          line_is >> std::ws;
-          if (line_is.peek() == ']') {
-            line_is.get();
+          while (::isspace(static_cast<unsigned char>(*p))) p++;
+          if (*p == ']') {
+            p++;
             break;
           }
-          int32 i; BaseFloat p;
-          line_is >> i >> p;
-          if (line_is.fail())
+          int32 i; BaseFloat prob;
+          if (!ParseBasicType(&p, &i) ||
+              !::isspace(static_cast<unsigned char>(*p)) ||
+              !ParseBasicType(&p, &prob))
             KALDI_ERR << "Error reading Posterior object (could not get data after \"[\");";
-          this_vec.push_back(std::make_pair(i, p));
+          this_vec.push_back(std::make_pair(i, prob));
         }
         t_.push_back(this_vec);
       }
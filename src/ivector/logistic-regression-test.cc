@@ -81,6 +81,7 @@ void UnitTestTrain() {
   LogisticRegressionConfig conf;
   conf.max_steps = 20;
   conf.normalizer = normalizer;
+  conf.num_threads = 1 + rand() % 3;
   // Train the classifier
   LogisticRegression classifier = LogisticRegression();
   classifier.Train(xs, ys, conf);
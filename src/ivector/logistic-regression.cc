@@ -20,6 +20,7 @@
 
 #include "ivector/logistic-regression.h"
 #include "gmm/model-common.h" // For GetSplitTargets()
+#include "thread/kaldi-parallel-lbfgs.h"
 #include <numeric> // For std::accumulate
 
 namespace kaldi {
@@ -117,6 +118,56 @@ void LogisticRegression::MixUp(const std::vector<int32> &ys,
   }
 }
 
+/// This class computes the objective function of LogisticRegression on
+/// blocks of the training data, for ParallelLbfgsEvaluator.
+class LogisticRegressionObjective: public LbfgsShardedObjective<BaseFloat> {
+ public:
+  LogisticRegressionObjective(const LogisticRegression &lr,
+                              const Matrix<BaseFloat> &xs,
+                              const std::vector<int32> &ys,
+                              BaseFloat normalizer,
+                              int32 num_shards):
+      lr_(lr), xs_(xs), ys_(ys), normalizer_(normalizer),
+      num_shards_(std::min<int32>(num_shards, ys.size())) {
+    KALDI_ASSERT(num_shards_ > 0);
+  }
+
+  virtual int32 NumShards() const { return num_shards_; }
+
+  virtual BaseFloat ComputeShard(int32 shard, const VectorBase<BaseFloat> &x,
+                                 VectorBase<BaseFloat> *gradient) const {
+    int32 num_examples = ys_.size(),
+        begin = (shard * num_examples) / num_shards_,
+        end = ((shard + 1) * num_examples) / num_shards_;
+    Matrix<BaseFloat> weights(lr_.weights_.NumRows(), lr_.weights_.NumCols(),
+                              kUndefined);
+    weights.CopyRowsFromVec(x);
+    SubMatrix<BaseFloat> xs(xs_, begin, end - begin, 0, xs_.NumCols());
+    Matrix<BaseFloat> xw(end - begin, weights.NumRows());
+    xw.AddMatMat(1.0, xs, kNoTrans, weights, kTrans, 0.0);
+    Matrix<BaseFloat> grad(weights.NumRows(), weights.NumCols());
+    BaseFloat objf = lr_.GetLogLikeAndGrad(xs_, ys_, begin, end, xw, &grad);
+    // Scale, and add the regularization term to the first shard.
+    grad.Scale(1.0 / num_examples);
+    objf /= num_examples;
+    if (shard == 0) {
+      grad.AddMat(-1.0 * normalizer_, weights);
+      objf -= 0.5 * normalizer_ * TraceMatMat(weights, weights, kTrans);
+    }
+    Vector<BaseFloat> grad_vec(gradient->Dim(), kUndefined);
+    grad_vec.CopyRowsFromMat(grad);
+    gradient->AddVec(1.0, grad_vec);
+    return objf;
+  }
+
+ private:
+  const LogisticRegression &lr_;
+  const Matrix<BaseFloat> &xs_;
+  const std::vector<int32> &ys_;
+  BaseFloat normalizer_;
+  int32 num_shards_;
+};
+
 void LogisticRegression::TrainParameters(const Matrix<BaseFloat> &xs,
     const std::vector<int32> &ys, const LogisticRegressionConfig &conf,
     Matrix<BaseFloat> *xw) {
@@ -129,8 +180,22 @@ void LogisticRegression::TrainParameters(const Matrix<BaseFloat> &xs,
   init_w.CopyRowsFromMat(weights_);
   OptimizeLbfgs<BaseFloat> lbfgs(init_w, lbfgs_opts);
 
-  for (int32 step = 0; step < max_steps; step++) {
-    DoStep(xs, xw, ys, &lbfgs, normalizer);
+  if (conf.num_threads > 1) {
+    // Compute the objective function on blocks of the training data in
+    // parallel.
+    LogisticRegressionObjective objective(*this, xs, ys, normalizer,
+                                          conf.num_threads);
+    ParallelLbfgsConfig parallel_config;
+    parallel_config.num_threads = conf.num_threads;
+    ParallelLbfgsEvaluator<BaseFloat> evaluator(parallel_config, objective);
+    for (int32 step = 0; step < max_steps; step++) {
+      BaseFloat objf = evaluator.DoStep(&lbfgs);
+      KALDI_LOG << "Objective function is " << objf;
+    }
+  } else {
+    for (int32 step = 0; step < max_steps; step++) {
+      DoStep(xs, xw, ys, &lbfgs, normalizer);
+    }
   }
 
   Vector<BaseFloat> best_w(lbfgs.GetValue());
@@ -231,16 +296,33 @@ BaseFloat LogisticRegression::GetObjfAndGrad(
     const Matrix<BaseFloat> &xs,
     const std::vector<int32> &ys, const Matrix<BaseFloat> &xw,
     Matrix<BaseFloat> *grad, BaseFloat normalizer) {
+  BaseFloat raw_objf = GetLogLikeAndGrad(xs, ys, 0, ys.size(), xw, grad);
+  // Scale and add regularization term.
+  grad->Scale(1.0/ys.size());
+  grad->AddMat(-1.0 * normalizer, weights_);
+  raw_objf /= ys.size();
+  BaseFloat regularizer = - 0.5 * normalizer 
+                          * TraceMatMat(weights_, weights_, kTrans);
+  KALDI_VLOG(2) << "Objf is " << raw_objf << " + " << regularizer
+                << " = " << (raw_objf + regularizer);
+  return raw_objf + regularizer;
+}
+
+BaseFloat LogisticRegression::GetLogLikeAndGrad(
+    const MatrixBase<BaseFloat> &xs,
+    const std::vector<int32> &ys, int32 begin, int32 end,
+    const MatrixBase<BaseFloat> &xw,
+    MatrixBase<BaseFloat> *grad) const {
   BaseFloat raw_objf = 0.0;
-  int32 num_classes = *std::max_element(ys.begin(), ys.end()) + 1;
+  int32 num_classes = *std::max_element(class_.begin(), class_.end()) + 1;
   std::vector< std::vector<int32> > class_to_cols(num_classes, std::vector<int32>());
   for (int32 i = 0; i < class_.size(); i++) {
     class_to_cols[class_[i]].push_back(i);
   }
   // For each training example class
-  for (int32 i = 0; i < ys.size(); i++) {
+  for (int32 i = begin; i < end; i++) {
     Vector<BaseFloat> row(xw.NumCols());
-    row.CopyFromVec(xw.Row(i));
+    row.CopyFromVec(xw.Row(i - begin));
     row.ApplySoftMax();
     // Identify the rows of weights_ (which are a set of columns in wx) 
     // which correspond to class ys[i]
@@ -266,15 +348,7 @@ BaseFloat LogisticRegression::GetObjfAndGrad(
       }
     }
   }
-  // Scale and add regularization term.
-  grad->Scale(1.0/ys.size());
-  grad->AddMat(-1.0 * normalizer, weights_);
-  raw_objf /= ys.size();
-  BaseFloat regularizer = - 0.5 * normalizer 
-                          * TraceMatMat(weights_, weights_, kTrans);
-  KALDI_VLOG(2) << "Objf is " << raw_objf << " + " << regularizer
-                << " = " << (raw_objf + regularizer);
-  return raw_objf + regularizer;
+  return raw_objf;
 }
 
 void LogisticRegression::SetWeights(const Matrix<BaseFloat> &weights,
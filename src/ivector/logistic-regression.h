@@ -27,10 +27,11 @@ namespace kaldi {
 
 struct LogisticRegressionConfig {
   int32 max_steps,
-        mix_up;
+        mix_up,
+        num_threads;
   double normalizer,
          power;
-  LogisticRegressionConfig(): max_steps(20), mix_up(0), 
+  LogisticRegressionConfig(): max_steps(20), mix_up(0), num_threads(1),
                               normalizer(0.0025), power(0.15){ }
   void Register(OptionsItf *po) {
     po->Register("max-steps", &max_steps,
@@ -43,9 +44,14 @@ struct LogisticRegressionConfig {
     po->Register("power", &power,
                  "Power rule for determining the number of mixtures "
                  "to create.");
+    po->Register("num-threads", &num_threads,
+                 "Number of threads used to compute the objective function "
+                 "and gradient in training.");
   }
 };
 
+class LogisticRegressionObjective;
+
 class LogisticRegression {
  public:
   // xs and ys are the training data. Each row of xs is a vector
@@ -73,6 +79,7 @@ class LogisticRegression {
  protected:
   void friend UnitTestTrain();
   void friend UnitTestPosteriors();
+  friend class LogisticRegressionObjective;
 
  private:
   // Performs a step in the L-BFGS. This is mostly used internally
@@ -102,6 +109,16 @@ class LogisticRegression {
                         Matrix<BaseFloat> *grad,
                         BaseFloat normalizer);
   
+  // Adds to grad the gradient of the (unnormalized, unregularized) log
+  // likelihood of the training examples begin ... end - 1, and returns the
+  // log likelihood.  Row i of xw is row begin + i of xs times weights^T (the
+  // weights may differ from weights_, but have the same dimension).
+  BaseFloat GetLogLikeAndGrad(const MatrixBase<BaseFloat> &xs,
+                              const std::vector<int32> &ys,
+                              int32 begin, int32 end,
+                              const MatrixBase<BaseFloat> &xw,
+                              MatrixBase<BaseFloat> *grad) const;
+
   // Sets the weights and class map. This is generally used for testing.
   void SetWeights(const Matrix<BaseFloat> &weights, 
                   const std::vector<int32> classes);
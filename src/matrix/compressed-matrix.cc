@@ -25,15 +25,12 @@ namespace kaldi {
 
 template<typename Real>
 void CompressedMatrix::CopyFromMat(
-    const MatrixBase<Real> &mat) {
-  if (data_ != NULL) {
-    delete [] static_cast<float*>(data_);  // call delete [] because was allocated with new float[]
-    data_ = NULL;
-  }
+    const MatrixBase<Real> &mat, CompressionMethod method) {
+  Destroy();
   if (mat.NumRows() == 0) { return; }  // Zero-size matrix stored as zero pointer.
 
   GlobalHeader global_header;
-  KALDI_COMPILE_TIME_ASSERT(sizeof(global_header) == 16);  // otherwise
+  KALDI_COMPILE_TIME_ASSERT(sizeof(global_header) == 20);  // otherwise
   // something weird is happening and our code probably won't work or
   // won't be robust across platforms.
 
@@ -64,7 +61,16 @@ void CompressedMatrix::CopyFromMat(
   global_header.num_rows = mat.NumRows();
   global_header.num_cols = mat.NumCols();
 
-  int32 data_size = DataSize(global_header);
+  if (method == kOneByteRowLinear) {
+    global_header.format = kOneByteRowLinear;
+    CopyFromMatRowLinear(mat, global_header);
+    return;
+  }
+  KALDI_ASSERT(method == kSpeechFeature || method == kEntropyCodedFeature);
+  global_header.format = kSpeechFeature;  // EntropyCode() converts it later.
+
+  int32 data_size = HeaderSize(global_header) +
+      global_header.num_rows * global_header.num_cols;
 
   data_ = AllocateData(data_size);
 
@@ -86,14 +92,18 @@ void CompressedMatrix::CopyFromMat(
     header_data++;
     byte_data += global_header.num_rows;
   }
+  if (method == kEntropyCodedFeature)
+    EntropyCode();
 }
 
 // Instantiate the template for float and double.
 template
-void CompressedMatrix::CopyFromMat(const MatrixBase<float> &mat);
+void CompressedMatrix::CopyFromMat(const MatrixBase<float> &mat,
+                                   CompressionMethod method);
 
 template
-void CompressedMatrix::CopyFromMat(const MatrixBase<double> &mat);
+void CompressedMatrix::CopyFromMat(const MatrixBase<double> &mat,
+                                   CompressionMethod method);
 
 
 template<typename Real>
@@ -263,6 +273,230 @@ void CompressedMatrix::CompressColumn(
   }
 }
 
+template<typename Real>
+void CompressedMatrix::CopyFromMatRowLinear(const MatrixBase<Real> &mat,
+                                            const GlobalHeader &global_header) {
+  int32 num_rows = global_header.num_rows, num_cols = global_header.num_cols;
+  data_ = AllocateData(HeaderSize(global_header) + num_rows * num_cols);
+  *(reinterpret_cast<GlobalHeader*>(data_)) = global_header;
+  PerRowHeader *row_header =
+      reinterpret_cast<PerRowHeader*>(static_cast<char*>(data_) +
+                                      sizeof(GlobalHeader));
+  unsigned char *byte_data =
+      reinterpret_cast<unsigned char*>(row_header + num_rows);
+
+  for (int32 r = 0; r < num_rows; r++, row_header++, byte_data += num_cols) {
+    const Real *row_data = mat.RowData(r);
+    Real row_min = row_data[0], row_max = row_data[0];
+    for (int32 c = 1; c < num_cols; c++) {
+      if (row_data[c] < row_min) row_min = row_data[c];
+      if (row_data[c] > row_max) row_max = row_data[c];
+    }
+    uint16 min16 = FloatToUint16(global_header, row_min),
+        max16 = FloatToUint16(global_header, row_max);
+    // Make sure the 16-bit range covers the row, and is nonempty.
+    if (min16 > 0 && Uint16ToFloat(global_header, min16) > row_min) min16--;
+    if (max16 < 65535 && Uint16ToFloat(global_header, max16) < row_max) max16++;
+    if (max16 <= min16) {
+      if (min16 < 65535) max16 = min16 + 1;
+      else min16 = max16 - 1;
+    }
+    row_header->min_value = min16;
+    row_header->max_value = max16;
+    float min_f = Uint16ToFloat(global_header, min16),
+        scale = 255.0 / (Uint16ToFloat(global_header, max16) - min_f);
+    for (int32 c = 0; c < num_cols; c++) {
+      int ans = static_cast<int>((row_data[c] - min_f) * scale + 0.5);
+      if (ans < 0) ans = 0;
+      if (ans > 255) ans = 255;
+      byte_data[c] = static_cast<unsigned char>(ans);
+    }
+  }
+}
+
+// Helper class for CompressedMatrix::EntropyCode(): appends bits, least
+// significant first, to a vector of bytes.
+class CompressedMatrixBitWriter {
+ public:
+  explicit CompressedMatrixBitWriter(std::vector<unsigned char> *bytes):
+      bytes_(bytes), buffer_(0), num_bits_(0) { }
+  // Writes the lowest "num_bits" bits of "bits"; num_bits <= 24.
+  inline void Write(uint32 bits, int32 num_bits) {
+    buffer_ |= static_cast<uint64>(bits) << num_bits_;
+    num_bits_ += num_bits;
+    while (num_bits_ >= 8) {
+      bytes_->push_back(static_cast<unsigned char>(buffer_ & 0xFF));
+      buffer_ >>= 8;
+      num_bits_ -= 8;
+    }
+  }
+  // Writes "n" one-bits followed by a zero bit.
+  inline void WriteUnary(int32 n) {
+    for (; n >= 16; n -= 16) Write(0xFFFF, 16);
+    Write((1 << n) - 1, n + 1);
+  }
+  // Pads to a whole number of bytes.
+  void Flush() {
+    if (num_bits_ > 0)
+      bytes_->push_back(static_cast<unsigned char>(buffer_ & 0xFF));
+    buffer_ = 0;
+    num_bits_ = 0;
+  }
+ private:
+  std::vector<unsigned char> *bytes_;
+  uint64 buffer_;
+  int32 num_bits_;
+};
+
+void CompressedMatrix::EntropyCode() {
+  const GlobalHeader &h = *reinterpret_cast<GlobalHeader*>(data_);
+  KALDI_ASSERT(h.format == kSpeechFeature);
+  int32 num_rows = h.num_rows, num_cols = h.num_cols;
+  const PerColHeader *per_col_header =
+      reinterpret_cast<const PerColHeader*>(&h + 1);
+  const unsigned char *byte_data =
+      reinterpret_cast<const unsigned char*>(per_col_header + num_cols);
+
+  std::vector<CodedColHeader> coded_header(num_cols);
+  std::vector<unsigned char> coded;
+  coded.reserve(num_rows * num_cols / 2);
+  std::vector<uint32> zigzag(num_rows);
+  CompressedMatrixBitWriter writer(&coded);
+  for (int32 col = 0; col < num_cols; col++, byte_data += num_rows) {
+    // Differences between successive frames, zigzag-mapped to nonnegative
+    // values (0, -1, 1, -2, 2 ... map to 0, 1, 2, 3, 4 ...).
+    int32 prev = 0;
+    for (int32 i = 0; i < num_rows; i++) {
+      int32 diff = static_cast<int32>(byte_data[i]) - prev;
+      zigzag[i] = (diff >= 0 ? 2 * diff : -2 * diff - 1);
+      prev = byte_data[i];
+    }
+    // Choose the Rice parameter that gives the fewest bits.
+    int32 rice_param = 0;
+    int64 best_bits = -1;
+    for (int32 k = 0; k < 8; k++) {
+      int64 bits = static_cast<int64>(num_rows) * (k + 1);
+      for (int32 i = 0; i < num_rows; i++)
+        bits += zigzag[i] >> k;
+      if (best_bits < 0 || bits < best_bits) {
+        best_bits = bits;
+        rice_param = k;
+      }
+    }
+    uint32 mask = (1 << rice_param) - 1;
+    for (int32 i = 0; i < num_rows; i++) {
+      writer.WriteUnary(zigzag[i] >> rice_param);
+      writer.Write(zigzag[i] & mask, rice_param);
+    }
+    writer.Flush();
+    coded_header[col].end_byte = coded.size();
+    coded_header[col].rice_param = rice_param;
+  }
+
+  GlobalHeader new_h = h;
+  new_h.format = kEntropyCodedFeature;
+  int32 header_size = HeaderSize(new_h),
+      new_size = header_size + coded.size();
+  if (new_size >= DataSize(data_))
+    return;  // Not worth it; keep the kSpeechFeature format.
+
+  void *new_data = AllocateData(new_size);
+  char *ptr = static_cast<char*>(new_data);
+  *reinterpret_cast<GlobalHeader*>(ptr) = new_h;
+  ptr += sizeof(GlobalHeader);
+  memcpy(ptr, per_col_header, num_cols * sizeof(PerColHeader));
+  ptr += num_cols * sizeof(PerColHeader);
+  memcpy(ptr, &(coded_header[0]), num_cols * sizeof(CodedColHeader));
+  ptr += num_cols * sizeof(CodedColHeader);
+  memcpy(ptr, &(coded[0]), coded.size());
+  Destroy();
+  data_ = new_data;
+}
+
+// static
+void CompressedMatrix::DecodeColumn(const unsigned char *coded,
+                                    int32 rice_param, int32 num_rows,
+                                    unsigned char *byte_data) {
+  // This mirrors the encoding in EntropyCode().
+  uint64 buffer = 0;
+  int32 num_bits = 0, prev = 0;
+  uint32 mask = (1 << rice_param) - 1;
+  for (int32 i = 0; i < num_rows; i++) {
+    uint32 q = 0;
+    while (true) {
+      if (num_bits == 0) {
+        buffer = *(coded++);
+        num_bits = 8;
+      }
+      uint64 bit = buffer & 1;
+      buffer >>= 1;
+      num_bits--;
+      if (bit == 0) break;
+      q++;
+    }
+    while (num_bits < rice_param) {
+      buffer |= static_cast<uint64>(*(coded++)) << num_bits;
+      num_bits += 8;
+    }
+    uint32 zigzag = (q << rice_param) | (static_cast<uint32>(buffer) & mask);
+    buffer >>= rice_param;
+    num_bits -= rice_param;
+    int32 diff = (zigzag & 1) ? -static_cast<int32>((zigzag + 1) >> 1) :
+        static_cast<int32>(zigzag >> 1);
+    prev += diff;
+    byte_data[i] = static_cast<unsigned char>(prev);
+  }
+}
+
+const unsigned char *CompressedMatrix::ColumnBytes(
+    int32 col, int32 num_rows, unsigned char *buffer) const {
+  const GlobalHeader *h = reinterpret_cast<const GlobalHeader*>(data_);
+  const PerColHeader *per_col_header =
+      reinterpret_cast<const PerColHeader*>(h + 1);
+  if (h->format == kSpeechFeature)
+    return reinterpret_cast<const unsigned char*>(per_col_header +
+                                                  h->num_cols) +
+        col * h->num_rows;
+  KALDI_ASSERT(h->format == kEntropyCodedFeature);
+  const CodedColHeader *coded_header =
+      reinterpret_cast<const CodedColHeader*>(per_col_header + h->num_cols);
+  const unsigned char *coded =
+      reinterpret_cast<const unsigned char*>(coded_header + h->num_cols);
+  uint32 begin = (col == 0 ? 0 : coded_header[col - 1].end_byte);
+  DecodeColumn(coded + begin, coded_header[col].rice_param, num_rows, buffer);
+  return buffer;
+}
+
+// static
+MatrixIndexT CompressedMatrix::HeaderSize(const GlobalHeader &header) {
+  switch (header.format) {
+    case kSpeechFeature:
+      return sizeof(GlobalHeader) + header.num_cols * sizeof(PerColHeader);
+    case kOneByteRowLinear:
+      return sizeof(GlobalHeader) + header.num_rows * sizeof(PerRowHeader);
+    case kEntropyCodedFeature:
+      return sizeof(GlobalHeader) + header.num_cols *
+          (sizeof(PerColHeader) + sizeof(CodedColHeader));
+    default:
+      KALDI_ERR << "Invalid compressed-matrix format " << header.format;
+      return 0;
+  }
+}
+
+// static
+MatrixIndexT CompressedMatrix::DataSize(const void *data) {
+  const GlobalHeader &h = *static_cast<const GlobalHeader*>(data);
+  MatrixIndexT header_size = HeaderSize(h);
+  if (h.format == kEntropyCodedFeature) {
+    const CodedColHeader *coded_header =
+        reinterpret_cast<const CodedColHeader*>(
+            static_cast<const char*>(data) + header_size) - 1;
+    return header_size + coded_header->end_byte;  // end of last column.
+  } else {
+    return header_size + h.num_rows * h.num_cols;
+  }
+}
+
 // static
 void* CompressedMatrix::AllocateData(int32 num_bytes) {
   KALDI_ASSERT(num_bytes > 0);
@@ -276,17 +510,23 @@ void* CompressedMatrix::AllocateData(int32 num_bytes) {
 
 void CompressedMatrix::Write(std::ostream &os, bool binary) const {
   if (binary) {  // Binary-mode write:
-    WriteToken(os, binary, "CM");
     if (data_ != NULL) {
       GlobalHeader &h = *reinterpret_cast<GlobalHeader*>(data_);
-      MatrixIndexT size = DataSize(h);  // total size of data in data_
-      os.write(reinterpret_cast<const char*>(data_), size);
+      WriteToken(os, binary, (h.format == kOneByteRowLinear ? "CM2" :
+                              (h.format == kEntropyCodedFeature ? "CM3" :
+                               "CM")));
+      MatrixIndexT size = DataSize(data_);  // total size of data in data_
+      // The format field is not written; it is implied by the token.
+      os.write(reinterpret_cast<const char*>(&h.min_value),
+               size - sizeof(int32));
     } else {  // special case: where data_ == NULL, we treat it as an empty
       // matrix.
+      WriteToken(os, binary, "CM");
       GlobalHeader h;
       h.range = h.min_value = 0.0;
       h.num_rows = h.num_cols = 0;
-      os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+      os.write(reinterpret_cast<const char*>(&h.min_value),
+               sizeof(h) - sizeof(int32));
     }
   } else {
     // In text mode, just use the same format as a regular matrix.
@@ -302,7 +542,7 @@ void CompressedMatrix::Write(std::ostream &os, bool binary) const {
       os << 0.0 << ' ' << 0.0 << ' ' << 0 << ' ' << 0 << '\n';
     } else {
       GlobalHeader &h = *reinterpret_cast<GlobalHeader*>(data_);
-      KALDI_ASSERT(h.num_cols != 0);
+      KALDI_ASSERT(h.num_cols != 0 && h.format == kSpeechFeature);
       os << h.min_value << ' ' << h.range << ' ' << h.num_rows << ' ' << h.num_cols << '\n';
 
       PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(&h + 1);
@@ -324,29 +564,41 @@ void CompressedMatrix::Write(std::ostream &os, bool binary) const {
 }
 
 void CompressedMatrix::Read(std::istream &is, bool binary) {
-  if (data_ != NULL) {
-    delete [] (static_cast<float*>(data_));
-    data_ = NULL;
-  }
+  Destroy();
   if (binary) {  // Binary-mode read.
     // Caution: the following is not back compatible, if you were using
     // CompressedMatrix before, the old format will not be readable.
 
     int peekval = Peek(is, binary);
     if (peekval == 'C') {
-      ExpectToken(is, binary, "CM"); 
+      std::string token;
+      ReadToken(is, binary, &token);
       GlobalHeader h;
-      is.read(reinterpret_cast<char*>(&h), sizeof(h));
+      if (token == "CM") h.format = kSpeechFeature;
+      else if (token == "CM2") h.format = kOneByteRowLinear;
+      else if (token == "CM3") h.format = kEntropyCodedFeature;
+      else KALDI_ERR << "Unexpected token " << token
+                     << ", expecting compressed matrix.";
+      is.read(reinterpret_cast<char*>(&h.min_value),
+              sizeof(h) - sizeof(int32));
       if (is.fail())
         KALDI_ERR << "Failed to read header";
       if (h.num_cols == 0) {  // empty matrix.
         return;
       }
-      int32 size = DataSize(h), remaining_size = size - sizeof(GlobalHeader);
+      // We need the rest of the headers to work out the total size.
+      int32 header_size = HeaderSize(h);
+      std::vector<char> header(header_size);
+      memcpy(&(header[0]), &h, sizeof(h));
+      if (header_size > static_cast<int32>(sizeof(h)))
+        is.read(&(header[sizeof(h)]), header_size - sizeof(h));
+      if (is.fail())
+        KALDI_ERR << "Failed to read header";
+      int32 size = DataSize(&(header[0]));
       data_ = AllocateData(size);
-      *(reinterpret_cast<GlobalHeader*>(data_)) = h;
-      is.read(reinterpret_cast<char*>(data_) + sizeof(GlobalHeader),
-              remaining_size);
+      memcpy(data_, &(header[0]), header_size);
+      is.read(reinterpret_cast<char*>(data_) + header_size,
+              size - header_size);
     } else {
       // Assume that what we're reading is a regular Matrix.  This might be the
       // case if you changed your code, making a Matrix into a CompressedMatrix,
@@ -372,7 +624,8 @@ void CompressedMatrix::Read(std::istream &is, bool binary) {
     if (h.num_cols == 0) {  // Empty matrix; null data_ pointer.
       return;
     }
-    int32 size = DataSize(h);
+    h.format = kSpeechFeature;
+    int32 size = HeaderSize(h) + h.num_rows * h.num_cols;
     data_ = AllocateData(size);
     *(reinterpret_cast<GlobalHeader*>(data_)) = h;
 
@@ -404,17 +657,31 @@ void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat) const {
     KALDI_ASSERT(mat->NumCols() == 0);
   } else {
     GlobalHeader *h = reinterpret_cast<GlobalHeader*>(data_);
-    PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
-    unsigned char *byte_data = reinterpret_cast<unsigned char*>(per_col_header +
-                                                                h->num_cols);
     int32 num_cols = h->num_cols, num_rows = h->num_rows;
     KALDI_ASSERT(mat->NumRows() == num_rows);
     KALDI_ASSERT(mat->NumCols() == num_cols);
+    if (h->format == kOneByteRowLinear) {
+      PerRowHeader *per_row_header = reinterpret_cast<PerRowHeader*>(h+1);
+      unsigned char *byte_data =
+          reinterpret_cast<unsigned char*>(per_row_header + num_rows);
+      for (int32 i = 0; i < num_rows; i++, per_row_header++) {
+        float min_f = Uint16ToFloat(*h, per_row_header->min_value),
+            increment = (Uint16ToFloat(*h, per_row_header->max_value) - min_f)
+            * (1/255.0);
+        Real *row_data = mat->RowData(i);
+        for (int32 j = 0; j < num_cols; j++, byte_data++)
+          row_data[j] = min_f + increment * *byte_data;
+      }
+      return;
+    }
+    PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
+    std::vector<unsigned char> buffer(num_rows);
     for (int32 i = 0; i < num_cols; i++, per_col_header++) {
       float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
           p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
           p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
           p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
+      const unsigned char *byte_data = ColumnBytes(i, num_rows, &(buffer[0]));
       for (int32 j = 0; j < num_rows; j++, byte_data++) {
         float f = CharToFloat(p0, p25, p75, p100, *byte_data);
         (*mat)(j, i) = f;
@@ -437,17 +704,32 @@ void CompressedMatrix::CopyRowToVec(MatrixIndexT row,
   KALDI_ASSERT(v->Dim() == this->NumCols());
 
   GlobalHeader *h = reinterpret_cast<GlobalHeader*>(data_);
+  if (h->format == kOneByteRowLinear) {
+    PerRowHeader *per_row_header = reinterpret_cast<PerRowHeader*>(h+1);
+    unsigned char *byte_data =
+        reinterpret_cast<unsigned char*>(per_row_header + h->num_rows) +
+        row * h->num_cols;
+    per_row_header += row;
+    float min_f = Uint16ToFloat(*h, per_row_header->min_value),
+        increment = (Uint16ToFloat(*h, per_row_header->max_value) - min_f)
+        * (1/255.0);
+    for (int32 i = 0; i < h->num_cols; i++, byte_data++)
+      (*v)(i) = min_f + increment * *byte_data;
+    return;
+  }
   PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
-  unsigned char *byte_data = reinterpret_cast<unsigned char*>(per_col_header +
-                                                              h->num_cols);
-  byte_data += row;  // point to first value we are interested in
-  for (int32 i = 0; i < h->num_cols;
-       i++, per_col_header++, byte_data+=h->num_rows) {
+  // Note: for kEntropyCodedFeature, we have to decode each column up to this
+  // row, so this is not efficient.
+  std::vector<unsigned char> buffer(h->format == kEntropyCodedFeature ?
+                                    row + 1 : 0);
+  for (int32 i = 0; i < h->num_cols; i++, per_col_header++) {
     float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
           p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
           p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
           p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-    float f = CharToFloat(p0, p25, p75, p100, *byte_data);
+    const unsigned char *byte_data =
+        ColumnBytes(i, row + 1, buffer.empty() ? NULL : &(buffer[0]));
+    float f = CharToFloat(p0, p25, p75, p100, byte_data[row]);
     (*v)(i) = f;
   }
 }
@@ -459,10 +741,22 @@ void CompressedMatrix::CopyColToVec(MatrixIndexT col,
   KALDI_ASSERT(v->Dim() == this->NumRows());
 
   GlobalHeader *h = reinterpret_cast<GlobalHeader*>(data_);
+  if (h->format == kOneByteRowLinear) {
+    PerRowHeader *per_row_header = reinterpret_cast<PerRowHeader*>(h+1);
+    unsigned char *byte_data =
+        reinterpret_cast<unsigned char*>(per_row_header + h->num_rows) + col;
+    for (int32 i = 0; i < h->num_rows;
+         i++, per_row_header++, byte_data += h->num_cols) {
+      float min_f = Uint16ToFloat(*h, per_row_header->min_value),
+          max_f = Uint16ToFloat(*h, per_row_header->max_value);
+      (*v)(i) = min_f + (max_f - min_f) * (1/255.0) * *byte_data;
+    }
+    return;
+  }
   PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
-  unsigned char *byte_data = reinterpret_cast<unsigned char*>(per_col_header +
-                                                              h->num_cols);
-  byte_data += col*h->num_rows;  // point to first value in the column we want
+  std::vector<unsigned char> buffer(h->num_rows);
+  const unsigned char *byte_data = ColumnBytes(col, h->num_rows,
+                                               &(buffer[0]));
   per_col_header += col;
   float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
         p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
@@ -496,22 +790,37 @@ void CompressedMatrix::CopyToMat(int32 row_offset,
   KALDI_ASSERT(column_offset+dest->NumCols() < this->NumCols());
   // everything is OK
   GlobalHeader *h = reinterpret_cast<GlobalHeader*>(data_);
-  PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
-  unsigned char *byte_data = reinterpret_cast<unsigned char*>(per_col_header +
-                                                              h->num_cols);
-  int32 num_rows = h->num_rows;
+  int32 num_rows = h->num_rows, num_cols = h->num_cols;
   int32 tgt_cols = dest->NumCols(), tgt_rows = dest->NumRows();
 
-  unsigned char *start_of_subcol = byte_data+row_offset;  // skip appropriate
-  // number of columns
-  start_of_subcol += column_offset*num_rows;  // skip appropriate number of rows
+  if (h->format == kOneByteRowLinear) {
+    PerRowHeader *per_row_header =
+        reinterpret_cast<PerRowHeader*>(h+1) + row_offset;
+    unsigned char *start_of_subrow =
+        reinterpret_cast<unsigned char*>(reinterpret_cast<PerRowHeader*>(h+1)
+                                         + num_rows) +
+        row_offset * num_cols + column_offset;
+    for (int32 i = 0; i < tgt_rows;
+         i++, per_row_header++, start_of_subrow += num_cols) {
+      float min_f = Uint16ToFloat(*h, per_row_header->min_value),
+          increment = (Uint16ToFloat(*h, per_row_header->max_value) - min_f)
+          * (1/255.0);
+      unsigned char *byte_data = start_of_subrow;
+      Real *row_data = dest->RowData(i);
+      for (int32 j = 0; j < tgt_cols; j++, byte_data++)
+        row_data[j] = min_f + increment * *byte_data;
+    }
+    return;
+  }
 
+  PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
   per_col_header += column_offset;  // skip the appropriate number of headers
 
-  for (int32 i = 0;
-       i < tgt_cols;
-       i++, per_col_header++, start_of_subcol+=num_rows) {
-    byte_data = start_of_subcol;
+  std::vector<unsigned char> buffer(std::max(row_offset + tgt_rows, 1));
+  for (int32 i = 0; i < tgt_cols; i++, per_col_header++) {
+    const unsigned char *byte_data =
+        ColumnBytes(column_offset + i, row_offset + tgt_rows, &(buffer[0])) +
+        row_offset;
     float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
           p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
           p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
@@ -545,7 +854,7 @@ CompressedMatrix::CompressedMatrix(const CompressedMatrix &mat): data_(NULL) {
 CompressedMatrix &CompressedMatrix::operator = (const CompressedMatrix &mat) {
   Destroy(); // now this->data_ == NULL.
   if (mat.data_ != NULL) {
-    MatrixIndexT data_size = DataSize(*static_cast<GlobalHeader*>(mat.data_));
+    MatrixIndexT data_size = DataSize(mat.data_);
     data_ = AllocateData(data_size);
     memcpy(static_cast<void*>(data_),
            static_cast<void*>(mat.data_),
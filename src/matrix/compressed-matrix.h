@@ -39,6 +39,31 @@ namespace kaldi {
 /// and store them as 16-bit integers; we then encode each value in
 /// the column as a single byte, in 3 separate ranges with different
 /// linear encodings (0-25th, 25-50th, 50th-100th).
+///
+/// There are also some other formats, selected by the CompressionMethod
+/// given when compressing; see the comment there.  The format is written
+/// as part of the binary token ("CM", "CM2" or "CM3"), so readers don't need
+/// to know which method was used.
+
+enum CompressionMethod {
+  /// The default.  Per-column percentile encoding as described above: about
+  /// one byte per element plus 8 bytes per column.  Written as "CM".
+  kSpeechFeature = 1,
+  /// Each row is encoded linearly in one byte per element, between a
+  /// per-row minimum and maximum stored as 16-bit integers (4 bytes per row).
+  /// Less accurate than kSpeechFeature for features whose columns have very
+  /// different ranges, but much smaller for short, wide matrices such as
+  /// neural-net training examples, where the per-column header of
+  /// kSpeechFeature is a large overhead.  Written as "CM2".
+  kOneByteRowLinear = 2,
+  /// The same quantization as kSpeechFeature (it decompresses to exactly the
+  /// same values), but each column's bytes are stored as differences between
+  /// successive frames, Rice-coded with a per-column parameter.  Gives a
+  /// substantial size reduction for smooth, long feature streams.  If the
+  /// coded form would not be smaller than the kSpeechFeature form, the
+  /// kSpeechFeature form is stored instead.  Written as "CM3".
+  kEntropyCodedFeature = 3
+};
 
 class CompressedMatrix {
  public:
@@ -47,12 +72,16 @@ class CompressedMatrix {
   ~CompressedMatrix() { Destroy(); }
   
   template<typename Real>
-  CompressedMatrix(const MatrixBase<Real> &mat): data_(NULL) { CopyFromMat(mat); }
+  CompressedMatrix(const MatrixBase<Real> &mat,
+                   CompressionMethod method = kSpeechFeature): data_(NULL) {
+    CopyFromMat(mat, method);
+  }
 
 
   /// This will resize *this and copy the contents of mat to *this.
   template<typename Real>
-  void CopyFromMat(const MatrixBase<Real> &mat);
+  void CopyFromMat(const MatrixBase<Real> &mat,
+                   CompressionMethod method = kSpeechFeature);
   
   CompressedMatrix(const CompressedMatrix &mat);
   
@@ -78,6 +107,12 @@ class CompressedMatrix {
   inline MatrixIndexT NumCols() const { return (data_ == NULL) ? 0 :
       (*reinterpret_cast<GlobalHeader*>(data_)).num_cols; }
 
+  /// Returns the method that the data is stored with (kSpeechFeature for
+  /// an empty matrix).
+  inline CompressionMethod Method() const { return (data_ == NULL) ?
+      kSpeechFeature : static_cast<CompressionMethod>(
+          (*reinterpret_cast<GlobalHeader*>(data_)).format); }
+
   /// Copies row #row of the matrix into vector v.
   /// Note: v must have same size as #cols.
   template<typename Real>
@@ -107,18 +142,14 @@ class CompressedMatrix {
   static void *AllocateData(int32 num_bytes);
 
   struct GlobalHeader {
+    int32 format;  // a CompressionMethod; not written to disk, since it is
+                   // encoded in the token.
     float min_value;
     float range;
     int32 num_rows;
     int32 num_cols;
   };
 
-  static MatrixIndexT DataSize(const GlobalHeader &header) {
-    // Returns size in bytes of the data.
-    return sizeof(GlobalHeader) +
-        header.num_cols * (sizeof(PerColHeader) + header.num_rows);
-  }
-
   struct PerColHeader {
     uint16 percentile_0;
     uint16 percentile_25;
@@ -126,6 +157,27 @@ class CompressedMatrix {
     uint16 percentile_100;
   };
 
+  // used in format kOneByteRowLinear.
+  struct PerRowHeader {
+    uint16 min_value;
+    uint16 max_value;
+  };
+
+  // used in format kEntropyCodedFeature, after the PerColHeaders.
+  struct CodedColHeader {
+    uint32 end_byte;    // end of this column's bytes, relative to the start
+                        // of the coded data.
+    uint32 rice_param;  // Rice parameter, 0 <= rice_param < 8.
+  };
+
+  // Returns size in bytes of the global header plus the per-column or per-row
+  // headers; the byte data starts here.
+  static MatrixIndexT HeaderSize(const GlobalHeader &header);
+
+  // Returns total size in bytes of the data, which must start with a
+  // GlobalHeader followed by the rest of the headers.
+  static MatrixIndexT DataSize(const void *data);
+
   template<typename Real>
   static void CompressColumn(const GlobalHeader &global_header,
                              const Real *data, MatrixIndexT stride,
@@ -147,12 +199,35 @@ class CompressedMatrix {
   static inline float CharToFloat(float p0, float p25,
                                   float p75, float p100,
                                   unsigned char value);
+
+  template<typename Real>
+  void CopyFromMatRowLinear(const MatrixBase<Real> &mat,
+                            const GlobalHeader &global_header);
+
+  // Converts data_ (which must be in kSpeechFeature format) to
+  // kEntropyCodedFeature format, if that would make it smaller.
+  void EntropyCode();
+
+  // Decodes the first "num_rows" bytes of a column stored in
+  // kEntropyCodedFeature format into "byte_data".
+  static void DecodeColumn(const unsigned char *coded, int32 rice_param,
+                           int32 num_rows, unsigned char *byte_data);
+
+  // Returns the byte data of column "col" in kSpeechFeature encoding.  If the
+  // format is kEntropyCodedFeature, only the first "num_rows" bytes are
+  // guaranteed to be valid, and they are decoded into "buffer", which must
+  // have at least that size.
+  const unsigned char *ColumnBytes(int32 col, int32 num_rows,
+                                   unsigned char *buffer) const;
   
   void Destroy();
   
   void *data_; // first GlobalHeader, then PerColHeader (repeated), then
   // the byte data for each column (repeated).  Note: don't intersperse
   // the byte data with the PerColHeaders, because of alignment issues.
+  // For kOneByteRowLinear, the PerColHeaders are replaced by PerRowHeaders and
+  // the byte data is stored row by row; for kEntropyCodedFeature the
+  // PerColHeaders are followed by CodedColHeaders and then the coded bytes.
 
 };
 
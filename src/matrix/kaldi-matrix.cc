@@ -25,6 +25,8 @@
 #include "matrix/jama-svd.h"
 #include "matrix/jama-eig.h"
 #include "matrix/compressed-matrix.h"
+#include "matrix/sparse-matrix.h"
+#include "matrix/threaded-blas.h"
 
 namespace kaldi {
 
@@ -168,8 +170,9 @@ void MatrixBase<Real>::AddMatMat(const Real alpha,
                || (transA == kTrans && transB == kTrans && A.num_rows_ == B.num_cols_ && A.num_cols_ == num_rows_ && B.num_rows_ == num_cols_));
   KALDI_ASSERT(&A !=  this && &B != this);
   if (num_rows_ == 0) return;
-  cblas_Xgemm(alpha, transA, A.data_, A.num_rows_, A.num_cols_, A.stride_,
-              transB, B.data_, B.stride_, beta, data_, num_rows_, num_cols_, stride_);
+  ThreadedXgemm(alpha, transA, A.data_, A.num_rows_, A.num_cols_, A.stride_,
+                transB, B.data_, B.stride_, beta, data_, num_rows_, num_cols_,
+                stride_);
 
 }
 template<typename Real>
@@ -252,8 +255,8 @@ void MatrixBase<Real>::SymAddMat2(const Real alpha,
   MatrixIndexT A_other_dim = (transA == kNoTrans ? A.num_cols_ : A.num_rows_);
   
   // This function call is hard-coded to update the lower triangle.
-  cblas_Xsyrk(transA, num_rows_, A_other_dim, alpha, A.Data(),
-              A.Stride(), beta, this->data_, this->stride_);
+  ThreadedXsyrk(transA, num_rows_, A_other_dim, alpha, A.Data(),
+                A.Stride(), beta, this->data_, this->stride_);
 }
 
 
@@ -295,6 +298,41 @@ void MatrixBase<Real>::AddMatSmat(const Real alpha,
   }
 }
 
+template<typename Real>
+void MatrixBase<Real>::AddMatSmat(const Real alpha,
+                                  const MatrixBase<Real> &A,
+                                  MatrixTransposeType transA,
+                                  const SparseMatrix<Real> &B,
+                                  MatrixTransposeType transB,
+                                  const Real beta) {
+  MatrixIndexT inner_dim = (transA == kNoTrans ? A.num_cols_ : A.num_rows_);
+  KALDI_ASSERT((transA == kNoTrans ? A.num_rows_ : A.num_cols_) == num_rows_);
+  KALDI_ASSERT((transB == kNoTrans && B.NumRows() == inner_dim &&
+                B.NumCols() == num_cols_) ||
+               (transB == kTrans && B.NumCols() == inner_dim &&
+                B.NumRows() == num_cols_));
+  KALDI_ASSERT(&A != this);
+  if (beta == 0.0) this->SetZero();
+  else if (beta != 1.0) this->Scale(beta);
+  // For each stored element B(i, j) we add alpha * B(i, j) times column k of
+  // op(A) to column c of *this, where (k, c) = (i, j), or (j, i) if
+  // transB == kTrans.
+  Real *data = this->data_;
+  const Real *Adata = A.data_;
+  MatrixIndexT a_inc = (transA == kNoTrans ? A.stride_ : 1),
+      a_k_offset = (transA == kNoTrans ? 1 : A.stride_);
+  for (MatrixIndexT i = 0; i < B.NumRows(); i++) {
+    const SparseVector<Real> &row = B.Row(i);
+    const std::pair<MatrixIndexT, Real> *sdata = row.Data();
+    for (MatrixIndexT n = 0; n < row.NumElements(); n++) {
+      MatrixIndexT j = sdata[n].first,
+          k = (transB == kNoTrans ? i : j), c = (transB == kNoTrans ? j : i);
+      cblas_Xaxpy(num_rows_, alpha * sdata[n].second, Adata + k * a_k_offset,
+                  a_inc, data + c, stride_);
+    }
+  }
+}
+
 template<typename Real>
 void MatrixBase<Real>::AddSmatMat(const Real alpha,
                                   const MatrixBase<Real> &A,
@@ -1314,7 +1352,7 @@ void Matrix<Real>::Read(std::istream & is, bool binary, bool add) {
         }
       } else if ( (i >= '0' && i <= '9') || i == '-' ) {  // A number...
         Real r;
-        is >> r;
+        ReadNumberText(is, &r);
         if (is.fail()) {
           specific_error << "Stream failure/EOF while reading matrix data.";
           goto cleanup;
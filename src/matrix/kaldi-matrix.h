@@ -516,6 +516,14 @@ class MatrixBase {
                   const MatrixBase<Real>& B, MatrixTransposeType transB,
                   const Real beta);
 
+  /// this <-- beta*this + alpha*A*B, where B is stored as a SparseMatrix
+  /// (see sparse-matrix.h).  The time taken is proportional to the number
+  /// of stored elements of B times the number of rows of *this.
+  void AddMatSmat(const Real alpha,
+                  const MatrixBase<Real>& A, MatrixTransposeType transA,
+                  const SparseMatrix<Real>& B, MatrixTransposeType transB,
+                  const Real beta);
+
   /// A version of AddMatMat specialized for when the first argument
   /// contains a lot of zeroes.  
   void AddSmatMat(const Real alpha,
@@ -1068,7 +1068,7 @@ void Vector<Real>::Read(std::istream & is,  bool binary, bool add) {
       int i = is.peek();
       if (i == '-' || (i >= '0' && i <= '9')) {  // common cases first.
         Real r;
-        is >> r;
+        ReadNumberText(is, &r);
         if (is.fail()) { specific_error << "Failed to read number."; goto bad; }
         if (! std::isspace(is.peek()) && is.peek() != ']') {
           specific_error << "Expected whitespace after number."; goto bad;
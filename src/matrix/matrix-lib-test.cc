@@ -22,6 +22,7 @@
 // limitations under the License.
 
 #include "matrix/matrix-lib.h"
+#include "util/timer.h"
 #include <numeric>
 #include <time.h> // This is only needed for UnitTestSvdSpeed, you can
 // comment it (and that function) out if it causes problems.
@@ -3426,6 +3427,89 @@ template<typename Real> static void UnitTestSplitRadixRealFft() {
 }
 
 
+template<typename Real> static void UnitTestSplitRadixRealFftBatch() {
+  for (MatrixIndexT p = 0; p < 10; p++) {
+    MatrixIndexT logn = 2 + rand() % 11,
+        N = 1 << logn, num_rows = 1 + rand() % 40;
+    SplitRadixRealFft<Real> srfft(N);
+    for (MatrixIndexT q = 0; q < 2; q++) {
+      bool forward = (q == 0);
+      Matrix<Real> M(num_rows, N), M2(num_rows, N);
+      InitRand(&M);
+      M2.CopyFromMat(M);
+      srfft.Compute(&M2, forward);
+      for (MatrixIndexT r = 0; r < num_rows; r++)
+        srfft.Compute(M.RowData(r), forward);
+      AssertEqual(M, M2, 1.0e-05 * N);
+    }
+  }
+}
+
+template<typename Real> static void UnitTestSplitRadixRealFftBatchSpeed() {
+  MatrixIndexT sz = 512, num_frames = 100000;  // 1000 seconds of speech.
+  SplitRadixRealFft<Real> srfft(sz);
+  Matrix<Real> M(num_frames, sz);
+  InitRand(&M);
+  clock_t start = clock();
+  for (MatrixIndexT r = 0; r < num_frames; r++)
+    srfft.Compute(M.RowData(r), true);
+  double per_frame_time = (clock() - start) / (double)CLOCKS_PER_SEC;
+  start = clock();
+  srfft.Compute(&M, true);
+  double batch_time = (clock() - start) / (double)CLOCKS_PER_SEC;
+  KALDI_LOG << "For " << sz << "-point real FFT, per-frame version does "
+            << (num_frames / per_frame_time) << " frames/sec, batched version "
+            << (num_frames / batch_time) << " frames/sec.";
+}
+
+
+template<typename Real> static void UnitTestThreadedBlas() {
+  int32 num_threads = GetNumBlasThreads();
+  for (MatrixIndexT i = 0; i < 8; i++) {
+    MatrixIndexT m = 100 + rand() % 300, n = 100 + rand() % 300,
+        k = 100 + rand() % 300;
+    MatrixTransposeType transA = (i % 2 == 0 ? kNoTrans : kTrans),
+        transB = ((i / 2) % 2 == 0 ? kNoTrans : kTrans);
+    Matrix<Real> A(transA == kNoTrans ? m : k, transA == kNoTrans ? k : m),
+        B(transB == kNoTrans ? k : n, transB == kNoTrans ? n : k),
+        C(m, n);
+    A.SetRandn();
+    B.SetRandn();
+    C.SetRandn();
+    Matrix<Real> C2(C);
+    SetNumBlasThreads(1);
+    C.AddMatMat(0.5, A, transA, B, transB, 0.3);
+    SetNumBlasThreads(1 + i);
+    C2.AddMatMat(0.5, A, transA, B, transB, 0.3);
+    AssertEqual(C, C2);
+
+    SpMatrix<Real> S(m), S2(m);
+    S.SetRandn();
+    S2.CopyFromSp(S);
+    SetNumBlasThreads(1);
+    S.AddMat2(0.7, A, transA, 0.2);
+    SetNumBlasThreads(1 + i);
+    S2.AddMat2(0.7, A, transA, 0.2);
+    AssertEqual(S, S2);
+  }
+  SetNumBlasThreads(num_threads);
+}
+
+template<typename Real> static void UnitTestThreadedBlasSpeed() {
+  MatrixIndexT dim = 1000;
+  Matrix<Real> A(dim, dim), B(dim, dim), C(dim, dim);
+  A.SetRandn();
+  B.SetRandn();
+  int32 num_threads = GetNumBlasThreads();
+  for (int32 n = 1; n <= 4; n *= 2) {
+    SetNumBlasThreads(n);
+    Timer timer;
+    C.AddMatMat(1.0, A, kNoTrans, B, kNoTrans, 0.0);
+    KALDI_LOG << "For " << dim << " x " << dim << " AddMatMat with " << n
+              << " threads, time was " << timer.Elapsed() << " seconds.";
+  }
+  SetNumBlasThreads(num_threads);
+}
 
 template<typename Real> static void UnitTestRealFftSpeed() {
 
@@ -4009,6 +4093,89 @@ template<typename Real> static void UnitTestCompressedMatrix() {
   if (num_failure > 1)
     KALDI_ERR << "Too many failures in compressed matrix test.";
 }
+
+template<typename Real> static void UnitTestCompressedMatrixMethods() {
+  for (MatrixIndexT n = 0; n < 10; n++) {
+    MatrixIndexT num_rows = 1 + rand() % 200, num_cols = 1 + rand() % 20;
+    Matrix<Real> M(num_rows, num_cols);
+    if (n % 2 == 0) {
+      InitRand(&M);
+    } else {  // something smooth in time, like features.
+      Vector<Real> v(num_cols);
+      v.SetRandn();
+      for (MatrixIndexT r = 0; r < num_rows; r++) {
+        for (MatrixIndexT c = 0; c < num_cols; c++)
+          v(c) += 0.01 * RandGauss();
+        M.Row(r).CopyFromVec(v);
+      }
+    }
+    Matrix<Real> M_ref(num_rows, num_cols);
+    CompressedMatrix(M).CopyToMat(&M_ref);
+
+    for (int32 method = kSpeechFeature; method <= kEntropyCodedFeature;
+         method++) {
+      CompressedMatrix cmat(M, static_cast<CompressionMethod>(method));
+      KALDI_ASSERT(cmat.NumRows() == num_rows && cmat.NumCols() == num_cols);
+      Matrix<Real> M2(num_rows, num_cols);
+      cmat.CopyToMat(&M2);
+      if (method == kEntropyCodedFeature) {
+        // lossless with respect to kSpeechFeature.
+        AssertEqual(M2, M_ref);
+        if (n % 2 == 1 && num_rows > 100)
+          KALDI_ASSERT(cmat.Method() == kEntropyCodedFeature);
+      } else {
+        KALDI_ASSERT(cmat.Method() == method);
+        Matrix<Real> diff(M2);
+        diff.AddMat(-1.0, M);
+        KALDI_ASSERT(diff.FrobeniusNorm() <= 0.02 * M.FrobeniusNorm());
+      }
+
+      for (MatrixIndexT i = 0; i < num_rows; i++) {
+        Vector<Real> V(num_cols);
+        cmat.CopyRowToVec(i, &V);
+        Vector<Real> V2(M2.Row(i));
+        AssertEqual(V, V2);
+      }
+      for (MatrixIndexT i = 0; i < num_cols; i++) {
+        Vector<Real> V(num_rows);
+        cmat.CopyColToVec(i, &V);
+        for (MatrixIndexT k = 0; k < num_rows; k++)
+          AssertEqual(M2(k, i), V(k));
+      }
+      if (num_rows > 1 && num_cols > 1) {
+        MatrixIndexT row_offset = rand() % (num_rows - 1),
+            col_offset = rand() % (num_cols - 1),
+            num_subrows = 1 + rand() % (num_rows - row_offset - 1),
+            num_subcols = 1 + rand() % (num_cols - col_offset - 1);
+        Matrix<Real> Msub(num_subrows, num_subcols);
+        cmat.CopyToMat(row_offset, col_offset, &Msub);
+        Matrix<Real> Msub2(M2.Range(row_offset, num_subrows,
+                                    col_offset, num_subcols));
+        AssertEqual(Msub, Msub2);
+      }
+
+      // test I/O, and that the format is auto-detected.
+      std::ostringstream os;
+      cmat.Write(os, true);
+      CompressedMatrix cmat2;
+      std::istringstream is(os.str());
+      cmat2.Read(is, true);
+      KALDI_ASSERT(cmat2.Method() == cmat.Method());
+      Matrix<Real> M3(cmat2);
+      AssertEqual(M2, M3);
+      std::istringstream is2(os.str());
+      Matrix<Real> M4;
+      M4.Read(is2, true);  // read as a regular matrix.
+      AssertEqual(M2, M4);
+      CompressedMatrix cmat3(cmat2);
+      Matrix<Real> M5(cmat3);
+      AssertEqual(M2, M5);
+      KALDI_LOG << "Compression method " << method << ", size of "
+                << num_rows << " x " << num_cols << " matrix is "
+                << os.str().size() << " bytes.";
+    }
+  }
+}
   
 
 template<typename Real>
@@ -4099,6 +4266,7 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestLbfgs<Real>();
   // UnitTestSvdBad<Real>(); // test bug in Jama SVD code.
   UnitTestCompressedMatrix<Real>();
+  UnitTestCompressedMatrixMethods<Real>();
   UnitTestResize<Real>();
   UnitTestMatrixExponentialBackprop();
   UnitTestMatrixExponential<Real>();
@@ -4113,6 +4281,8 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   // commenting these out for now-- they test the speed, but take a while.
   // UnitTestSplitRadixRealFftSpeed<Real>();
   // UnitTestRealFftSpeed<Real>();   // won't exit!/
+  // UnitTestSplitRadixRealFftBatchSpeed<Real>();
+  // UnitTestThreadedBlasSpeed<Real>();
   UnitTestComplexFt<Real>();
   KALDI_LOG << " Point B";
   UnitTestComplexFft2<Real>();
@@ -4224,6 +4394,8 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestPca2<Real>(full_test);
   UnitTestAddVecVec<Real>();
   UnitTestReplaceValue<Real>();
+  UnitTestSplitRadixRealFftBatch<Real>();
+  UnitTestThreadedBlas<Real>();
   // The next one is slow.  The upshot is that Eig is up to ten times faster
   // than SVD. 
   // UnitTestSvdSpeed<Real>();
@@ -31,7 +31,9 @@
 #include "matrix/matrix-functions.h"
 #include "matrix/srfft.h"
 #include "matrix/compressed-matrix.h"
+#include "matrix/sparse-matrix.h"
 #include "matrix/optimization.h"
+#include "matrix/threaded-blas.h"
 
 #endif
 
@@ -408,6 +408,24 @@ void OptimizeLbfgs<Real>::DoStep(Real function_value,
   DoStep(function_value, gradient);
 }
 
+template<typename Real>
+void OptimizeLbfgs<Real>::GetLineSearchCandidates(
+    int32 num_candidates, std::vector<Vector<Real> > *candidates) const {
+  KALDI_ASSERT(num_candidates > 0);
+  if (computation_state_ != kWithinStep) num_candidates = 1;
+  candidates->resize(num_candidates);
+  (*candidates)[0] = new_x_;
+  // This mirrors the kDecreaseStep case of StepSizeIteration(), so the
+  // values come out exactly the same.
+  Real scale = 1.0 / d_;
+  for (int32 i = 1; i < num_candidates; i++) {
+    Vector<Real> &x = (*candidates)[i];
+    x = (*candidates)[i - 1];
+    x.Scale(scale);
+    x.AddVec(1.0 - scale, x_);
+  }
+}
+
 template<typename Real>
 const VectorBase<Real>&
 OptimizeLbfgs<Real>::GetValue(Real *objf_value) const {
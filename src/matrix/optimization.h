@@ -25,6 +25,8 @@
 #ifndef KALDI_MATRIX_OPTIMIZATION_H_
 #define KALDI_MATRIX_OPTIMIZATION_H_
 
+#include <vector>
+
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
 
@@ -83,6 +85,30 @@ struct LbfgsOptions {
       avg_step_length(4) { }
 };
 
+/**
+   This is an optional interface for objective functions that are a sum of
+   terms computed on separate "shards" of the data (e.g. blocks of training
+   examples).  It is used by ParallelLbfgsEvaluator (see
+   thread/kaldi-parallel-lbfgs.h), which computes the shards in parallel and
+   sums them before calling OptimizeLbfgs::DoStep().
+*/
+template<typename Real>
+class LbfgsShardedObjective {
+ public:
+  /// Returns the number of shards the objective function is split into.
+  virtual int32 NumShards() const = 0;
+
+  /// Returns the contribution of this shard to the objective function at x,
+  /// and adds its contribution to the gradient to *gradient, which will
+  /// have the same dimension as x.  This will be called from multiple threads
+  /// at once (for different shards and possibly different x), so it must not
+  /// modify any shared state.
+  virtual Real ComputeShard(int32 shard, const VectorBase<Real> &x,
+                            VectorBase<Real> *gradient) const = 0;
+
+  virtual ~LbfgsShardedObjective() { }
+};
+
 template<typename Real>
 class OptimizeLbfgs {
  public:
@@ -98,6 +124,16 @@ class OptimizeLbfgs {
   /// This returns the value at which the function wants us
   /// to compute the objective function and gradient.
   const VectorBase<Real>& GetProposedValue() const { return new_x_; }
+
+  /// This outputs GetProposedValue() followed by up to num_candidates - 1
+  /// further points at which the line search may ask for the function next,
+  /// namely those it would propose if the step size keeps being decreased.
+  /// They are computed exactly as DoStep() would compute them, so a caller
+  /// that can evaluate several points at once (see ParallelLbfgsEvaluator in
+  /// thread/kaldi-parallel-lbfgs.h) can evaluate them together and recognize
+  /// them later.  Outside the line search, only GetProposedValue() is output.
+  void GetLineSearchCandidates(int32 num_candidates,
+                               std::vector<Vector<Real> > *candidates) const;
   
   /// Returns the average magnitude of the last n steps (but not
   /// more than the number we have stored).  Before we have taken
@@ -393,7 +393,7 @@ void PackedMatrix<Real>::Read(std::istream& is, bool binary, bool add) {
       }
       else if ( (i >= '0' && i <= '9') || i == '-' ) {  // A number...
         Real r; 
-        is >> r;
+        ReadNumberText(is, &r);
         if (is.fail()) {
           specific_error << "Stream failure/EOF while reading matrix data.";
           goto bad;
@@ -26,6 +26,7 @@
 #include "matrix/kaldi-matrix.h"
 #include "matrix/matrix-functions.h"
 #include "matrix/cblas-wrappers.h"
+#include "matrix/threaded-blas.h"
 
 namespace kaldi {
 
@@ -1153,8 +1154,8 @@ void SpMatrix<Real>::AddMat2(const Real alpha, const MatrixBase<Real> &M,
   // doesn't dominate O(N) time.
 
   // This function call is hard-coded to update the lower triangle.
-  cblas_Xsyrk(transM, this_dim, m_other_dim, alpha, M.Data(),
-              M.Stride(), beta, temp_mat.Data(), temp_mat.Stride());
+  ThreadedXsyrk(transM, this_dim, m_other_dim, alpha, M.Data(),
+                M.Stride(), beta, temp_mat.Data(), temp_mat.Stride());
 
   this->CopyFromMat(temp_mat, kTakeLower);
 }
@@ -0,0 +1,181 @@
+// matrix/sparse-matrix-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+// Returns a random sparse matrix in the same format as a Posterior, possibly
+// with repeated indexes (which should be summed).
+template<typename Real>
+static void RandSparsePairs(
+    MatrixIndexT num_rows, MatrixIndexT num_cols,
+    std::vector<std::vector<std::pair<MatrixIndexT, Real> > > *pairs) {
+  pairs->resize(num_rows);
+  for (MatrixIndexT r = 0; r < num_rows; r++) {
+    (*pairs)[r].clear();
+    if (num_cols == 0) continue;
+    int32 n = rand() % 4;
+    for (int32 i = 0; i < n; i++)
+      (*pairs)[r].push_back(std::make_pair<MatrixIndexT, Real>(
+          rand() % num_cols, RandGauss()));
+  }
+}
+
+template<typename Real>
+static void UnitTestSparseVector() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT dim = 1 + rand() % 20;
+    std::vector<std::vector<std::pair<MatrixIndexT, Real> > > pairs;
+    RandSparsePairs(1, dim, &pairs);
+    SparseVector<Real> svec(dim, pairs[0]);
+    Vector<Real> vec(dim);
+    for (size_t j = 0; j < pairs[0].size(); j++)
+      vec(pairs[0][j].first) += pairs[0][j].second;
+
+    Vector<Real> vec2(dim);
+    svec.CopyElementsToVec(&vec2);
+    AssertEqual(vec, vec2);
+    vec2.SetRandn();
+    Vector<double> vec3(vec2);
+    vec3.AddVec(0.5, vec);
+    svec.AddToVec(0.5, &vec2);
+    KALDI_ASSERT(vec2.ApproxEqual(Vector<Real>(vec3)));
+
+    AssertEqual(svec.Sum(), vec.Sum());
+    Vector<Real> other(dim);
+    other.SetRandn();
+    AssertEqual(VecSvec(other, svec), VecVec(other, vec));
+
+    int32 index;
+    Real max = svec.Max(&index);
+    if (svec.NumElements() == 0) {
+      KALDI_ASSERT(index == -1);
+    } else {
+      KALDI_ASSERT(max == vec(index));
+      for (MatrixIndexT k = 0; k < svec.NumElements(); k++)
+        KALDI_ASSERT(svec.GetElement(k).second <= max);
+    }
+
+    bool binary = (rand() % 2 == 0);
+    std::ostringstream os;
+    svec.Write(os, binary);
+    SparseVector<Real> svec2;
+    std::istringstream is(os.str());
+    svec2.Read(is, binary);
+    KALDI_ASSERT(svec2.Dim() == dim &&
+                 svec2.NumElements() == svec.NumElements());
+    svec2.CopyElementsToVec(&vec2);
+    KALDI_ASSERT(vec2.ApproxEqual(vec, 1.0e-04));
+  }
+}
+
+template<typename Real>
+static void UnitTestSparseMatrix() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_rows = 1 + rand() % 10, num_cols = 1 + rand() % 10;
+    std::vector<std::vector<std::pair<MatrixIndexT, Real> > > pairs;
+    RandSparsePairs(num_rows, num_cols, &pairs);
+    SparseMatrix<Real> smat(num_cols, pairs);
+    KALDI_ASSERT(smat.NumRows() == num_rows && smat.NumCols() == num_cols);
+    Matrix<Real> mat(num_rows, num_cols);
+    smat.CopyToMat(&mat);
+    AssertEqual(smat.Sum(), mat.Sum());
+    AssertEqual(smat.FrobeniusNorm(), mat.FrobeniusNorm());
+
+    Matrix<Real> mat_trans(num_cols, num_rows);
+    smat.CopyToMat(&mat_trans, kTrans);
+    Matrix<Real> mat_trans2(mat, kTrans);
+    AssertEqual(mat_trans, mat_trans2);
+
+    Matrix<Real> sum(num_rows, num_cols), sum2(num_rows, num_cols);
+    sum.SetRandn();
+    sum2.CopyFromMat(sum);
+    smat.AddToMat(2.0, &sum);
+    sum2.AddMat(2.0, mat);
+    AssertEqual(sum, sum2);
+    Matrix<Real> sum_trans(num_cols, num_rows);
+    smat.AddToMat(2.0, &sum_trans, kTrans);
+    mat_trans2.Scale(2.0);
+    AssertEqual(sum_trans, mat_trans2);
+
+    bool binary = (rand() % 2 == 0);
+    std::ostringstream os;
+    smat.Write(os, binary);
+    SparseMatrix<Real> smat2;
+    std::istringstream is(os.str());
+    smat2.Read(is, binary);
+    KALDI_ASSERT(smat2.NumRows() == num_rows &&
+                 smat2.NumElements() == smat.NumElements());
+    Matrix<Real> mat2(num_rows, num_cols);
+    smat2.CopyToMat(&mat2);
+    KALDI_ASSERT(mat2.ApproxEqual(mat, 1.0e-04));
+  }
+}
+
+template<typename Real>
+static void UnitTestMatSmat() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT m = 1 + rand() % 10, k = 1 + rand() % 10,
+        n = 1 + rand() % 10;
+    MatrixTransposeType transA = (rand() % 2 == 0 ? kNoTrans : kTrans),
+        transB = (rand() % 2 == 0 ? kNoTrans : kTrans);
+    Matrix<Real> A(transA == kNoTrans ? m : k, transA == kNoTrans ? k : m);
+    A.SetRandn();
+    std::vector<std::vector<std::pair<MatrixIndexT, Real> > > pairs;
+    MatrixIndexT b_rows = (transB == kNoTrans ? k : n),
+        b_cols = (transB == kNoTrans ? n : k);
+    RandSparsePairs(b_rows, b_cols, &pairs);
+    SparseMatrix<Real> B(b_cols, pairs);
+    Matrix<Real> B_dense(b_rows, b_cols);
+    B.CopyToMat(&B_dense);
+
+    Matrix<Real> C(m, n), C2(m, n);
+    C.SetRandn();
+    C2.CopyFromMat(C);
+    Real alpha = RandGauss(), beta = (rand() % 3 == 0 ? 0.0 : RandGauss());
+    C.AddMatSmat(alpha, A, transA, B, transB, beta);
+    C2.AddMatMat(alpha, A, transA, B_dense, transB, beta);
+    KALDI_ASSERT(C.ApproxEqual(C2, 1.0e-04));
+
+    // tr(A B) and tr(A B^T).
+    Matrix<Real> D(b_cols, b_rows);
+    D.SetRandn();
+    AssertEqual(TraceMatSmat(D, B, kNoTrans),
+                TraceMatMat(D, B_dense, kNoTrans));
+    Matrix<Real> E(b_rows, b_cols);
+    E.SetRandn();
+    AssertEqual(TraceMatSmat(E, B, kTrans),
+                TraceMatMat(E, B_dense, kTrans));
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestSparseVector<float>();
+  UnitTestSparseVector<double>();
+  UnitTestSparseMatrix<float>();
+  UnitTestSparseMatrix<double>();
+  UnitTestMatSmat<float>();
+  UnitTestMatSmat<double>();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,415 @@
+// matrix/sparse-matrix.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+#include "matrix/sparse-matrix.h"
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+// Parses a decimal integer that makes up the whole of "str"; returns false on
+// failure.  (ConvertStringToInteger() is in util/, which we can't use here.)
+static bool ParseMatrixIndex(const std::string &str, MatrixIndexT *i) {
+  const char *begin = str.c_str();
+  char *end;
+  long l = strtol(begin, &end, 10);
+  if (end == begin || *end != '\0' ||
+      static_cast<long>(static_cast<MatrixIndexT>(l)) != l)
+    return false;
+  *i = static_cast<MatrixIndexT>(l);
+  return true;
+}
+
+template <typename Real>
+SparseVector<Real>::SparseVector(
+    MatrixIndexT dim, const std::vector<std::pair<MatrixIndexT, Real> > &pairs):
+    dim_(dim), pairs_(pairs) {
+  std::sort(pairs_.begin(), pairs_.end());
+  // Merge any repeated indexes.
+  typename std::vector<std::pair<MatrixIndexT, Real> >::iterator
+      out = pairs_.begin(), in = pairs_.begin(), end = pairs_.end();
+  while (in != end) {
+    *out = *in;
+    ++in;
+    while (in != end && in->first == out->first) {
+      out->second += in->second;
+      ++in;
+    }
+    ++out;
+  }
+  pairs_.erase(out, end);
+  if (!pairs_.empty()) {
+    KALDI_ASSERT(pairs_.front().first >= 0 && pairs_.back().first < dim_);
+  }
+}
+
+template <typename Real>
+Real SparseVector<Real>::Sum() const {
+  Real sum = 0.0;
+  for (size_t i = 0; i < pairs_.size(); i++)
+    sum += pairs_[i].second;
+  return sum;
+}
+
+template <typename Real>
+Real SparseVector<Real>::Max(int32 *index) const {
+  Real ans = -std::numeric_limits<Real>::infinity();
+  int32 index_ans = -1;
+  for (size_t i = 0; i < pairs_.size(); i++) {
+    if (pairs_[i].second > ans) {
+      ans = pairs_[i].second;
+      index_ans = pairs_[i].first;
+    }
+  }
+  *index = index_ans;
+  return ans;
+}
+
+template <typename Real>
+template <class OtherReal>
+void SparseVector<Real>::CopyElementsToVec(VectorBase<OtherReal> *vec) const {
+  KALDI_ASSERT(vec->Dim() == dim_);
+  vec->SetZero();
+  OtherReal *data = vec->Data();
+  for (size_t i = 0; i < pairs_.size(); i++)
+    data[pairs_[i].first] = pairs_[i].second;
+}
+
+template <typename Real>
+template <class OtherReal>
+void SparseVector<Real>::AddToVec(Real alpha,
+                                  VectorBase<OtherReal> *vec) const {
+  KALDI_ASSERT(vec->Dim() == dim_);
+  OtherReal *data = vec->Data();
+  for (size_t i = 0; i < pairs_.size(); i++)
+    data[pairs_[i].first] += alpha * pairs_[i].second;
+}
+
+template <typename Real>
+void SparseVector<Real>::Resize(MatrixIndexT dim) {
+  KALDI_ASSERT(dim >= 0);
+  dim_ = dim;
+  pairs_.clear();
+}
+
+template <typename Real>
+void SparseVector<Real>::Swap(SparseVector<Real> *other) {
+  std::swap(dim_, other->dim_);
+  pairs_.swap(other->pairs_);
+}
+
+template <typename Real>
+void SparseVector<Real>::Write(std::ostream &os, bool binary) const {
+  if (binary) {
+    WriteToken(os, binary, "SV");
+    WriteBasicType(os, binary, dim_);
+    MatrixIndexT num_elems = pairs_.size();
+    WriteBasicType(os, binary, num_elems);
+    for (size_t i = 0; i < pairs_.size(); i++) {
+      WriteBasicType(os, binary, pairs_[i].first);
+      WriteBasicType(os, binary, pairs_[i].second);
+    }
+  } else {
+    // The text format is "dim=10 [ 0 0.5 3 0.5 ] ".
+    os << "dim=" << dim_ << " [ ";
+    for (size_t i = 0; i < pairs_.size(); i++)
+      os << pairs_[i].first << ' ' << pairs_[i].second << ' ';
+    os << "] ";
+  }
+  if (os.fail())
+    KALDI_ERR << "Error writing sparse vector to stream.";
+}
+
+template <typename Real>
+void SparseVector<Real>::Read(std::istream &is, bool binary) {
+  if (binary) {
+    ExpectToken(is, binary, "SV");
+    ReadBasicType(is, binary, &dim_);
+    KALDI_ASSERT(dim_ >= 0);
+    MatrixIndexT num_elems;
+    ReadBasicType(is, binary, &num_elems);
+    KALDI_ASSERT(num_elems >= 0 && num_elems <= dim_);
+    pairs_.resize(num_elems);
+    for (size_t i = 0; i < pairs_.size(); i++) {
+      ReadBasicType(is, binary, &(pairs_[i].first));
+      ReadBasicType(is, binary, &(pairs_[i].second));
+    }
+  } else {
+    std::string str;
+    is >> str;
+    if (str.substr(0, 4) != "dim=" ||
+        !ParseMatrixIndex(str.substr(4), &dim_) || dim_ < 0)
+      KALDI_ERR << "Reading sparse vector, expected 'dim=xxx', got " << str;
+    is >> str;
+    if (str != "[")
+      KALDI_ERR << "Reading sparse vector, expected '[', got " << str;
+    pairs_.clear();
+    while (true) {
+      is >> str;
+      if (is.fail())
+        KALDI_ERR << "Reading sparse vector, unexpected end of input.";
+      if (str == "]") break;
+      std::pair<MatrixIndexT, Real> p;
+      if (!ParseMatrixIndex(str, &(p.first)))
+        KALDI_ERR << "Reading sparse vector, expected index or ']', got "
+                  << str;
+      ReadBasicType(is, binary, &(p.second));
+      pairs_.push_back(p);
+    }
+  }
+  if (is.fail())
+    KALDI_ERR << "Error reading sparse vector from stream.";
+  for (size_t i = 0; i < pairs_.size(); i++) {
+    if (pairs_[i].first < 0 || pairs_[i].first >= dim_ ||
+        (i > 0 && pairs_[i].first <= pairs_[i-1].first))
+      KALDI_ERR << "Reading sparse vector, indexes out of range or "
+                << "not sorted.";
+  }
+}
+
+template <typename Real>
+Real VecSvec(const VectorBase<Real> &vec, const SparseVector<Real> &svec) {
+  KALDI_ASSERT(vec.Dim() == svec.Dim());
+  const Real *data = vec.Data();
+  const std::pair<MatrixIndexT, Real> *sdata = svec.Data();
+  MatrixIndexT num_elems = svec.NumElements();
+  Real ans = 0.0;
+  for (MatrixIndexT i = 0; i < num_elems; i++)
+    ans += data[sdata[i].first] * sdata[i].second;
+  return ans;
+}
+
+template <typename Real>
+SparseMatrix<Real>::SparseMatrix(
+    MatrixIndexT num_cols,
+    const std::vector<std::vector<std::pair<MatrixIndexT, Real> > > &pairs):
+    rows_(pairs.size()) {
+  for (size_t r = 0; r < pairs.size(); r++) {
+    SparseVector<Real> row(num_cols, pairs[r]);
+    rows_[r].Swap(&row);
+  }
+}
+
+template <typename Real>
+MatrixIndexT SparseMatrix<Real>::NumElements() const {
+  MatrixIndexT num_elems = 0;
+  for (size_t r = 0; r < rows_.size(); r++)
+    num_elems += rows_[r].NumElements();
+  return num_elems;
+}
+
+template <typename Real>
+Real SparseMatrix<Real>::Sum() const {
+  Real sum = 0.0;
+  for (size_t r = 0; r < rows_.size(); r++)
+    sum += rows_[r].Sum();
+  return sum;
+}
+
+template <typename Real>
+Real SparseMatrix<Real>::FrobeniusNorm() const {
+  Real sumsq = 0.0;
+  for (size_t r = 0; r < rows_.size(); r++) {
+    const std::pair<MatrixIndexT, Real> *sdata = rows_[r].Data();
+    for (MatrixIndexT i = 0; i < rows_[r].NumElements(); i++)
+      sumsq += sdata[i].second * sdata[i].second;
+  }
+  return std::sqrt(sumsq);
+}
+
+template <typename Real>
+void SparseMatrix<Real>::SetRow(MatrixIndexT r, const SparseVector<Real> &vec) {
+  KALDI_ASSERT(static_cast<UnsignedMatrixIndexT>(r) < rows_.size() &&
+               vec.Dim() == rows_[0].Dim());
+  rows_[r] = vec;
+}
+
+template <typename Real>
+template <class OtherReal>
+void SparseMatrix<Real>::CopyToMat(MatrixBase<OtherReal> *other,
+                                   MatrixTransposeType trans) const {
+  if (trans == kNoTrans) {
+    KALDI_ASSERT(other->NumRows() == NumRows() &&
+                 other->NumCols() == NumCols());
+    for (size_t r = 0; r < rows_.size(); r++) {
+      SubVector<OtherReal> row(*other, r);
+      rows_[r].CopyElementsToVec(&row);
+    }
+  } else {
+    KALDI_ASSERT(other->NumRows() == NumCols() &&
+                 other->NumCols() == NumRows());
+    other->SetZero();
+    OtherReal *data = other->Data();
+    MatrixIndexT stride = other->Stride();
+    for (size_t r = 0; r < rows_.size(); r++) {
+      const std::pair<MatrixIndexT, Real> *sdata = rows_[r].Data();
+      for (MatrixIndexT i = 0; i < rows_[r].NumElements(); i++)
+        data[sdata[i].first * stride + r] = sdata[i].second;
+    }
+  }
+}
+
+template <typename Real>
+void SparseMatrix<Real>::AddToMat(Real alpha, MatrixBase<Real> *other,
+                                  MatrixTransposeType trans) const {
+  if (trans == kNoTrans) {
+    KALDI_ASSERT(other->NumRows() == NumRows() &&
+                 other->NumCols() == NumCols());
+    for (size_t r = 0; r < rows_.size(); r++) {
+      SubVector<Real> row(*other, r);
+      rows_[r].AddToVec(alpha, &row);
+    }
+  } else {
+    KALDI_ASSERT(other->NumRows() == NumCols() &&
+                 other->NumCols() == NumRows());
+    Real *data = other->Data();
+    MatrixIndexT stride = other->Stride();
+    for (size_t r = 0; r < rows_.size(); r++) {
+      const std::pair<MatrixIndexT, Real> *sdata = rows_[r].Data();
+      for (MatrixIndexT i = 0; i < rows_[r].NumElements(); i++)
+        data[sdata[i].first * stride + r] += alpha * sdata[i].second;
+    }
+  }
+}
+
+template <typename Real>
+void SparseMatrix<Real>::Resize(MatrixIndexT num_rows, MatrixIndexT num_cols) {
+  KALDI_ASSERT(num_rows >= 0 && num_cols >= 0);
+  rows_.resize(num_rows);
+  for (size_t r = 0; r < rows_.size(); r++)
+    rows_[r].Resize(num_cols);
+}
+
+template <typename Real>
+void SparseMatrix<Real>::Swap(SparseMatrix<Real> *other) {
+  rows_.swap(other->rows_);
+}
+
+template <typename Real>
+void SparseMatrix<Real>::Write(std::ostream &os, bool binary) const {
+  if (binary) {
+    WriteToken(os, binary, "SM");
+    MatrixIndexT num_rows = rows_.size();
+    WriteBasicType(os, binary, num_rows);
+  } else {
+    // The text format is "rows=3 dim=10 [ ... ] dim=10 [ ... ] ... ".
+    os << "rows=" << rows_.size() << ' ';
+  }
+  for (size_t r = 0; r < rows_.size(); r++)
+    rows_[r].Write(os, binary);
+  if (!binary) os << '\n';
+  if (os.fail())
+    KALDI_ERR << "Error writing sparse matrix to stream.";
+}
+
+template <typename Real>
+void SparseMatrix<Real>::Read(std::istream &is, bool binary) {
+  MatrixIndexT num_rows;
+  if (binary) {
+    ExpectToken(is, binary, "SM");
+    ReadBasicType(is, binary, &num_rows);
+  } else {
+    std::string str;
+    is >> str;
+    if (str.substr(0, 5) != "rows=" ||
+        !ParseMatrixIndex(str.substr(5), &num_rows))
+      KALDI_ERR << "Reading sparse matrix, expected 'rows=xxx', got " << str;
+  }
+  KALDI_ASSERT(num_rows >= 0);
+  rows_.resize(num_rows);
+  for (size_t r = 0; r < rows_.size(); r++) {
+    rows_[r].Read(is, binary);
+    if (rows_[r].Dim() != rows_[0].Dim())
+      KALDI_ERR << "Reading sparse matrix, rows have inconsistent dimension.";
+  }
+}
+
+template <typename Real>
+Real TraceMatSmat(const MatrixBase<Real> &A, const SparseMatrix<Real> &B,
+                  MatrixTransposeType trans) {
+  Real sum = 0.0;
+  if (trans == kNoTrans) {
+    // tr(A B) = sum_{i,j} A(j, i) B(i, j).
+    KALDI_ASSERT(A.NumRows() == B.NumCols() && A.NumCols() == B.NumRows());
+    const Real *data = A.Data();
+    MatrixIndexT stride = A.Stride();
+    for (MatrixIndexT i = 0; i < B.NumRows(); i++) {
+      const SparseVector<Real> &row = B.Row(i);
+      const std::pair<MatrixIndexT, Real> *sdata = row.Data();
+      for (MatrixIndexT k = 0; k < row.NumElements(); k++)
+        sum += data[sdata[k].first * stride + i] * sdata[k].second;
+    }
+  } else {
+    // tr(A B^T) = sum_i A.Row(i) . B.Row(i).
+    KALDI_ASSERT(A.NumRows() == B.NumRows() && A.NumCols() == B.NumCols());
+    for (MatrixIndexT i = 0; i < B.NumRows(); i++)
+      sum += VecSvec(A.Row(i), B.Row(i));
+  }
+  return sum;
+}
+
+
+template class SparseVector<float>;
+template class SparseVector<double>;
+template class SparseMatrix<float>;
+template class SparseMatrix<double>;
+
+template void SparseVector<float>::CopyElementsToVec(
+    VectorBase<float> *vec) const;
+template void SparseVector<float>::CopyElementsToVec(
+    VectorBase<double> *vec) const;
+template void SparseVector<double>::CopyElementsToVec(
+    VectorBase<float> *vec) const;
+template void SparseVector<double>::CopyElementsToVec(
+    VectorBase<double> *vec) const;
+
+template void SparseVector<float>::AddToVec(float alpha,
+                                            VectorBase<float> *vec) const;
+template void SparseVector<float>::AddToVec(float alpha,
+                                            VectorBase<double> *vec) const;
+template void SparseVector<double>::AddToVec(double alpha,
+                                             VectorBase<float> *vec) const;
+template void SparseVector<double>::AddToVec(double alpha,
+                                             VectorBase<double> *vec) const;
+
+template void SparseMatrix<float>::CopyToMat(MatrixBase<float> *other,
+                                             MatrixTransposeType trans) const;
+template void SparseMatrix<float>::CopyToMat(MatrixBase<double> *other,
+                                             MatrixTransposeType trans) const;
+template void SparseMatrix<double>::CopyToMat(MatrixBase<float> *other,
+                                              MatrixTransposeType trans) const;
+template void SparseMatrix<double>::CopyToMat(MatrixBase<double> *other,
+                                              MatrixTransposeType trans) const;
+
+template float VecSvec(const VectorBase<float> &vec,
+                       const SparseVector<float> &svec);
+template double VecSvec(const VectorBase<double> &vec,
+                        const SparseVector<double> &svec);
+
+template float TraceMatSmat(const MatrixBase<float> &A,
+                            const SparseMatrix<float> &B,
+                            MatrixTransposeType trans);
+template double TraceMatSmat(const MatrixBase<double> &A,
+                             const SparseMatrix<double> &B,
+                             MatrixTransposeType trans);
+
+}  // namespace kaldi
@@ -0,0 +1,168 @@
+// matrix/sparse-matrix.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_SPARSE_MATRIX_H_
+#define KALDI_MATRIX_SPARSE_MATRIX_H_ 1
+
+#include <utility>
+#include <vector>
+
+#include "matrix/matrix-common.h"
+#include "matrix/kaldi-matrix.h"
+#include "matrix/kaldi-vector.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/// A sparse vector, stored as a list of (index, value) pairs sorted on the
+/// index, with no repeated indexes.  This is useful for things like
+/// posteriors and one-hot targets, which would otherwise be expanded to
+/// vectors with thousands of zeros.
+template <typename Real>
+class SparseVector {
+ public:
+  SparseVector(): dim_(0) { }
+
+  explicit SparseVector(MatrixIndexT dim): dim_(dim) { KALDI_ASSERT(dim >= 0); }
+
+  /// The pairs may be in any order and may have repeated indexes (which are
+  /// summed); all indexes must be in the range [0, dim).
+  SparseVector(MatrixIndexT dim,
+               const std::vector<std::pair<MatrixIndexT, Real> > &pairs);
+
+  MatrixIndexT Dim() const { return dim_; }
+
+  /// Returns the number of nonzero elements (strictly, the number of stored
+  /// elements; some could be zero).
+  MatrixIndexT NumElements() const { return pairs_.size(); }
+
+  /// Returns the i'th stored element, 0 <= i < NumElements().
+  const std::pair<MatrixIndexT, Real> &GetElement(MatrixIndexT i) const {
+    return pairs_[i];
+  }
+
+  /// Returns a pointer to the stored elements, or NULL if there are none.
+  const std::pair<MatrixIndexT, Real> *Data() const {
+    return (pairs_.empty() ? NULL : &(pairs_[0]));
+  }
+
+  Real Sum() const;
+
+  /// Returns the maximum stored element and puts its index in *index; ties
+  /// are broken in favor of the lowest index.  If there are no stored
+  /// elements, returns -infinity and sets *index to -1.
+  Real Max(int32 *index) const;
+
+  /// Sets *vec (which must have dimension Dim()) to this vector.
+  template <class OtherReal>
+  void CopyElementsToVec(VectorBase<OtherReal> *vec) const;
+
+  /// Does *vec += alpha * (this vector).
+  template <class OtherReal>
+  void AddToVec(Real alpha, VectorBase<OtherReal> *vec) const;
+
+  /// Resizes to dimension "dim", and removes all elements.
+  void Resize(MatrixIndexT dim);
+
+  void Swap(SparseVector<Real> *other);
+
+  void Write(std::ostream &os, bool binary) const;
+
+  void Read(std::istream &is, bool binary);
+
+ private:
+  MatrixIndexT dim_;
+  std::vector<std::pair<MatrixIndexT, Real> > pairs_;
+};
+
+
+/// Returns the dot product of a dense and a sparse vector.
+template <typename Real>
+Real VecSvec(const VectorBase<Real> &vec, const SparseVector<Real> &svec);
+
+
+/// A sparse matrix, stored as a vector of SparseVector's, one per row.
+template <typename Real>
+class SparseMatrix {
+ public:
+  SparseMatrix() { }
+
+  /// This constructor is mostly for converting from type Posterior
+  /// (hmm/posterior.h), for which pairs[r] is the list of (column, value)
+  /// pairs for row r; there are pairs.size() rows and num_cols columns.
+  SparseMatrix(MatrixIndexT num_cols,
+               const std::vector<std::vector<std::pair<MatrixIndexT, Real> > >
+               &pairs);
+
+  MatrixIndexT NumRows() const { return rows_.size(); }
+
+  MatrixIndexT NumCols() const {
+    return (rows_.empty() ? 0 : rows_[0].Dim());
+  }
+
+  /// Returns the total number of stored elements.
+  MatrixIndexT NumElements() const;
+
+  Real Sum() const;
+
+  Real FrobeniusNorm() const;
+
+  const SparseVector<Real> &Row(MatrixIndexT r) const {
+    KALDI_ASSERT(static_cast<UnsignedMatrixIndexT>(r) < rows_.size());
+    return rows_[r];
+  }
+
+  /// Sets row r to "vec", which must have dimension NumCols().
+  void SetRow(MatrixIndexT r, const SparseVector<Real> &vec);
+
+  /// Sets *other (which must have the right dimension) to this matrix, or
+  /// its transpose if trans == kTrans.
+  template <class OtherReal>
+  void CopyToMat(MatrixBase<OtherReal> *other,
+                 MatrixTransposeType trans = kNoTrans) const;
+
+  /// Does *other += alpha * (this matrix), or its transpose if
+  /// trans == kTrans.
+  void AddToMat(Real alpha, MatrixBase<Real> *other,
+                MatrixTransposeType trans = kNoTrans) const;
+
+  /// Resizes to num_rows by num_cols, and removes all elements.
+  void Resize(MatrixIndexT num_rows, MatrixIndexT num_cols);
+
+  void Swap(SparseMatrix<Real> *other);
+
+  void Write(std::ostream &os, bool binary) const;
+
+  void Read(std::istream &is, bool binary);
+
+ private:
+  std::vector<SparseVector<Real> > rows_;
+};
+
+
+/// Returns tr(A B), or tr(A B^T) if trans == kTrans.
+template <typename Real>
+Real TraceMatSmat(const MatrixBase<Real> &A, const SparseMatrix<Real> &B,
+                  MatrixTransposeType trans = kNoTrans);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_SPARSE_MATRIX_H_
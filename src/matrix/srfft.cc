@@ -27,6 +27,9 @@
 
 #include "matrix/srfft.h"
 #include "matrix/matrix-functions.h"
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 
 namespace kaldi {
 
@@ -319,6 +322,248 @@ void SplitRadixComplexFft<Real>::ComputeRecursive(Real *xr, Real *xi, MatrixInde
   ComputeRecursive(xr + m4, xi + m4, logm-2);
 }
 
+// The following helper functions are used in the batched FFT; each operates on
+// "n" contiguous elements, which will typically be whole batches or runs of
+// batches.  They are written as simple loops so that the compiler can
+// vectorize them.
+
+// Does a <-- a + b, b <-- a - b.
+template<typename Real>
+static inline void BatchButterfly(Real *a, Real *b, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++) {
+    Real tmp = a[i] + b[i];
+    b[i] = a[i] - b[i];
+    a[i] = tmp;
+  }
+}
+
+// Does the multiplications by +/- i that appear in the radix-4 butterfly:
+// xr1 <-- xr1 + xi2, xi2 <-- xi1 + xr2, xi1 <-- xi1 - xr2, xr2 <-- xr1 - xi2.
+template<typename Real>
+static inline void BatchRotate(Real *xr1, Real *xi1, Real *xr2, Real *xi2,
+                               MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++) {
+    Real tmp1 = xr1[i] + xi2[i],
+        tmp2 = xi1[i] + xr2[i];
+    xi1[i] = xi1[i] - xr2[i];
+    xr2[i] = xr1[i] - xi2[i];
+    xr1[i] = tmp1;
+    xi2[i] = tmp2;
+  }
+}
+
+// Does the twiddle-factor multiplication of Steps 3 & 4 of the split-radix
+// algorithm, with c, spc and smc being the table entries cn, spcn and smcn.
+template<typename Real>
+static inline void BatchTwiddle(Real *xr, Real *xi, MatrixIndexT n,
+                                Real c, Real spc, Real smc) {
+  for (MatrixIndexT i = 0; i < n; i++) {
+    Real tmp2 = c * (xr[i] + xi[i]);
+    Real tmp1 = spc * xr[i] + tmp2;
+    xr[i] = smc * xi[i] + tmp2;
+    xi[i] = tmp1;
+  }
+}
+
+#ifdef __SSE__
+// SSE versions of the above for float, which do 4 elements at a time; the
+// operations are the same, so the results are identical.
+template<>
+inline void BatchButterfly(float *a, float *b, MatrixIndexT n) {
+  MatrixIndexT i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 va = _mm_loadu_ps(a + i), vb = _mm_loadu_ps(b + i);
+    _mm_storeu_ps(a + i, _mm_add_ps(va, vb));
+    _mm_storeu_ps(b + i, _mm_sub_ps(va, vb));
+  }
+  for (; i < n; i++) {
+    float tmp = a[i] + b[i];
+    b[i] = a[i] - b[i];
+    a[i] = tmp;
+  }
+}
+
+template<>
+inline void BatchRotate(float *xr1, float *xi1, float *xr2, float *xi2,
+                        MatrixIndexT n) {
+  MatrixIndexT i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 r1 = _mm_loadu_ps(xr1 + i), i1 = _mm_loadu_ps(xi1 + i),
+        r2 = _mm_loadu_ps(xr2 + i), i2 = _mm_loadu_ps(xi2 + i);
+    _mm_storeu_ps(xr1 + i, _mm_add_ps(r1, i2));
+    _mm_storeu_ps(xi2 + i, _mm_add_ps(i1, r2));
+    _mm_storeu_ps(xi1 + i, _mm_sub_ps(i1, r2));
+    _mm_storeu_ps(xr2 + i, _mm_sub_ps(r1, i2));
+  }
+  for (; i < n; i++) {
+    float tmp1 = xr1[i] + xi2[i],
+        tmp2 = xi1[i] + xr2[i];
+    xi1[i] = xi1[i] - xr2[i];
+    xr2[i] = xr1[i] - xi2[i];
+    xr1[i] = tmp1;
+    xi2[i] = tmp2;
+  }
+}
+
+template<>
+inline void BatchTwiddle(float *xr, float *xi, MatrixIndexT n,
+                         float c, float spc, float smc) {
+  __m128 vc = _mm_set1_ps(c), vspc = _mm_set1_ps(spc),
+      vsmc = _mm_set1_ps(smc);
+  MatrixIndexT i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 r = _mm_loadu_ps(xr + i), im = _mm_loadu_ps(xi + i);
+    __m128 tmp2 = _mm_mul_ps(vc, _mm_add_ps(r, im));
+    _mm_storeu_ps(xi + i, _mm_add_ps(_mm_mul_ps(vspc, r), tmp2));
+    _mm_storeu_ps(xr + i, _mm_add_ps(_mm_mul_ps(vsmc, im), tmp2));
+  }
+  for (; i < n; i++) {
+    float tmp2 = c * (xr[i] + xi[i]);
+    float tmp1 = spc * xr[i] + tmp2;
+    xr[i] = smc * xi[i] + tmp2;
+    xi[i] = tmp1;
+  }
+}
+#endif
+
+template<typename Real>
+static inline void BatchSwap(Real *a, Real *b, MatrixIndexT n) {
+  for (MatrixIndexT i = 0; i < n; i++) {
+    Real tmp = a[i];
+    a[i] = b[i];
+    b[i] = tmp;
+  }
+}
+
+template<typename Real>
+void SplitRadixComplexFft<Real>::ComputeBatch(Real *xr, Real *xi,
+                                              MatrixIndexT batch,
+                                              bool forward) const {
+  if (!forward) {  // reverse real and imaginary parts for complex FFT.
+    Real *tmp = xr;
+    xr = xi;
+    xi = tmp;
+  }
+  ComputeRecursiveBatch(xr, xi, logm_, batch);
+  if (logm_ > 1) {
+    BitReversePermuteBatch(xr, logm_, batch);
+    BitReversePermuteBatch(xi, logm_, batch);
+  }
+}
+
+// This is the same as BitReversePermute(), except it swaps whole batches.
+template<typename Real>
+void SplitRadixComplexFft<Real>::BitReversePermuteBatch(
+    Real *x, MatrixIndexT logm, MatrixIndexT batch) const {
+  MatrixIndexT      i, j, lg2, n;
+  MatrixIndexT      off, fj, gno, *brp;
+
+  lg2 = logm >> 1;
+  n = 1 << lg2;
+  if (logm & 1) lg2++;
+
+  /* Unshuffling loop */
+  for (off = 1; off < n; off++) {
+    fj = n * brseed[off]; i = off; j = fj;
+    BatchSwap(x + i * batch, x + j * batch, batch);
+    brp = &(brseed[1]);
+    for (gno = 1; gno < brseed[off]; gno++) {
+      i += n;
+      j = fj + *brp++;
+      BatchSwap(x + i * batch, x + j * batch, batch);
+    }
+  }
+}
+
+// This is the same algorithm as ComputeRecursive(), with each operation
+// applied to a whole batch; see that function for the structure.
+template<typename Real>
+void SplitRadixComplexFft<Real>::ComputeRecursiveBatch(
+    Real *xr, Real *xi, MatrixIndexT logm, MatrixIndexT batch) const {
+  MatrixIndexT    m, m2, m4, m8, nel, n, b;
+  Real    *xr1, *xr2, *xi1, *xi2;
+  Real    *cn = NULL, *spcn = NULL, *smcn = NULL,
+      *c3n = NULL, *spc3n = NULL, *smc3n = NULL;
+  Real    sqhalf = M_SQRT1_2;
+
+  if (logm < 0)
+    KALDI_ERR << "Error: logm is out of bounds in SRFFT";
+
+  /* Compute trivial cases */
+  if (logm < 3) {
+    if (logm == 2) {  /* length m = 4 */
+      BatchButterfly(xr, xr + 2 * batch, batch);
+      BatchButterfly(xi, xi + 2 * batch, batch);
+      BatchButterfly(xr + batch, xr + 3 * batch, batch);
+      BatchButterfly(xi + batch, xi + 3 * batch, batch);
+      BatchButterfly(xr, xr + batch, batch);
+      BatchButterfly(xi, xi + batch, batch);
+      BatchRotate(xr + 2 * batch, xi + 2 * batch,
+                  xr + 3 * batch, xi + 3 * batch, batch);
+    } else if (logm == 1) {   /* length m = 2 */
+      BatchButterfly(xr, xr + batch, batch);
+      BatchButterfly(xi, xi + batch, batch);
+    }
+    return;
+  }
+
+  /* Compute a few constants */
+  m = 1 << logm; m2 = m / 2; m4 = m2 / 2; m8 = m4 /2;
+
+  /* Step 1 */
+  BatchButterfly(xr, xr + m2 * batch, m2 * batch);
+  BatchButterfly(xi, xi + m2 * batch, m2 * batch);
+
+  /* Step 2 */
+  BatchRotate(xr + m2 * batch, xi + m2 * batch,
+              xr + (m2 + m4) * batch, xi + (m2 + m4) * batch, m4 * batch);
+
+  /* Steps 3 & 4 */
+  if (logm >= 4) {
+    nel = m4 - 2;
+    cn  = tab[logm-4]; spcn  = cn + nel;  smcn  = spcn + nel;
+    c3n = smcn + nel;  spc3n = c3n + nel; smc3n = spc3n + nel;
+  }
+  for (n = 1; n < m4; n++) {
+    xr1 = xr + (m2 + n) * batch; xr2 = xr1 + m4 * batch;
+    xi1 = xi + (m2 + n) * batch; xi2 = xi1 + m4 * batch;
+    if (n == m8) {
+      for (b = 0; b < batch; b++) {
+        Real tmp1 =  sqhalf * (xr1[b] + xi1[b]);
+        xi1[b] =  sqhalf * (xi1[b] - xr1[b]);
+        xr1[b] =  tmp1;
+        Real tmp2 =  sqhalf * (xi2[b] - xr2[b]);
+        xi2[b] = -sqhalf * (xr2[b] + xi2[b]);
+        xr2[b] =  tmp2;
+      }
+    } else {
+      BatchTwiddle(xr1, xi1, batch, *cn++, *spcn++, *smcn++);
+      BatchTwiddle(xr2, xi2, batch, *c3n++, *spc3n++, *smc3n++);
+    }
+  }
+
+  ComputeRecursiveBatch(xr, xi, logm-1, batch);
+  ComputeRecursiveBatch(xr + m2 * batch, xi + m2 * batch, logm-2, batch);
+  m4 = 3 * (m / 4);
+  ComputeRecursiveBatch(xr + m4 * batch, xi + m4 * batch, logm-2, batch);
+}
+
+template<typename Real>
+SplitRadixRealFft<Real>::SplitRadixRealFft(MatrixIndexT N):
+    SplitRadixComplexFft<Real>(N/2), N_(N) {
+  // Compute the twiddle factors the same way Compute(Real*, bool) does, so
+  // that the batched version gives the same answer.
+  MatrixIndexT N2 = N/2;
+  Real rootN_re, rootN_im;
+  ComplexImExp(static_cast<Real>(-M_2PI/N), &rootN_re, &rootN_im);
+  Real kN_re = 1.0, kN_im = 0.0;
+  for (MatrixIndexT k = 1; 2*k <= N2; k++) {
+    ComplexMul(rootN_re, rootN_im, &kN_re, &kN_im);
+    twiddle_re_.push_back(kN_re);
+    twiddle_im_.push_back(kN_im);
+  }
+}
+
 // This code is mostly the same as the RealFft function.  It would be
 // possible to replace it with more efficient code from Rico's book.
 template<typename Real>
@@ -391,6 +636,88 @@ void SplitRadixRealFft<Real>::Compute(Real *data, bool forward) {
   }
 }
 
+template<typename Real>
+void SplitRadixRealFft<Real>::ComputeRealStepBatch(Real *xr, Real *xi,
+                                                   MatrixIndexT batch,
+                                                   bool forward) const {
+  // This is the same computation as in Compute(Real*, bool); see the comments
+  // there.  Note: in the backward direction, the twiddle factor is
+  // exp(2pi k/N) times -1, i.e. -conj(the forward one).
+  MatrixIndexT N2 = N_/2;
+  for (MatrixIndexT k = 1; 2*k <= N2; k++) {
+    Real kN_re = twiddle_re_[k-1], kN_im = twiddle_im_[k-1];
+    if (!forward) kN_re = -kN_re;
+    MatrixIndexT kdash = N2 - k;
+    Real *xr_k = xr + k * batch, *xi_k = xi + k * batch,
+        *xr_kdash = xr + kdash * batch, *xi_kdash = xi + kdash * batch;
+    for (MatrixIndexT b = 0; b < batch; b++) {
+      Real Ck_re = 0.5 * (xr_k[b] + xr_kdash[b]),
+          Ck_im = 0.5 * (xi_k[b] - xi_kdash[b]),
+          Dk_re = 0.5 * (xi_k[b] + xi_kdash[b]),
+          Dk_im = -0.5 * (xr_k[b] - xr_kdash[b]);
+      xr_k[b] = Ck_re;
+      xi_k[b] = Ck_im;
+      ComplexAddProduct(Dk_re, Dk_im, kN_re, kN_im, xr_k + b, xi_k + b);
+      if (kdash != k) {
+        xr_kdash[b] = Ck_re;
+        xi_kdash[b] = -Ck_im;
+        ComplexAddProduct(Dk_re, -Dk_im, -kN_re, kN_im,
+                          xr_kdash + b, xi_kdash + b);
+      }
+    }
+  }
+  for (MatrixIndexT b = 0; b < batch; b++) {  // Now handle k = 0.
+    Real zeroth = xr[b] + xi[b],
+        n2th = xr[b] - xi[b];
+    xr[b] = zeroth;
+    xi[b] = n2th;
+    if (!forward) {
+      xr[b] /= 2;
+      xi[b] /= 2;
+    }
+  }
+}
+
+template<typename Real>
+void SplitRadixRealFft<Real>::Compute(MatrixBase<Real> *frames, bool forward) {
+  KALDI_ASSERT(frames->NumCols() == N_);
+  // The batch size is a compromise between vectorization and keeping the
+  // buffer in cache; 16 frames of a 512-point FFT use 32KB.
+  const MatrixIndexT kMaxBatch = 16;
+  MatrixIndexT N2 = N_/2, num_rows = frames->NumRows();
+  batch_buffer_.resize(N_ * kMaxBatch);
+
+  for (MatrixIndexT start = 0; start < num_rows; start += kMaxBatch) {
+    MatrixIndexT batch = std::min(kMaxBatch, num_rows - start);
+    Real *xr = &(batch_buffer_[0]), *xi = xr + N2 * batch;
+    // Rearrange into the batched format; the even-numbered elements are the
+    // real parts and the odd-numbered ones the imaginary parts.
+    for (MatrixIndexT b = 0; b < batch; b++) {
+      const Real *row = frames->RowData(start + b);
+      for (MatrixIndexT k = 0; k < N2; k++) {
+        xr[k * batch + b] = row[2*k];
+        xi[k * batch + b] = row[2*k + 1];
+      }
+    }
+    if (forward) {
+      this->ComputeBatch(xr, xi, batch, true);
+      ComputeRealStepBatch(xr, xi, batch, true);
+    } else {
+      ComputeRealStepBatch(xr, xi, batch, false);
+      this->ComputeBatch(xr, xi, batch, false);
+    }
+    // See Compute(Real*, bool) for why we scale by 2 in the backward case.
+    Real scale = (forward ? 1.0 : 2.0);
+    for (MatrixIndexT b = 0; b < batch; b++) {
+      Real *row = frames->RowData(start + b);
+      for (MatrixIndexT k = 0; k < N2; k++) {
+        row[2*k] = scale * xr[k * batch + b];
+        row[2*k + 1] = scale * xi[k * batch + b];
+      }
+    }
+  }
+}
+
 template class SplitRadixComplexFft<float>;
 template class SplitRadixComplexFft<double>;
 template class SplitRadixRealFft<float>;
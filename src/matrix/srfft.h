@@ -63,11 +63,22 @@ class SplitRadixComplexFft {
   // same as the version above.
   void Compute(Real *x, bool forward);
 
+  // This version does the FFT of "batch" sequences at once.  The data is
+  // stored interleaved by sequence: the n'th point of sequence b is at
+  // xr[n * batch + b] (real part) and xi[n * batch + b] (imaginary part), so
+  // xr and xi are arrays of size N * batch.  The innermost loops are over the
+  // batch, which lets the compiler vectorize the butterflies; it's faster than
+  // calling the single-sequence Compute() batch times.
+  void ComputeBatch(Real *xr, Real *xi, Integer batch, bool forward) const;
+
   ~SplitRadixComplexFft();
  private:
   void ComputeTables();
   void ComputeRecursive(Real *xr, Real *xi, Integer logm) const;
   void BitReversePermute(Real *x, Integer logm) const;
+  void ComputeRecursiveBatch(Real *xr, Real *xi, Integer logm,
+                             Integer batch) const;
+  void BitReversePermuteBatch(Real *x, Integer logm, Integer batch) const;
 
   Integer N_;
   Integer logm_;  // log(N) [a slight mismatch in notation which we have not
@@ -86,8 +97,7 @@ class SplitRadixComplexFft {
 template<typename Real>
 class SplitRadixRealFft: private SplitRadixComplexFft<Real> {
  public:
-  SplitRadixRealFft(MatrixIndexT N):  // will fail unless N>=4 and N is a power of 2.
-      SplitRadixComplexFft<Real> (N/2), N_(N) { }
+  SplitRadixRealFft(MatrixIndexT N);  // will fail unless N>=4 and N is a power of 2.
 
   /// If forward == true, this function transforms from a sequence of N real points to its complex fourier
   /// transform; otherwise it goes in the reverse direction.  If you call it
@@ -97,8 +107,26 @@ class SplitRadixRealFft: private SplitRadixComplexFft<Real> {
   /// is a sequence of complex numbers C_n of length N/2 with (real, im) format,
   /// i.e. [real0, real_{N/2}, real1, im1, real2, im2, real3, im3, ...].
   void Compute(Real *x, bool forward);
+
+  /// This does the same as calling Compute(frames->RowData(i), forward) for
+  /// each row i of "frames" (which must have N columns), but the rows are
+  /// transformed in batches using SplitRadixComplexFft::ComputeBatch(), which
+  /// is a lot faster when there are many rows, e.g. the windowed frames of a
+  /// file in feature extraction.
+  void Compute(MatrixBase<Real> *frames, bool forward);
  private:
+  // Does the step that converts between the N/2-point complex FFT and the
+  // N-point real FFT, for data in the batched format of
+  // SplitRadixComplexFft::ComputeBatch().
+  void ComputeRealStepBatch(Real *xr, Real *xi, MatrixIndexT batch,
+                            bool forward) const;
+
   int N_;
+  // The twiddle factors exp(-2 pi i k / N) used in the forward transform, for
+  // 0 < k <= N/4; computed once in the constructor.
+  std::vector<Real> twiddle_re_;
+  std::vector<Real> twiddle_im_;
+  std::vector<Real> batch_buffer_;  // Used in the batched Compute().
 };
 
 
@@ -0,0 +1,248 @@
+// matrix/threaded-blas.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <algorithm>
+#include <vector>
+
+#include "matrix/threaded-blas.h"
+#include "matrix/cblas-wrappers.h"
+
+namespace kaldi {
+
+static int32 g_num_blas_threads = 1;
+
+void SetNumBlasThreads(int32 num_threads) {
+  KALDI_ASSERT(num_threads > 0);
+  g_num_blas_threads = num_threads;
+}
+
+int32 GetNumBlasThreads() { return g_num_blas_threads; }
+
+#if !defined(HAVE_MKL) && !defined(HAVE_OPENBLAS)
+
+// Size of the blocks of the output, and of the panels of the inner dimension.
+static const MatrixIndexT kBlasBlockSize = 256;
+
+// Products smaller than this (in multiply-adds) are not worth starting
+// threads for.
+static const double kMinThreadedBlasWork = 1.0e+06;
+
+template<typename Real>
+struct ThreadedBlasTask {
+  bool syrk;  // If true, only the lower triangle of blocks is computed, B is
+              // the same as A, and the diagonal blocks use syrk.
+  MatrixTransposeType transA, transB;
+  const Real *A;
+  MatrixIndexT a_stride;
+  const Real *B;
+  MatrixIndexT b_stride;
+  Real *C;
+  MatrixIndexT c_stride;
+  MatrixIndexT num_rows, num_cols, inner_dim;
+  Real alpha, beta;
+  int32 thread_id, num_threads;
+};
+
+// Computes the block of the output with rows r0 ... r0 + nr - 1 and columns c0
+// ... c0 + nc - 1.
+template<typename Real>
+static void ComputeBlasBlock(const ThreadedBlasTask<Real> &t,
+                             MatrixIndexT r0, MatrixIndexT nr,
+                             MatrixIndexT c0, MatrixIndexT nc) {
+  Real *Cp = t.C + r0 * t.c_stride + c0;
+  for (MatrixIndexT k0 = 0; k0 < t.inner_dim; k0 += kBlasBlockSize) {
+    MatrixIndexT nk = std::min(kBlasBlockSize, t.inner_dim - k0);
+    Real beta = (k0 == 0 ? t.beta : 1.0);
+    const Real *Ap = (t.transA == kNoTrans ? t.A + r0 * t.a_stride + k0 :
+                      t.A + k0 * t.a_stride + r0);
+    bool use_syrk = (t.syrk && r0 == c0);
+#ifdef HAVE_ATLAS
+    // See the comment in MatrixBase::SymAddMat2() about ATLAS's syrk.
+    if (t.transA == kTrans && nr >= 56) use_syrk = false;
+#endif
+    if (use_syrk) {
+      cblas_Xsyrk(t.transA, nr, nk, t.alpha, Ap, t.a_stride, beta,
+                  Cp, t.c_stride);
+    } else {
+      const Real *Bp = (t.transB == kNoTrans ? t.B + k0 * t.b_stride + c0 :
+                        t.B + c0 * t.b_stride + k0);
+      cblas_Xgemm(t.alpha, t.transA, Ap,
+                  (t.transA == kNoTrans ? nr : nk),
+                  (t.transA == kNoTrans ? nk : nr), t.a_stride,
+                  t.transB, Bp, t.b_stride, beta, Cp, nr, nc, t.c_stride);
+    }
+  }
+}
+
+// Processes this thread's share of the blocks, which are dealt out to the
+// threads in turn.
+template<typename Real>
+static void *RunThreadedBlasTask(void *arg) {
+  const ThreadedBlasTask<Real> &t = *static_cast<ThreadedBlasTask<Real>*>(arg);
+  MatrixIndexT num_row_blocks = (t.num_rows + kBlasBlockSize - 1) / kBlasBlockSize,
+      num_col_blocks = (t.num_cols + kBlasBlockSize - 1) / kBlasBlockSize;
+  int32 block_index = 0;
+  for (MatrixIndexT i = 0; i < num_row_blocks; i++) {
+    MatrixIndexT r0 = i * kBlasBlockSize,
+        nr = std::min(kBlasBlockSize, t.num_rows - r0);
+    for (MatrixIndexT j = 0; j < (t.syrk ? i + 1 : num_col_blocks); j++) {
+      if (block_index++ % t.num_threads != t.thread_id) continue;
+      MatrixIndexT c0 = j * kBlasBlockSize,
+          nc = std::min(kBlasBlockSize, t.num_cols - c0);
+      ComputeBlasBlock(t, r0, nr, c0, nc);
+    }
+  }
+  return NULL;
+}
+
+// Returns the number of threads to use for an output of this size.
+static int32 NumBlasThreadsFor(MatrixIndexT num_rows, MatrixIndexT num_cols,
+                               MatrixIndexT inner_dim, bool syrk) {
+  if (g_num_blas_threads <= 1 || inner_dim == 0) return 1;
+  double work = static_cast<double>(num_rows) * num_cols * inner_dim;
+  if (syrk) work *= 0.5;
+  if (work < kMinThreadedBlasWork) return 1;
+  MatrixIndexT num_row_blocks = (num_rows + kBlasBlockSize - 1) / kBlasBlockSize,
+      num_col_blocks = (num_cols + kBlasBlockSize - 1) / kBlasBlockSize,
+      num_blocks = (syrk ? num_row_blocks * (num_row_blocks + 1) / 2 :
+                    num_row_blocks * num_col_blocks);
+  return std::min<int32>(g_num_blas_threads, num_blocks);
+}
+
+template<typename Real>
+static void RunThreadedBlas(const ThreadedBlasTask<Real> &task,
+                            int32 num_threads) {
+  std::vector<ThreadedBlasTask<Real> > tasks(num_threads, task);
+  std::vector<pthread_t> threads(num_threads);
+  for (int32 i = 0; i < num_threads; i++) {
+    tasks[i].thread_id = i;
+    tasks[i].num_threads = num_threads;
+  }
+  // Thread zero's share is done in this thread.
+  for (int32 i = 1; i < num_threads; i++) {
+    int32 ret = pthread_create(&(threads[i]), NULL, RunThreadedBlasTask<Real>,
+                               static_cast<void*>(&(tasks[i])));
+    if (ret != 0)
+      KALDI_ERR << "Error creating thread, errno was: " << ret;
+  }
+  RunThreadedBlasTask<Real>(static_cast<void*>(&(tasks[0])));
+  for (int32 i = 1; i < num_threads; i++)
+    if (pthread_join(threads[i], NULL))
+      KALDI_ERR << "Error rejoining thread.";
+}
+
+#endif  // !defined(HAVE_MKL) && !defined(HAVE_OPENBLAS)
+
+template<typename Real>
+void ThreadedXgemm(const Real alpha,
+                   MatrixTransposeType transA,
+                   const Real *Adata,
+                   MatrixIndexT a_num_rows, MatrixIndexT a_num_cols,
+                   MatrixIndexT a_stride,
+                   MatrixTransposeType transB,
+                   const Real *Bdata, MatrixIndexT b_stride,
+                   const Real beta,
+                   Real *Mdata,
+                   MatrixIndexT num_rows, MatrixIndexT num_cols,
+                   MatrixIndexT stride) {
+#if !defined(HAVE_MKL) && !defined(HAVE_OPENBLAS)
+  MatrixIndexT inner_dim = (transA == kNoTrans ? a_num_cols : a_num_rows);
+  int32 num_threads = NumBlasThreadsFor(num_rows, num_cols, inner_dim, false);
+  if (num_threads > 1) {
+    ThreadedBlasTask<Real> task;
+    task.syrk = false;
+    task.transA = transA;
+    task.transB = transB;
+    task.A = Adata;
+    task.a_stride = a_stride;
+    task.B = Bdata;
+    task.b_stride = b_stride;
+    task.C = Mdata;
+    task.c_stride = stride;
+    task.num_rows = num_rows;
+    task.num_cols = num_cols;
+    task.inner_dim = inner_dim;
+    task.alpha = alpha;
+    task.beta = beta;
+    RunThreadedBlas(task, num_threads);
+    return;
+  }
+#endif
+  cblas_Xgemm(alpha, transA, Adata, a_num_rows, a_num_cols, a_stride,
+              transB, Bdata, b_stride, beta, Mdata, num_rows, num_cols, stride);
+}
+
+template<typename Real>
+void ThreadedXsyrk(const MatrixTransposeType trans, const MatrixIndexT dim_c,
+                   const MatrixIndexT other_dim_a, const Real alpha,
+                   const Real *A, const MatrixIndexT a_stride,
+                   const Real beta, Real *C, const MatrixIndexT c_stride) {
+#if !defined(HAVE_MKL) && !defined(HAVE_OPENBLAS)
+  int32 num_threads = NumBlasThreadsFor(dim_c, dim_c, other_dim_a, true);
+  if (num_threads > 1) {
+    ThreadedBlasTask<Real> task;
+    task.syrk = true;
+    task.transA = trans;
+    task.transB = (trans == kNoTrans ? kTrans : kNoTrans);
+    task.A = A;
+    task.a_stride = a_stride;
+    task.B = A;
+    task.b_stride = a_stride;
+    task.C = C;
+    task.c_stride = c_stride;
+    task.num_rows = dim_c;
+    task.num_cols = dim_c;
+    task.inner_dim = other_dim_a;
+    task.alpha = alpha;
+    task.beta = beta;
+    RunThreadedBlas(task, num_threads);
+    return;
+  }
+#endif
+  cblas_Xsyrk(trans, dim_c, other_dim_a, alpha, A, a_stride, beta,
+              C, c_stride);
+}
+
+template
+void ThreadedXgemm(const float alpha, MatrixTransposeType transA,
+                   const float *Adata, MatrixIndexT a_num_rows,
+                   MatrixIndexT a_num_cols, MatrixIndexT a_stride,
+                   MatrixTransposeType transB, const float *Bdata,
+                   MatrixIndexT b_stride, const float beta, float *Mdata,
+                   MatrixIndexT num_rows, MatrixIndexT num_cols,
+                   MatrixIndexT stride);
+template
+void ThreadedXgemm(const double alpha, MatrixTransposeType transA,
+                   const double *Adata, MatrixIndexT a_num_rows,
+                   MatrixIndexT a_num_cols, MatrixIndexT a_stride,
+                   MatrixTransposeType transB, const double *Bdata,
+                   MatrixIndexT b_stride, const double beta, double *Mdata,
+                   MatrixIndexT num_rows, MatrixIndexT num_cols,
+                   MatrixIndexT stride);
+template
+void ThreadedXsyrk(const MatrixTransposeType trans, const MatrixIndexT dim_c,
+                   const MatrixIndexT other_dim_a, const float alpha,
+                   const float *A, const MatrixIndexT a_stride,
+                   const float beta, float *C, const MatrixIndexT c_stride);
+template
+void ThreadedXsyrk(const MatrixTransposeType trans, const MatrixIndexT dim_c,
+                   const MatrixIndexT other_dim_a, const double alpha,
+                   const double *A, const MatrixIndexT a_stride,
+                   const double beta, double *C, const MatrixIndexT c_stride);
+
+}  // namespace kaldi
@@ -0,0 +1,70 @@
+// matrix/threaded-blas.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_THREADED_BLAS_H_
+#define KALDI_MATRIX_THREADED_BLAS_H_ 1
+
+#include "matrix/matrix-common.h"
+
+// This header provides multi-threaded versions of the GEMM and SYRK
+// operations, which are used by MatrixBase::AddMatMat(),
+// MatrixBase::SymAddMat2() and SpMatrix::AddMat2().  They exist for builds
+// against a single-threaded BLAS (ATLAS or CLAPACK); with MKL or OpenBLAS,
+// which do their own threading, they just call the BLAS directly.
+//
+// The output matrix is divided into blocks of kBlasBlockSize x kBlasBlockSize,
+// which are shared out among the threads; each block is computed as a sequence
+// of BLAS calls over panels of kBlasBlockSize of the inner dimension, so the
+// operands of each call fit in cache even if the BLAS itself is unblocked.
+
+namespace kaldi {
+
+/// Sets the number of threads used by ThreadedXgemm() and ThreadedXsyrk().
+/// The default is 1, which means the BLAS is always called directly.  This
+/// has no effect when compiled with HAVE_MKL or HAVE_OPENBLAS.
+void SetNumBlasThreads(int32 num_threads);
+
+/// Returns the number of threads set by SetNumBlasThreads().
+int32 GetNumBlasThreads();
+
+/// Same interface as cblas_Xgemm() in cblas-wrappers.h:
+/// M = alpha * op(A) * op(B) + beta * M.
+template<typename Real>
+void ThreadedXgemm(const Real alpha,
+                   MatrixTransposeType transA,
+                   const Real *Adata,
+                   MatrixIndexT a_num_rows, MatrixIndexT a_num_cols,
+                   MatrixIndexT a_stride,
+                   MatrixTransposeType transB,
+                   const Real *Bdata, MatrixIndexT b_stride,
+                   const Real beta,
+                   Real *Mdata,
+                   MatrixIndexT num_rows, MatrixIndexT num_cols,
+                   MatrixIndexT stride);
+
+/// Same interface as cblas_Xsyrk() in cblas-wrappers.h: if trans == kNoTrans,
+/// C = alpha A A^T + beta C, else C = alpha A^T A + beta C.  Only the lower
+/// triangle of C is guaranteed to be updated.
+template<typename Real>
+void ThreadedXsyrk(const MatrixTransposeType trans, const MatrixIndexT dim_c,
+                   const MatrixIndexT other_dim_a, const Real alpha,
+                   const Real *A, const MatrixIndexT a_stride,
+                   const Real beta, Real *C, const MatrixIndexT c_stride);
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_THREADED_BLAS_H_
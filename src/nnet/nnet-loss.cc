@@ -20,6 +20,7 @@
 #include "nnet/nnet-loss.h"
 #include "cudamatrix/cu-math.h"
 #include "hmm/posterior.h"
+#include "matrix/sparse-matrix.h"
 
 #include <sstream>
 #include <iterator>
@@ -47,7 +48,7 @@ void Xent::Eval(const CuMatrix<BaseFloat> &net_out, const CuMatrix<BaseFloat> &t
   // calculate cross_entropy (in GPU)
   xentropy_aux_ = net_out; // y
   xentropy_aux_.ApplyLog(); // log(y)
-  xentropy_aux_.MulElements(tgt_mat_device_); // t*log(y)
+  xentropy_aux_.MulElements(target); // t*log(y)
   log_post_tgt_.Resize(num_frames);
   log_post_tgt_.AddColSumMat(1.0,xentropy_aux_,0.0); // sum over cols (pdfs)
   log_post_tgt_host_.Resize(num_frames);
@@ -58,7 +59,7 @@ void Xent::Eval(const CuMatrix<BaseFloat> &net_out, const CuMatrix<BaseFloat> &t
   xentropy_aux_ = target; // t
   xentropy_aux_.Add(1e-99); // avoid log(0)
   xentropy_aux_.ApplyLog(); // log(t)
-  xentropy_aux_.MulElements(tgt_mat_device_); // t*log(t)
+  xentropy_aux_.MulElements(target); // t*log(t)
   log_post_tgt_.Resize(num_frames);
   log_post_tgt_.AddColSumMat(1.0,xentropy_aux_,0.0); // sum over cols (pdfs)
   log_post_tgt_host_.Resize(num_frames);
@@ -76,8 +77,7 @@ void Xent::Eval(const CuMatrix<BaseFloat>& net_out, const Posterior& post, CuMat
     num_pdf = net_out.NumCols();
   KALDI_ASSERT(num_frames == post.size());
 
-  // convert posterior to matrix
-  Matrix<BaseFloat> tgt_mat_host(num_frames, num_pdf, kSetZero); // zero-filled
+  // check the pdf-ids
   for (int32 t = 0; t < post.size(); t++) {
     for (int32 i = 0; i < post[t].size(); i++) {
       int32 pdf = post[t][i].first;
@@ -85,23 +85,37 @@ void Xent::Eval(const CuMatrix<BaseFloat>& net_out, const Posterior& post, CuMat
         KALDI_ERR << "Posterior pdf-id out of NN-output dimension, please check number of pdfs by 'hmm-info'."
                   << " nn-outputs : " << num_pdf << ", posterior pdf-id : " << pdf;
       }
-      tgt_mat_host(t, pdf) += post[t][i].second;
     }
   }
-  tgt_mat_device_ = tgt_mat_host; // -> GPU
+  // convert posterior to a sparse matrix (this merges repeated pdf-ids),
+  // and get the list of non-zero targets
+  SparseMatrix<BaseFloat> tgt_mat(num_pdf, post);
+  int32 num_elements = tgt_mat.NumElements();
+  tgt_elements_.resize(num_elements);
+  tgt_indices_.resize(num_elements);
+  max_id_tgt_host_.resize(num_frames);
+  for (int32 t = 0, n = 0; t < num_frames; t++) {
+    const SparseVector<BaseFloat> &row = tgt_mat.Row(t);
+    for (int32 i = 0; i < row.NumElements(); i++, n++) {
+      tgt_elements_[n].row = tgt_indices_[n].first = t;
+      tgt_elements_[n].column = tgt_indices_[n].second = row.GetElement(i).first;
+      tgt_elements_[n].weight = row.GetElement(i).second;
+    }
+    // frames without targets count as pdf 0, like the all-zero dense row.
+    row.Max(&(max_id_tgt_host_[t]));
+    if (max_id_tgt_host_[t] == -1) max_id_tgt_host_[t] = 0;
+  }
 
-  // compute derivaitve w.r.t. pre-softmax activation (net_out - tgt)
+  // compute derivaitve w.r.t. pre-softmax activation (net_out - tgt),
+  // touching only the non-zero targets
   *diff = net_out;
-  diff->AddMat(-1.0, tgt_mat_device_);
+  diff->AddElements(-1.0, tgt_elements_);
 
   // evaluate the frame-level classification
   int32 correct=0;
   net_out.FindRowMaxId(&max_id_out_); // find max in nn-output
-  tgt_mat_device_.FindRowMaxId(&max_id_tgt_); // find max in targets
   max_id_out_host_.resize(num_frames);
-  max_id_tgt_host_.resize(num_frames);
   max_id_out_.CopyToVec(&max_id_out_host_);
-  max_id_tgt_.CopyToVec(&max_id_tgt_host_);
   // count frames where maxima match
   for(int32 i=0; i<num_frames; i++) {
     if (max_id_tgt_host_[i] == max_id_out_host_[i]) correct++;
@@ -109,16 +123,12 @@ void Xent::Eval(const CuMatrix<BaseFloat>& net_out, const Posterior& post, CuMat
   // TODO calculate phone-level accuracy,
   // need to get shuffled phone-ids externally ...
 
-  // calculate cross_entropy (in GPU)
-  xentropy_aux_ = net_out; // y
-  xentropy_aux_.Add(1e-20); // avoid -inf
-  xentropy_aux_.ApplyLog(); // log(y)
-  xentropy_aux_.MulElements(tgt_mat_device_); // t*log(y)
-  log_post_tgt_.Resize(num_frames);
-  log_post_tgt_.AddColSumMat(1.0,xentropy_aux_,0.0); // sum over cols (pdfs)
-  log_post_tgt_host_.Resize(num_frames);
-  log_post_tgt_.CopyToVec(&log_post_tgt_host_);
-  double cross_entropy = -log_post_tgt_host_.Sum(); // sum over rows (frames)
+  // calculate cross_entropy, -sum t*log(y), from the outputs at the
+  // non-zero targets only
+  net_out.Lookup(tgt_indices_, &tgt_net_out_);
+  double cross_entropy = 0.0;
+  for (int32 n = 0; n < num_elements; n++)
+    cross_entropy -= tgt_elements_[n].weight * log(tgt_net_out_[n] + 1e-20);
 
   // calculate entropy (from Posterior)
   double entropy = 0.0;
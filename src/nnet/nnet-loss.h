@@ -66,13 +66,16 @@ class Xent {
 
   CuVector<BaseFloat> log_post_tgt_;
   Vector<BaseFloat>   log_post_tgt_host_;
-  CuMatrix<BaseFloat> tgt_mat_device_;
   CuMatrix<BaseFloat> xentropy_aux_;
 
+  // sparse targets (from posteriors)
+  std::vector<MatrixElement<BaseFloat> > tgt_elements_;
+  std::vector<Int32Pair> tgt_indices_;
+  std::vector<BaseFloat> tgt_net_out_;
+
   // frame classification buffers 
   CuArray<int32> max_id_out_;
   std::vector<int32> max_id_out_host_;
-  CuArray<int32> max_id_tgt_;
   std::vector<int32> max_id_tgt_host_;
 
 };
@@ -48,6 +48,7 @@ static void ProcessFile(const MatrixBase<BaseFloat> &feats,
                         int32 left_context,
                         int32 right_context,
                         BaseFloat keep_proportion,
+                        CompressionMethod compression_method,
                         int64 *num_frames_written,
                         NnetExampleWriter *example_writer) {
   KALDI_ASSERT(feats.NumRows() == static_cast<int32>(pdf_post.size()));
@@ -70,7 +71,7 @@ static void ProcessFile(const MatrixBase<BaseFloat> &feats,
         dest.CopyFromVec(src);
       }
       eg.labels = pdf_post[i];
-      eg.input_frames = input_frames;
+      eg.input_frames.CopyFromMat(input_frames, compression_method);
       std::ostringstream os;
       os << ((*num_frames_written)++);
       std::string key = os.str(); // key in the archive is the number of the
@@ -116,6 +117,7 @@ int main(int argc, char *argv[]) {
     int32 left_context = 0, right_context = 0;
     int32 srand_seed = 0;
     BaseFloat keep_proportion = 1.0;
+    int32 compression_method_in = 1;
     
     std::string spk_vecs_rspecifier, utt2spk_rspecifier;
     
@@ -133,6 +135,11 @@ int main(int argc, char *argv[]) {
                 "of times equal to floor(keep-proportion) or ceil(keep-proportion).");
     po.Register("srand", &srand_seed, "Seed for random number generator "
                 "(only relevant if --keep-proportion != 1.0)");
+    po.Register("compression-method", &compression_method_in, "Method (1, 2 "
+                "or 3) used to compress the input frames of each example; "
+                "2 (per-row linear) gives smaller examples than the default "
+                "when there are few frames.  See CompressionMethod in "
+                "matrix/compressed-matrix.h");
     
     po.Read(argc, argv);
 
@@ -143,6 +150,12 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    if (compression_method_in < kSpeechFeature ||
+        compression_method_in > kEntropyCodedFeature)
+      KALDI_ERR << "Invalid --compression-method=" << compression_method_in;
+    CompressionMethod compression_method =
+        static_cast<CompressionMethod>(compression_method_in);
+
     std::string feature_rspecifier = po.GetArg(1),
         pdf_post_rspecifier = po.GetArg(2),
         examples_wspecifier = po.GetArg(3);
@@ -193,7 +206,7 @@ int main(int argc, char *argv[]) {
         }
         ProcessFile(feats, pdf_post, spk_info,
                     left_context, right_context, keep_proportion,
-                    &num_frames_written, &example_writer);
+                    compression_method, &num_frames_written, &example_writer);
         num_done++;
       }
     }
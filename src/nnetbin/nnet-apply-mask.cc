@@ -0,0 +1,310 @@
+// nnetbin/nnet-apply-mask.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/timer.h"
+#include "feat/feature-mfcc.h"
+#include "feat/feature-task.h"
+#include "feat/mask-targets.h"
+#include "nnet/nnet-nnet.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-task-sequence.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+// Copies of the network for the threads: Nnet::Feedforward() uses buffers
+// inside the Nnet, so each copy may only be used by one thread at a time.
+// There are never more copies than threads running at once.
+class NnetPool {
+ public:
+  // Takes ownership of "nnet".
+  explicit NnetPool(Nnet *nnet): nnet_(nnet) { free_.push_back(nnet); }
+
+  Nnet *Acquire() {
+    mutex_.Lock();
+    Nnet *ans;
+    if (free_.empty()) {
+      ans = new Nnet(*nnet_);
+      copies_.push_back(ans);
+    } else {
+      ans = free_.back();
+      free_.pop_back();
+    }
+    mutex_.Unlock();
+    return ans;
+  }
+
+  void Release(Nnet *nnet) {
+    mutex_.Lock();
+    free_.push_back(nnet);
+    mutex_.Unlock();
+  }
+
+  ~NnetPool() {
+    delete nnet_;
+    for (size_t i = 0; i < copies_.size(); i++)
+      delete copies_[i];
+  }
+
+ private:
+  Nnet *nnet_;
+  std::vector<Nnet*> copies_;
+  std::vector<Nnet*> free_;
+  Mutex mutex_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NnetPool);
+};
+
+// How the network outputs are turned into masks and applied; shared by all
+// the tasks.
+struct MaskConfig {
+  MaskTargetType mask_type;  // Not kSnr.
+  const MaskTargetComputer *computer;
+  BaseFloat mask_floor;
+  bool log_domain;  // If true, the features are log-filterbank energies.
+  FeatureComputerPool<Mfcc> *mfcc_pool;  // If non-NULL, output MFCCs.
+};
+
+// Runs the network on the features of one utterance and applies the mask.
+class MaskTask {
+ public:
+  MaskTask(const MaskConfig &config, NnetPool *pool, const std::string &utt,
+           const MatrixBase<BaseFloat> &feats,
+           BaseFloatMatrixWriter *feats_writer,
+           BaseFloatMatrixWriter *mask_writer, int32 *num_success):
+      config_(config), pool_(pool), utt_(utt), feats_(feats),
+      feats_writer_(feats_writer), mask_writer_(mask_writer),
+      num_success_(num_success), ok_(false) { }
+
+  void operator () () {
+    Nnet *nnet = pool_->Acquire();
+    Mfcc *mfcc = (config_.mfcc_pool != NULL ? config_.mfcc_pool->Acquire() :
+                  NULL);
+    try {
+      CuMatrix<BaseFloat> nnet_out;
+      nnet->Feedforward(CuMatrix<BaseFloat>(feats_), &nnet_out);
+      if (nnet_out.NumRows() != feats_.NumRows())
+        KALDI_ERR << "Network gives " << nnet_out.NumRows() << " frames for "
+                  << feats_.NumRows() << " input frames.";
+      mask_.Resize(nnet_out.NumRows(), nnet_out.NumCols(), kUndefined);
+      nnet_out.CopyToMat(&mask_);
+
+      // Work out the log of the mask.
+      config_.computer->ToLogMask(config_.mask_type, &mask_);
+      if (config_.mask_floor > 0.0)
+        mask_.ApplyFloor(Log(config_.mask_floor));
+
+      if (config_.log_domain) {
+        feats_.AddMat(1.0, mask_);
+      } else {
+        Matrix<BaseFloat> mask(mask_);
+        mask.ApplyExp();
+        feats_.MulElements(mask);
+      }
+
+      if (mfcc != NULL) {
+        Matrix<BaseFloat> log_fbank;
+        log_fbank.Swap(&feats_);
+        if (!config_.log_domain) {
+          // As in Fbank::Compute().
+          log_fbank.ApplyFloor(std::numeric_limits<BaseFloat>::epsilon());
+          log_fbank.ApplyLog();
+        }
+        mfcc->ComputeFromFbank(log_fbank, &feats_);
+      }
+      ok_ = true;
+    } catch (...) {
+      ok_ = false;
+    }
+    pool_->Release(nnet);
+    if (mfcc != NULL)
+      config_.mfcc_pool->Release(mfcc);
+  }
+
+  ~MaskTask() {  // Produces output.  Run sequentially.
+    if (!ok_) {
+      KALDI_WARN << "Failed to enhance features for utterance " << utt_;
+      return;
+    }
+    feats_writer_->Write(utt_, feats_);
+    if (mask_writer_->IsOpen())
+      mask_writer_->Write(utt_, mask_);
+    KALDI_VLOG(2) << "Processed features for key " << utt_;
+    (*num_success_)++;
+  }
+
+ private:
+  const MaskConfig &config_;
+  NnetPool *pool_;
+  std::string utt_;
+  Matrix<BaseFloat> feats_;
+  BaseFloatMatrixWriter *feats_writer_;
+  BaseFloatMatrixWriter *mask_writer_;
+  int32 *num_success_;
+  bool ok_;
+  Matrix<BaseFloat> mask_;
+};
+
+}  // namespace nnet1
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  using namespace kaldi;
+  using namespace kaldi::nnet1;
+  typedef kaldi::int32 int32;
+
+  try {
+    const char *usage =
+        "Enhance noisy filterbank features with a time-frequency masking\n"
+        "network: run the network on the features, turn its outputs into a\n"
+        "mask (see --mask-type and MaskTargetOptions in feat/mask-targets.h),\n"
+        "apply the mask to the features and optionally convert them to MFCCs.\n"
+        "This replaces nnet-forward, irm-targets-to-irm, matrix-sum and\n"
+        "compute-mfcc-feats-from-fbank, without intermediate archives.\n"
+        "With --use-gpu=no, --num-threads networks are run in parallel.\n"
+        "Usage:  nnet-apply-mask [options] <model-in> <feature-rspecifier> "
+        "<feature-wspecifier>\n"
+        "e.g.: \n"
+        " nnet-apply-mask --num-threads=8 --mfcc=true --mfcc.num-mel-bins=40 \\\n"
+        "   irm.nnet scp:feats.scp ark:mfcc.ark\n";
+
+    ParseOptions po(usage);
+
+    MaskTargetOptions mask_opts;
+    mask_opts.Register(&po);
+    MfccOptions mfcc_opts;
+    ParseOptions po_mfcc("mfcc", &po);
+    mfcc_opts.Register(&po_mfcc);
+    TaskSequencerConfig thread_config;
+    thread_config.Register(&po);
+
+    std::string feature_transform;
+    po.Register("feature-transform", &feature_transform, "Feature transform in front of main network (in nnet format)");
+    std::string mask_type = "irm-targets";
+    po.Register("mask-type", &mask_type, "What the network predicts: irm-targets|arm-targets|irm|arm (the IRM or ARM itself, or its log if --apply-log=true)");
+    BaseFloat mask_floor = 0.0;
+    po.Register("mask-floor", &mask_floor, "If > 0, floor the mask at this value");
+    std::string mask_domain = "log";
+    po.Register("mask-domain", &mask_domain, "log|power: the features are log filterbank energies, to which the log of the mask is added, or filterbank energies (compute-fbank-feats --use-log-fbank=false), which are multiplied by the mask");
+    bool mfcc = false;
+    po.Register("mfcc", &mfcc, "If true, convert the enhanced features to MFCCs (see the --mfcc.* options)");
+    std::string mask_wspecifier;
+    po.Register("mask-wspecifier", &mask_wspecifier, "If supplied, write the log of the masks here");
+
+    std::string use_gpu="no";
+    po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if compiled with CUDA");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string model_filename = po.GetArg(1),
+        feature_rspecifier = po.GetArg(2),
+        feature_wspecifier = po.GetArg(3);
+
+    MaskConfig config;
+    if (!GetMaskTargetType(mask_type, &config.mask_type) ||
+        config.mask_type == kSnr)
+      KALDI_ERR << "Invalid --mask-type=" << mask_type;
+    if (mask_domain != "log" && mask_domain != "power")
+      KALDI_ERR << "Invalid --mask-domain=" << mask_domain;
+    MaskTargetComputer computer(mask_opts);
+    config.computer = &computer;
+    config.mask_floor = mask_floor;
+    config.log_domain = (mask_domain == "log");
+    FeatureComputerPool<Mfcc> mfcc_pool(mfcc_opts);
+    config.mfcc_pool = (mfcc ? &mfcc_pool : NULL);
+
+    //Select the GPU
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+    CuDevice::Instantiate().DisableCaching();
+    if (CuDevice::Instantiate().Enabled() && thread_config.num_threads > 1)
+      KALDI_ERR << "--num-threads > 1 is only supported with --use-gpu=no";
+#endif
+
+    // The feature transform and the network are run as one network.
+    Nnet *nnet = new Nnet();
+    if (feature_transform != "") {
+      nnet->Read(feature_transform);
+      Nnet nnet_main;
+      nnet_main.Read(model_filename);
+      nnet->AppendNnet(nnet_main);
+    } else {
+      nnet->Read(model_filename);
+    }
+    int32 feat_dim = nnet->InputDim();
+    if (nnet->OutputDim() != feat_dim)
+      KALDI_ERR << "The network should output a mask value for each of its "
+                << feat_dim << " inputs, but its output dimension is "
+                << nnet->OutputDim();
+    // Otherwise every utterance would fail in Mfcc::ComputeFromFbank().
+    if (mfcc && mfcc_opts.mel_opts.num_bins != feat_dim)
+      KALDI_ERR << "--mfcc.num-mel-bins is " << mfcc_opts.mel_opts.num_bins
+                << " but the features have dimension " << feat_dim;
+    NnetPool pool(nnet);
+
+    SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+    BaseFloatMatrixWriter feature_writer(feature_wspecifier);
+    BaseFloatMatrixWriter mask_writer;
+    if (mask_wspecifier != "" && !mask_writer.Open(mask_wspecifier))
+      KALDI_ERR << "Could not initialize output with wspecifier "
+                << mask_wspecifier;
+
+    Timer time;
+    kaldi::int64 tot_t = 0;
+    int32 num_utts = 0, num_success = 0;
+    TaskSequencer<MaskTask> sequencer(thread_config);
+    for (; !feature_reader.Done(); feature_reader.Next()) {
+      num_utts++;
+      std::string utt = feature_reader.Key();
+      const Matrix<BaseFloat> &mat = feature_reader.Value();
+      if (mat.NumCols() != feat_dim) {
+        KALDI_WARN << "Features for utterance " << utt << " have dimension "
+                   << mat.NumCols() << ", but the network expects "
+                   << feat_dim;
+        continue;
+      }
+      tot_t += mat.NumRows();
+      sequencer.Run(new MaskTask(config, &pool, utt, mat, &feature_writer,
+                                 &mask_writer, &num_success));
+    }
+    sequencer.Wait();
+
+    KALDI_LOG << "Done " << num_success << " out of " << num_utts
+              << " utterances in " << time.Elapsed()/60 << "min,"
+              << " (fps " << tot_t/time.Elapsed() << ")";
+
+#if HAVE_CUDA==1
+    if (kaldi::g_kaldi_verbose_level >= 1) {
+      CuDevice::Instantiate().PrintProfile();
+    }
+#endif
+
+    return (num_success != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
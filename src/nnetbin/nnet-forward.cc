@@ -105,7 +105,7 @@ int main(int argc, char *argv[]) {
 
     kaldi::int64 tot_t = 0;
 
-    SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+    SequentialBaseFloatMatrixViewReader feature_reader(feature_rspecifier);
     BaseFloatMatrixWriter feature_writer(feature_wspecifier);
 
     CuMatrix<BaseFloat> feats, feats_transf, nnet_out;
@@ -118,7 +118,7 @@ int main(int argc, char *argv[]) {
     // iterate over all feature files
     for (; !feature_reader.Done(); feature_reader.Next()) {
       // read
-      const Matrix<BaseFloat> &mat = feature_reader.Value();
+      const MatrixBase<BaseFloat> &mat = feature_reader.Value();
       KALDI_VLOG(2) << "Processing utterance " << num_done+1 
                     << ", " << feature_reader.Key() 
                     << ", " << mat.NumRows() << "frm";
@@ -32,10 +32,15 @@ int main(int argc, char *argv[]) {
   try {
     const char *usage =
         "Perform one iteration of Neural Network training by mini-batch Stochastic Gradient Descent.\n"
-        "This version use pdf-posterior as targets, prepared typically by ali-to-post.\n"
+        "This version use pdf-posterior as targets, prepared typically by ali-to-post,\n"
+        "or with --dense-targets=true, matrices of target values (e.g. IRM targets).\n"
         "Usage:  nnet-train-frmshuff [options] <feature-rspecifier> <targets-rspecifier> <model-in> [<model-out>]\n"
         "e.g.: \n"
-        " nnet-train-frmshuff scp:feature.scp ark:posterior.ark nnet.init nnet.iter1\n";
+        " nnet-train-frmshuff scp:feature.scp ark:posterior.ark nnet.init nnet.iter1\n"
+        " mkfifo targets.fifo\n"
+        " nnet-train-frmshuff --objective-function=mse --dense-targets=true \\\n"
+        "   \"ark:simulate-noisy-feats --srand=1 --feats-wspecifier=ark,f:- --targets-wspecifier='ark,f:| cat > targets.fifo' scp:wav.scp noise.scp |\" \\\n"
+        "   ark,s,cs:targets.fifo nnet.init nnet.iter1\n";
 
     ParseOptions po(usage);
 
@@ -55,6 +60,8 @@ int main(int argc, char *argv[]) {
     po.Register("feature-transform", &feature_transform, "Feature transform in Nnet format");
     std::string objective_function = "xent";
     po.Register("objective-function", &objective_function, "Objective function : xent|mse");
+    bool dense_targets = false;
+    po.Register("dense-targets", &dense_targets, "If true, the targets are matrices with a row per frame (e.g. IRM targets) rather than posteriors");
 
     int32 length_tolerance = 5;
     po.Register("length-tolerance", &length_tolerance, "Allowed length difference of features/targets (frames)");
@@ -103,7 +110,13 @@ int main(int argc, char *argv[]) {
     kaldi::int64 total_frames = 0;
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-    RandomAccessPosteriorReader targets_reader(targets_rspecifier);
+    RandomAccessPosteriorReader targets_reader;
+    RandomAccessBaseFloatMatrixReader dense_targets_reader;
+    if (dense_targets) {
+      dense_targets_reader.Open(targets_rspecifier);
+    } else {
+      targets_reader.Open(targets_rspecifier);
+    }
     RandomAccessBaseFloatVectorReader weights_reader;
     if (frame_weights != "") {
       weights_reader.Open(frame_weights);
@@ -112,6 +125,7 @@ int main(int argc, char *argv[]) {
     RandomizerMask randomizer_mask(rnd_opts);
     MatrixRandomizer feature_randomizer(rnd_opts);
     PosteriorRandomizer targets_randomizer(rnd_opts);
+    MatrixRandomizer dense_targets_randomizer(rnd_opts);
     VectorRandomizer weights_randomizer(rnd_opts);
 
     Xent xent;
@@ -129,7 +143,7 @@ int main(int argc, char *argv[]) {
         std::string utt = feature_reader.Key();
         KALDI_VLOG(3) << "Reading " << utt;
         // check that we have targets
-        if (!targets_reader.HasKey(utt)) {
+        if (dense_targets ? !dense_targets_reader.HasKey(utt) : !targets_reader.HasKey(utt)) {
           KALDI_WARN << utt << ", missing targets";
           num_no_tgt_mat++;
           continue;
@@ -142,7 +156,14 @@ int main(int argc, char *argv[]) {
         }
         // get feature / target pair
         Matrix<BaseFloat> mat = feature_reader.Value();
-        Posterior targets = targets_reader.Value(utt);
+        Posterior targets;
+        Matrix<BaseFloat> dense_tgt_mat;
+        if (dense_targets) {
+          dense_tgt_mat = dense_targets_reader.Value(utt);
+        } else {
+          targets = targets_reader.Value(utt);
+        }
+        int32 num_tgt_frames = (dense_targets ? dense_tgt_mat.NumRows() : targets.size());
         // get per-frame weights
         Vector<BaseFloat> weights;
         if (frame_weights != "") {
@@ -156,7 +177,7 @@ int main(int argc, char *argv[]) {
           // add lengths to vector
           std::vector<int32> lenght;
           lenght.push_back(mat.NumRows());
-          lenght.push_back(targets.size());
+          lenght.push_back(num_tgt_frames);
           lenght.push_back(weights.Dim());
           // find min, max
           int32 min = *std::min_element(lenght.begin(),lenght.end());
@@ -164,10 +185,14 @@ int main(int argc, char *argv[]) {
           // fix or drop ?
           if (max - min < length_tolerance) {
             if(mat.NumRows() != min) mat.Resize(min, mat.NumCols(), kCopyData);
-            if(targets.size() != min) targets.resize(min);
+            if (dense_targets) {
+              if(dense_tgt_mat.NumRows() != min) dense_tgt_mat.Resize(min, dense_tgt_mat.NumCols(), kCopyData);
+            } else {
+              if(targets.size() != min) targets.resize(min);
+            }
             if(weights.Dim() != min) weights.Resize(min, kCopyData);
           } else {
-            KALDI_WARN << utt << ", length mismatch of targets " << targets.size()
+            KALDI_WARN << utt << ", length mismatch of targets " << num_tgt_frames
                        << " and features " << mat.NumRows();
             num_other_error++;
             continue;
@@ -176,10 +201,21 @@ int main(int argc, char *argv[]) {
         // apply optional feature transform
         nnet_transf.Feedforward(CuMatrix<BaseFloat>(mat), &feats_transf);
 
+        // the randomizers must get the same number of frames
+        if (dense_targets) {
+          KALDI_ASSERT(feats_transf.NumRows() == dense_tgt_mat.NumRows());
+        } else {
+          KALDI_ASSERT(feats_transf.NumRows() == targets.size());
+        }
+        KALDI_ASSERT(feats_transf.NumRows() == weights.Dim());
+
         // pass data to randomizers
-        KALDI_ASSERT(feats_transf.NumRows() == targets.size());
         feature_randomizer.AddData(feats_transf);
-        targets_randomizer.AddData(targets);
+        if (dense_targets) {
+          dense_targets_randomizer.AddData(CuMatrix<BaseFloat>(dense_tgt_mat));
+        } else {
+          targets_randomizer.AddData(targets);
+        }
         weights_randomizer.AddData(weights);
         num_done++;
         // end when randomizer full
@@ -198,29 +234,45 @@ int main(int argc, char *argv[]) {
       if (!crossvalidate && randomize) {
         const std::vector<int32>& mask = randomizer_mask.Generate(feature_randomizer.NumFrames());
         feature_randomizer.Randomize(mask);
-        targets_randomizer.Randomize(mask);
+        if (dense_targets) {
+          dense_targets_randomizer.Randomize(mask);
+        } else {
+          targets_randomizer.Randomize(mask);
+        }
         weights_randomizer.Randomize(mask);
       }
 
       // train with data from randomizers (using mini-batches)
       for ( ; !feature_randomizer.Done(); feature_randomizer.Next(),
-                                          targets_randomizer.Next(),
                                           weights_randomizer.Next()) {
         // get block of feature/target pairs
         const CuMatrix<BaseFloat>& nnet_in = feature_randomizer.Value();
-        const Posterior& nnet_tgt = targets_randomizer.Value();
         const Vector<BaseFloat>& frm_weights = weights_randomizer.Value();
 
         // forward pass
         nnet.Propagate(nnet_in, &nnet_out);
 
         // evaluate objective function we've chosen
-        if (objective_function == "xent") {
-          xent.Eval(nnet_out, nnet_tgt, &obj_diff);
-        } else if (objective_function == "mse") {
-          mse.Eval(nnet_out, nnet_tgt, &obj_diff);
+        if (dense_targets) {
+          const CuMatrix<BaseFloat>& nnet_tgt = dense_targets_randomizer.Value();
+          if (objective_function == "xent") {
+            xent.Eval(nnet_out, nnet_tgt, &obj_diff);
+          } else if (objective_function == "mse") {
+            mse.Eval(nnet_out, nnet_tgt, &obj_diff);
+          } else {
+            KALDI_ERR << "Unknown objective function code : " << objective_function;
+          }
+          dense_targets_randomizer.Next();
         } else {
-          KALDI_ERR << "Unknown objective function code : " << objective_function;
+          const Posterior& nnet_tgt = targets_randomizer.Value();
+          if (objective_function == "xent") {
+            xent.Eval(nnet_out, nnet_tgt, &obj_diff);
+          } else if (objective_function == "mse") {
+            mse.Eval(nnet_out, nnet_tgt, &obj_diff);
+          } else {
+            KALDI_ERR << "Unknown objective function code : " << objective_function;
+          }
+          targets_randomizer.Next();
         }
 
         // backward pass
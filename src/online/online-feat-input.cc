@@ -35,14 +35,14 @@ namespace kaldi {
 bool OnlineCmnInput::Compute(Matrix<BaseFloat> *output) {
   
   int32 orig_nr = output->NumRows(), orig_nc = output->NumCols();
-  int32 initial_t_in = t_in_;
+  int32 initial_t_in = cmn_.NumFramesAccepted();
   bool ans;
   while ((ans = ComputeInternal(output))) {
     if (output->NumRows() == 0 &&
-        t_in_ != initial_t_in) {
+        cmn_.NumFramesAccepted() != initial_t_in) {
       // we produced no output but added to our internal buffer.
       // Call ComputeInternal again.
-      initial_t_in = t_in_;
+      initial_t_in = cmn_.NumFramesAccepted();
       output->Resize(orig_nr, orig_nc); // make the same request.
     } else {
       return ans;
@@ -54,19 +54,12 @@ bool OnlineCmnInput::Compute(Matrix<BaseFloat> *output) {
 }
 
 
-int32 OnlineCmnInput::NumOutputFrames(int32 num_new_frames,
-                                      bool more_data) const {
-  // Tells the caller, assuming we get given "num_new_frames" of input (and
-  // given knowledge of whether there is more data coming), how many frames
-  // would we be able to output?
-
-  int32 max_t = t_in_ + num_new_frames;
-  if (max_t >= min_window_ || !more_data) {
-    // If this takes us to "min_window_" frames, we'll output all we have.
-    return num_new_frames + t_in_ - t_out_;
-  } else {
-    return 0; // We'll wait till we have at least "min_window_" frames.
-  }
+SlidingWindowCmnOptions OnlineCmnInput::CmnOptions(int32 cmn_window,
+                                                   int32 min_window) {
+  SlidingWindowCmnOptions opts;
+  opts.cmn_window = cmn_window;
+  opts.min_window = min_window;
+  return opts;
 }
 
 
@@ -81,71 +74,22 @@ bool OnlineCmnInput::ComputeInternal(Matrix<BaseFloat> *output) {
   
   bool more_data = input_->Compute(&input);
 
-  int32 num_input_frames = input.NumRows();
-  
-  int32 output_frames = NumOutputFrames(num_input_frames,
-                                        more_data);
+  for (int32 i = 0; i < input.NumRows(); i++)
+    cmn_.AcceptFrame(input.Row(i));
+  if (!more_data)
+    cmn_.InputFinished();
+
+  // We wait till we have at least "min_window" frames, or the input has
+  // finished, and then output all we have.
+  int32 output_frames = cmn_.NumFramesReady() - cmn_.NumFramesOutput();
   output->Resize(output_frames,
                  output_frames == 0 ? 0 : Dim());
-  
-  int32 output_counter = 0;
-  for (int32 i = 0; i < num_input_frames; i++) {
-    AcceptFrame(input.Row(i));
-    while (t_in_ >= cmn_window_ && t_out_ < t_in_) {
-      // We must output a frame now or we'll overwrite
-      // frames we need in the buffer.
-      SubVector<BaseFloat> this_frame(*output, output_counter);
-      OutputFrame(&this_frame);
-      output_counter++;
-    }
-  }
-  for (; output_counter < output_frames; output_counter++) {
-    SubVector<BaseFloat> this_frame(*output, output_counter);
-    OutputFrame(&this_frame);
+  for (int32 i = 0; i < output_frames; i++) {
+    SubVector<BaseFloat> this_frame(*output, i);
+    cmn_.OutputFrame(&this_frame);
   }
   return more_data;
 }
-
-void OnlineCmnInput::AcceptFrame(const VectorBase<BaseFloat> &input) {
-  KALDI_ASSERT(t_in_ <= t_out_ + cmn_window_);
-  history_.Row(t_in_ % (cmn_window_ + 1)).CopyFromVec(input);
-  t_in_++;
-}
-
-// Output the frame indexed "t_out_".
-void OnlineCmnInput::OutputFrame(VectorBase<BaseFloat> *output) {
-  KALDI_ASSERT(t_out_ < t_in_); // or there is nothing to output.
-  // First set "sum_".
-  if (t_out_ == 0) { // This is the first request for an output frame,
-    // so in general we need to set sum_ to the sum of the first "min_window_"
-    // frames.  We will have less than min_window_ frames if the input finished
-    // before then (if the input were not finished, we'd not have reached this
-    // code).
-    int32 num_frames = t_in_ < min_window_ ? t_in_ : min_window_;
-    for (int32 i = 0; i < num_frames; i++)
-      sum_.AddVec(1.0, history_.Row(i));
-  }
-  int32 num_history_frames;
-  if (t_out_ >= cmn_window_) num_history_frames = cmn_window_;
-  else if (t_out_ < min_window_)
-    num_history_frames = (t_in_ < min_window_ ? t_in_ : min_window_);
-  else
-    num_history_frames = t_out_;
-  
-  SubVector<BaseFloat> input_frame(history_, t_out_ % (cmn_window_ + 1));
-  output->CopyFromVec(input_frame);
-  output->AddVec(-1.0 / num_history_frames, sum_); // Apply CMN to the output.
-  
-  // Update sum.
-  if (t_out_ >= min_window_)
-    sum_.AddVec(1.0, input_frame);
-  if (t_out_ >= cmn_window_) { // Remove the frame from "cmn_window_" frames ago.
-    sum_.AddVec(-1.0, history_.Row((t_out_ - cmn_window_) % (cmn_window_ + 1)));
-    KALDI_ASSERT(t_in_ == t_out_ + 1); // or else the frame indexed t_out_ -
-                                       // cmn_window_ would not be the right one.
-  }
-  t_out_++;
-}
   
 
 OnlineUdpInput::OnlineUdpInput(int32 port, int32 feature_dim):
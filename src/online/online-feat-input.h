@@ -83,9 +83,10 @@ class OnlineCmnInput: public OnlineFeatInputItf {
   //                mean, at the start of the file.  Adds latency but only at the
   //                start
   OnlineCmnInput(OnlineFeatInputItf *input, int32 cmn_window, int32 min_window)
-      : input_(input), cmn_window_(cmn_window), min_window_(min_window),
-        history_(cmn_window + 1, input->Dim()), t_in_(0), t_out_(0),
-        sum_(input->Dim()) { KALDI_ASSERT(cmn_window >= min_window && min_window > 0); }
+      : input_(input),
+        cmn_(CmnOptions(cmn_window, min_window), input->Dim(), true) {
+    KALDI_ASSERT(cmn_window >= min_window && min_window > 0);
+  }
   
   virtual bool Compute(Matrix<BaseFloat> *output);
 
@@ -94,31 +95,14 @@ class OnlineCmnInput: public OnlineFeatInputItf {
  private:
   virtual bool ComputeInternal(Matrix<BaseFloat> *output);
 
+  static SlidingWindowCmnOptions CmnOptions(int32 cmn_window,
+                                            int32 min_window);
   
   OnlineFeatInputItf *input_;
-  const int32 cmn_window_; // > 0
-  const int32 min_window_; // > 0, < cmn_window_.
-  Matrix<BaseFloat> history_; // circular-buffer history, of dim (cmn_window_ +
-                              // 1, feat-dim).  The + 1 is to serve as a place
-                              // for the frame we're about to normalize.
-
-  void AcceptFrame(const VectorBase<BaseFloat> &input); // Accept the next frame
-                                                        // of input (read into the
-                                                        // history buffer).
-  void OutputFrame(VectorBase<BaseFloat> *output); // Output the next frame.
-  
-  int32 NumOutputFrames(int32 num_new_frames,
-                        bool more_data) const; // Tells the caller, assuming
-  // we get given "num_new_frames" of input (and given knowledge of whether
-  // there is more data coming), how many frames would we be able to
-  // output?
-  
-  
-  int64 t_in_; // Time-counter for what we've obtained from the input.
-  int64 t_out_; // Time-counter for what we've written to the output.
-  
-  Vector<double> sum_; // Sum of the frames from t_out_ - HistoryLength(t_out_),
-                       // to t_out_ - 1.
+  // Does the normalization, with the window of each frame being the
+  // "cmn_window" frames before it (or the first "min_window" frames, at the
+  // start), as in SlidingWindowCmn() but excluding the frame itself.
+  SlidingWindowCmnComputer cmn_;
   
   KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineCmnInput);
 };
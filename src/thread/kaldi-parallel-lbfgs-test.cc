@@ -0,0 +1,130 @@
+// thread/kaldi-parallel-lbfgs-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "matrix/matrix-lib.h"
+#include "thread/kaldi-parallel-lbfgs.h"
+
+namespace kaldi {
+
+// The objective function is sum_s (x' v_s - 0.5 x' S_s x), which we maximize.
+class QuadraticObjective: public LbfgsShardedObjective<double> {
+ public:
+  QuadraticObjective(int32 dim, int32 num_shards):
+      S_(num_shards), v_(num_shards) {
+    for (int32 s = 0; s < num_shards; s++) {
+      Matrix<double> M(dim, dim);
+      M.SetRandn();
+      S_[s].Resize(dim);
+      S_[s].AddMat2(1.0, M, kNoTrans, 0.0);
+      for (int32 i = 0; i < dim; i++)
+        S_[s](i, i) += 1.0;
+      v_[s].Resize(dim);
+      v_[s].SetRandn();
+    }
+  }
+  virtual int32 NumShards() const { return S_.size(); }
+  virtual double ComputeShard(int32 shard, const VectorBase<double> &x,
+                              VectorBase<double> *gradient) const {
+    gradient->AddVec(1.0, v_[shard]);
+    gradient->AddSpVec(-1.0, S_[shard], x, 1.0);
+    return VecVec(x, v_[shard]) - 0.5 * VecSpVec(x, S_[shard], x);
+  }
+  // Returns the optimum.
+  void GetOptimum(Vector<double> *x) const {
+    SpMatrix<double> S(S_[0].NumRows());
+    Vector<double> v(S_[0].NumRows());
+    for (size_t s = 0; s < S_.size(); s++) {
+      S.AddSp(1.0, S_[s]);
+      v.AddVec(1.0, v_[s]);
+    }
+    S.Invert();
+    x->Resize(v.Dim());
+    x->AddSpVec(1.0, S, v, 0.0);
+  }
+ private:
+  std::vector<SpMatrix<double> > S_;
+  std::vector<Vector<double> > v_;
+};
+
+
+void TestParallelLbfgs() {
+  int32 dim = 1 + rand() % 20, num_shards = 1 + rand() % 10;
+  QuadraticObjective objective(dim, num_shards);
+  Vector<double> x_opt;
+  objective.GetOptimum(&x_opt);
+
+  ParallelLbfgsConfig config;
+  config.num_threads = 1 + rand() % 5;
+  config.num_line_search_candidates = 1 + rand() % 3;
+  ParallelLbfgsEvaluator<double> evaluator(config, objective);
+
+  Vector<double> init_x(dim);
+  init_x.SetRandn();
+  LbfgsOptions opts(false);  // maximize.
+  OptimizeLbfgs<double> lbfgs(init_x, opts);
+  int32 num_steps = 0;
+  while (lbfgs.RecentStepLength() > 1.0e-06 && num_steps < 1000) {
+    evaluator.DoStep(&lbfgs);
+    num_steps++;
+  }
+  Vector<double> x(lbfgs.GetValue());
+  KALDI_LOG << "Converged after " << num_steps << " steps and "
+            << evaluator.NumEvaluations() << " evaluations, with "
+            << config.num_threads << " threads and "
+            << config.num_line_search_candidates << " candidates.";
+  KALDI_ASSERT(evaluator.NumEvaluations() >= num_steps);
+  KALDI_ASSERT(x.ApproxEqual(x_opt, 1.0e-03));
+}
+
+
+void TestLineSearchCandidates() {
+  // Checks that the line search candidates are what OptimizeLbfgs asks for
+  // when the step has to be decreased.
+  int32 dim = 1 + rand() % 10;
+  Vector<double> init_x(dim);
+  init_x.SetRandn();
+  LbfgsOptions opts;  // minimize.
+  OptimizeLbfgs<double> lbfgs(init_x, opts);
+  // The function is f = 5 x.x, with gradient 10 x; L-BFGS with learning rate 1
+  // will overshoot by a lot, so the step will be decreased several times.
+  Vector<double> x(lbfgs.GetProposedValue()), gradient(x);
+  gradient.Scale(10.0);
+  lbfgs.DoStep(5.0 * VecVec(x, x), gradient);
+  std::vector<Vector<double> > candidates;
+  lbfgs.GetLineSearchCandidates(3, &candidates);
+  KALDI_ASSERT(candidates.size() == 3);
+  for (int32 i = 0; i < 3; i++) {
+    Vector<double> y(lbfgs.GetProposedValue());
+    KALDI_ASSERT(y.ApproxEqual(candidates[i], 0.0));
+    gradient.CopyFromVec(y);
+    gradient.Scale(10.0);
+    lbfgs.DoStep(5.0 * VecVec(y, y), gradient);
+  }
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 20; i++) {
+    TestParallelLbfgs();
+    TestLineSearchCandidates();
+  }
+  KALDI_LOG << "Tests succeeded.";
+}
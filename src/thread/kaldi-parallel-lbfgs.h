@@ -0,0 +1,172 @@
+// thread/kaldi-parallel-lbfgs.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_THREAD_KALDI_PARALLEL_LBFGS_H_
+#define KALDI_THREAD_KALDI_PARALLEL_LBFGS_H_ 1
+
+#include <vector>
+#include "thread/kaldi-thread.h"
+#include "itf/options-itf.h"
+#include "matrix/optimization.h"
+
+
+namespace kaldi {
+
+/**
+   The class OptimizeLbfgs (matrix/optimization.h) leaves it to the caller to
+   evaluate the objective function, one point at a time.  This file provides a
+   class that does this evaluation for objective functions that implement
+   LbfgsShardedObjective, i.e. that are a sum over shards of data: the shards
+   are computed in parallel and summed.
+
+   It can also evaluate several points of the line search at once: if
+   num_line_search_candidates > 1, then together with the proposed value it
+   evaluates the points the line search would try next if it had to decrease
+   the step size (see OptimizeLbfgs::GetLineSearchCandidates()), and if the
+   line search then asks for one of those, the stored value is used instead
+   of computing it again.  This uses more computation in total but can reduce
+   the time taken when there are more threads than shards.
+
+   Example:
+     ParallelLbfgsEvaluator<BaseFloat> evaluator(config, objective);
+     OptimizeLbfgs<BaseFloat> lbfgs(init_x, lbfgs_opts);
+     for (int32 iter = 0; iter < num_iters; iter++)
+       evaluator.DoStep(&lbfgs);
+     const VectorBase<BaseFloat> &x = lbfgs.GetValue();
+*/
+
+struct ParallelLbfgsConfig {
+  int32 num_threads;
+  int32 num_line_search_candidates;
+  ParallelLbfgsConfig(): num_threads(1), num_line_search_candidates(1) { }
+  void Register(OptionsItf *po) {
+    po->Register("num-threads", &num_threads, "Number of threads used to "
+                 "evaluate the objective function in L-BFGS.");
+    po->Register("num-line-search-candidates", &num_line_search_candidates,
+                 "Number of step sizes to evaluate at once in the L-BFGS "
+                 "line search (if >1, some computation is speculative).");
+  }
+};
+
+template<typename Real>
+class ParallelLbfgsEvaluator {
+ public:
+  ParallelLbfgsEvaluator(const ParallelLbfgsConfig &config,
+                         const LbfgsShardedObjective<Real> &objective):
+      config_(config), objective_(objective), num_evaluations_(0) {
+    KALDI_ASSERT(config.num_threads > 0 &&
+                 config.num_line_search_candidates > 0);
+  }
+
+  /// Evaluates the objective function and gradient at
+  /// lbfgs->GetProposedValue() (or uses the stored values, if this point was
+  /// already evaluated as a line-search candidate), and passes them to
+  /// lbfgs->DoStep().  Returns the objective function value.
+  Real DoStep(OptimizeLbfgs<Real> *lbfgs) {
+    int32 i = FindCandidate(lbfgs->GetProposedValue());
+    if (i == -1) {
+      lbfgs->GetLineSearchCandidates(config_.num_line_search_candidates,
+                                     &candidate_x_);
+      Evaluate();
+      i = 0;
+    }
+    Real objf = candidate_objf_[i];
+    lbfgs->DoStep(objf, candidate_gradient_[i]);
+    return objf;
+  }
+
+  /// Returns the number of points at which the objective function has been
+  /// evaluated, including line-search candidates that were never used.
+  int32 NumEvaluations() const { return num_evaluations_; }
+
+ private:
+  // Computes candidate_objf_ and candidate_gradient_ from candidate_x_.
+  void Evaluate() {
+    int32 num_candidates = candidate_x_.size();
+    candidate_objf_.assign(num_candidates, 0.0);
+    candidate_gradient_.resize(num_candidates);
+    for (int32 c = 0; c < num_candidates; c++)
+      candidate_gradient_[c].Resize(candidate_x_[c].Dim());
+    ShardClass c(objective_, candidate_x_, &candidate_objf_,
+                 &candidate_gradient_);
+    // With num_threads == 1, we pass 0, which means "run in this thread".
+    MultiThreader<ShardClass> m(config_.num_threads == 1 ? 0 :
+                                config_.num_threads, c);
+    num_evaluations_ += num_candidates;
+  }
+
+  // Returns the index of the stored candidate equal to x, or -1.
+  int32 FindCandidate(const VectorBase<Real> &x) const {
+    for (size_t i = 0; i < candidate_x_.size(); i++)
+      if (candidate_x_[i].Dim() == x.Dim() &&
+          candidate_x_[i].ApproxEqual(x, 0.0))
+        return i;
+    return -1;
+  }
+
+  // Computes (candidate, shard) pairs, dealt out to the threads in turn; each
+  // thread sums its own results, and these are added to the totals in the
+  // destructor (the destructors are called sequentially).
+  class ShardClass: public MultiThreadable {
+   public:
+    ShardClass(const LbfgsShardedObjective<Real> &objective,
+               const std::vector<Vector<Real> > &xs,
+               std::vector<Real> *objf,
+               std::vector<Vector<Real> > *gradient):
+        objective_(objective), xs_(xs), objf_ptr_(objf),
+        gradient_ptr_(gradient) { }
+
+    void operator() () {
+      int32 num_shards = objective_.NumShards(),
+          num_tasks = num_shards * xs_.size();
+      objf_.assign(xs_.size(), 0.0);
+      gradient_.resize(xs_.size());
+      for (int32 t = thread_id_; t < num_tasks; t += num_threads_) {
+        int32 c = t / num_shards, shard = t % num_shards;
+        if (gradient_[c].Dim() == 0)
+          gradient_[c].Resize(xs_[c].Dim());
+        objf_[c] += objective_.ComputeShard(shard, xs_[c], &(gradient_[c]));
+      }
+    }
+
+    ~ShardClass() {
+      for (size_t c = 0; c < objf_.size(); c++) {
+        (*objf_ptr_)[c] += objf_[c];
+        if (gradient_[c].Dim() != 0)
+          (*gradient_ptr_)[c].AddVec(1.0, gradient_[c]);
+      }
+    }
+   private:
+    const LbfgsShardedObjective<Real> &objective_;
+    const std::vector<Vector<Real> > &xs_;
+    std::vector<Real> *objf_ptr_;
+    std::vector<Vector<Real> > *gradient_ptr_;
+    std::vector<Real> objf_;  // this thread's objf for each candidate.
+    std::vector<Vector<Real> > gradient_;  // this thread's gradients.
+  };
+
+  ParallelLbfgsConfig config_;
+  const LbfgsShardedObjective<Real> &objective_;
+  std::vector<Vector<Real> > candidate_x_;
+  std::vector<Real> candidate_objf_;
+  std::vector<Vector<Real> > candidate_gradient_;
+  int32 num_evaluations_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_THREAD_KALDI_PARALLEL_LBFGS_H_
@@ -0,0 +1,230 @@
+// util/kaldi-gzipbuf.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/kaldi-gzipbuf.h"
+
+#ifdef HAVE_ZLIB
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _MSC_VER
+#define fseeko _fseeki64
+#define ftello _ftelli64
+#endif
+
+namespace kaldi {
+
+GzipInputStreambuf::GzipInputStreambuf():
+    file_(NULL), in_member_(false), error_(false), in_buf_(kBufferSize),
+    out_buf_(kPutbackSize + kBufferSize) { }
+
+bool GzipInputStreambuf::Open(const std::string &filename, int64 offset) {
+  if (file_ != NULL && filename != filename_)
+    Close();
+  if (file_ == NULL) {
+    file_ = std::fopen(filename.c_str(), "rb");
+    if (file_ == NULL) return false;
+    // We do our own buffering.
+    std::setvbuf(file_, NULL, _IONBF, 0);
+    filename_ = filename;
+    std::memset(&stream_, 0, sizeof(stream_));
+    // 15 + 32 means the maximum window size, and detect gzip or zlib format.
+    if (inflateInit2(&stream_, 15 + 32) != Z_OK) {
+      std::fclose(file_);
+      file_ = NULL;
+      return false;
+    }
+  } else {
+    inflateReset(&stream_);
+  }
+  if (fseeko(file_, offset, SEEK_SET) != 0) {
+    Close();
+    return false;
+  }
+  stream_.next_in = NULL;
+  stream_.avail_in = 0;
+  in_member_ = false;
+  error_ = false;
+  setg(NULL, NULL, NULL);
+  return true;
+}
+
+void GzipInputStreambuf::Close() {
+  if (file_ == NULL) return;
+  inflateEnd(&stream_);
+  std::fclose(file_);  // Don't check status; this is input.
+  file_ = NULL;
+  setg(NULL, NULL, NULL);
+}
+
+GzipInputStreambuf::~GzipInputStreambuf() { Close(); }
+
+size_t GzipInputStreambuf::Inflate(char *data, size_t size) {
+  if (error_) return 0;
+  stream_.next_out = reinterpret_cast<Bytef*>(data);
+  stream_.avail_out = size;
+  while (stream_.avail_out == size) {
+    if (stream_.avail_in == 0) {
+      size_t n = std::fread(&(in_buf_[0]), 1, kBufferSize, file_);
+      if (n == 0) {
+        if (in_member_) {
+          KALDI_WARN << "Compressed file " << filename_
+                     << " ends unexpectedly (truncated?)";
+          error_ = true;
+        }
+        break;
+      }
+      stream_.next_in = reinterpret_cast<Bytef*>(&(in_buf_[0]));
+      stream_.avail_in = n;
+    }
+    in_member_ = true;
+    int ret = inflate(&stream_, Z_NO_FLUSH);
+    if (ret == Z_STREAM_END) {
+      // The end of a gzip member; there may be another one after it.
+      inflateReset(&stream_);
+      in_member_ = false;
+    } else if (ret != Z_OK) {
+      KALDI_WARN << "Error decompressing " << filename_ << ": "
+                 << (stream_.msg != NULL ? stream_.msg : "unknown error");
+      error_ = true;
+      break;
+    }
+  }
+  return size - stream_.avail_out;
+}
+
+GzipInputStreambuf::int_type GzipInputStreambuf::underflow() {
+  if (gptr() < egptr())
+    return traits_type::to_int_type(*gptr());
+  if (file_ == NULL)
+    return traits_type::eof();
+  // Keep the last few characters so that unget() works.
+  size_t putback = 0;
+  if (eback() != NULL) {
+    putback = std::min(static_cast<size_t>(gptr() - eback()), kPutbackSize);
+    std::memmove(&(out_buf_[kPutbackSize - putback]), gptr() - putback,
+                 putback);
+  }
+  char *start = &(out_buf_[kPutbackSize]);
+  size_t n = Inflate(start, kBufferSize);
+  if (n == 0)
+    return traits_type::eof();
+  setg(start - putback, start, start + n);
+  return traits_type::to_int_type(*gptr());
+}
+
+
+GzipOutputStreambuf::GzipOutputStreambuf():
+    file_(NULL), error_(false), member_empty_(true), wrote_member_(false),
+    in_buf_(kBufferSize), out_buf_(kBufferSize) { }
+
+bool GzipOutputStreambuf::Open(const std::string &filename) {
+  KALDI_ASSERT(file_ == NULL);
+  file_ = std::fopen(filename.c_str(), "wb");
+  if (file_ == NULL) return false;
+  std::setvbuf(file_, NULL, _IONBF, 0);  // We do our own buffering.
+  std::memset(&stream_, 0, sizeof(stream_));
+  // 15 + 16 means the maximum window size, and write the gzip format.
+  if (deflateInit2(&stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    std::fclose(file_);
+    file_ = NULL;
+    return false;
+  }
+  error_ = false;
+  member_empty_ = true;
+  wrote_member_ = false;
+  setp(&(in_buf_[0]), &(in_buf_[0]) + kBufferSize);
+  return true;
+}
+
+bool GzipOutputStreambuf::Deflate(int flush) {
+  if (error_) return false;
+  stream_.next_in = reinterpret_cast<Bytef*>(pbase());
+  stream_.avail_in = pptr() - pbase();
+  setp(&(in_buf_[0]), &(in_buf_[0]) + kBufferSize);
+  if (stream_.avail_in != 0)
+    member_empty_ = false;
+  // Don't start a gzip member just to write nothing.
+  if (member_empty_) return true;
+  int ret;
+  do {
+    stream_.next_out = reinterpret_cast<Bytef*>(&(out_buf_[0]));
+    stream_.avail_out = kBufferSize;
+    ret = deflate(&stream_, flush);
+    if (ret == Z_STREAM_ERROR) {
+      error_ = true;
+      return false;
+    }
+    size_t n = kBufferSize - stream_.avail_out;
+    if (n != 0 && std::fwrite(&(out_buf_[0]), 1, n, file_) != n) {
+      error_ = true;
+      return false;
+    }
+  } while (flush == Z_FINISH ? ret != Z_STREAM_END : stream_.avail_out == 0);
+  if (flush == Z_FINISH) {  // Get ready to start a new member.
+    deflateReset(&stream_);
+    member_empty_ = true;
+    wrote_member_ = true;
+  }
+  return true;
+}
+
+GzipOutputStreambuf::int_type GzipOutputStreambuf::overflow(int_type c) {
+  if (file_ == NULL || !Deflate(Z_NO_FLUSH))
+    return traits_type::eof();
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+int GzipOutputStreambuf::sync() {
+  if (file_ == NULL) return -1;
+  if (!Deflate(Z_SYNC_FLUSH) || std::fflush(file_) != 0) return -1;
+  return 0;
+}
+
+GzipOutputStreambuf::pos_type GzipOutputStreambuf::seekoff(
+    off_type off, std::ios_base::seekdir way, std::ios_base::openmode which) {
+  if (file_ == NULL || off != 0 || way != std::ios_base::cur ||
+      !(which & std::ios_base::out) || !Deflate(Z_FINISH))
+    return pos_type(off_type(-1));
+  return pos_type(off_type(ftello(file_)));
+}
+
+bool GzipOutputStreambuf::Close() {
+  if (file_ == NULL) return false;
+  // A gzip file needs at least one member, even if it is empty.
+  if (!wrote_member_) member_empty_ = false;
+  bool ans = Deflate(Z_FINISH);
+  deflateEnd(&stream_);
+  if (std::fclose(file_) != 0) ans = false;
+  file_ = NULL;
+  setp(NULL, NULL);
+  return ans;
+}
+
+GzipOutputStreambuf::~GzipOutputStreambuf() {
+  if (file_ != NULL) Close();
+}
+
+}  // namespace kaldi
+
+#endif  // HAVE_ZLIB
@@ -0,0 +1,140 @@
+// util/kaldi-gzipbuf.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+/** @file kaldi-gzipbuf.h
+ *  This is an Kaldi C++ Library header.
+ */
+
+#ifndef KALDI_UTIL_KALDI_GZIPBUF_H_
+#define KALDI_UTIL_KALDI_GZIPBUF_H_
+
+#ifdef HAVE_ZLIB
+
+#include <cstdio>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+// These stream buffers read and write gzip-compressed files using zlib, so
+// that Input and Output can handle .gz files without starting gzip processes
+// (see kaldi-io.h).
+//
+// To allow offsets into compressed archives (as in scp files written by
+// TableWriter), GzipOutputStreambuf ends the current gzip "member" whenever
+// its position is asked for (i.e. on tellp()), and returns the position in the
+// compressed file at which the next member starts.  A gzip file may consist of
+// any number of members, and the standard tools decompress them as one stream;
+// GzipInputStreambuf can start decompressing at any member boundary, which is
+// what an offset like foo.ark.gz:12345 refers to.  If the position is never
+// asked for, the output is a normal single-member gzip file.
+
+class GzipInputStreambuf: public std::streambuf {
+ public:
+  GzipInputStreambuf();
+
+  // Opens the file and starts decompressing at byte "offset" of the compressed
+  // file, which must be the start of a gzip member.  If the same file is
+  // already open it just seeks.  Returns true on success; errors in the
+  // compressed data are only detected as they are read.
+  bool Open(const std::string &filename, int64 offset);
+
+  bool IsOpen() const { return file_ != NULL; }
+
+  void Close();
+
+  ~GzipInputStreambuf();
+
+ protected:
+  virtual int_type underflow();
+
+ private:
+  // Decompresses up to "size" bytes into "data"; returns the number of bytes
+  // decompressed, which is zero only at the end of the file or on error.
+  size_t Inflate(char *data, size_t size);
+
+  static const size_t kBufferSize = 65536;
+  static const size_t kPutbackSize = 16;  // Characters kept for unget().
+
+  std::string filename_;
+  FILE *file_;
+  z_stream stream_;
+  bool in_member_;  // True if we are partway through a gzip member.
+  bool error_;  // True if the data could not be decompressed.
+  std::vector<char> in_buf_;  // Compressed data.
+  std::vector<char> out_buf_;  // kPutbackSize + kBufferSize bytes.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(GzipInputStreambuf);
+};
+
+
+class GzipOutputStreambuf: public std::streambuf {
+ public:
+  GzipOutputStreambuf();
+
+  // Opens the file for writing; returns true on success.
+  bool Open(const std::string &filename);
+
+  bool IsOpen() const { return file_ != NULL; }
+
+  // Finishes the compressed stream and closes the file; returns true on
+  // success.
+  bool Close();
+
+  ~GzipOutputStreambuf();
+
+ protected:
+  virtual int_type overflow(int_type c);
+
+  // Flushes the data written so far to the file (it is decompressible up to
+  // this point).
+  virtual int sync();
+
+  // Only supports getting the current position: this ends the current gzip
+  // member and returns the position in the compressed file, as explained
+  // above.
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir way,
+                           std::ios_base::openmode which);
+
+ private:
+  // Compresses the buffered data with the given zlib flush mode and writes the
+  // output to the file.  Returns false on error.
+  bool Deflate(int flush);
+
+  static const size_t kBufferSize = 65536;
+
+  FILE *file_;
+  z_stream stream_;
+  bool error_;
+  bool member_empty_;  // True if nothing was written in the current member.
+  bool wrote_member_;  // True if at least one member was written.
+  std::vector<char> in_buf_;  // Uncompressed data, used as the put area.
+  std::vector<char> out_buf_;  // Compressed data.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(GzipOutputStreambuf);
+};
+
+}  // namespace kaldi
+
+#endif  // HAVE_ZLIB
+
+#endif  // KALDI_UTIL_KALDI_GZIPBUF_H_
@@ -61,6 +61,10 @@ template<class KaldiType> class KaldiObjectHolder {
     }
   }
 
+  void Swap(KaldiObjectHolder<KaldiType> *other) {
+    std::swap(t_, other->t_);
+  }
+
   // Reads into the holder.
   bool Read(std::istream &is) {
     if (t_) delete t_;
@@ -127,6 +131,10 @@ template<class BasicType> class BasicHolder {
 
   void Clear() { }
 
+  void Swap(BasicHolder<BasicType> *other) {
+    std::swap(t_, other->t_);
+  }
+
   // Reads into the holder.
   bool Read(std::istream &is) {
     bool is_binary;
@@ -225,6 +233,10 @@ template<class BasicType> class BasicVectorHolder {
 
   void Clear() { t_.clear(); }
 
+  void Swap(BasicVectorHolder<BasicType> *other) {
+    t_.swap(other->t_);
+  }
+
   // Reads into the holder.
   bool Read(std::istream &is) {
     t_.clear();
@@ -241,21 +253,21 @@ template<class BasicType> class BasicVectorHolder {
         KALDI_WARN << "BasicVectorHolder::Read, error reading line " << (is.eof() ? "[eof]" : "");
         return false;  // probably eof.  fail in any case.
       }
-      std::istringstream line_is(line);
-      try {
-        while (1) {
-          line_is >> std::ws;  // eat up whitespace.
-          if (line_is.eof()) break;
-          BasicType bt;
-          ReadBasicType(line_is, false, &bt);
-          t_.push_back(bt);
+      // Parse the line directly; this is much faster than using an
+      // istringstream.
+      const char *p = line.c_str();
+      while (1) {
+        while (::isspace(static_cast<unsigned char>(*p))) p++;
+        if (*p == '\0') break;
+        BasicType bt;
+        if (!ParseBasicType(&p, &bt) ||
+            !(*p == '\0' || ::isspace(static_cast<unsigned char>(*p)))) {
+          KALDI_WARN << "BasicVectorHolder::Read, could not interpret line: " << line;
+          return false;
         }
-        return true;
-      } catch(std::exception &e) {
-        KALDI_WARN << "BasicVectorHolder::Read, could not interpret line: " << line;
-        if (!IsKaldiError(e.what())) { std::cerr << e.what(); }
-        return false;
+        t_.push_back(bt);
       }
+      return true;
     } else {  // binary mode.
       size_t filepos = is.tellg();
       try {
@@ -343,6 +355,10 @@ template<class BasicType> class BasicVectorVectorHolder {
 
   void Clear() { t_.clear(); }
 
+  void Swap(BasicVectorVectorHolder<BasicType> *other) {
+    t_.swap(other->t_);
+  }
+
   // Reads into the holder.
   bool Read(std::istream &is) {
     t_.clear();
@@ -469,6 +485,10 @@ template<class BasicType> class BasicPairVectorHolder {
   
   void Clear() { t_.clear(); }
 
+  void Swap(BasicPairVectorHolder<BasicType> *other) {
+    t_.swap(other->t_);
+  }
+
   // Reads into the holder.
   bool Read(std::istream &is) {
     t_.clear();
@@ -573,6 +593,10 @@ class TokenHolder {
 
   void Clear() { t_.clear(); }
 
+  void Swap(TokenHolder *other) {
+    t_.swap(other->t_);
+  }
+
   // Reads into the holder.
   bool Read(std::istream &is) {
     is >> t_;
@@ -622,6 +646,10 @@ class TokenVectorHolder {
 
   void Clear() { t_.clear(); }
 
+  void Swap(TokenVectorHolder *other) {
+    t_.swap(other->t_);
+  }
+
 
   // Reads into the holder.
   bool Read(std::istream &is) {
@@ -670,6 +698,11 @@ class HtkMatrixHolder {
 
   void Clear() { t_.first.Resize(0, 0); }
 
+  void Swap(HtkMatrixHolder *other) {
+    t_.first.Swap(&(other->t_.first));
+    std::swap(t_.second, other->t_.second);
+  }
+
   // Reads into the holder.
   bool Read(std::istream &is) {
     bool ans = ReadHtk(is, &t_.first, &t_.second);
@@ -692,6 +725,138 @@ class HtkMatrixHolder {
   T t_;
 };
 
+// MatrixViewHolder reads matrices like KaldiObjectHolder<Matrix<BaseFloat> >,
+// but when the data is an uncompressed binary matrix of type BaseFloat in a
+// memory-mapped file (see SetMemoryMappedInput() in kaldi-io.h) it is taken
+// straight from the mapping rather than read through the stream.  If the data
+// is aligned for BaseFloat, Value() is a read-only view of it, so there is no
+// allocation or copying; otherwise it is copied into a Matrix with memcpy.
+// The format has no padding, so the data of an archive entry starts
+// (key-length + 16) bytes into the record and is aligned only for some key
+// lengths, and in a file holding a single matrix it is never aligned.  For
+// other matrices it reads into a Matrix as usual.  T is
+// MatrixBase<BaseFloat>, so you can use it (e.g. with TableWriter) to write
+// any kind of matrix; the output is the same as for Matrix<BaseFloat>.  The
+// data of Value() must not be modified.
+class MatrixViewHolder {
+ public:
+  typedef MatrixBase<BaseFloat> T;
+
+  MatrixViewHolder(): is_view_(false) { }
+
+  static bool Write(std::ostream &os, bool binary, const T &t) {
+    return KaldiObjectHolder<T>::Write(os, binary, t);
+  }
+
+  void Clear() {
+    view_.Set(NULL, 0, 0);
+    region_.Clear();
+    mat_.Resize(0, 0);
+    is_view_ = false;
+  }
+
+  void Swap(MatrixViewHolder *other) {
+    view_.Swap(&other->view_);
+    region_.Swap(&other->region_);
+    mat_.Swap(&other->mat_);
+    std::swap(is_view_, other->is_view_);
+  }
+
+  bool Read(std::istream &is) {
+    Clear();
+    bool is_binary;
+    if (!InitKaldiInputStream(is, &is_binary)) {
+      KALDI_WARN << "Reading Table object, failed reading binary header\n";
+      return false;
+    }
+    if (is_binary && ReadView(is)) return true;
+    try {
+      mat_.Read(is, is_binary);
+      return true;
+    } catch (std::exception &e) {
+      KALDI_WARN << "Exception caught reading Table object ";
+      if (!IsKaldiError(e.what())) { std::cerr << e.what(); }
+      return false;
+    }
+  }
+
+  static bool IsReadInBinary() { return true; }
+
+  const T &Value() const {
+    if (is_view_) return view_;
+    else return mat_;
+  }
+
+ private:
+  // A MatrixBase that points to data it does not own.
+  class View: public MatrixBase<BaseFloat> {
+   public:
+    View() { Set(NULL, 0, 0); }
+    void Set(const BaseFloat *data, MatrixIndexT num_rows,
+             MatrixIndexT num_cols) {
+      this->data_ = const_cast<BaseFloat*>(data);
+      this->num_rows_ = num_rows;
+      this->num_cols_ = num_cols;
+      this->stride_ = num_cols;
+    }
+    void Swap(View *other) {
+      std::swap(this->data_, other->data_);
+      std::swap(this->num_rows_, other->num_rows_);
+      std::swap(this->num_cols_, other->num_cols_);
+      std::swap(this->stride_, other->stride_);
+    }
+  };
+
+  // If the stream is memory-mapped and the next thing in it is a nonempty
+  // binary matrix of type BaseFloat, skips over the matrix in the stream and
+  // returns true: if its data is aligned for BaseFloat, view_ and region_ are
+  // set up to point to it, and otherwise it is copied into mat_.
+  bool ReadView(std::istream &is) {
+    if (is.peek() != (sizeof(BaseFloat) == 4 ? 'F' : 'D') ||
+        !region_.Init(is))
+      return false;
+    // The format is "FM " (or "DM "), then the number of rows and columns,
+    // each written as a size byte (4) and an int32, then the data.
+    const size_t header_size = 3 + 2 * (1 + sizeof(int32));
+    const char *data = region_.Data();
+    int32 num_rows, num_cols;
+    if (region_.Size() < header_size || data[1] != 'M' || data[2] != ' ' ||
+        data[3] != sizeof(int32) || data[8] != sizeof(int32)) {
+      region_.Clear();
+      return false;
+    }
+    memcpy(&num_rows, data + 4, sizeof(int32));
+    memcpy(&num_cols, data + 9, sizeof(int32));
+    size_t num_bytes = header_size + sizeof(BaseFloat) *
+        static_cast<size_t>(num_rows) * static_cast<size_t>(num_cols);
+    if (num_rows <= 0 || num_cols <= 0 || region_.Size() < num_bytes) {
+      region_.Clear();  // Let Matrix::Read() deal with it.
+      return false;
+    }
+    if (reinterpret_cast<size_t>(data + header_size) % sizeof(BaseFloat) != 0) {
+      // A view would be misaligned, so copy; memcpy does not care about the
+      // alignment of its source.
+      mat_.Resize(num_rows, num_cols, kUndefined);
+      const char *row_data = data + header_size;
+      for (int32 r = 0; r < num_rows; r++, row_data += sizeof(BaseFloat) * num_cols)
+        memcpy(mat_.RowData(r), row_data, sizeof(BaseFloat) * num_cols);
+      region_.Clear();
+    } else {
+      view_.Set(reinterpret_cast<const BaseFloat*>(data + header_size),
+                num_rows, num_cols);
+      is_view_ = true;
+    }
+    is.seekg(num_bytes, std::ios_base::cur);
+    return true;
+  }
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MatrixViewHolder);
+  View view_;  // Used if is_view_.
+  MappedStreamRegion region_;  // Keeps the data of view_ valid.
+  Matrix<BaseFloat> mat_;  // Used if !is_view_.
+  bool is_view_;
+};
+
 // SphinxMatrixHolder can be used to read and write feature files in
 // CMU Sphinx format. 13-dimensional big-endian features are assumed.
 // The ultimate reference is SphinxBase's source code (for example see
@@ -711,6 +876,10 @@ template<int kFeatDim> class SphinxMatrixHolder {
 
   void Clear() { feats_.Resize(0, 0); }
 
+  void Swap(SphinxMatrixHolder<kFeatDim> *other) {
+    feats_.Swap(&(other->feats_));
+  }
+
   // Writes Sphinx-format features
   static bool Write(std::ostream &os, bool binary, const T &m) {
     if (!binary) {
@@ -127,6 +127,11 @@ template<class SomeType> class GenericHolder {
   /// allow the object to free resources if they're no longer needed.
   void Clear() { }
 
+  /// Swaps the contents of this holder with another holder of the same type.
+  /// This is used by the background-reading code in kaldi-table-inl.h, to
+  /// hand objects from one thread to another without copying them.
+  void Swap(GenericHolder<T> *other) { std::swap(t_, other->t_); }
+
   /// If the object held pointers, the destructor would free them.
   ~GenericHolder() { }
 
@@ -196,6 +201,22 @@ class HtkMatrixHolder;
 /// A class for reading/writing Sphinx format matrices.
 template<int kFeatDim=13> class SphinxMatrixHolder;
 
+/// A class for reading Matrix<BaseFloat> from memory-mapped files, without
+/// copying the data when it is suitably aligned.  T == MatrixBase<BaseFloat>;
+/// see the comment in kaldi-holder-inl.h.
+class MatrixViewHolder;
+
+/// HolderUsesMappedInput<Holder>::value is true for holders that can use the
+/// data of a memory-mapped stream in place; TableReaders open files for these
+/// with Input::OpenMapped() rather than Input::Open().
+template<class Holder> struct HolderUsesMappedInput {
+  static const bool value = false;
+};
+
+template<> struct HolderUsesMappedInput<MatrixViewHolder> {
+  static const bool value = true;
+};
+
 
 /// @} end "addtogroup holders"
 
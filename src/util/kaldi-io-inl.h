@@ -23,11 +23,15 @@
 namespace kaldi {
 
 bool Input::Open(const std::string &rxfilename, bool *binary) {
-  return OpenInternal(rxfilename, true, binary);
+  return OpenInternal(rxfilename, true, false, binary);
+}
+
+bool Input::OpenMapped(const std::string &rxfilename, bool *binary) {
+  return OpenInternal(rxfilename, true, true, binary);
 }
 
 bool Input::OpenTextMode(const std::string &rxfilename) {
-  return OpenInternal(rxfilename, false, NULL);
+  return OpenInternal(rxfilename, false, false, NULL);
 }
 
 bool Input::IsOpen() {
@@ -157,6 +157,112 @@ void UnitTestIoNew(bool binary) {
   }
 }
 
+// Reading offsets into files, e.g. "tmpf:10", with and without memory
+// mapping, including after the file has been rewritten.
+void UnitTestIoOffset(bool mapped) {
+  SetMemoryMappedInput(mapped);
+  for (int32 n = 0; n < 2; n++) {
+    const char *filename = "tmpf";
+    std::vector<int32> offsets;
+    std::vector<std::vector<int32> > vecs(5 + n);
+    {
+      Output ko(filename, true);
+      for (size_t i = 0; i < vecs.size(); i++) {
+        for (int32 j = rand() % 10; j > 0; j--)
+          vecs[i].push_back(rand() % 1000);
+        offsets.push_back(ko.Stream().tellp());
+        WriteIntegerVector(ko.Stream(), true, vecs[i]);
+      }
+    }
+    Input ki;
+    for (int32 k = 0; k < 20; k++) {
+      int32 i = rand() % vecs.size();
+      std::ostringstream rxfilename;
+      rxfilename << filename << ':' << offsets[i];
+      KALDI_ASSERT(ki.Open(rxfilename.str()));
+      std::vector<int32> vec;
+      ReadIntegerVector(ki.Stream(), true, &vec);
+      KALDI_ASSERT(vec == vecs[i]);
+    }
+    KALDI_ASSERT(!ki.Open("nonexistent_file:0"));
+  }
+  SetMemoryMappedInput(true);
+}
+
+// Only Input::OpenMapped() memory-maps an ordinary file.
+void UnitTestIoOpenMapped() {
+  {
+    Output ko("tmpf", true);
+    WriteBasicType(ko.Stream(), true, static_cast<int32>(7));
+  }
+  for (int32 mapped = 0; mapped < 2; mapped++) {
+    Input ki;
+    bool binary;
+    KALDI_ASSERT(mapped ? ki.OpenMapped("tmpf", &binary) :
+                 ki.Open("tmpf", &binary));
+    KALDI_ASSERT(binary);
+    MappedStreamRegion region;
+    KALDI_ASSERT(region.Init(ki.Stream()) == (mapped != 0));
+    int32 i;
+    ReadBasicType(ki.Stream(), true, &i);
+    KALDI_ASSERT(i == 7);
+  }
+}
+
+#ifdef HAVE_ZLIB
+// Tests the built-in reading and writing of .gz files, including offsets into
+// them, and that they are compatible with gzip.
+void UnitTestIoGzip() {
+  for (int32 n = 0; n < 2; n++) {
+    // The first time we write through gzip, and read what we wrote directly.
+    const char *wxfilename = (n == 0 ? "| cat | gzip -c > tmpf.gz" : "tmpf.gz");
+    std::vector<int32> offsets;
+    // Some of the vectors are bigger than GzipInputStreambuf's buffer.
+    std::vector<std::vector<int32> > vecs(5 + rand() % 5);
+    {
+      Output ko(wxfilename, true);
+      for (size_t i = 0; i < vecs.size(); i++) {
+        for (int32 j = rand() % (i % 2 == 0 ? 10 : 30000); j > 0; j--)
+          vecs[i].push_back(rand() % 1000);
+        if (n == 1)
+          offsets.push_back(ko.Stream().tellp());
+        WriteIntegerVector(ko.Stream(), true, vecs[i]);
+      }
+    }
+    for (int32 m = 0; m < 2; m++) {
+      // Read through gzip, or directly.
+      const char *rxfilename = (m == 0 ? "gunzip -c tmpf.gz | cat |" :
+                                "tmpf.gz");
+      bool binary_in;
+      Input ki(rxfilename, &binary_in);
+      KALDI_ASSERT(binary_in);
+      for (size_t i = 0; i < vecs.size(); i++) {
+        std::vector<int32> vec;
+        ReadIntegerVector(ki.Stream(), true, &vec);
+        KALDI_ASSERT(vec == vecs[i]);
+      }
+      KALDI_ASSERT(ki.Stream().peek() == EOF);
+    }
+    if (n == 0) continue;
+    Input ki;
+    for (int32 k = 0; k < 20; k++) {
+      int32 i = rand() % vecs.size();
+      std::ostringstream rxfilename;
+      rxfilename << "tmpf.gz:" << offsets[i];
+      KALDI_ASSERT(ki.Open(rxfilename.str()));
+      std::vector<int32> vec;
+      ReadIntegerVector(ki.Stream(), true, &vec);
+      KALDI_ASSERT(vec == vecs[i]);
+    }
+  }
+  {
+    // Writing nothing still gives a valid gzip file.
+    Output ko("tmpf.gz", false, false);
+  }
+  KALDI_ASSERT(system("gunzip -c tmpf.gz >/dev/null") == 0);
+}
+#endif
+
 void UnitTestIoPipe(bool binary) {
   // This is as UnitTestIoNew except with different filenames.
   {
@@ -304,6 +410,12 @@ int main() {
 
   UnitTestIoNew(false);
   UnitTestIoNew(true);
+  UnitTestIoOffset(true);
+  UnitTestIoOffset(false);
+  UnitTestIoOpenMapped();
+#ifdef HAVE_ZLIB
+  UnitTestIoGzip();
+#endif
   UnitTestIoPipe(true);
   UnitTestIoPipe(false);
   UnitTestIoStandard();
@@ -313,4 +425,3 @@ int main() {
   KALDI_ASSERT(1);  // just wanted to check that KALDI_ASSERT does not fail for 1.
   return 0;
 }
-
@@ -23,6 +23,16 @@
 #include <errno.h>
 
 #include "util/kaldi-pipebuf.h"
+#include "util/kaldi-gzipbuf.h"
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <list>
+#include <map>
+#endif
 namespace kaldi {
 
 #ifndef _MSC_VER // on VS, we don't need this type.
@@ -583,6 +593,428 @@ class OffsetFileInputImpl: public InputImplBase {
   std::ifstream is_;
 };
 
+static bool g_memory_mapped_input = true;
+
+void SetMemoryMappedInput(bool enabled) { g_memory_mapped_input = enabled; }
+
+#ifndef _MSC_VER
+// A read-only memory mapping of a whole file, shared between
+// MappedOffsetFileInputImpl objects via MappedFileCache.
+struct MappedFile {
+  std::string filename;
+  const char *data;
+  size_t size;
+  // The following identify the version of the file that was mapped.
+  dev_t dev;
+  ino_t ino;
+  time_t mtime;
+  int32 ref_count;  // Number of Input objects using it.
+  bool stale;  // True if the file has changed since it was mapped.
+};
+
+// This keeps track of the memory-mapped files.  Files are unmapped once no
+// Input uses them, except that the kMaxUnused most recently used ones are
+// kept, since with scp files we tend to go back to the same archives.
+class MappedFileCache {
+ public:
+  // Returns the mapping of "filename", or NULL if it could not be mapped.
+  static MappedFile *Acquire(const std::string &filename) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode) ||
+        st.st_size == 0)
+      return NULL;
+    pthread_mutex_lock(&mutex_);
+    MappedFile *ans = NULL;
+    std::map<std::string, MappedFile*>::iterator iter = files_.find(filename);
+    if (iter != files_.end()) {
+      MappedFile *file = iter->second;
+      if (file->dev == st.st_dev && file->ino == st.st_ino &&
+          file->mtime == st.st_mtime &&
+          file->size == static_cast<size_t>(st.st_size)) {
+        if (file->ref_count == 0) unused_.remove(file);
+        file->ref_count++;
+        ans = file;
+      } else {  // The file has changed.
+        files_.erase(iter);
+        if (file->ref_count == 0) {
+          unused_.remove(file);
+          Unmap(file);
+        } else {
+          file->stale = true;  // Unmapped by Release().
+        }
+      }
+    }
+    if (ans == NULL && (ans = Map(filename)) != NULL)
+      files_[filename] = ans;
+    pthread_mutex_unlock(&mutex_);
+    return ans;
+  }
+
+  // Adds a reference to a file that already has one.
+  static void AddReference(MappedFile *file) {
+    pthread_mutex_lock(&mutex_);
+    KALDI_ASSERT(file->ref_count > 0);
+    file->ref_count++;
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  static void Release(MappedFile *file) {
+    pthread_mutex_lock(&mutex_);
+    KALDI_ASSERT(file->ref_count > 0);
+    if (--file->ref_count == 0) {
+      if (file->stale) {
+        Unmap(file);
+      } else {
+        unused_.push_front(file);
+        if (unused_.size() > static_cast<size_t>(kMaxUnused)) {
+          MappedFile *oldest = unused_.back();
+          unused_.pop_back();
+          files_.erase(oldest->filename);
+          Unmap(oldest);
+        }
+      }
+    }
+    pthread_mutex_unlock(&mutex_);
+  }
+
+ private:
+  static const int32 kMaxUnused = 16;
+
+  static MappedFile *Map(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      return NULL;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping remains valid.
+    if (data == MAP_FAILED) return NULL;
+    MappedFile *file = new MappedFile();
+    file->filename = filename;
+    file->data = static_cast<const char*>(data);
+    file->size = st.st_size;
+    file->dev = st.st_dev;
+    file->ino = st.st_ino;
+    file->mtime = st.st_mtime;
+    file->ref_count = 1;
+    file->stale = false;
+    return file;
+  }
+
+  static void Unmap(MappedFile *file) {
+    munmap(const_cast<char*>(file->data), file->size);
+    delete file;
+  }
+
+  static pthread_mutex_t mutex_;
+  static std::map<std::string, MappedFile*> files_;
+  static std::list<MappedFile*> unused_;  // Most recently used first.
+};
+
+pthread_mutex_t MappedFileCache::mutex_ = PTHREAD_MUTEX_INITIALIZER;
+std::map<std::string, MappedFile*> MappedFileCache::files_;
+std::list<MappedFile*> MappedFileCache::unused_;
+
+
+// A read-only streambuf reading from a memory-mapped file, with seeking.
+class MemoryStreambuf: public std::streambuf {
+ public:
+  MemoryStreambuf(): file_(NULL) { }
+  void SetFile(MappedFile *file) {
+    file_ = file;
+    // We never write to the data.
+    char *begin = (file == NULL ? NULL : const_cast<char*>(file->data));
+    setg(begin, begin, begin + (file == NULL ? 0 : file->size));
+  }
+  MappedFile *File() const { return file_; }
+  // The next unread byte.
+  const char *Current() const { return gptr(); }
+  size_t NumRemaining() const { return egptr() - gptr(); }
+ protected:
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which) {
+    off_type pos;
+    if (dir == std::ios_base::beg) pos = off;
+    else if (dir == std::ios_base::cur) pos = (gptr() - eback()) + off;
+    else pos = (egptr() - eback()) + off;
+    if (pos < 0 || pos > egptr() - eback() || !(which & std::ios_base::in))
+      return pos_type(off_type(-1));
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+  }
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which) {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+ private:
+  MappedFile *file_;
+};
+
+
+// This is used instead of OffsetFileInputImpl (where supported) to read
+// offsets into files, e.g. /some/filename:12970, by memory-mapping the file;
+// and instead of FileInputImpl for files opened in binary mode (if type is
+// kFileInput), in which case there is no offset.
+class MappedFileInputImpl: public InputImplBase {
+ public:
+  explicit MappedFileInputImpl(InputType type):
+      type_(type), file_(NULL), is_(&buf_) { }
+
+  // Like OffsetFileInputImpl::Open(), this may be called when already open;
+  // if it is the same file we just seek.
+  virtual bool Open(const std::string &rxfilename, bool binary) {
+    std::string filename;
+    size_t offset = 0;
+    if (type_ == kOffsetFileInput)
+      OffsetFileInputImpl::SplitFilename(rxfilename, &filename, &offset);
+    else
+      filename = rxfilename;
+    if (file_ == NULL || file_->filename != filename) {
+      if (file_ != NULL) Close();
+      file_ = MappedFileCache::Acquire(filename);
+      if (file_ == NULL) return false;
+      buf_.SetFile(file_);
+    }
+    is_.clear();
+    if (offset > file_->size) return false;
+    is_.seekg(offset, std::ios_base::beg);
+    return !is_.fail();
+  }
+
+  virtual std::istream &Stream() {
+    if (file_ == NULL)
+      KALDI_ERR << "MappedFileInputImpl::Stream(), file is not open.";
+    return is_;
+  }
+
+  virtual void Close() {
+    if (file_ == NULL)
+      KALDI_ERR << "MappedFileInputImpl::Close(), file is not open.";
+    MappedFileCache::Release(file_);
+    file_ = NULL;
+    buf_.SetFile(NULL);
+  }
+
+  virtual InputType MyType() { return type_; }
+
+  virtual ~MappedFileInputImpl() {
+    if (file_ != NULL) MappedFileCache::Release(file_);
+  }
+ private:
+  InputType type_;  // kOffsetFileInput or kFileInput.
+  MappedFile *file_;
+  MemoryStreambuf buf_;
+  std::istream is_;
+};
+
+
+MappedStreamRegion::MappedStreamRegion(): file_(NULL), data_(NULL), size_(0) { }
+
+bool MappedStreamRegion::Init(std::istream &is) {
+  Clear();
+  MemoryStreambuf *buf = dynamic_cast<MemoryStreambuf*>(is.rdbuf());
+  if (buf == NULL || buf->File() == NULL || !is.good()) return false;
+  file_ = buf->File();
+  MappedFileCache::AddReference(file_);
+  data_ = buf->Current();
+  size_ = buf->NumRemaining();
+  return true;
+}
+
+void MappedStreamRegion::Clear() {
+  if (file_ != NULL) MappedFileCache::Release(file_);
+  file_ = NULL;
+  data_ = NULL;
+  size_ = 0;
+}
+#else
+MappedStreamRegion::MappedStreamRegion(): file_(NULL), data_(NULL), size_(0) { }
+bool MappedStreamRegion::Init(std::istream &is) { return false; }
+void MappedStreamRegion::Clear() { }
+#endif
+
+void MappedStreamRegion::Swap(MappedStreamRegion *other) {
+  std::swap(file_, other->file_);
+  std::swap(data_, other->data_);
+  std::swap(size_, other->size_);
+}
+
+
+#ifdef HAVE_ZLIB
+// Returns true if "filename" ends in ".gz"; Input and Output compress and
+// decompress such files themselves.
+static bool IsGzipFilename(const std::string &filename) {
+  return (filename.size() > 3 &&
+          filename.compare(filename.size() - 3, 3, ".gz") == 0);
+}
+
+// Returns true if "word" means the same to the shell whether or not it is
+// quoted, so we can interpret a command containing it ourselves.
+static bool IsPlainShellWord(const std::string &word) {
+  return (!word.empty() && word[0] != '-' &&
+          word.find_first_of("\"'`$\\*?[]{}()<>|;&~!#") == std::string::npos);
+}
+
+// If "rxfilename" is a pipe that just decompresses one gzip file, i.e. it is
+// like "gunzip -c foo.gz |", "gzip -cd foo.gz |" or "zcat foo.gz |", outputs
+// the filename and returns true.
+static bool ParseGunzipPipe(const std::string &rxfilename,
+                            std::string *filename) {
+  std::vector<std::string> words;
+  SplitStringToVector(rxfilename.substr(0, rxfilename.size() - 1), " \t", true,
+                      &words);
+  bool is_gunzip =
+      (words.size() == 2 && words[0] == "zcat") ||
+      (words.size() == 3 && ((words[0] == "gunzip" && words[1] == "-c") ||
+                             (words[0] == "gzip" &&
+                              (words[1] == "-cd" || words[1] == "-dc"))));
+  if (!is_gunzip || !IsPlainShellWord(words.back())) return false;
+  *filename = words.back();
+  return true;
+}
+
+// If "wxfilename" is a pipe that just compresses to one file, i.e. it is like
+// "| gzip -c > foo.gz", outputs the filename and returns true.
+static bool ParseGzipPipe(const std::string &wxfilename,
+                          std::string *filename) {
+  std::vector<std::string> words;
+  SplitStringToVector(wxfilename.substr(1), " \t", true, &words);
+  if (words.size() == 3 && words[2].size() > 1 && words[2][0] == '>') {
+    // "gzip -c >foo.gz".
+    words.push_back(words[2].substr(1));
+    words[2] = ">";
+  }
+  if (words.size() != 4 || words[0] != "gzip" || words[1] != "-c" ||
+      words[2] != ">" || !IsPlainShellWord(words[3]))
+    return false;
+  *filename = words[3];
+  return true;
+}
+
+// Returns true if Input reads "rxfilename", of type "type", with
+// GzipInputImpl.
+static bool IsGzipInput(const std::string &rxfilename, InputType type) {
+  std::string filename;
+  size_t offset;
+  switch (type) {
+    case kFileInput:
+      return IsGzipFilename(rxfilename);
+    case kOffsetFileInput:
+      OffsetFileInputImpl::SplitFilename(rxfilename, &filename, &offset);
+      return IsGzipFilename(filename);
+    case kPipeInput:
+      return ParseGunzipPipe(rxfilename, &filename);
+    default:
+      return false;
+  }
+}
+
+// Returns true if Output writes "wxfilename", of type "type", with
+// GzipOutputImpl.
+static bool IsGzipOutput(const std::string &wxfilename, OutputType type) {
+  std::string filename;
+  return ((type == kFileOutput && IsGzipFilename(wxfilename)) ||
+          (type == kPipeOutput && ParseGzipPipe(wxfilename, &filename)));
+}
+
+// GzipInputImpl reads gzip-compressed files with GzipInputStreambuf: files
+// whose names end in .gz (type kFileInput), offsets into them such as
+// foo.ark.gz:12345 (kOffsetFileInput; see kaldi-gzipbuf.h), and pipes that
+// just decompress such a file (kPipeInput; see ParseGunzipPipe()).
+class GzipInputImpl: public InputImplBase {
+ public:
+  explicit GzipInputImpl(InputType type): type_(type), is_(&buf_) { }
+
+  // Like OffsetFileInputImpl::Open(), this may be called when already open;
+  // if it is the same file we just seek.
+  virtual bool Open(const std::string &rxfilename, bool binary) {
+    std::string filename;
+    size_t offset = 0;
+    if (type_ == kOffsetFileInput)
+      OffsetFileInputImpl::SplitFilename(rxfilename, &filename, &offset);
+    else if (type_ == kPipeInput)
+      ParseGunzipPipe(rxfilename, &filename);
+    else
+      filename = rxfilename;
+    is_.clear();
+    return buf_.Open(filename, offset);
+  }
+
+  virtual std::istream &Stream() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "GzipInputImpl::Stream(), file is not open.";
+    return is_;
+  }
+
+  virtual void Close() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "GzipInputImpl::Close(), file is not open.";
+    buf_.Close();
+  }
+
+  virtual InputType MyType() { return type_; }
+
+ private:
+  InputType type_;
+  GzipInputStreambuf buf_;
+  std::istream is_;
+};
+
+// GzipOutputImpl writes gzip-compressed files with GzipOutputStreambuf, for
+// filenames ending in .gz and pipes that just compress to such a file (see
+// ParseGzipPipe()).
+class GzipOutputImpl: public OutputImplBase {
+ public:
+  GzipOutputImpl(): os_(&buf_) { }
+
+  virtual bool Open(const std::string &wxfilename, bool binary) {
+    if (buf_.IsOpen()) KALDI_ERR << "GzipOutputImpl::Open(), "
+                                 << "open called on already open file.";
+    filename_ = wxfilename;
+    if (ClassifyWxfilename(wxfilename) == kPipeOutput)
+      ParseGzipPipe(wxfilename, &filename_);
+    os_.clear();
+    return buf_.Open(filename_);
+  }
+
+  virtual std::ostream &Stream() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "GzipOutputImpl::Stream(), file is not open.";
+    return os_;
+  }
+
+  virtual bool Close() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "GzipOutputImpl::Close(), file is not open.";
+    bool ok = !os_.fail();
+    return buf_.Close() && ok;
+  }
+
+  virtual ~GzipOutputImpl() {
+    if (buf_.IsOpen() && !buf_.Close())
+      KALDI_ERR << "Error closing output file " << filename_;
+  }
+
+ private:
+  std::string filename_;
+  GzipOutputStreambuf buf_;
+  std::ostream os_;
+};
+
+static bool IsGzipInputImpl(InputImplBase *impl) {
+  return (dynamic_cast<GzipInputImpl*>(impl) != NULL);
+}
+#else
+static bool IsGzipInput(const std::string &rxfilename, InputType type) {
+  return false;
+}
+static bool IsGzipOutput(const std::string &wxfilename, OutputType type) {
+  return false;
+}
+static bool IsGzipInputImpl(InputImplBase *impl) { return false; }
+#endif  // HAVE_ZLIB
+
 
 Output::Output(const std::string &rxfilename, bool binary, bool write_header): impl_(NULL) {
   if (!Open(rxfilename, binary, write_header))  {
@@ -639,7 +1071,11 @@ bool Output::Open(const std::string &wxfn, bool binary, bool header) {
   OutputType type = ClassifyWxfilename(wxfn);
   KALDI_ASSERT(impl_ == NULL);
 
-  if (type ==  kFileOutput) {
+  if (IsGzipOutput(wxfn, type)) {
+#ifdef HAVE_ZLIB
+    impl_ = new GzipOutputImpl();
+#endif
+  } else if (type ==  kFileOutput) {
     impl_ = new FileOutputImpl();
   } else if (type == kStandardOutput) {
     impl_ = new StandardOutputImpl();
@@ -685,34 +1121,64 @@ void Input::Close() {
 
 bool Input::OpenInternal(const std::string &rxfilename,
                          bool file_binary,
+                         bool map_file,
                          bool *contents_binary) {
   InputType type = ClassifyRxfilename(rxfilename);
+  bool gzip = IsGzipInput(rxfilename, type);
   if (IsOpen()) {
     // May have to close the stream first.
-    if (type == kOffsetFileInput && impl_->MyType() == kOffsetFileInput) {
+    if (type == kOffsetFileInput && impl_->MyType() == kOffsetFileInput &&
+        gzip == IsGzipInputImpl(impl_)) {
       // We want to use the same object to Open... this is in case
       // the files are the same, so we can just seek.
-      if (!impl_->Open(rxfilename, file_binary)) {  // true is binary mode-- always open in binary.
-        delete impl_;
-        impl_ = NULL;
-        return false;
+      if (impl_->Open(rxfilename, file_binary)) {
+        // read the binary header, if requested.
+        if (contents_binary != NULL)
+          return InitKaldiInputStream(impl_->Stream(), contents_binary);
+        else return true;
       }
-      // read the binary header, if requested.
-      if (contents_binary != NULL)
-        return InitKaldiInputStream(impl_->Stream(), contents_binary);
-      else return true;
+      // Otherwise fall through to the code below, which will try again with a
+      // new object (e.g. the new file could not be memory-mapped).
+      delete impl_;
+      impl_ = NULL;
     } else {
       Close();
       // and fall through to code below which actually opens the file.
     }
   }
-  if (type ==  kFileInput) {
+  if (gzip) {
+#ifdef HAVE_ZLIB
+    impl_ = new GzipInputImpl(type);
+#endif
+  } else if (type ==  kFileInput) {
+#ifndef _MSC_VER
+    if (g_memory_mapped_input && file_binary && map_file) {
+      impl_ = new MappedFileInputImpl(kFileInput);
+      if (impl_->Open(rxfilename, file_binary)) {
+        if (contents_binary != NULL)
+          return InitKaldiInputStream(impl_->Stream(), contents_binary);
+        else return true;
+      }
+      delete impl_;  // Could not map the file; read it the normal way.
+    }
+#endif
     impl_ = new FileInputImpl();
   } else if (type == kStandardInput) {
     impl_ = new StandardInputImpl();
   } else if (type == kPipeInput) {
     impl_ = new PipeInputImpl();
   } else if (type == kOffsetFileInput) {
+#ifndef _MSC_VER
+    if (g_memory_mapped_input) {
+      impl_ = new MappedFileInputImpl(kOffsetFileInput);
+      if (impl_->Open(rxfilename, file_binary)) {
+        if (contents_binary != NULL)
+          return InitKaldiInputStream(impl_->Stream(), contents_binary);
+        else return true;
+      }
+      delete impl_;  // Could not map the file; read it the normal way.
+    }
+#endif
     impl_ = new OffsetFileInputImpl();
   } else {  // type == kNoInput
     KALDI_WARN << "Invalid input filename format "<<
@@ -68,6 +68,17 @@ class InputImplBase;  // Forward decl; defined in a .cc file
 //   [these are created by the Table and TableWriter classes; I may also write
 //    a program that creates them for arbitrary files]
 //
+// If Kaldi was compiled with zlib (HAVE_ZLIB), files whose names end in .gz are
+// compressed and decompressed by Input and Output themselves, and so are pipes
+// that just compress or decompress one such file, like "| gzip -c > foo.gz" and
+// "gunzip -c foo.gz |", which avoids starting a process and copying the data
+// through a pipe.  Offsets into .gz files (e.g. foo.ark.gz:1732, as written by
+// TableWriter with "ark,scp") work too: see kaldi-gzipbuf.h for how.  Note
+// that this goes by the name alone: a file named foo.gz is always written
+// compressed, and reading it fails if it is not in gzip (or zlib) format.  To
+// read or write such a file as it is, use a pipe, e.g. "cat foo.gz |" or
+// "| cat > foo.gz".
+//
 
 
 // Typical usage:
@@ -113,6 +124,49 @@ enum InputType {
 
 InputType ClassifyRxfilename(const std::string &rxfilename);
 
+// Offsets into files (e.g. /some/filename:12970, as in scp files written by
+// TableWriter with "ark,scp"), and files opened with Input::OpenMapped(), are
+// normally read by memory-mapping the whole file, where this is supported; the
+// mappings are shared between Input objects and a few recently used ones are
+// kept after the last Input using them is closed, so reading many objects from
+// the same archives avoids repeated open, seek and read calls.  This function
+// turns this on or off (it is on by default); it affects Input objects opened
+// afterwards.
+void SetMemoryMappedInput(bool enabled);
+
+struct MappedFile;  // Defined in a .cc file.
+
+// MappedStreamRegion gives direct access to the data of an Input stream that
+// is reading a memory-mapped file, so that objects can be used in place
+// without copying them (see MatrixViewHolder).  It holds a reference to the
+// mapping, so the data stays valid until Clear() is called or the object is
+// destroyed, even if the Input is closed.
+class MappedStreamRegion {
+ public:
+  MappedStreamRegion();
+
+  // If "is" is reading a memory-mapped file, sets Data() to the next unread
+  // byte and Size() to the number of bytes remaining, and returns true.
+  // Otherwise returns false (and the object is empty).  It does not move the
+  // stream position.
+  bool Init(std::istream &is);
+
+  void Clear();
+
+  const char *Data() const { return data_; }
+
+  size_t Size() const { return size_; }
+
+  void Swap(MappedStreamRegion *other);
+
+  ~MappedStreamRegion() { Clear(); }
+ private:
+  MappedFile *file_;
+  const char *data_;
+  size_t size_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedStreamRegion);
+};
+
 
 class Output {
  public:
@@ -201,6 +255,12 @@ class Input {
   // will throw).
   inline bool Open(const std::string &rxfilename, bool *contents_binary = NULL);
 
+  // As Open, but if rxfilename is an ordinary file it is memory-mapped where
+  // possible (Open only maps offsets into files), so that its data can be used
+  // in place through MappedStreamRegion.
+  inline bool OpenMapped(const std::string &rxfilename,
+                         bool *contents_binary = NULL);
+
   // As Open but (if the file system has text/binary modes) opens in text mode;
   // you shouldn't ever have to use this as in Kaldi we read even text files in
   // binary mode (and ignore the \r).
@@ -222,7 +282,8 @@ class Input {
   // don't worry about the status when we close them.
   ~Input();
  private:
-  bool OpenInternal(const std::string &rxfilename, bool file_binary, bool *contents_binary);
+  bool OpenInternal(const std::string &rxfilename, bool file_binary,
+                    bool map_file, bool *contents_binary);
   InputImplBase *impl_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(Input);
 };
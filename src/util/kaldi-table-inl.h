@@ -22,7 +22,12 @@
 #ifndef KALDI_UTIL_KALDI_TABLE_INL_H_
 #define KALDI_UTIL_KALDI_TABLE_INL_H_
 
+#include <pthread.h>
 #include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <sstream>
+#include "matrix/compressed-matrix.h"
 #include "util/kaldi-io.h"
 #include "util/text-utils.h"
 #include "util/stl-utils.h" // for StringHasher.
@@ -33,6 +38,20 @@ namespace kaldi {
 /// \addtogroup table_impl_types
 /// @{
 
+// Opens the archive or file "rxfilename" for reading objects of type
+// Holder::T: in text mode if the holder reads text, and memory-mapped if the
+// holder can use that (see HolderUsesMappedInput).  Does not read the
+// binary-mode header.
+template<class Holder>
+inline bool OpenTableInput(const std::string &rxfilename, Input *input) {
+  if (!Holder::IsReadInBinary())
+    return input->OpenTextMode(rxfilename);
+  else if (HolderUsesMappedInput<Holder>::value)
+    return input->OpenMapped(rxfilename, NULL);
+  else
+    return input->Open(rxfilename, NULL);
+}
+
 template<class Holder> class SequentialTableReaderImplBase {
  public:
   typedef typename Holder::T T;
@@ -45,6 +64,11 @@ template<class Holder> class SequentialTableReaderImplBase {
   virtual void FreeCurrent() = 0;
   virtual void Next() = 0;
   virtual bool Close() = 0;
+  // Swaps the current object into "other_holder" (after which the object is
+  // treated as freed, as after FreeCurrent()).  Valid whenever Value() would
+  // be valid, and throws in the same circumstances.  This is used by the
+  // background-reading code.
+  virtual void SwapHolder(Holder *other_holder) = 0;
   SequentialTableReaderImplBase() { }
   virtual ~SequentialTableReaderImplBase() { }
  private:
@@ -161,6 +185,11 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
       KALDI_WARN << "TableReader: FreeCurrent called at the wrong time.";
     }
   }
+  virtual void SwapHolder(Holder *other_holder) {
+    Value();  // Loads the object, or throws.
+    holder_.Swap(other_holder);
+    state_ = kLoadFailed;  // Same as after FreeCurrent().
+  }
   void Next() {
     while (1) {
       NextScpLine();
@@ -216,8 +245,7 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
       KALDI_ERR << "TableReader: LoadCurrent() called at the wrong time.";
     bool ans;
     // note, NULL means it doesn't read the binary-mode header
-    if (Holder::IsReadInBinary()) ans = data_input_.Open(data_rxfilename_, NULL);
-    else ans = data_input_.OpenTextMode(data_rxfilename_);
+    ans = OpenTableInput<Holder>(data_rxfilename_, &data_input_);
     if (!ans) {
       // May want to make this warning a VLOG at some point
       KALDI_WARN << "TableReader: failed to open file "
@@ -328,10 +356,7 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
 
     bool ans;
     // NULL means don't expect binary-mode header
-    if (Holder::IsReadInBinary())
-      ans = input_.Open(archive_rxfilename_, NULL);
-    else
-      ans = input_.OpenTextMode(archive_rxfilename_);
+    ans = OpenTableInput<Holder>(archive_rxfilename_, &input_);
     if (!ans) {  // header.
       KALDI_WARN << "TableReader: failed to open stream "
                  << PrintableRxfilename(archive_rxfilename_);
@@ -448,6 +473,12 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
     } else
       KALDI_WARN << "TableReader: FreeCurernt called at the wrong time.";
   }
+  virtual void SwapHolder(Holder *other_holder) {
+    if (state_ != kHaveObject)
+      KALDI_ERR << "SwapHolder() called on TableReader object at the wrong time.";
+    holder_.Swap(other_holder);
+    state_ = kFreedObject;
+  }
 
   virtual bool Close() {
     if (! this->IsOpen())
@@ -501,6 +532,345 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
   } state_;
 };
 
+// This is the implementation for SequentialTableReader when the "bg"
+// (background) option is given in the rspecifier.  It wraps another
+// SequentialTableReaderImplBase object (for the archive or script file), which
+// is used only by a background thread: that thread reads ahead up to
+// kQueueSize objects and puts them in a queue (handing them over with
+// SwapHolder()), so the calling thread only has to wait when the reading
+// can't keep up.  The behavior seen by the user is the same as without "bg".
+template<class Holder>  class SequentialTableReaderBackgroundImpl:
+      public SequentialTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  // The maximum number of objects that are read ahead.
+  static const int32 kQueueSize = 4;
+
+  // Takes ownership of "base_reader", which must already be open, and starts
+  // the background thread.
+  explicit SequentialTableReaderBackgroundImpl(
+      SequentialTableReaderImplBase<Holder> *base_reader):
+      base_reader_(base_reader), holders_(kQueueSize), keys_(kQueueSize),
+      failed_(kQueueSize, 0), head_(0), count_(0), freed_(false),
+      thread_done_(false), stop_(false), thread_running_(false) {
+    KALDI_ASSERT(base_reader_ != NULL && base_reader_->IsOpen());
+    for (int32 i = 0; i < kQueueSize; i++)
+      holders_[i] = new Holder;
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&not_empty_, NULL);
+    pthread_cond_init(&not_full_, NULL);
+    int ret = pthread_create(&thread_, NULL, RunThread,
+                             static_cast<void*>(this));
+    if (ret != 0)
+      KALDI_ERR << "TableReader: error creating background thread, errno was: "
+                << ret;
+    thread_running_ = true;
+  }
+
+  virtual bool Open(const std::string &rspecifier) {
+    KALDI_ERR << "Open() called on background TableReader object.";
+    return false;
+  }
+
+  virtual bool IsOpen() const { return (base_reader_ != NULL); }
+
+  virtual bool Done() const {
+    KALDI_ASSERT(IsOpen());
+    return !WaitForObject();
+  }
+
+  virtual std::string Key() {
+    if (!WaitForObject())
+      KALDI_ERR << "Key() called on TableReader object at the wrong time.";
+    return keys_[head_];
+  }
+
+  virtual const T &Value() {
+    if (!WaitForObject())
+      KALDI_ERR << "Value() called on TableReader object at the wrong time.";
+    if (failed_[head_])  // The error was printed in the background thread.
+      KALDI_ERR << "TableReader: failed to read object for key "
+                << keys_[head_];
+    if (freed_)
+      KALDI_ERR << "TableReader: you called Value() after FreeCurrent().";
+    return holders_[head_]->Value();
+  }
+
+  virtual void FreeCurrent() {
+    if (WaitForObject() && !freed_) {
+      holders_[head_]->Clear();
+      freed_ = true;
+    } else {
+      KALDI_WARN << "TableReader: FreeCurrent called at the wrong time.";
+    }
+  }
+
+  virtual void SwapHolder(Holder *other_holder) {
+    Value();  // Checks that there is an object, or throws.
+    holders_[head_]->Swap(other_holder);
+    freed_ = true;
+  }
+
+  virtual void Next() {
+    if (!WaitForObject())
+      KALDI_ERR << "TableReader: Next() called wrongly.";
+    holders_[head_]->Clear();
+    freed_ = false;
+    pthread_mutex_lock(&mutex_);
+    head_ = (head_ + 1) % kQueueSize;
+    count_--;
+    pthread_cond_signal(&not_full_);
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  virtual bool Close() {
+    if (!IsOpen())
+      KALDI_ERR << "Close() called on TableReader twice or otherwise wrongly.";
+    StopThread();
+    bool ans = base_reader_->Close();
+    delete base_reader_;
+    base_reader_ = NULL;
+    return ans;
+  }
+
+  virtual ~SequentialTableReaderBackgroundImpl() {
+    StopThread();
+    for (int32 i = 0; i < kQueueSize; i++)
+      delete holders_[i];
+    pthread_cond_destroy(&not_full_);
+    pthread_cond_destroy(&not_empty_);
+    pthread_mutex_destroy(&mutex_);
+    // The destructor of base_reader_ may throw if there was an error and the
+    // user did not call Close(), as for the other TableReader types.
+    delete base_reader_;
+  }
+
+ private:
+  static void *RunThread(void *arg) {
+    static_cast<SequentialTableReaderBackgroundImpl<Holder>*>(arg)->Run();
+    return NULL;
+  }
+
+  // This is what the background thread does.  An exception may not leave
+  // this thread, so errors from the base reader are recorded in error_ and
+  // rethrown in the calling thread once it has used up the queue.
+  void Run() {
+    try {
+      while (true) {
+        pthread_mutex_lock(&mutex_);
+        while (count_ == kQueueSize && !stop_)
+          pthread_cond_wait(&not_full_, &mutex_);
+        bool stop = stop_;
+        int32 slot = (head_ + count_) % kQueueSize;
+        pthread_mutex_unlock(&mutex_);
+        if (stop || base_reader_->Done()) break;
+        keys_[slot] = base_reader_->Key();
+        try {
+          base_reader_->SwapHolder(holders_[slot]);
+          failed_[slot] = false;
+        } catch (const std::exception &e) {
+          // This can only happen for scp files without the "p" option; we
+          // report the error when the user calls Value().
+          failed_[slot] = true;
+        }
+        pthread_mutex_lock(&mutex_);
+        count_++;
+        pthread_cond_signal(&not_empty_);
+        pthread_mutex_unlock(&mutex_);
+        base_reader_->Next();
+      }
+    } catch (const std::exception &e) {
+      error_ = e.what();
+      if (error_.empty()) error_ = "unknown error";
+    }
+    pthread_mutex_lock(&mutex_);
+    thread_done_ = true;
+    pthread_cond_signal(&not_empty_);
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  // Waits until the queue is nonempty or the background thread has finished.
+  // Returns true if there is a current object (i.e. we are not done).  Throws
+  // if the queue is empty because the background thread failed.
+  bool WaitForObject() const {
+    pthread_mutex_lock(&mutex_);
+    while (count_ == 0 && !thread_done_)
+      pthread_cond_wait(&not_empty_, &mutex_);
+    bool ans = (count_ != 0);
+    // error_ is only written before thread_done_ is set.
+    bool failed = (!ans && !error_.empty());
+    pthread_mutex_unlock(&mutex_);
+    if (failed)
+      KALDI_ERR << "TableReader: error reading in background thread: "
+                << error_;
+    return ans;
+  }
+
+  void StopThread() {
+    if (!thread_running_) return;
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_signal(&not_full_);
+    pthread_mutex_unlock(&mutex_);
+    if (pthread_join(thread_, NULL))
+      KALDI_ERR << "TableReader: error rejoining background thread.";
+    thread_running_ = false;
+  }
+
+  SequentialTableReaderImplBase<Holder> *base_reader_;
+  // holders_, keys_ and failed_ are a circular buffer; the queue consists of
+  // the count_ elements starting from head_.  Only the background thread
+  // writes to the elements outside the queue, and only the calling thread
+  // accesses the elements inside it.
+  std::vector<Holder*> holders_;
+  std::vector<std::string> keys_;
+  std::vector<char> failed_;  // not vector<bool>, whose elements share
+                              // storage, as the two threads write to it.
+  int32 head_;
+  int32 count_;
+  bool freed_;  // True if the user called FreeCurrent() on the current object.
+  bool thread_done_;  // True if the background thread has reached the end.
+  bool stop_;  // Tells the background thread to stop.
+  bool thread_running_;
+  std::string error_;  // The error from the background thread, if it failed.
+  pthread_t thread_;
+  mutable pthread_mutex_t mutex_;  // Protects head_, count_, thread_done_ and
+                                   // stop_.
+  mutable pthread_cond_t not_empty_;
+  mutable pthread_cond_t not_full_;
+};
+
+
+// This is the implementation for SequentialTableReader when the "shards=N"
+// option is given in the rspecifier.  Each shard (archive or script file) is
+// read by its own SequentialTableReaderBackgroundImpl object, so the shards
+// are read in parallel.  If the "s" option is given the objects are returned
+// in key order, which merges the shards if each of them is sorted; otherwise
+// they are taken from each shard in turn.
+template<class Holder>  class SequentialTableReaderShardedImpl:
+      public SequentialTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  SequentialTableReaderShardedImpl(): current_(-1) { }
+
+  virtual bool Open(const std::string &rspecifier) {
+    if (IsOpen())
+      KALDI_ERR << "TableReader: Open() called on open sharded TableReader.";
+    RspecifierType rs = ClassifyRspecifier(rspecifier, NULL, &opts_);
+    KALDI_ASSERT(opts_.num_shards > 0 && rs != kNoRspecifier);
+    for (int32 shard = 0; shard < opts_.num_shards; shard++) {
+      std::string shard_rspecifier = ShardSpecifier(rspecifier, shard);
+      SequentialTableReaderImplBase<Holder> *reader;
+      if (rs == kArchiveRspecifier)
+        reader = new SequentialTableReaderArchiveImpl<Holder>();
+      else
+        reader = new SequentialTableReaderScriptImpl<Holder>();
+      if (!reader->Open(shard_rspecifier)) {
+        delete reader;
+        KALDI_WARN << "TableReader: failed to open shard " << shard_rspecifier;
+        CloseShards();
+        return false;
+      }
+      shards_.push_back(new SequentialTableReaderBackgroundImpl<Holder>(reader));
+    }
+    SelectShard(0);
+    return true;
+  }
+
+  virtual bool IsOpen() const { return !shards_.empty(); }
+
+  virtual bool Done() const {
+    KALDI_ASSERT(IsOpen());
+    return (current_ == -1);
+  }
+
+  virtual std::string Key() {
+    if (Done())
+      KALDI_ERR << "Key() called on TableReader object at the wrong time.";
+    return shards_[current_]->Key();
+  }
+
+  virtual const T &Value() {
+    if (Done())
+      KALDI_ERR << "Value() called on TableReader object at the wrong time.";
+    return shards_[current_]->Value();
+  }
+
+  virtual void FreeCurrent() {
+    if (Done())
+      KALDI_WARN << "TableReader: FreeCurrent called at the wrong time.";
+    else
+      shards_[current_]->FreeCurrent();
+  }
+
+  virtual void SwapHolder(Holder *other_holder) {
+    if (Done())
+      KALDI_ERR << "TableReader: SwapHolder() called at the wrong time.";
+    shards_[current_]->SwapHolder(other_holder);
+  }
+
+  virtual void Next() {
+    if (Done())
+      KALDI_ERR << "TableReader: Next() called wrongly.";
+    shards_[current_]->Next();
+    SelectShard(current_ + 1);
+  }
+
+  virtual bool Close() {
+    if (!IsOpen())
+      KALDI_ERR << "Close() called on TableReader twice or otherwise wrongly.";
+    return CloseShards();
+  }
+
+  virtual ~SequentialTableReaderShardedImpl() {
+    // As for the other TableReader types, this may throw if there was an
+    // error and the user did not call Close().
+    for (size_t i = 0; i < shards_.size(); i++)
+      delete shards_[i];
+  }
+
+ private:
+  // Sets current_ to the shard that the next object comes from: the first
+  // shard that is not done, searching from shard "start" onwards, or the one
+  // whose next key is smallest if opts_.sorted; or -1 if all are done.
+  void SelectShard(int32 start) {
+    int32 num_shards = shards_.size();
+    std::string best_key;
+    current_ = -1;
+    for (int32 i = 0; i < num_shards; i++) {
+      int32 shard = (start + i) % num_shards;
+      if (shards_[shard]->Done()) continue;
+      if (!opts_.sorted) {
+        current_ = shard;
+        return;
+      }
+      std::string key = shards_[shard]->Key();
+      if (current_ == -1 || key < best_key) {
+        current_ = shard;
+        best_key = key;
+      }
+    }
+  }
+
+  // Closes and deletes the shards; returns false if any Close() failed.
+  bool CloseShards() {
+    bool ans = true;
+    for (size_t i = 0; i < shards_.size(); i++) {
+      if (!shards_[i]->Close()) ans = false;
+      delete shards_[i];
+    }
+    shards_.clear();
+    current_ = -1;
+    return ans;
+  }
+
+  RspecifierOptions opts_;
+  std::vector<SequentialTableReaderImplBase<Holder>*> shards_;
+  int32 current_;  // The shard the current object comes from, or -1 if done.
+};
+
 
 template<class Holder>
 SequentialTableReader<Holder>::SequentialTableReader(const std::string &rspecifier): impl_(NULL) {
@@ -515,13 +885,20 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
       KALDI_ERR << "SequentialTableReader<Holder>::Open(), could not close previously open object.";
   // now impl_ will be NULL.
 
-  RspecifierType wt = ClassifyRspecifier(rspecifier, NULL, NULL);
+  RspecifierOptions opts;
+  RspecifierType wt = ClassifyRspecifier(rspecifier, NULL, &opts);
   switch (wt) {
     case kArchiveRspecifier:
-      impl_ = new SequentialTableReaderArchiveImpl<Holder>();
+      if (opts.num_shards > 0)
+        impl_ = new SequentialTableReaderShardedImpl<Holder>();
+      else
+        impl_ = new SequentialTableReaderArchiveImpl<Holder>();
       break;
     case kScriptRspecifier:
-      impl_ = new SequentialTableReaderScriptImpl<Holder>();
+      if (opts.num_shards > 0)
+        impl_ = new SequentialTableReaderShardedImpl<Holder>();
+      else
+        impl_ = new SequentialTableReaderScriptImpl<Holder>();
       break;
     case kNoRspecifier: default:
       KALDI_WARN << "Invalid rspecifier " << rspecifier;
@@ -532,7 +909,10 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
     impl_ = NULL;
     return false;  // sub-object will have printed warnings.
   }
-  else return true;
+  // The sharded reader already reads each shard in a background thread.
+  if (opts.background && opts.num_shards == 0)
+    impl_ = new SequentialTableReaderBackgroundImpl<Holder>(impl_);
+  return true;
 }
 
 template<class Holder>
@@ -627,6 +1007,23 @@ template<class Holder> class TableWriterImplBase {
 };
 
 
+// If the "idx" option was given but the archive is not being written to an
+// ordinary file, warns and turns the option off.  If the option was not given,
+// removes any index left over from an earlier archive of the same name, since
+// it would be out of date (its modification time may not show this).
+inline void CheckIndexOption(const std::string &archive_wxfilename,
+                             WspecifierOptions *opts) {
+  bool is_file = (ClassifyWxfilename(archive_wxfilename) == kFileOutput);
+  if (opts->index && !is_file) {
+    KALDI_WARN << "TableWriter: not writing an index for archive "
+               << PrintableWxfilename(archive_wxfilename)
+               << " as it is not an ordinary file.";
+    opts->index = false;
+  } else if (!opts->index && is_file) {
+    RemoveArchiveIndex(archive_wxfilename);
+  }
+}
+
 // The implementation of TableWriter we use when writing directly
 // to an archive with no associated scp.
 template<class Holder>
@@ -650,6 +1047,8 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
                                            NULL,
                                            &opts_);
     KALDI_ASSERT(ws == kArchiveWspecifier);  // or wrongly called.
+    CheckIndexOption(archive_wxfilename_, &opts_);
+    index_.clear();
 
     if (output_.Open(archive_wxfilename_, opts_.binary, false)) {  // false means no binary header.
       state_ = kOpen;
@@ -689,6 +1088,9 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
     if (!IsToken(key)) // e.g. empty string or has spaces...
       KALDI_ERR << "TableWriter: using invalid key " << key;
     output_.Stream() << key << ' ';
+    if (opts_.index)
+      index_.push_back(std::make_pair(
+          key, static_cast<int64>(output_.Stream().tellp())));
     if (!Holder::Write(output_.Stream(), opts_.binary, value)) {
       KALDI_WARN << "TableWriter: write failure to "
                  << PrintableWxfilename(archive_wxfilename_);
@@ -733,6 +1135,11 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
       return false;
     }
     state_ = kUninitialized;
+    // The index is written after the archive is closed, so it is newer.
+    if (opts_.index &&
+        !WriteArchiveIndex(ArchiveIndexFilename(archive_wxfilename_), index_))
+      return false;
+    index_.clear();
     return true;
   }
 
@@ -750,6 +1157,8 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
   Output output_;
   WspecifierOptions opts_;
   std::string archive_wxfilename_;
+  // (key, offset) pairs for the archive index, if opts_.index.
+  std::vector<std::pair<std::string, int64> > index_;
   enum {               // is stream open?
     kUninitialized,    // no
     kOpen,             // yes
@@ -940,6 +1349,8 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
       KALDI_WARN << "When writing to both archive and script, the script file "
           "will generally not be interpreted correctly unless the archive is "
           "an actual file: wspecifier = " << wspecifier;
+    CheckIndexOption(archive_wxfilename_, &opts_);
+    index_.clear();
 
     if (!archive_output_.Open(archive_wxfilename_, opts_.binary, false)) {  // false means no binary header.
       state_ = kUninitialized;
@@ -1006,6 +1417,9 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
     // script file, to make it easier to unwind errors later.
     std::ostream &script_os = script_output_.Stream();
     script_output_.Stream() << key << ' ' << offset_rxfilename << '\n';
+    if (opts_.index)
+      index_.push_back(std::make_pair(key,
+                                      static_cast<int64>(archive_os_pos)));
 
     if (!Holder::Write(archive_output_.Stream(), opts_.binary, value)) {
       KALDI_WARN << "TableWriter: write failure to"
@@ -1060,6 +1474,11 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
       if (!script_output_.Close()) close_success = false;
     bool ans = close_success && (state_ != kWriteError);
     state_ = kUninitialized;
+    // The index is written after the archive is closed, so it is newer.
+    if (ans && opts_.index &&
+        !WriteArchiveIndex(ArchiveIndexFilename(archive_wxfilename_), index_))
+      ans = false;
+    index_.clear();
     return ans;
   }
 
@@ -1081,6 +1500,8 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
   std::string archive_wxfilename_;
   std::string script_wxfilename_;
   std::string wspecifier_;
+  // (key, offset) pairs for the archive index, if opts_.index.
+  std::vector<std::pair<std::string, int64> > index_;
   enum {               // is stream open?
     kUninitialized,    // no
     kOpen,             // yes
@@ -1088,6 +1509,398 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
   } state_;
 };
 
+// This Holder type is used internally by TableWriterBackgroundImpl: the
+// object is an already-serialized object (the output of some other Holder's
+// Write() function), which is written out unchanged.  It is only for writing.
+class SerializedObjectHolder {
+ public:
+  typedef std::string T;
+  static bool Write(std::ostream &os, bool binary, const T &t) {
+    os.write(t.data(), t.size());
+    return os.good();
+  }
+};
+
+// Returns a new, not-yet-opened TableWriter implementation for the given
+// wspecifier type, or NULL if it is kNoWspecifier.
+template<class Holder>
+TableWriterImplBase<Holder> *NewTableWriterImpl(WspecifierType wtype) {
+  switch (wtype) {
+    case kBothWspecifier: return new TableWriterBothImpl<Holder>();
+    case kArchiveWspecifier: return new TableWriterArchiveImpl<Holder>();
+    case kScriptWspecifier: return new TableWriterScriptImpl<Holder>();
+    case kNoWspecifier: default: return NULL;
+  }
+}
+
+// If "*data" is a binary-mode serialized Matrix<BaseFloat> or Matrix<double>
+// (as written by KaldiObjectHolder), replaces it with the serialized
+// CompressedMatrix, which Matrix::Read() reads transparently.  Otherwise,
+// including when the matrix is followed by other data (i.e. the object only
+// starts with a matrix), leaves it unchanged.
+inline void CompressSerializedMatrix(std::string *data) {
+  // The binary-mode header "\0B" is followed by the token "FM " or "DM ".
+  if (data->size() < 5 || (*data)[0] != '\0' || (*data)[1] != 'B' ||
+      (data->compare(2, 3, "FM ") != 0 && data->compare(2, 3, "DM ") != 0))
+    return;
+  std::istringstream is(*data);
+  is.get();
+  is.get();  // Skip over the binary-mode header.
+  Matrix<BaseFloat> mat;
+  try {
+    mat.Read(is, true);
+  } catch (const std::exception &e) {
+    return;  // Not expected; leave the data as it was.
+  }
+  if (is.peek() != EOF)
+    return;  // Not just a matrix; compressing it would lose the rest.
+  CompressedMatrix cmat(mat);
+  std::ostringstream os;
+  InitKaldiOutputStream(os, true);
+  cmat.Write(os, true);
+  *data = os.str();
+}
+
+// This is the implementation of TableWriter used when the "bg" (background)
+// or "cm" (compress) options are given in the wspecifier.  Write() serializes
+// the object to a string (objects are not in general copyable) and puts it in
+// a queue of at most kQueueSize objects; a background thread takes them from
+// the queue, compresses them if requested, and writes them using the regular
+// archive, script or both implementation instantiated on
+// SerializedObjectHolder, so the output (including the offsets in the scp
+// file) is the same as it would be without "bg".
+template<class Holder>
+class TableWriterBackgroundImpl: public TableWriterImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  static const int32 kQueueSize = 16;
+
+  TableWriterBackgroundImpl(): base_writer_(NULL), stop_(false),
+                               write_error_(false), num_flush_requests_(0),
+                               num_flushes_done_(0) { }
+
+  virtual bool Open(const std::string &wspecifier) {
+    if (IsOpen())
+      if (!Close())
+        KALDI_ERR << "TableWriter: opening stream, error closing previously "
+                  << "open stream.";
+    WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, &opts_);
+    base_writer_ = NewTableWriterImpl<SerializedObjectHolder>(wtype);
+    KALDI_ASSERT(base_writer_ != NULL);  // or wrongly called.
+    if (!base_writer_->Open(wspecifier)) {
+      delete base_writer_;
+      base_writer_ = NULL;
+      return false;
+    }
+    stop_ = false;
+    write_error_ = false;
+    num_flush_requests_ = 0;
+    num_flushes_done_ = 0;
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&not_empty_, NULL);
+    pthread_cond_init(&not_full_, NULL);
+    pthread_cond_init(&flushed_, NULL);
+    int ret = pthread_create(&thread_, NULL, RunThread,
+                             static_cast<void*>(this));
+    if (ret != 0)
+      KALDI_ERR << "TableWriter: error creating background thread, errno was: "
+                << ret;
+    return true;
+  }
+
+  virtual bool IsOpen() const { return (base_writer_ != NULL); }
+
+  // Returns false if writing this object or an earlier one failed; errors for
+  // the most recent objects may only be detected by later calls or by Close().
+  virtual bool Write(const std::string &key, const T &value) {
+    if (!IsOpen())
+      KALDI_ERR << "TableWriter: Write called on invalid stream";
+    if (!IsToken(key))  // e.g. empty string or has spaces...
+      KALDI_ERR << "TableWriter: using invalid key " << key;
+    std::ostringstream os;
+    if (!Holder::Write(os, opts_.binary, value)) {
+      KALDI_WARN << "TableWriter: failed to write data for key " << key;
+      return false;
+    }
+    return Enqueue(key, os.str(), false);
+  }
+
+  // Waits until the background thread has written the objects queued so far
+  // and flushed the output, as Flush() does for the other writers.
+  virtual void Flush() {
+    if (!IsOpen()) {
+      KALDI_WARN << "TableWriter: Flush called on not-open writer.";
+      return;
+    }
+    pthread_mutex_lock(&mutex_);
+    int64 request = ++num_flush_requests_;
+    pthread_mutex_unlock(&mutex_);
+    Enqueue("", "", true);
+    pthread_mutex_lock(&mutex_);
+    while (num_flushes_done_ < request)
+      pthread_cond_wait(&flushed_, &mutex_);
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  virtual bool Close() {
+    if (!IsOpen())
+      KALDI_ERR << "TableWriter: Close called on a stream that was not open.";
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_signal(&not_empty_);
+    pthread_mutex_unlock(&mutex_);
+    if (pthread_join(thread_, NULL))
+      KALDI_ERR << "TableWriter: error rejoining background thread.";
+    pthread_cond_destroy(&flushed_);
+    pthread_cond_destroy(&not_full_);
+    pthread_cond_destroy(&not_empty_);
+    pthread_mutex_destroy(&mutex_);
+    bool ans = base_writer_->Close() && !write_error_;
+    delete base_writer_;
+    base_writer_ = NULL;
+    return ans;
+  }
+
+  // May throw on write error if Close was not called.
+  virtual ~TableWriterBackgroundImpl() {
+    if (IsOpen() && !Close())
+      KALDI_ERR << "At TableWriter destructor: Write failed or stream close "
+                << "failed.";
+  }
+
+ private:
+  struct QueueElement {
+    std::string key;
+    std::string data;  // The serialized object.
+    bool flush;  // If true, this is a request to flush; key and data unused.
+  };
+
+  // Adds an element to the queue, waiting while it is full.  Returns false if
+  // the background thread has already had a write error.
+  bool Enqueue(const std::string &key, const std::string &data, bool flush) {
+    pthread_mutex_lock(&mutex_);
+    while (queue_.size() >= static_cast<size_t>(kQueueSize))
+      pthread_cond_wait(&not_full_, &mutex_);
+    bool ans = !write_error_;
+    queue_.push_back(QueueElement());
+    queue_.back().key = key;
+    queue_.back().data = data;
+    queue_.back().flush = flush;
+    pthread_cond_signal(&not_empty_);
+    pthread_mutex_unlock(&mutex_);
+    if (!ans)
+      KALDI_WARN << "TableWriter: writing to TableWriter that had an earlier "
+                 << "write error.";
+    return ans;
+  }
+
+  static void *RunThread(void *arg) {
+    static_cast<TableWriterBackgroundImpl<Holder>*>(arg)->Run();
+    return NULL;
+  }
+
+  // This is what the background thread does: it writes the queued objects in
+  // order until Close() sets stop_ and the queue is empty.
+  void Run() {
+    while (true) {
+      QueueElement elem;
+      pthread_mutex_lock(&mutex_);
+      while (queue_.empty() && !stop_)
+        pthread_cond_wait(&not_empty_, &mutex_);
+      if (queue_.empty()) {  // stop_ was set and there is nothing left.
+        pthread_mutex_unlock(&mutex_);
+        return;
+      }
+      elem.key.swap(queue_.front().key);
+      elem.data.swap(queue_.front().data);
+      elem.flush = queue_.front().flush;
+      queue_.pop_front();
+      pthread_cond_signal(&not_full_);
+      pthread_mutex_unlock(&mutex_);
+
+      if (elem.flush) {
+        try {
+          base_writer_->Flush();
+        } catch (const std::exception &e) {
+          KALDI_WARN << "TableWriter: error flushing output.";
+        }
+        pthread_mutex_lock(&mutex_);
+        num_flushes_done_++;
+        pthread_cond_broadcast(&flushed_);
+        pthread_mutex_unlock(&mutex_);
+        continue;
+      }
+      if (opts_.compress && opts_.binary)
+        CompressSerializedMatrix(&elem.data);
+      bool ok;
+      try {
+        ok = base_writer_->Write(elem.key, elem.data);
+      } catch (const std::exception &e) {
+        ok = false;
+      }
+      if (!ok) {
+        pthread_mutex_lock(&mutex_);
+        write_error_ = true;
+        pthread_mutex_unlock(&mutex_);
+      }
+    }
+  }
+
+  TableWriterImplBase<SerializedObjectHolder> *base_writer_;
+  WspecifierOptions opts_;
+  std::deque<QueueElement> queue_;
+  bool stop_;  // Set by Close() to tell the background thread to finish.
+  bool write_error_;  // Set by the background thread if a write failed.
+  // Flush() waits until num_flushes_done_ reaches the number of its request.
+  int64 num_flush_requests_;
+  int64 num_flushes_done_;
+  pthread_t thread_;
+  pthread_mutex_t mutex_;  // Protects queue_, stop_, write_error_ and the
+                           // flush counts.
+  pthread_cond_t not_empty_;
+  pthread_cond_t not_full_;
+  pthread_cond_t flushed_;
+};
+
+
+// This is the implementation of TableWriter used when the "shards=N" option
+// is given in the wspecifier.  Each object is written to the shard given by
+// KeyShard() by one of N TableWriterBackgroundImpl objects, so the shards are
+// written in parallel.  If a single script file is to be written, each shard
+// writes its own script file to a temporary file (the shard's archive
+// filename plus ".scp.tmp") and Close() merges them in the order of writing.
+template<class Holder>
+class TableWriterShardedImpl: public TableWriterImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  TableWriterShardedImpl(): merge_script_(false) { }
+
+  virtual bool Open(const std::string &wspecifier) {
+    if (IsOpen())
+      if (!Close())
+        KALDI_ERR << "TableWriter: opening stream, error closing previously "
+                  << "open stream.";
+    WspecifierType ws = ClassifyWspecifier(wspecifier, NULL,
+                                           &script_wxfilename_, &opts_);
+    KALDI_ASSERT(opts_.num_shards > 0 &&
+                 (ws == kArchiveWspecifier || ws == kBothWspecifier));
+    merge_script_ = (ws == kBothWspecifier &&
+                     script_wxfilename_.find("JOB") == std::string::npos);
+    for (int32 shard = 0; shard < opts_.num_shards; shard++) {
+      std::string shard_wspecifier = ShardSpecifier(wspecifier, shard);
+      if (merge_script_) {
+        std::string shard_archive;
+        ClassifyWspecifier(shard_wspecifier, &shard_archive, NULL, NULL);
+        temp_scripts_.push_back(shard_archive + ".scp.tmp");
+        shard_wspecifier = shard_wspecifier.substr(
+            0, shard_wspecifier.find(':') + 1) + shard_archive + ',' +
+            temp_scripts_.back();
+      }
+      TableWriterBackgroundImpl<Holder> *writer =
+          new TableWriterBackgroundImpl<Holder>();
+      if (!writer->Open(shard_wspecifier)) {
+        delete writer;
+        KALDI_WARN << "TableWriter: failed to open shard " << shard_wspecifier;
+        merge_script_ = false;
+        if (!shards_.empty())
+          Close();
+        return false;
+      }
+      shards_.push_back(writer);
+    }
+    return true;
+  }
+
+  virtual bool IsOpen() const { return !shards_.empty(); }
+
+  virtual bool Write(const std::string &key, const T &value) {
+    if (!IsOpen())
+      KALDI_ERR << "TableWriter: Write called on invalid stream";
+    if (!IsToken(key))  // e.g. empty string or has spaces...
+      KALDI_ERR << "TableWriter: using invalid key " << key;
+    int32 shard = KeyShard(key, shards_.size());
+    if (merge_script_)
+      shard_of_.push_back(shard);
+    return shards_[shard]->Write(key, value);
+  }
+
+  virtual void Flush() {
+    for (size_t i = 0; i < shards_.size(); i++)
+      shards_[i]->Flush();
+  }
+
+  virtual bool Close() {
+    if (!IsOpen())
+      KALDI_ERR << "TableWriter: Close called on a stream that was not open.";
+    bool ans = true;
+    for (size_t i = 0; i < shards_.size(); i++) {
+      if (!shards_[i]->Close()) ans = false;
+      delete shards_[i];
+    }
+    shards_.clear();
+    if (merge_script_ && ans)
+      ans = MergeScripts();
+    for (size_t i = 0; i < temp_scripts_.size(); i++)
+      std::remove(temp_scripts_[i].c_str());
+    temp_scripts_.clear();
+    shard_of_.clear();
+    return ans;
+  }
+
+  // May throw on write error if Close was not called.
+  virtual ~TableWriterShardedImpl() {
+    if (IsOpen() && !Close())
+      KALDI_ERR << "At TableWriter destructor: Write failed or stream close "
+                << "failed.";
+  }
+
+ private:
+  // Writes the script file from the shards' temporary script files, in the
+  // order in which the objects were written.  Returns true on success.
+  bool MergeScripts() {
+    std::vector<std::vector<std::pair<std::string, std::string> > > scripts(
+        temp_scripts_.size());
+    for (size_t i = 0; i < temp_scripts_.size(); i++)
+      if (!ReadScriptFile(temp_scripts_[i], true, &scripts[i]))
+        return false;
+    std::vector<std::pair<std::string, std::string> > script;
+    script.reserve(shard_of_.size());
+    std::vector<size_t> next(scripts.size(), 0);
+    for (size_t i = 0; i < shard_of_.size(); i++) {
+      int32 shard = shard_of_[i];
+      if (next[shard] >= scripts[shard].size()) {
+        KALDI_WARN << "TableWriter: script file for shard " << (shard + 1)
+                   << " is too short: " << temp_scripts_[shard];
+        return false;
+      }
+      script.push_back(scripts[shard][next[shard]++]);
+    }
+    Output output;
+    if (!output.Open(script_wxfilename_, false, false)) {  // text mode.
+      KALDI_WARN << "TableWriter: error opening script file "
+                 << PrintableWxfilename(script_wxfilename_);
+      return false;
+    }
+    if (!WriteScriptFile(output.Stream(), script) || !output.Close()) {
+      KALDI_WARN << "TableWriter: error writing script file "
+                 << PrintableWxfilename(script_wxfilename_);
+      return false;
+    }
+    return true;
+  }
+
+  WspecifierOptions opts_;
+  std::vector<TableWriterBackgroundImpl<Holder>*> shards_;
+  std::string script_wxfilename_;
+  bool merge_script_;  // True if we write one script file for all shards.
+  std::vector<std::string> temp_scripts_;  // The shards' script files, if
+                                           // merge_script_.
+  std::vector<int32> shard_of_;  // The shard of each object written, in order,
+                                 // if merge_script_.
+};
+
 
 template<class Holder>
 TableWriter<Holder>::TableWriter(const std::string &wspecifier): impl_(NULL) {
@@ -1111,21 +1924,18 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
       KALDI_ERR << "TableWriter::Open, failed to close previously open writer.";
   }
   KALDI_ASSERT(impl_ == NULL);
-  WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, NULL);
-  switch (wtype) {
-    case kBothWspecifier:
-      impl_ = new TableWriterBothImpl<Holder>();
-      break;
-    case kArchiveWspecifier:
-      impl_ = new TableWriterArchiveImpl<Holder>();
-      break;
-    case kScriptWspecifier:
-      impl_ = new TableWriterScriptImpl<Holder>();
-      break;
-    case kNoWspecifier: default:
-      KALDI_WARN << "ClassifyWspecifier: invalid wspecifier " << wspecifier;
-      return false;
+  WspecifierOptions opts;
+  WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, &opts);
+  if (wtype == kNoWspecifier) {
+    KALDI_WARN << "ClassifyWspecifier: invalid wspecifier " << wspecifier;
+    return false;
   }
+  if (opts.num_shards > 0)
+    impl_ = new TableWriterShardedImpl<Holder>();
+  else if (opts.background || opts.compress)
+    impl_ = new TableWriterBackgroundImpl<Holder>();
+  else
+    impl_ = NewTableWriterImpl<Holder>(wtype);
   if (impl_->Open(wspecifier)) return true;
   else {  // The class will have printed a more specific warning.
     delete impl_;
@@ -1184,6 +1994,9 @@ TableWriter<Holder>::~TableWriter() {
 // [i.e. write it as ark, scp].  The main reason to read archives directly
 // is if they are part of a pipe, and in this case it's not seekable, so
 // we implement only this case.
+// [The exception is an archive that has an index (see ArchiveIndexFilename()):
+// then we read the index and use RandomAccessTableReaderScriptImpl, as if the
+// archive had been written as ark, scp.]
 //
 // Note that we will rarely in practice have to keep in memory everything in
 // the archive, as long as things are only read once from the archive (the
@@ -1245,6 +2058,47 @@ class RandomAccessTableReaderScriptImpl:
     }
 
     rspecifier_ = rspecifier;
+    return SortAndCheckScript();
+  }
+
+  // This is used instead of Open() for an archive rspecifier "ark:foo" when
+  // foo has an index (see ArchiveIndexIsUsable()): the index is read and
+  // turned into the script file we would have if the archive had been written
+  // as ark,scp, so that each object is read by seeking in the archive.
+  bool OpenIndexedArchive(const std::string &rspecifier) {
+    switch (state_) {
+      case kNotHaveObject: case kHaveObject: case kGaveObject:
+        KALDI_ERR << " Opening already open RandomAccessTableReader: call Close first.";
+      case kUninitialized: case kNotReadScript:
+        break;
+    }
+    std::string archive_rxfilename;
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &archive_rxfilename,
+                                           &opts_);
+    KALDI_ASSERT(rs == kArchiveRspecifier);  // or wrongly called.
+    KALDI_ASSERT(script_.empty());
+    script_rxfilename_ = ArchiveIndexFilename(archive_rxfilename);
+    std::vector<std::pair<std::string, int64> > index;
+    if (!ReadArchiveIndex(script_rxfilename_, true, &index)) {
+      state_ = kNotReadScript;
+      return false;
+    }
+    script_.resize(index.size());
+    for (size_t i = 0; i < index.size(); i++) {
+      std::ostringstream ss;
+      ss << archive_rxfilename << ':' << index[i].second;
+      script_[i].first = index[i].first;
+      script_[i].second = ss.str();
+    }
+    rspecifier_ = rspecifier;
+    opts_.sorted = false;  // The archive need not be sorted.
+    return SortAndCheckScript();
+  }
+
+ private:
+  // Called from Open(): sorts script_ if needed and checks for duplicate
+  // keys.
+  bool SortAndCheckScript() {
     // If opts_.sorted, the user has asserted that the keys are already sorted.
     // Although we could easily sort them, we want to let the user know of this
     // mistake.  This same mistake could have serious effects if used with an
@@ -1267,6 +2121,7 @@ class RandomAccessTableReaderScriptImpl:
     return true;
   }
 
+ public:
   virtual bool IsOpen() const {
     return  (state_ == kNotHaveObject || state_ == kHaveObject ||
              state_ == kGaveObject);
@@ -1475,10 +2330,7 @@ template<class Holder>  class RandomAccessTableReaderArchiveImplBase:
 
     // NULL means don't expect binary-mode header
     bool ans;
-    if (Holder::IsReadInBinary())
-      ans = input_.Open(archive_rxfilename_, NULL);
-    else
-      ans = input_.OpenTextMode(archive_rxfilename_);
+    ans = OpenTableInput<Holder>(archive_rxfilename_, &input_);
     if (!ans) {  // header.
       KALDI_WARN << "TableReader: failed to open stream "
                  << PrintableRxfilename(archive_rxfilename_);
@@ -2055,6 +2907,64 @@ template<class Holder>  class RandomAccessTableReaderUnsortedArchiveImpl:
 
 
 
+// This is the implementation of RandomAccessTableReader used when the
+// "shards=N" option is given in the rspecifier: it opens a
+// RandomAccessTableReader for each shard and looks up each key only in the
+// shard given by KeyShard().
+template<class Holder>  class RandomAccessTableReaderShardedImpl:
+      public RandomAccessTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  virtual bool Open(const std::string &rspecifier) {
+    RspecifierOptions opts;
+    ClassifyRspecifier(rspecifier, NULL, &opts);
+    KALDI_ASSERT(opts.num_shards > 0 && shards_.empty());
+    for (int32 shard = 0; shard < opts.num_shards; shard++) {
+      std::string shard_rspecifier = ShardSpecifier(rspecifier, shard);
+      RandomAccessTableReader<Holder> *reader =
+          new RandomAccessTableReader<Holder>();
+      if (!reader->Open(shard_rspecifier)) {
+        delete reader;
+        KALDI_WARN << "RandomAccessTableReader: failed to open shard "
+                   << shard_rspecifier;
+        Close();
+        return false;
+      }
+      shards_.push_back(reader);
+    }
+    return true;
+  }
+
+  virtual bool HasKey(const std::string &key) {
+    return shards_[KeyShard(key, shards_.size())]->HasKey(key);
+  }
+
+  virtual const T &Value(const std::string &key) {
+    return shards_[KeyShard(key, shards_.size())]->Value(key);
+  }
+
+  virtual bool Close() {
+    bool ans = true;
+    for (size_t i = 0; i < shards_.size(); i++) {
+      if (!shards_[i]->Close()) ans = false;
+      delete shards_[i];
+    }
+    shards_.clear();
+    return ans;
+  }
+
+  virtual ~RandomAccessTableReaderShardedImpl() {
+    for (size_t i = 0; i < shards_.size(); i++)
+      delete shards_[i];
+  }
+
+ private:
+  std::vector<RandomAccessTableReader<Holder>*> shards_;
+};
+
+
+
 template<class Holder>
 RandomAccessTableReader<Holder>::RandomAccessTableReader(const std::string &rspecifier):
     impl_(NULL) {
@@ -2068,12 +2978,33 @@ bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
   if (IsOpen())
     KALDI_ERR << "RandomAccessTableReader::Open(): already open.";
   RspecifierOptions opts;
-  RspecifierType rs = ClassifyRspecifier(rspecifier, NULL, &opts);
+  std::string rxfilename;
+  RspecifierType rs = ClassifyRspecifier(rspecifier, &rxfilename, &opts);
   switch (rs) {
     case kScriptRspecifier:
-      impl_ = new RandomAccessTableReaderScriptImpl<Holder>();
+      if (opts.num_shards > 0)
+        impl_ = new RandomAccessTableReaderShardedImpl<Holder>();
+      else
+        impl_ = new RandomAccessTableReaderScriptImpl<Holder>();
       break;
     case kArchiveRspecifier:
+      if (opts.num_shards > 0) {
+        impl_ = new RandomAccessTableReaderShardedImpl<Holder>();
+        break;
+      }
+      if (ArchiveIndexIsUsable(rxfilename)) {
+        RandomAccessTableReaderScriptImpl<Holder> *impl =
+            new RandomAccessTableReaderScriptImpl<Holder>();
+        if (impl->OpenIndexedArchive(rspecifier)) {
+          impl_ = impl;
+          return true;
+        }
+        // Fall back to reading the archive itself.
+        KALDI_WARN << "Error reading index for archive "
+                   << PrintableRxfilename(rxfilename)
+                   << ", reading the archive without it.";
+        delete impl;
+      }
       if (opts.sorted) {
         if (opts.called_sorted) // "doubly" sorted case.
           impl_ = new RandomAccessTableReaderDSortedArchiveImpl<Holder>();
@@ -2211,6 +3142,226 @@ const typename Holder::T& RandomAccessTableReaderMapped<Holder>::Value(
 }
 
 
+// This stream buffer discards what is written to it, and counts the bytes; we
+// use it to measure the size of objects.
+class ByteCountingStreambuf: public std::streambuf {
+ public:
+  ByteCountingStreambuf(): count_(0) { setp(buf_, buf_ + sizeof(buf_)); }
+  int64 Count() const { return count_ + (pptr() - pbase()); }
+ protected:
+  virtual int_type overflow(int_type c) {
+    count_ += pptr() - pbase();
+    setp(buf_, buf_ + sizeof(buf_));
+    if (!traits_type::eq_int_type(c, traits_type::eof())) count_++;
+    return traits_type::not_eof(c);
+  }
+  virtual std::streamsize xsputn(const char *s, std::streamsize n) {
+    count_ += n;
+    return n;
+  }
+ private:
+  char buf_[256];
+  int64 count_;
+};
+
+template<class Holder>
+RandomAccessTableReaderCached<Holder>::RandomAccessTableReaderCached():
+    cache_size_(0), cur_size_(0) {
+  pthread_mutex_init(&token_mutex_, NULL);
+  pthread_mutex_init(&reader_mutex_, NULL);
+  pthread_mutex_init(&mutex_, NULL);
+}
+
+template<class Holder>
+RandomAccessTableReaderCached<Holder>::RandomAccessTableReaderCached(
+    const std::string &table_rxfilename,
+    const std::string &utt2spk_rxfilename,
+    int64 cache_size): cache_size_(0), cur_size_(0) {
+  pthread_mutex_init(&token_mutex_, NULL);
+  pthread_mutex_init(&reader_mutex_, NULL);
+  pthread_mutex_init(&mutex_, NULL);
+  if (!Open(table_rxfilename, utt2spk_rxfilename, cache_size)) {
+    pthread_mutex_destroy(&mutex_);
+    pthread_mutex_destroy(&reader_mutex_);
+    pthread_mutex_destroy(&token_mutex_);
+    KALDI_ERR << "Error opening RandomAccessTableReaderCached object "
+              << "(rspecifier is: " << table_rxfilename << ")";
+  }
+}
+
+template<class Holder>
+bool RandomAccessTableReaderCached<Holder>::Open(
+    const std::string &table_rxfilename,
+    const std::string &utt2spk_rxfilename,
+    int64 cache_size) {
+  if (IsOpen()) Close();
+  KALDI_ASSERT(!table_rxfilename.empty() && cache_size >= 0);
+  if (!reader_.Open(table_rxfilename)) return false;
+  if (!utt2spk_rxfilename.empty()) {
+    if (!token_reader_.Open(utt2spk_rxfilename)) {
+      reader_.Close();
+      return false;
+    }
+  }
+  utt2spk_rxfilename_ = utt2spk_rxfilename;
+  cache_size_ = cache_size;
+  return true;
+}
+
+template<class Holder>
+std::string RandomAccessTableReaderCached<Holder>::MapKey(
+    const std::string &utt) {
+  if (!token_reader_.IsOpen()) return utt;
+  pthread_mutex_lock(&token_mutex_);
+  std::string ans;
+  try {
+    if (!token_reader_.HasKey(utt))
+      KALDI_ERR << "Attempting to read key " << utt << ", which is not "
+                << "present in utt2spk map or similar map being read from "
+                << PrintableRxfilename(utt2spk_rxfilename_);
+    ans = token_reader_.Value(utt);
+  } catch (...) {
+    pthread_mutex_unlock(&token_mutex_);
+    throw;
+  }
+  pthread_mutex_unlock(&token_mutex_);
+  return ans;
+}
+
+template<class Holder>
+bool RandomAccessTableReaderCached<Holder>::HasKey(const std::string &key) {
+  std::string table_key = MapKey(key);
+  pthread_mutex_lock(&mutex_);
+  bool ans = (cache_.count(table_key) != 0);
+  pthread_mutex_unlock(&mutex_);
+  if (ans) return true;
+  pthread_mutex_lock(&reader_mutex_);
+  try {
+    ans = reader_.HasKey(table_key);
+  } catch (...) {
+    pthread_mutex_unlock(&reader_mutex_);
+    throw;
+  }
+  pthread_mutex_unlock(&reader_mutex_);
+  return ans;
+}
+
+template<class Holder>
+typename RandomAccessTableReaderCached<Holder>::CacheEntry*
+RandomAccessTableReaderCached<Holder>::FindEntry(const std::string &table_key) {
+  pthread_mutex_lock(&mutex_);
+  CacheEntry *entry = NULL;
+  typename CacheType::iterator iter = cache_.find(table_key);
+  if (iter != cache_.end()) {
+    entry = &(iter->second);
+    lru_.splice(lru_.begin(), lru_, entry->lru_pos);
+    entry->num_users++;
+  }
+  pthread_mutex_unlock(&mutex_);
+  return entry;
+}
+
+template<class Holder>
+typename RandomAccessTableReaderCached<Holder>::CacheEntry*
+RandomAccessTableReaderCached<Holder>::GetEntry(const std::string &table_key) {
+  CacheEntry *entry = FindEntry(table_key);
+  if (entry != NULL) return entry;
+  pthread_mutex_lock(&reader_mutex_);
+  // Another thread may have read the object while we were waiting.
+  entry = FindEntry(table_key);
+  if (entry != NULL) {
+    pthread_mutex_unlock(&reader_mutex_);
+    return entry;
+  }
+  T *object;
+  try {
+    object = new T(reader_.Value(table_key));
+  } catch (...) {
+    pthread_mutex_unlock(&reader_mutex_);
+    throw;
+  }
+  ByteCountingStreambuf counter;
+  std::ostream os(&counter);
+  Holder::Write(os, true, *object);
+  pthread_mutex_lock(&mutex_);
+  entry = &(cache_[table_key]);
+  lru_.push_front(table_key);
+  entry->object = object;
+  entry->size = counter.Count();
+  entry->num_users = 1;
+  entry->lru_pos = lru_.begin();
+  cur_size_ += entry->size;
+  Evict();
+  pthread_mutex_unlock(&mutex_);
+  // We release reader_mutex_ only once the object is in the cache, so that no
+  // other thread reads it again.
+  pthread_mutex_unlock(&reader_mutex_);
+  return entry;
+}
+
+template<class Holder>
+void RandomAccessTableReaderCached<Holder>::ReleaseEntry(CacheEntry *entry) {
+  pthread_mutex_lock(&mutex_);
+  KALDI_ASSERT(entry->num_users > 0);
+  entry->num_users--;
+  Evict();
+  pthread_mutex_unlock(&mutex_);
+}
+
+template<class Holder>
+void RandomAccessTableReaderCached<Holder>::Evict() {
+  std::list<std::string>::iterator iter = lru_.end();
+  while (cur_size_ > cache_size_ && iter != lru_.begin()) {
+    --iter;
+    typename CacheType::iterator cache_iter = cache_.find(*iter);
+    KALDI_ASSERT(cache_iter != cache_.end());
+    CacheEntry &entry = cache_iter->second;
+    if (entry.num_users != 0) continue;  // In use; can't discard it yet.
+    cur_size_ -= entry.size;
+    delete entry.object;
+    cache_.erase(cache_iter);
+    iter = lru_.erase(iter);
+  }
+}
+
+template<class Holder>
+void RandomAccessTableReaderCached<Holder>::Value(const std::string &key,
+                                                  T *value) {
+  KALDI_ASSERT(value != NULL);
+  CacheEntry *entry = GetEntry(MapKey(key));
+  // Other threads may use the cache while we copy the object.
+  *value = *(entry->object);
+  ReleaseEntry(entry);
+}
+
+template<class Holder>
+void RandomAccessTableReaderCached<Holder>::ClearCache() {
+  for (typename CacheType::iterator iter = cache_.begin();
+       iter != cache_.end(); ++iter) {
+    KALDI_ASSERT(iter->second.num_users == 0);
+    delete iter->second.object;
+  }
+  cache_.clear();
+  lru_.clear();
+  cur_size_ = 0;
+}
+
+template<class Holder>
+bool RandomAccessTableReaderCached<Holder>::Close() {
+  ClearCache();
+  if (token_reader_.IsOpen()) token_reader_.Close();
+  return reader_.Close();
+}
+
+template<class Holder>
+RandomAccessTableReaderCached<Holder>::~RandomAccessTableReaderCached() {
+  ClearCache();
+  pthread_mutex_destroy(&mutex_);
+  pthread_mutex_destroy(&reader_mutex_);
+  pthread_mutex_destroy(&token_mutex_);
+}
+
+
 
 /// @}
 
@@ -0,0 +1,166 @@
+// util/kaldi-table-speed-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/timer.h"
+
+namespace kaldi {
+
+// Writes a feats.scp-like archive of num_utts matrices, split over num_archives
+// archives, as nnet training would read it, and returns the keys.
+void WriteFeatures(int32 num_utts, int32 num_archives,
+                   std::vector<std::string> *keys) {
+  std::vector<BaseFloatMatrixWriter*> writers(num_archives);
+  for (int32 a = 0; a < num_archives; a++) {
+    std::ostringstream wspecifier;
+    wspecifier << "ark,scp:tmpf." << a << ".ark,tmpf." << a << ".scp";
+    writers[a] = new BaseFloatMatrixWriter(wspecifier.str());
+  }
+  for (int32 i = 0; i < num_utts; i++) {
+    std::ostringstream key;
+    key << "utt" << (1000000 + i);
+    keys->push_back(key.str());
+    Matrix<BaseFloat> feats(100 + rand() % 200, 40);
+    feats.SetRandn();
+    writers[i % num_archives]->Write(key.str(), feats);
+  }
+  for (int32 a = 0; a < num_archives; a++)
+    delete writers[a];
+  // Concatenate the scp files.
+  Output ko("tmpf.scp", false);
+  for (int32 a = 0; a < num_archives; a++) {
+    std::ostringstream scp;
+    scp << "tmpf." << a << ".scp";
+    Input ki(scp.str());
+    ko.Stream() << ki.Stream().rdbuf();
+  }
+}
+
+void TestRandomAccessSpeed(const std::vector<std::string> &keys, bool mapped) {
+  SetMemoryMappedInput(mapped);
+  std::vector<std::string> shuffled(keys);
+  std::random_shuffle(shuffled.begin(), shuffled.end());
+  Timer timer;
+  RandomAccessBaseFloatMatrixReader reader("scp:tmpf.scp");
+  double sum = 0.0;
+  for (size_t i = 0; i < shuffled.size(); i++)
+    sum += reader.Value(shuffled[i])(0, 0);
+  double elapsed = timer.Elapsed();
+  KALDI_LOG << "For random access to " << keys.size() << " matrices via scp, "
+            << (mapped ? "with" : "without") << " memory mapping, time was "
+            << elapsed << " seconds (" << (keys.size() / elapsed)
+            << " matrices per second); checksum " << sum;
+}
+
+void TestSequentialSpeed(const std::vector<std::string> &keys, bool mapped) {
+  SetMemoryMappedInput(mapped);
+  Timer timer;
+  SequentialBaseFloatMatrixReader reader("scp:tmpf.scp");
+  size_t n = 0;
+  double sum = 0.0;
+  for (; !reader.Done(); reader.Next(), n++) {
+    KALDI_ASSERT(reader.Key() == keys[n]);
+    sum += reader.Value()(0, 0);
+  }
+  double elapsed = timer.Elapsed();
+  KALDI_LOG << "For sequential reading of " << n << " matrices via scp, "
+            << (mapped ? "with" : "without") << " memory mapping, time was "
+            << elapsed << " seconds (" << (n / elapsed)
+            << " matrices per second); checksum " << sum;
+}
+
+// As TestSequentialSpeed, but reading views of the mapped matrices.
+void TestSequentialViewSpeed(const std::vector<std::string> &keys) {
+  SetMemoryMappedInput(true);
+  Timer timer;
+  SequentialBaseFloatMatrixViewReader reader("scp:tmpf.scp");
+  size_t n = 0;
+  double sum = 0.0;
+  for (; !reader.Done(); reader.Next(), n++) {
+    KALDI_ASSERT(reader.Key() == keys[n]);
+    sum += reader.Value()(0, 0);
+  }
+  double elapsed = timer.Elapsed();
+  KALDI_LOG << "For sequential reading of " << n << " matrix views via scp, "
+            << "time was " << elapsed << " seconds (" << (n / elapsed)
+            << " matrices per second); checksum " << sum;
+}
+
+// Reads text archives of alignments and of feature matrices.
+void TestTextSpeed(int32 num_utts) {
+  {
+    Int32VectorWriter ali_writer("ark,t:tmpf.ali");
+    BaseFloatMatrixWriter feats_writer("ark,t:tmpf.txt");
+    for (int32 i = 0; i < num_utts; i++) {
+      std::ostringstream key;
+      key << "utt" << (1000000 + i);
+      int32 num_frames = 100 + rand() % 200;
+      std::vector<int32> ali(num_frames);
+      for (int32 t = 0; t < num_frames; t++)
+        ali[t] = rand() % 5000;
+      ali_writer.Write(key.str(), ali);
+      Matrix<BaseFloat> feats(num_frames, 40);
+      feats.SetRandn();
+      feats_writer.Write(key.str(), feats);
+    }
+  }
+  Timer timer;
+  SequentialInt32VectorReader ali_reader("ark:tmpf.ali");
+  size_t num_ints = 0;
+  for (; !ali_reader.Done(); ali_reader.Next())
+    num_ints += ali_reader.Value().size();
+  double elapsed = timer.Elapsed();
+  KALDI_LOG << "For reading a text archive of " << num_ints
+            << " alignment entries, time was " << elapsed << " seconds ("
+            << (num_ints / elapsed) << " integers per second)";
+  timer.Reset();
+  SequentialBaseFloatMatrixReader feats_reader("ark:tmpf.txt");
+  size_t num_floats = 0;
+  for (; !feats_reader.Done(); feats_reader.Next())
+    num_floats += feats_reader.Value().NumRows() *
+        feats_reader.Value().NumCols();
+  elapsed = timer.Elapsed();
+  KALDI_LOG << "For reading a text archive of " << num_floats
+            << " matrix elements, time was " << elapsed << " seconds ("
+            << (num_floats / elapsed) << " floats per second)";
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  std::vector<std::string> keys;
+  int32 num_utts = 2000, num_archives = 4;
+  WriteFeatures(num_utts, num_archives, &keys);
+  // The scp file lists the keys of archive 0, then archive 1, etc.
+  std::vector<std::string> ordered_keys(keys.size());
+  for (int32 i = 0; i < num_utts; i++)
+    ordered_keys[(i % num_archives) * (num_utts / num_archives) +
+                 i / num_archives] = keys[i];
+  for (int32 i = 0; i < 2; i++) {
+    TestRandomAccessSpeed(keys, true);
+    TestRandomAccessSpeed(keys, false);
+  }
+  TestSequentialSpeed(ordered_keys, true);
+  TestSequentialSpeed(ordered_keys, false);
+  TestSequentialViewSpeed(ordered_keys);
+  TestTextSpeed(500);
+  SetMemoryMappedInput(true);
+}
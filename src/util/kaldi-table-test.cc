@@ -23,8 +23,10 @@
 #include "util/kaldi-holder.h"
 #include "util/table-types.h"
 #ifndef _MSC_VER
-#include <unistd.h> // for sleep.
+#include <sys/time.h>  // for utimes.
+#include <unistd.h> // for sleep and unlink.
 #endif
+#include <algorithm>
 
 namespace kaldi {
 
@@ -166,6 +168,47 @@ void UnitTestClassifyWspecifier() {
     KALDI_ASSERT(ans == kBothWspecifier && ark == "" && scp == "" && opts.binary == true && opts.flush == false);
   }
 
+  {
+    std::string a = "bg,cm,t,ark,scp:a,b";
+    std::string ark, scp; WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kBothWspecifier && ark == "a" && scp == "b" &&
+                 opts.binary == false && opts.background && opts.compress);
+  }
+
+  {
+    std::string a = "bg,nbg,ncm,ark:a";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, NULL, NULL, &opts);
+    KALDI_ASSERT(ans == kArchiveWspecifier && !opts.background &&
+                 !opts.compress && !opts.index);
+  }
+
+  {
+    std::string a = "ark,idx:a";
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, NULL, NULL, &opts);
+    KALDI_ASSERT(ans == kArchiveWspecifier && opts.index);
+  }
+
+  {
+    std::string a = "ark,scp,shards=4:a.JOB,b", ark, scp;
+    WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kBothWspecifier && ark == "a.JOB" && scp == "b" &&
+                 opts.num_shards == 4);
+    KALDI_ASSERT(ShardSpecifier(a, 2) == "ark,scp:a.3,b");
+  }
+
+  {
+    // Invalid: no JOB in the archive filename, zero shards, sharded scp.
+    KALDI_ASSERT(ClassifyWspecifier("ark,scp,shards=4:a,b.JOB", NULL, NULL,
+                                    NULL) == kNoWspecifier);
+    KALDI_ASSERT(ClassifyWspecifier("ark,shards=0:a.JOB", NULL, NULL,
+                                    NULL) == kNoWspecifier);
+    KALDI_ASSERT(ClassifyWspecifier("scp,shards=2:a.JOB", NULL, NULL,
+                                    NULL) == kNoWspecifier);
+  }
 
 }
 
@@ -315,6 +358,28 @@ void UnitTestClassifyRspecifier() {
     RspecifierType ans = ClassifyRspecifier(a, &b, NULL);
     KALDI_ASSERT(ans == kArchiveRspecifier && b == "a");
   }
+  {
+    std::string a = "bg,scp:a", b;
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &b, &opts);
+    KALDI_ASSERT(ans == kScriptRspecifier && b == "a" && opts.background);
+  }
+  {
+    std::string a = "ark,nbg:a", b;
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &b, &opts);
+    KALDI_ASSERT(ans == kArchiveRspecifier && b == "a" && !opts.background);
+  }
+  {
+    std::string a = "s,ark,shards=2:a.JOB", b;
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &b, &opts);
+    KALDI_ASSERT(ans == kArchiveRspecifier && b == "a.JOB" &&
+                 opts.num_shards == 2 && opts.sorted);
+    KALDI_ASSERT(ShardSpecifier(a, 0) == "s,ark:a.1");
+    KALDI_ASSERT(ClassifyRspecifier("ark,shards=2:a", NULL, NULL) ==
+                 kNoRspecifier);
+  }
 
 
 }
@@ -618,6 +683,8 @@ void UnitTestTableSequentialInt32Script(bool binary) {
   KALDI_ASSERT(sbr.Close());
   KALDI_ASSERT(k2 == k);
   KALDI_ASSERT(v2 == v);
+  for (size_t i = 0; i < script.size(); i++)
+    unlink(script[i].second.c_str());  // The files the script points to.
 }
 
 // Writing as both and reading as archive.
@@ -668,6 +735,345 @@ void UnitTestTableSequentialDoubleMatrixBoth(bool binary, bool read_scp) {
 }
 
 
+// Reading in the background ("bg" option); we read more objects than the
+// background reader's queue holds.
+void UnitTestTableSequentialBackground(bool binary, bool read_scp) {
+  int32 sz = rand() % 20;
+  std::vector<std::string> k;
+  std::vector<std::vector<int32> > v;
+  for (int32 i = 0; i < sz; i++) {
+    k.push_back("key" + CharToString('a' + static_cast<char>(i)));
+    v.push_back(std::vector<int32>(rand() % 5, i));
+  }
+  Int32VectorWriter bw(binary ? "b,ark,scp:tmpf,tmpf.scp" :
+                       "t,ark,scp:tmpf,tmpf.scp");
+  for (int32 i = 0; i < sz; i++)
+    bw.Write(k[i], v[i]);
+  KALDI_ASSERT(bw.Close());
+
+  // Reading everything.
+  SequentialInt32VectorReader sbr(read_scp ? "bg,scp:tmpf.scp" : "bg,ark:tmpf");
+  std::vector<std::string> k2;
+  std::vector<std::vector<int32> > v2;
+  for (; !sbr.Done(); sbr.Next()) {
+    k2.push_back(sbr.Key());
+    v2.push_back(sbr.Value());
+    if (rand() % 2 == 0) sbr.FreeCurrent();
+  }
+  KALDI_ASSERT(sbr.Close());
+  KALDI_ASSERT(k2 == k && v2 == v);
+
+  // Stopping early, while the background thread may still be reading.
+  SequentialInt32VectorReader sbr2(read_scp ? "bg,scp:tmpf.scp" :
+                                   "bg,ark:tmpf");
+  for (int32 i = 0; i < sz / 2; i++, sbr2.Next()) {
+    KALDI_ASSERT(!sbr2.Done() && sbr2.Key() == k[i] && sbr2.Value() == v[i]);
+  }
+  KALDI_ASSERT(sbr2.Close());
+}
+
+// A holder whose Read() throws for empty vectors, to test errors in the
+// background thread.
+class ThrowingInt32VectorHolder: public BasicVectorHolder<int32> {
+ public:
+  bool Read(std::istream &is) {
+    if (!BasicVectorHolder<int32>::Read(is)) return false;
+    if (Value().empty())
+      KALDI_ERR << "Empty vector (this error is expected).";
+    return true;
+  }
+};
+
+// An error in the background thread is rethrown by the calling thread after
+// the objects read before it.
+void UnitTestTableSequentialBackgroundError() {
+  Int32VectorWriter bw("ark:tmpf");
+  for (int32 i = 0; i < 10; i++)
+    bw.Write("key" + CharToString('a' + static_cast<char>(i)),
+             std::vector<int32>(i == 7 ? 0 : 1, i));
+  KALDI_ASSERT(bw.Close());
+  SequentialTableReader<ThrowingInt32VectorHolder> sbr("bg,ark:tmpf");
+  int32 n = 0;
+  bool threw = false;
+  try {
+    for (; !sbr.Done(); sbr.Next(), n++)
+      KALDI_ASSERT(sbr.Value()[0] == n);
+  } catch (const std::exception &e) {
+    threw = true;
+  }
+  KALDI_ASSERT(threw && n == 7);
+}
+
+void UnitTestTableWriterBackground(bool binary, bool read_scp) {
+  int32 sz = rand() % 20;
+  std::vector<std::string> k;
+  std::vector<Matrix<BaseFloat> > v;
+  for (int32 i = 0; i < sz; i++) {
+    k.push_back("key" + CharToString('a' + static_cast<char>(i)));
+    // CompressedMatrix is only accurate for more than a few rows.
+    v.push_back(Matrix<BaseFloat>(10 + rand() % 10, 1 + rand() % 5));
+    v.back().SetRandn();
+  }
+  bool compress = (rand() % 2 == 0);
+  std::string opts = std::string(binary ? "b," : "t,") +
+      (compress ? "cm," : "bg,");
+  BaseFloatMatrixWriter bw(opts + "ark,scp:tmpf,tmpf.scp");
+  for (int32 i = 0; i < sz; i++) {
+    KALDI_ASSERT(bw.IsOpen());
+    bw.Write(k[i], v[i]);
+    if (i % 5 == 0) {
+      // After Flush(), the objects written so far are in the archive.
+      bw.Flush();
+      SequentialBaseFloatMatrixReader flushed_reader("ark:tmpf");
+      int32 num_flushed = 0;
+      for (; !flushed_reader.Done(); flushed_reader.Next())
+        num_flushed++;
+      KALDI_ASSERT(num_flushed == i + 1);
+    }
+  }
+  KALDI_ASSERT(bw.Close());
+
+  SequentialBaseFloatMatrixReader sbr(read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  int32 i = 0;
+  for (; !sbr.Done(); sbr.Next(), i++) {
+    KALDI_ASSERT(i < sz && sbr.Key() == k[i]);
+    // Compression loses precision; text-mode output is not compressed.
+    BaseFloat tol = (compress && binary ? 0.1 : 1.0e-04);
+    KALDI_ASSERT(sbr.Value().ApproxEqual(v[i], tol));
+  }
+  KALDI_ASSERT(i == sz && sbr.Close());
+}
+
+// An object whose serialized form starts with a matrix.
+struct MatrixAndVector {
+  Matrix<BaseFloat> mat;
+  Vector<BaseFloat> vec;
+  void Write(std::ostream &os, bool binary) const {
+    mat.Write(os, binary);
+    vec.Write(os, binary);
+  }
+  void Read(std::istream &is, bool binary) {
+    mat.Read(is, binary);
+    vec.Read(is, binary);
+  }
+};
+
+// The "cm" option only compresses objects that are just a matrix.
+void UnitTestTableWriterCompressOther() {
+  MatrixAndVector obj;
+  obj.mat.Resize(20, 3);
+  obj.mat.SetRandn();
+  obj.vec.Resize(4);
+  obj.vec.SetRandn();
+  {
+    TableWriter<KaldiObjectHolder<MatrixAndVector> > bw("b,cm,ark:tmpf");
+    bw.Write("key", obj);
+    KALDI_ASSERT(bw.Close());
+  }
+  SequentialTableReader<KaldiObjectHolder<MatrixAndVector> > sbr("ark:tmpf");
+  KALDI_ASSERT(!sbr.Done() && sbr.Key() == "key");
+  KALDI_ASSERT(sbr.Value().mat.ApproxEqual(obj.mat, 0.0) &&
+               sbr.Value().vec.ApproxEqual(obj.vec, 0.0));
+  sbr.Next();
+  KALDI_ASSERT(sbr.Done() && sbr.Close());
+}
+
+// Random access into an archive with an index (the "idx" option).
+void UnitTestTableRandomIndexed(bool binary) {
+  int32 sz = rand() % 20;
+  std::vector<std::string> k;
+  std::vector<std::vector<int32> > v;
+  for (int32 i = 0; i < sz; i++) {
+    // The keys are not in sorted order.
+    k.push_back("key" + CharToString('a' + static_cast<char>(sz - i)));
+    v.push_back(std::vector<int32>(rand() % 5, i));
+  }
+  std::string wspecifier;
+  switch (rand() % 3) {
+    case 0: wspecifier = "ark,idx:tmpf"; break;
+    case 1: wspecifier = "ark,scp,idx:tmpf,tmpf.scp"; break;
+    default: wspecifier = "ark,bg,idx:tmpf";
+  }
+  Int32VectorWriter bw((binary ? "b," : "t,") + wspecifier);
+  for (int32 i = 0; i < sz; i++)
+    bw.Write(k[i], v[i]);
+  KALDI_ASSERT(bw.Close());
+  KALDI_ASSERT(ArchiveIndexIsUsable("tmpf"));
+
+  std::vector<std::pair<std::string, int64> > index;
+  KALDI_ASSERT(ReadArchiveIndex(ArchiveIndexFilename("tmpf"), true, &index));
+  KALDI_ASSERT(index.size() == static_cast<size_t>(sz));
+  for (int32 i = 0; i < sz; i++)
+    KALDI_ASSERT(index[i].first == k[i] && (i == 0 ||
+                                            index[i].second > index[i-1].second));
+
+  RandomAccessInt32VectorReader rbr("ark:tmpf");
+  for (int32 n = 0; n < 2 * sz; n++) {
+    int32 i = rand() % sz;
+    KALDI_ASSERT(rbr.HasKey(k[i]) && rbr.Value(k[i]) == v[i]);
+  }
+  KALDI_ASSERT(!rbr.HasKey("foo"));
+  KALDI_ASSERT(rbr.Close());
+
+  // An archive modified later in the same second as its index is out of
+  // date; one modified at the same time is not.
+  struct timeval index_times[2], archive_times[2];
+  index_times[0].tv_sec = index_times[1].tv_sec = 1000000000;
+  index_times[0].tv_usec = index_times[1].tv_usec = 0;
+  archive_times[0] = archive_times[1] = index_times[0];
+  archive_times[1].tv_usec = 500000;
+  KALDI_ASSERT(utimes(ArchiveIndexFilename("tmpf").c_str(), index_times) == 0 &&
+               utimes("tmpf", archive_times) == 0);
+  KALDI_ASSERT(!ArchiveIndexIsUsable("tmpf"));
+  KALDI_ASSERT(utimes("tmpf", index_times) == 0);
+  KALDI_ASSERT(ArchiveIndexIsUsable("tmpf"));
+
+  // Writing the archive again without "idx" removes the out-of-date index.
+  Int32VectorWriter bw2("ark:tmpf");
+  KALDI_ASSERT(!ArchiveIndexIsUsable("tmpf") && bw2.Close());
+  KALDI_ASSERT(!Input().Open(ArchiveIndexFilename("tmpf")));
+}
+
+// Writing and reading a table sharded over several archives.
+void UnitTestTableSharded(bool binary) {
+  int32 sz = rand() % 30, num_shards = 1 + rand() % 4;
+  std::vector<std::string> k;
+  std::vector<std::vector<int32> > v;
+  for (int32 i = 0; i < sz; i++) {
+    // The keys are written in sorted order.
+    k.push_back("key" + CharToString('a' + static_cast<char>(i)));
+    v.push_back(std::vector<int32>(rand() % 5, i));
+  }
+  std::ostringstream shards;
+  shards << "shards=" << num_shards;
+  Int32VectorWriter bw((binary ? "b,ark,scp," : "t,ark,scp,") + shards.str() +
+                       ":tmpf.JOB,tmpf.scp");
+  for (int32 i = 0; i < sz; i++)
+    bw.Write(k[i], v[i]);
+  KALDI_ASSERT(bw.Close());
+  for (int32 s = 0; s < num_shards; s++) {
+    std::string shard_archive;
+    ClassifyWspecifier(ShardSpecifier("ark,shards=2:tmpf.JOB", s),
+                       &shard_archive, NULL, NULL);
+    KALDI_ASSERT(!Input().Open(shard_archive + ".scp.tmp"));  // Removed.
+  }
+
+  {
+    // The script file lists the objects in the order they were written.
+    SequentialInt32VectorReader sbr("scp:tmpf.scp");
+    int32 i = 0;
+    for (; !sbr.Done(); sbr.Next(), i++)
+      KALDI_ASSERT(sbr.Key() == k[i] && sbr.Value() == v[i]);
+    KALDI_ASSERT(i == sz && sbr.Close());
+  }
+  for (int32 sorted = 0; sorted < 2; sorted++) {
+    // Reading the shards directly gives the objects in sorted order if we
+    // give the "s" option, otherwise just all of them.
+    SequentialInt32VectorReader sbr((sorted ? "s,ark," : "ark,") +
+                                    shards.str() + ":tmpf.JOB");
+    std::vector<bool> seen(sz, false);
+    int32 i = 0;
+    for (; !sbr.Done(); sbr.Next(), i++) {
+      int32 j = std::find(k.begin(), k.end(), sbr.Key()) - k.begin();
+      KALDI_ASSERT(j >= 0 && j < sz && !seen[j] && sbr.Value() == v[j]);
+      KALDI_ASSERT(!sorted || j == i);
+      seen[j] = true;
+    }
+    KALDI_ASSERT(i == sz && sbr.Close());
+  }
+
+  RandomAccessInt32VectorReader rbr("ark," + shards.str() + ":tmpf.JOB");
+  for (int32 n = 0; n < 2 * sz; n++) {
+    int32 i = rand() % sz;
+    KALDI_ASSERT(rbr.HasKey(k[i]) && rbr.Value(k[i]) == v[i]);
+  }
+  KALDI_ASSERT(!rbr.HasKey("foo"));
+  KALDI_ASSERT(rbr.Close());
+}
+
+#ifdef HAVE_ZLIB
+// Writing and reading gzipped archives, with offsets into them in the scp file
+// and index.
+void UnitTestTableGzip(bool binary) {
+  int32 sz = rand() % 20;
+  std::vector<std::string> k;
+  std::vector<std::vector<int32> > v;
+  for (int32 i = 0; i < sz; i++) {
+    k.push_back("key" + CharToString('a' + static_cast<char>(i)));
+    v.push_back(std::vector<int32>(rand() % 5000, i));
+  }
+  Int32VectorWriter bw(binary ? "b,ark,scp,idx:tmpf.gz,tmpf.scp" :
+                       "t,ark,scp,idx:tmpf.gz,tmpf.scp");
+  for (int32 i = 0; i < sz; i++)
+    bw.Write(k[i], v[i]);
+  KALDI_ASSERT(bw.Close());
+
+  const char *rspecifiers[] = { "ark:tmpf.gz", "ark:gunzip -c tmpf.gz |",
+                                "scp:tmpf.scp" };
+  for (int32 r = 0; r < 3; r++) {
+    SequentialInt32VectorReader sbr(rspecifiers[r]);
+    int32 i = 0;
+    for (; !sbr.Done(); sbr.Next(), i++)
+      KALDI_ASSERT(sbr.Key() == k[i] && sbr.Value() == v[i]);
+    KALDI_ASSERT(i == sz && sbr.Close());
+  }
+  for (int32 r = 0; r < 2; r++) {
+    // Random access through the scp file, and through the index.
+    RandomAccessInt32VectorReader rbr(r == 0 ? "scp:tmpf.scp" : "ark:tmpf.gz");
+    for (int32 n = 0; n < 2 * sz; n++) {
+      int32 i = rand() % sz;
+      KALDI_ASSERT(rbr.HasKey(k[i]) && rbr.Value(k[i]) == v[i]);
+    }
+    KALDI_ASSERT(rbr.Close());
+  }
+}
+#endif
+
+// Reading matrices from mapped files (MatrixViewHolder).
+void UnitTestTableMatrixView(bool binary, bool read_scp) {
+  int32 sz = rand() % 10;
+  std::vector<std::string> k;
+  std::vector<Matrix<BaseFloat> > v;
+  for (int32 i = 0; i < sz; i++) {
+    // Keys of different lengths, so the data is aligned only in some entries.
+    k.push_back("key" + std::string(i % 4, 'x') +
+                CharToString('a' + static_cast<char>(i)));
+    int32 rows = rand() % 5, cols = (rows == 0 ? 0 : 1 + rand() % 5);
+    v.push_back(Matrix<BaseFloat>(rows, cols));
+    v.back().SetRandn();
+  }
+  {
+    // Write half the matrices as sub-matrices, which needs the view writer.
+    BaseFloatMatrixViewWriter bw(binary ? "b,ark,scp:tmpf,tmpf.scp" :
+                                 "t,ark,scp:tmpf,tmpf.scp");
+    for (int32 i = 0; i < sz; i++) {
+      if (i % 2 == 0 || v[i].NumRows() == 0) bw.Write(k[i], v[i]);
+      else bw.Write(k[i], v[i].Range(0, v[i].NumRows(), 0, v[i].NumCols()));
+    }
+  }
+  std::string rspecifier = (read_scp ? "scp:tmpf.scp" : "ark:tmpf");
+  BaseFloat tol = (binary ? 0.0 : 1.0e-04);
+  for (int32 bg = 0; bg < 2; bg++) {
+    SequentialBaseFloatMatrixViewReader sbr((bg ? "bg," : "") + rspecifier);
+    int32 i = 0;
+    for (; !sbr.Done(); sbr.Next(), i++) {
+      KALDI_ASSERT(i < sz && sbr.Key() == k[i]);
+      KALDI_ASSERT(sbr.Value().NumRows() == v[i].NumRows() &&
+                   sbr.Value().ApproxEqual(v[i], tol));
+      // Views into the file are only used where the data is aligned.
+      KALDI_ASSERT(reinterpret_cast<size_t>(sbr.Value().Data()) %
+                   sizeof(BaseFloat) == 0);
+    }
+    KALDI_ASSERT(i == sz && sbr.Close());
+  }
+  RandomAccessBaseFloatMatrixViewReader rbr(rspecifier);
+  for (int32 n = 0; n < sz; n++) {
+    int32 i = rand() % sz;
+    KALDI_ASSERT(rbr.HasKey(k[i]) && rbr.Value(k[i]).ApproxEqual(v[i], tol));
+  }
+  KALDI_ASSERT(rbr.Close());
+}
+
 // Writing as both and reading as archive.
 void UnitTestTableSequentialBaseFloatVectorBoth(bool binary, bool read_scp) {
   int32 sz = rand() % 10;
@@ -870,6 +1276,140 @@ void UnitTestTableRandomBothDoubleMatrix(bool binary, bool read_scp,
 }
 
 
+// Used in UnitTestTableCached: each thread reads random keys and checks the
+// values.
+struct CachedReaderTestArg {
+  RandomAccessBaseFloatVectorReaderCached *reader;
+  int32 num_keys;
+};
+
+void *CachedReaderTestThread(void *arg_in) {
+  CachedReaderTestArg *arg = static_cast<CachedReaderTestArg*>(arg_in);
+  Vector<BaseFloat> value;
+  for (int32 i = 0; i < 200; i++) {
+    int32 k = rand() % (arg->num_keys + 1);  // Includes a nonexistent key.
+    std::ostringstream key;
+    key << "key" << k;
+    bool has_key = arg->reader->HasKey(key.str());
+    KALDI_ASSERT(has_key == (k < arg->num_keys));
+    if (has_key) {
+      arg->reader->Value(key.str(), &value);
+      KALDI_ASSERT(value.Dim() == 10 + k && value(0) == k);
+    }
+  }
+  return NULL;
+}
+
+void UnitTestTableCached(bool binary) {
+  int32 num_keys = 20;
+  std::vector<std::string> utts;
+  {
+    BaseFloatVectorWriter writer(binary ? "ark,scp:tmpf,tmpf.scp" :
+                                 "ark,scp,t:tmpf,tmpf.scp");
+    Output ko("tmpf.utt2spk", false);
+    for (int32 k = 0; k < num_keys; k++) {
+      std::ostringstream key;
+      key << "key" << k;
+      Vector<BaseFloat> value(10 + k);
+      value.Set(k);
+      writer.Write(key.str(), value);
+      for (int32 u = 0; u < 2; u++) {
+        std::ostringstream utt;
+        utt << "utt" << k << "_" << u;
+        utts.push_back(utt.str());
+        ko.Stream() << utt.str() << ' ' << key.str() << '\n';
+      }
+    }
+  }
+  // The cache can hold only a few of the vectors.
+  int64 cache_size = 4 * 30 * sizeof(BaseFloat);
+  {
+    RandomAccessBaseFloatVectorReaderCached reader("scp:tmpf.scp", "",
+                                                   cache_size);
+    int32 num_threads = 4;
+    std::vector<pthread_t> threads(num_threads);
+    CachedReaderTestArg arg;
+    arg.reader = &reader;
+    arg.num_keys = num_keys;
+    for (int32 t = 0; t < num_threads; t++)
+      KALDI_ASSERT(pthread_create(&(threads[t]), NULL, CachedReaderTestThread,
+                                  &arg) == 0);
+    for (int32 t = 0; t < num_threads; t++)
+      pthread_join(threads[t], NULL);
+    KALDI_ASSERT(reader.Close());
+  }
+  {
+    // With an utt2spk map.
+    RandomAccessBaseFloatVectorReaderCached reader("ark:tmpf",
+                                                   "ark:tmpf.utt2spk",
+                                                   cache_size);
+    std::random_shuffle(utts.begin(), utts.end());
+    Vector<BaseFloat> value;
+    for (size_t i = 0; i < utts.size(); i++) {
+      KALDI_ASSERT(reader.HasKey(utts[i]));
+      reader.Value(utts[i], &value);
+      int32 k = atoi(utts[i].c_str() + 3);
+      KALDI_ASSERT(value.Dim() == 10 + k && value(0) == k);
+    }
+  }
+}
+
+// A vector that counts the live objects of its type, to check that the
+// cached reader discards objects.
+class CountedVector {
+ public:
+  CountedVector() { num_live++; }
+  CountedVector(const CountedVector &other): v_(other.v_) { num_live++; }
+  CountedVector &operator = (const CountedVector &other) {
+    v_ = other.v_;
+    return *this;
+  }
+  ~CountedVector() { num_live--; }
+  void Read(std::istream &is, bool binary) { v_.Read(is, binary); }
+  void Write(std::ostream &os, bool binary) const { v_.Write(os, binary); }
+  Vector<BaseFloat> &Vec() { return v_; }
+  const Vector<BaseFloat> &Vec() const { return v_; }
+  static int32 num_live;
+ private:
+  Vector<BaseFloat> v_;
+};
+
+int32 CountedVector::num_live = 0;
+
+static std::string CountedVectorKey(int32 k) {
+  std::ostringstream key;
+  key << "key" << k;
+  return key.str();
+}
+
+// Eviction keeps the number of objects in the cache within the cache size.
+void UnitTestTableCachedEviction() {
+  int32 num_keys = 100, dim = 50;
+  {
+    TableWriter<KaldiObjectHolder<CountedVector> > writer(
+        "ark,scp:tmpf,tmpf.scp");
+    for (int32 k = 0; k < num_keys; k++) {
+      CountedVector value;
+      value.Vec().Resize(dim);
+      value.Vec().Set(k);
+      writer.Write(CountedVectorKey(k), value);
+    }
+  }
+  // Room for about 5 vectors.
+  int64 object_size = dim * sizeof(BaseFloat) + 10,
+      cache_size = 5 * object_size;
+  RandomAccessTableReaderCached<KaldiObjectHolder<CountedVector> > reader(
+      "scp:tmpf.scp", "", cache_size);
+  CountedVector value;
+  for (int32 n = 0; n < 2 * num_keys; n++) {
+    int32 k = rand() % num_keys;
+    reader.Value(CountedVectorKey(k), &value);
+    KALDI_ASSERT(value.Vec().Dim() == dim && value.Vec()(0) == k);
+    // The cached objects, plus "value" and the object held by the scp reader.
+    KALDI_ASSERT(CountedVector::num_live <= cache_size / object_size + 2);
+  }
+  KALDI_ASSERT(reader.Close());
+}
 
 }  // end namespace kaldi.
 
@@ -878,12 +1418,21 @@ int main() {
   UnitTestReadScriptFile();
   UnitTestClassifyWspecifier();
   UnitTestClassifyRspecifier();
+  UnitTestTableSequentialBackgroundError();
   for (int i = 0; i < 10; i++) {
     bool b = (i == 0);
     UnitTestTableSequentialBool(b);
     UnitTestTableSequentialInt32(b);
     UnitTestTableSequentialInt32Script(b);
     UnitTestTableSequentialDouble(b);
+    UnitTestTableRandomIndexed(b);
+    UnitTestTableSharded(b);
+    UnitTestTableCached(b);
+    UnitTestTableCachedEviction();
+    UnitTestTableWriterCompressOther();
+#ifdef HAVE_ZLIB
+    UnitTestTableGzip(b);
+#endif
     for (int j = 0; j < 2; j++) {
       bool c = (j == 0);
       UnitTestTableSequentialDoubleBoth(b, c);
@@ -892,6 +1441,9 @@ int main() {
       UnitTestTableSequentialInt32PairVectorBoth(b, c);
       UnitTestTableSequentialInt32VectorVectorBoth(b, c);
       UnitTestTableSequentialBaseFloatVectorBoth(b, c);
+      UnitTestTableSequentialBackground(b, c);
+      UnitTestTableWriterBackground(b, c);
+      UnitTestTableMatrixView(b, c);
       for (int k = 0; k < 2; k++) {
         bool d = (k == 0);
         for (int l = 0; l < 2; l++) {
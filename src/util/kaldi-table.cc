@@ -17,6 +17,8 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <sys/stat.h>
+#include <cstdio>
 #include "util/kaldi-table.h"
 #include "util/text-utils.h"
 
@@ -123,6 +125,140 @@ bool WriteScriptFile(const std::string &wxfilename,
 }
 
 
+std::string ArchiveIndexFilename(const std::string &archive_filename) {
+  return archive_filename + ".idx";
+}
+
+bool ReadArchiveIndex(const std::string &rxfilename,
+                      bool print_warnings,
+                      std::vector<std::pair<std::string, int64> > *index) {
+  KALDI_ASSERT(index != NULL);
+  index->clear();
+  Input input;
+  if (!input.OpenTextMode(rxfilename)) {
+    if (print_warnings) KALDI_WARN << "Error opening archive index: "
+                                   << PrintableRxfilename(rxfilename);
+    return false;
+  }
+  std::istream &is = input.Stream();
+  std::string line;
+  int32 line_number = 0;
+  while (getline(is, line)) {
+    line_number++;
+    std::string key, offset_str;
+    SplitStringOnFirstSpace(line, &key, &offset_str);
+    int64 offset;
+    if (key.empty() || !ConvertStringToInteger(offset_str, &offset) ||
+        offset < 0) {
+      if (print_warnings)
+        KALDI_WARN << "Invalid " << line_number << "'th line in archive index "
+                   << PrintableRxfilename(rxfilename) << ": \"" << line << '"';
+      index->clear();
+      return false;
+    }
+    index->push_back(std::make_pair(key, offset));
+  }
+  return true;
+}
+
+bool WriteArchiveIndex(const std::string &wxfilename,
+                       const std::vector<std::pair<std::string, int64> > &index) {
+  Output output;
+  if (!output.Open(wxfilename, false, false)) {  // text mode, no header.
+    KALDI_WARN << "Error opening archive index for writing: "
+               << PrintableWxfilename(wxfilename);
+    return false;
+  }
+  std::ostream &os = output.Stream();
+  for (size_t i = 0; i < index.size(); i++)
+    os << index[i].first << ' ' << index[i].second << '\n';
+  if (!output.Close()) {
+    KALDI_WARN << "Error writing archive index "
+               << PrintableWxfilename(wxfilename);
+    return false;
+  }
+  return true;
+}
+
+// Returns the modification time in nanoseconds, or in whole seconds where the
+// system does not provide more.  Whole seconds are not enough to tell whether
+// an archive was modified after its index was written.
+static int64 ModificationTimeNs(const struct stat &file_stat) {
+#if defined(__APPLE__)
+  return static_cast<int64>(file_stat.st_mtimespec.tv_sec) * 1000000000 +
+      file_stat.st_mtimespec.tv_nsec;
+#elif defined(_MSC_VER)
+  return static_cast<int64>(file_stat.st_mtime) * 1000000000;
+#else
+  return static_cast<int64>(file_stat.st_mtim.tv_sec) * 1000000000 +
+      file_stat.st_mtim.tv_nsec;
+#endif
+}
+
+bool ArchiveIndexIsUsable(const std::string &archive_rxfilename) {
+  if (ClassifyRxfilename(archive_rxfilename) != kFileInput)
+    return false;
+  struct stat archive_stat, index_stat;
+  if (stat(archive_rxfilename.c_str(), &archive_stat) != 0 ||
+      stat(ArchiveIndexFilename(archive_rxfilename).c_str(), &index_stat) != 0)
+    return false;
+  if (ModificationTimeNs(index_stat) < ModificationTimeNs(archive_stat)) {
+    KALDI_WARN << "Not using archive index "
+               << ArchiveIndexFilename(archive_rxfilename)
+               << " as it is older than the archive.";
+    return false;
+  }
+  return true;
+}
+
+void RemoveArchiveIndex(const std::string &archive_wxfilename) {
+  std::string index_filename = ArchiveIndexFilename(archive_wxfilename);
+  struct stat index_stat;
+  if (stat(index_filename.c_str(), &index_stat) != 0)
+    return;  // No index.
+  KALDI_VLOG(1) << "Removing archive index " << index_filename
+                << ", which is out of date.";
+  std::remove(index_filename.c_str());
+}
+
+int32 KeyShard(const std::string &key, int32 num_shards) {
+  KALDI_ASSERT(num_shards > 0);
+  uint32 hash = 0;
+  for (size_t i = 0; i < key.size(); i++)
+    hash = hash * 7853 + static_cast<unsigned char>(key[i]);
+  return static_cast<int32>(hash % static_cast<uint32>(num_shards));
+}
+
+// If "option" is "shards=N" with N > 0, outputs N and returns true.
+static bool ParseShardsOption(const std::string &option, int32 *num_shards) {
+  return (option.compare(0, 7, "shards=") == 0 &&
+          ConvertStringToInteger(option.substr(7), num_shards) &&
+          *num_shards > 0);
+}
+
+std::string ShardSpecifier(const std::string &specifier, int32 shard) {
+  size_t pos = specifier.find(':');
+  KALDI_ASSERT(pos != std::string::npos && shard >= 0);
+  std::vector<std::string> split_first_part;
+  SplitStringToVector(std::string(specifier, 0, pos), ", ", false,
+                      &split_first_part);
+  std::string ans;
+  for (size_t i = 0; i < split_first_part.size(); i++) {
+    int32 num_shards;
+    if (ParseShardsOption(split_first_part[i], &num_shards)) continue;
+    if (!ans.empty()) ans += ',';
+    ans += split_first_part[i];
+  }
+  ans += ':';
+  std::ostringstream shard_str;
+  shard_str << (shard + 1);
+  std::string filenames(specifier, pos + 1);
+  for (size_t job_pos = filenames.find("JOB"); job_pos != std::string::npos;
+       job_pos = filenames.find("JOB", job_pos))
+    filenames.replace(job_pos, 3, shard_str.str());
+  return ans + filenames;
+}
+
 
 WspecifierType ClassifyWspecifier(const std::string &wspecifier,
                                   std::string *archive_wxfilename,
@@ -140,6 +276,9 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
   //  ark,scp,f:filename, wxfilename ->  kBothWspecifier
   // or:
   //  scp,t,nf:rxfilename -> kScriptWspecifier
+  // and similarly the background (bg, nbg), compress (cm, ncm) and index
+  // (idx, nidx) options, and shards=N, e.g.
+  //  ark,scp,shards=4:foo.JOB.ark,foo.scp ->  kBothWspecifier
 
   if (archive_wxfilename) archive_wxfilename->clear();
   if (script_wxfilename) script_wxfilename->clear();
@@ -155,6 +294,7 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
   // between commas.
 
   WspecifierType ws = kNoWspecifier;
+  int32 num_shards = 0;
 
   if (opts != NULL)
     *opts = WspecifierOptions(); // Make sure all the defaults are as in the
@@ -173,6 +313,20 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
       if (opts) opts->binary = false;
     } else if (!strcmp(c, "p")) {
       if (opts) opts->permissive = true;
+    } else if (!strcmp(c, "bg")) {
+      if (opts) opts->background = true;
+    } else if (!strcmp(c, "nbg")) {
+      if (opts) opts->background = false;
+    } else if (!strcmp(c, "cm")) {
+      if (opts) opts->compress = true;
+    } else if (!strcmp(c, "ncm")) {
+      if (opts) opts->compress = false;
+    } else if (!strcmp(c, "idx")) {
+      if (opts) opts->index = true;
+    } else if (!strcmp(c, "nidx")) {
+      if (opts) opts->index = false;
+    } else if (ParseShardsOption(str, &num_shards)) {
+      if (opts) opts->num_shards = num_shards;
     } else if (!strcmp(c, "ark")) {
       if (ws == kNoWspecifier) ws = kArchiveWspecifier;
       else return kNoWspecifier;  // We do not allow "scp, ark", only "ark, scp".
@@ -204,6 +358,15 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
       break;
     case kNoWspecifier: default: break;
   }
+  if (num_shards > 0) {  // The archive filename must contain JOB.
+    if (ws == kScriptWspecifier || (ws != kNoWspecifier &&
+        std::string(after_colon, 0, after_colon.find(',')).find("JOB") ==
+        std::string::npos)) {
+      if (archive_wxfilename) archive_wxfilename->clear();
+      if (script_wxfilename) script_wxfilename->clear();
+      return kNoWspecifier;
+    }
+  }
   return ws;
 }
 
@@ -219,7 +382,8 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
   // We also allow the meaningless prefixes b, and t,
   // plus the options o (once), no (not-once),
   // s (sorted) and ns (not-sorted), p (permissive)
-  // and np (not-permissive).
+  // and np (not-permissive), bg (background) and nbg (not-background),
+  // and shards=N.
   // so the following would be valid:
   //
   // f, o, b, np, ark:rxfilename  ->  kArchiveRspecifier
@@ -253,6 +417,7 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
   // between commas.
 
   RspecifierType rs = kNoRspecifier;
+  int32 num_shards = 0;
 
   for (size_t i = 0; i < split_first_part.size(); i++) {
     const std::string &str = split_first_part[i];  // e.g. "b", "t", "f", "ark", "scp".
@@ -276,6 +441,12 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       if (opts) opts->called_sorted = true;
     } else if (!strcmp(c, "ncs")) {
       if (opts) opts->called_sorted = false;
+    } else if (!strcmp(c, "bg")) {
+      if (opts) opts->background = true;
+    } else if (!strcmp(c, "nbg")) {
+      if (opts) opts->background = false;
+    } else if (ParseShardsOption(str, &num_shards)) {
+      if (opts) opts->num_shards = num_shards;
     } else if (!strcmp(c, "ark")) {
       if (rs == kNoRspecifier) rs = kArchiveRspecifier;
       else return kNoRspecifier;  // Repeated or combined ark and scp options invalid.
@@ -286,6 +457,8 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       return kNoRspecifier;  // Could not interpret this option.
     }
   }
+  if (num_shards > 0 && after_colon.find("JOB") == std::string::npos)
+    return kNoRspecifier;  // Sharded rxfilename must contain JOB.
   if ((rs == kArchiveRspecifier || rs == kScriptRspecifier)
      && wxfilename != NULL)
     *wxfilename = after_colon;
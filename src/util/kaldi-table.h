@@ -21,12 +21,15 @@
 #ifndef KALDI_UTIL_KALDI_TABLE_H_
 #define KALDI_UTIL_KALDI_TABLE_H_
 
+#include <pthread.h>
+#include <list>
 #include <string>
 #include <vector>
 #include <utility>
 
 #include "base/kaldi-common.h"
 #include "util/kaldi-holder.h"
+#include "util/stl-utils.h"
 
 namespace kaldi {
 
@@ -70,9 +73,33 @@ typedef std::vector<std::string> KeyList;
 //  p means permissive mode, when writing to an "scp" file only: will ignore
 //     missing scp entries, i.e. won't write anything for those files but will
 //     return success status).
+//  bg means background (write-behind) mode: Write() just serializes the
+//     object into memory and queues it, and a separate thread does the actual
+//     writing, so the program doesn't wait for slow disks.  The output is the
+//     same as without bg.  Write errors may only be detected on a later
+//     Write() or on Close().
+//  cm means compress: matrices (Matrix<BaseFloat> or Matrix<double>) are
+//     written in the compressed format of CompressedMatrix, which is read
+//     transparently as a Matrix.  Other types, and text-mode output, are not
+//     affected.  This implies bg, and the compression is done by the
+//     background thread.
+//  idx means write an index of the archive (see ArchiveIndexFilename()),
+//     which RandomAccessTableReader will use to seek directly to the objects.
+//     Only for archives written to an ordinary file.
+//  shards=N (N > 0) means write N archives instead of one, each written by
+//     its own background thread (as for bg), so that writing can use several
+//     disks at once.  The archive filename must contain the string JOB, which
+//     is replaced by 1, 2 ... N to give the shard filenames, and each object
+//     goes to the shard given by KeyShard(key, N).  With "ark,scp", if the
+//     script filename contains JOB, a script file is written for each shard;
+//     otherwise a single script file covering all the shards is written, in
+//     the order of writing, when the writer is closed.  Not for "scp".
 //
 //  So the following are valid wspecifiers:
 //  ark,b,f:foo
+//  ark,scp,bg,cm:feats.ark,feats.scp
+//  ark,idx:feats.ark
+//  ark,scp,shards=4:/disk1/feats.JOB.ark,feats.scp
 //  "ark,b,b:| gzip -c > foo"
 //  "ark,scp,t,nf:foo.ark,|gzip -c > foo.scp.gz"
 //  ark,b:-
@@ -113,7 +140,13 @@ struct WspecifierOptions {
   bool binary;
   bool flush;
   bool permissive; // will ignore absent scp entries.
-  WspecifierOptions(): binary(true), flush(false), permissive(false) { }
+  bool background;  // write in a background thread.
+  bool compress;  // compress matrices (implies background).
+  bool index;  // write an index of the archive.
+  int32 num_shards;  // if > 0, shard the archive over this many files.
+  WspecifierOptions(): binary(true), flush(false), permissive(false),
+                       background(false), compress(false), index(false),
+                       num_shards(0) { }
 };
 
 // ClassifyWspecifier returns the type of the wspecifier string,
@@ -156,6 +189,47 @@ bool WriteScriptFile(const std::string &wxfilename,
 bool WriteScriptFile(std::ostream &os,
                      const std::vector<std::pair<std::string, std::string> > &script);
 
+// An archive index is a text file with lines "key offset", one for each object
+// in the archive, where "offset" is the byte offset of the object in the
+// archive (i.e. just after "key ").  It is written by TableWriter if the "idx"
+// option is given, or by the program build-archive-index, and
+// RandomAccessTableReader uses it automatically, when it is present and up to
+// date, to seek directly to the objects instead of reading the archive.
+// This returns the filename of the index for the archive "archive_filename",
+// which is archive_filename + ".idx".
+std::string ArchiveIndexFilename(const std::string &archive_filename);
+
+// Reads an archive index; returns true on success.
+bool ReadArchiveIndex(const std::string &rxfilename,
+                      bool print_warnings,
+                      std::vector<std::pair<std::string, int64> > *index);
+
+// Writes an archive index; returns true on success.
+bool WriteArchiveIndex(const std::string &wxfilename,
+                       const std::vector<std::pair<std::string, int64> > &index);
+
+// Returns true if archive_rxfilename is an ordinary file (not a pipe, etc.)
+// and its index exists and was not modified before the archive was (comparing
+// the modification times in nanoseconds where the system provides them).
+bool ArchiveIndexIsUsable(const std::string &archive_rxfilename);
+
+// Removes the index of the archive archive_wxfilename, if there is one;
+// TableWriter calls this when it writes the archive without the "idx" option,
+// as the index would be out of date.
+void RemoveArchiveIndex(const std::string &archive_wxfilename);
+
+// For sharded tables (the "shards=N" option), returns the shard, from 0 to
+// num_shards - 1, that the object with this key is written to.  This is a
+// fixed hash of the key, so RandomAccessTableReader can find the shard that
+// holds a key without reading the others.
+int32 KeyShard(const std::string &key, int32 num_shards);
+
+// Returns the rspecifier or wspecifier for shard "shard" (zero-based) of a
+// sharded rspecifier or wspecifier: the "shards=N" option is removed and the
+// string JOB in the filenames is replaced by shard + 1.  E.g. shard 1 of
+// "ark,scp,shards=4:feats.JOB.ark,feats.scp" is "ark,scp:feats.2.ark,feats.scp".
+std::string ShardSpecifier(const std::string &specifier, int32 shard);
+
 // Documentation for "rspecifier"
 // "rspecifier" describes how we read a set of objects indexed by keys.
 // The possibilities are:
@@ -173,6 +247,24 @@ bool WriteScriptFile(std::ostream &os,
 //   p   means "permissive", and causes it to skip over keys whose corresponding
 //       scp-file entries cannot be read. [and to ignore errors in archives and
 //       script files, and just consider the "good" entries].
+//   bg  means "background", and (for SequentialTableReader only) causes the
+//       objects to be read ahead by a separate thread, so that reading and
+//       parsing the input overlaps with the program's own computation.
+//
+//   shards=N means the table was written with the "shards=N" option (see
+//       the wspecifier documentation): the rxfilename must contain the string
+//       JOB, which is replaced by 1, 2 ... N to give the shards, which may be
+//       archives or script files.  SequentialTableReader reads the shards in
+//       parallel, each in its own background thread, and returns the objects
+//       in key order if the s option is given (merging the shards, which must
+//       each be sorted), and otherwise takes them from the shards in turn.
+//       RandomAccessTableReader looks up each key in the shard given by
+//       KeyShard(), so N must be the same as when the table was written.
+//
+//   For RandomAccessTableReader, if an archive rxfilename is an ordinary file
+//   with an up-to-date index (see ArchiveIndexFilename()), the index is used to
+//   seek to the objects, and the options s and cs make no difference.
+//
 //       We allow the negation of the options above, as in no, ns, np,
 //       but these aren't currently very useful (just equivalent to omitting the
 //       corresponding option).
@@ -186,9 +278,11 @@ bool WriteScriptFile(std::ostream &os,
 //  So for instance the following would be a valid rspecifier:
 //
 //   "o, s, p, ark:gunzip -c foo.gz|"
+//   "s, ark, shards=4:/disk1/feats.JOB.ark"
 
 struct  RspecifierOptions {
-  // These options only make a difference for the RandomAccessTableReader class.
+  // once, sorted and called_sorted only make a difference for the
+  // RandomAccessTableReader class.
   bool once;   // we assert that the program will only ask for each key once.
   bool sorted;  // we assert that the keys are sorted.
   bool called_sorted;  // we assert that the (HasKey(), Value() functions will
@@ -198,9 +292,13 @@ struct  RspecifierOptions {
   // For archive files it will suppress errors getting thrown if the archive
   
   // is corrupted and can't be read to the end.
+  bool background;  // For SequentialTableReader: read ahead in a background
+  // thread.
+  int32 num_shards;  // If > 0, the table is sharded over this many files.
 
   RspecifierOptions(): once(false), sorted(false),
-                       called_sorted(false), permissive(false) { }
+                       called_sorted(false), permissive(false),
+                       background(false), num_shards(0) { }
 };
 
 enum RspecifierType  {
@@ -451,6 +549,94 @@ class RandomAccessTableReaderMapped {
 };
 
 
+/// This class is like RandomAccessTableReaderMapped, but it may be used from
+/// multiple threads at once, and it keeps the objects it has read in a cache
+/// whose size is limited to "cache_size" bytes (as measured by the size of the
+/// objects in binary form), discarding the least recently used objects first.
+/// Objects are read one at a time, but Value() calls for objects that are in the
+/// cache do not wait for each other or for reading.
+///
+/// Because another thread may discard an object from the cache at any time,
+/// Value() copies the object to the caller.  Note that the cache does not limit
+/// the memory used by the underlying reader; for that you should read a script
+/// file or an indexed archive, or a sorted archive (with the "s" option) if the
+/// keys are accessed in order.
+template<class Holder>
+class RandomAccessTableReaderCached {
+ public:
+  typedef typename Holder::T T;
+
+  /// "utt2spk_rxfilename" may be empty, meaning no mapping; see
+  /// RandomAccessTableReaderMapped.
+  RandomAccessTableReaderCached(const std::string &table_rxfilename,
+                                const std::string &utt2spk_rxfilename,
+                                int64 cache_size);
+
+  RandomAccessTableReaderCached();
+
+  bool Open(const std::string &table_rxfilename,
+            const std::string &utt2spk_rxfilename,
+            int64 cache_size);
+
+  /// HasKey() and Value() may be called from multiple threads.
+  bool HasKey(const std::string &key);
+
+  /// Copies the object for "key" to "value".
+  void Value(const std::string &key, T *value);
+
+  inline bool IsOpen() const { return reader_.IsOpen(); }
+
+  /// Close() and Open() must not be called while other threads are using the
+  /// reader.
+  bool Close();
+
+  ~RandomAccessTableReaderCached();
+
+ private:
+  struct CacheEntry {
+    T *object;
+    int64 size;
+    int32 num_users;  // Number of Value() calls copying the object.
+    std::list<std::string>::iterator lru_pos;
+  };
+  typedef unordered_map<std::string, CacheEntry, StringHasher> CacheType;
+
+  // Returns the key in the table, given the key asked for.
+  std::string MapKey(const std::string &key);
+
+  // Returns the cache entry for the key in the table, marked as in use, or
+  // NULL if the object is not in the cache.
+  CacheEntry *FindEntry(const std::string &table_key);
+
+  // Returns the cache entry for the key in the table, reading the object if
+  // necessary; the entry is marked as in use, so it won't be discarded until
+  // ReleaseEntry() is called.  Only reading waits for reader_mutex_.
+  CacheEntry *GetEntry(const std::string &table_key);
+
+  void ReleaseEntry(CacheEntry *entry);
+
+  // Discards least recently used objects that are not in use until the cache
+  // is small enough; requires mutex_ to be locked.
+  void Evict();
+
+  void ClearCache();
+
+  RandomAccessTableReader<Holder> reader_;
+  RandomAccessTableReader<TokenHolder> token_reader_;
+  std::string utt2spk_rxfilename_;  // Used only in diagnostic messages.
+  int64 cache_size_;
+
+  pthread_mutex_t token_mutex_;  // Protects token_reader_.
+  pthread_mutex_t reader_mutex_;  // Protects reader_.
+  pthread_mutex_t mutex_;  // Protects the members below.
+  CacheType cache_;
+  std::list<std::string> lru_;  // Keys in the cache, most recently used first.
+  int64 cur_size_;  // Total size of the objects in the cache.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(RandomAccessTableReaderCached);
+};
+
+
 /// @} end "addtogroup table_group"
 } // end namespace kaldi
 
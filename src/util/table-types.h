@@ -37,6 +37,14 @@ typedef TableWriter<KaldiObjectHolder<Matrix<BaseFloat> > >  BaseFloatMatrixWrit
 typedef SequentialTableReader<KaldiObjectHolder<Matrix<BaseFloat> > >  SequentialBaseFloatMatrixReader;
 typedef RandomAccessTableReader<KaldiObjectHolder<Matrix<BaseFloat> > >  RandomAccessBaseFloatMatrixReader;
 typedef RandomAccessTableReaderMapped<KaldiObjectHolder<Matrix<BaseFloat> > >  RandomAccessBaseFloatMatrixReaderMapped;
+typedef RandomAccessTableReaderCached<KaldiObjectHolder<Matrix<BaseFloat> > >  RandomAccessBaseFloatMatrixReaderCached;
+
+// These read matrices straight from memory-mapped files, without copying when
+// the data is aligned (see MatrixViewHolder); the Value() is a const
+// MatrixBase<BaseFloat>&.  The writer writes any MatrixBase.
+typedef TableWriter<MatrixViewHolder>  BaseFloatMatrixViewWriter;
+typedef SequentialTableReader<MatrixViewHolder>  SequentialBaseFloatMatrixViewReader;
+typedef RandomAccessTableReader<MatrixViewHolder>  RandomAccessBaseFloatMatrixViewReader;
 
 typedef TableWriter<KaldiObjectHolder<Matrix<double> > >  DoubleMatrixWriter;
 typedef SequentialTableReader<KaldiObjectHolder<Matrix<double> > >  SequentialDoubleMatrixReader;
@@ -49,6 +57,7 @@ typedef TableWriter<KaldiObjectHolder<Vector<BaseFloat> > >  BaseFloatVectorWrit
 typedef SequentialTableReader<KaldiObjectHolder<Vector<BaseFloat> > >  SequentialBaseFloatVectorReader;
 typedef RandomAccessTableReader<KaldiObjectHolder<Vector<BaseFloat> > >  RandomAccessBaseFloatVectorReader;
 typedef RandomAccessTableReaderMapped<KaldiObjectHolder<Vector<BaseFloat> > >  RandomAccessBaseFloatVectorReaderMapped;
+typedef RandomAccessTableReaderCached<KaldiObjectHolder<Vector<BaseFloat> > >  RandomAccessBaseFloatVectorReaderCached;
 
 typedef TableWriter<KaldiObjectHolder<Vector<double> > >  DoubleVectorWriter;
 typedef SequentialTableReader<KaldiObjectHolder<Vector<double> > >  SequentialDoubleVectorReader;
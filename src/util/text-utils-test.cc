@@ -170,6 +170,14 @@ void TestConvertStringToReal() {
   KALDI_ASSERT(!ConvertStringToReal("-1f", &d));
   KALDI_ASSERT(ConvertStringToReal("12345.2", &d) && fabs(d-12345.2) < 1.0);
   KALDI_ASSERT(ConvertStringToReal("1.0e+08", &d) && fabs(d-1.0e+08) < 100.0);
+  KALDI_ASSERT(ConvertStringToReal("0.0e-999", &d) && d == 0.0);
+  KALDI_ASSERT(ConvertStringToReal("-0", &d) && d == 0.0);
+  // Overflow and underflow.
+  KALDI_ASSERT(!ConvertStringToReal("1.0e+999", &d));
+  KALDI_ASSERT(!ConvertStringToReal("1.0e-999", &d));
+  KALDI_ASSERT(!ConvertStringToReal("-1.0e-999", &d));
+  KALDI_ASSERT(!ConvertStringToReal(sizeof(Real) == sizeof(float) ?
+                                    "1.0e-40" : "1.0e-310", &d));
 }
 
 
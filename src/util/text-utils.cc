@@ -159,32 +159,34 @@ bool IsLine(const std::string &line) {
   return true;
 }
 
-bool ConvertStringToReal(const std::string &str,
-                         double *out) {
-  const char *this_str = str.c_str();
-  char *end = NULL;
-  errno = 0;
-  double d = KALDI_STRTOD(this_str, &end);
-  if (end != this_str)
-    while (isspace(*end)) end++;
-  if (end == this_str || *end != '\0' || errno != 0)
+template<class Real>
+static bool ConvertStringToRealInternal(const std::string &str, Real *out) {
+  const char *this_str = str.c_str(), *begin = this_str;
+  Real r;
+  if (!ParseBasicType(&this_str, &r))
     return false;
-  *out = d;
+  if (std::abs(r) < std::numeric_limits<Real>::min()) {
+    // ParseBasicType accepts underflow, but like strtod we reject values that
+    // round to zero or to a denormal unless they are zero to begin with.
+    for (const char *p = begin; p != this_str && *p != 'e' && *p != 'E'; p++)
+      if (*p >= '1' && *p <= '9')
+        return false;
+  }
+  while (isspace(*this_str)) this_str++;
+  if (*this_str != '\0')
+    return false;
+  *out = r;
   return true;
 }
 
+bool ConvertStringToReal(const std::string &str,
+                         double *out) {
+  return ConvertStringToRealInternal(str, out);
+}
+
 bool ConvertStringToReal(const std::string &str,
                          float *out) {
-  const char *this_str = str.c_str();
-  char *end = NULL;
-  errno = 0;
-  double d = KALDI_STRTOD(this_str, &end);
-  if (end != this_str)
-    while (isspace(*end)) end++;
-  if (end == this_str || *end != '\0' || errno != 0)
-    return false;
-  *out = static_cast<float>(d);
-  return true;
+  return ConvertStringToRealInternal(str, out);
 }
 
 }  // end namespace kaldi
@@ -104,34 +104,29 @@ bool SplitStringToFloats(const std::string &full,
                          std::vector<F> *out);
 
 
-/// Converts a string into an integer via strtoll and
-/// returns false if there was any kind of problem (i.e. the string was not an
-/// integer or contained extra non-whitespace junk, or the integer was too large to fit into the
-/// type it is being converted into.
+/// Converts a string into an integer via ParseBasicType() (see
+/// base/io-funcs.h) and returns false if there was any kind of problem (i.e. the
+/// string was not an integer or contained extra non-whitespace junk, or the
+/// integer was too large to fit into the type it is being converted into.
 template<class Int>
 bool ConvertStringToInteger(const std::string &str,
                             Int *out) {
   KALDI_ASSERT_IS_INTEGER_TYPE(Int);
   const char *this_str = str.c_str();
-  char *end = NULL;
-  errno = 0;
-  long long int i = KALDI_STRTOLL(this_str, &end);
-  if (end != this_str)
-    while (isspace(*end)) end++;
-  if (end == this_str || *end != '\0' || errno != 0)
+  Int i;
+  if (!ParseBasicType(&this_str, &i))
     return false;
-  Int iInt = static_cast<Int>(i);
-  if (static_cast<long long int>(iInt) != i || (i<0 && !std::numeric_limits<Int>::is_signed)) {
+  while (isspace(*this_str)) this_str++;
+  if (*this_str != '\0')
     return false;
-  }
-  *out = iInt;
+  *out = i;
   return true;
 }
 
 
-/// ConvertStringToReal converts a string into either float or double via strtod,
-/// and returns false if there was any kind of problem (i.e. the string was not a
-/// floating point number or contained extra non-whitespace junk.
+/// ConvertStringToReal converts a string into either float or double via
+/// ParseBasicType(), and returns false if there was any kind of problem (i.e. the string was not a
+/// floating point number, was out of range for the type, or contained extra non-whitespace junk).
 bool ConvertStringToReal(const std::string &str,
                          double *out);
 bool ConvertStringToReal(const std::string &str,